@@ -0,0 +1,115 @@
+#version 440 core
+
+// maximum number of materials in the material uniform buffer,
+// must match SceneManager
+#define MAX_MATERIALS 256
+// maximum number of lights in the light uniform buffer,
+// must match LightManager
+#define MAX_LIGHTS 256
+
+out vec4 outFragmentColor;
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+// color of the drawn instance, used when there is no texture
+flat in vec4 fragmentObjectColor;
+// layer of the texture array, negative for no texture
+flat in float fragmentTextureLayer;
+
+// std140 packing - each vec3 shares its 16 bytes with the float after it
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	float shininess;
+	vec3 specularColor;
+	float opacity;
+};
+
+// std140 packing, same as LightManager::LIGHT_SOURCE
+struct LightSource
+{
+	vec3 position;
+	float focalStrength;
+	vec3 ambientColor;
+	float specularIntensity;
+	vec3 diffuseColor;
+	float padding0;
+	vec3 specularColor;
+	float padding1;
+};
+
+// all the defined materials, uploaded once when the scene is prepared
+layout (std140, binding = 0) uniform MaterialBlock
+{
+	Material materials[MAX_MATERIALS];
+};
+
+// the scene lights, of which the first lightCount are in use
+layout (std140, binding = 1) uniform LightBlock
+{
+	LightSource lightSources[MAX_LIGHTS];
+};
+
+uniform bool bUseTexture = false;
+uniform bool bUseLighting = false;
+// texture array holding the textures of the drawn objects
+uniform sampler2DArray objectTexture;
+uniform vec3 viewPosition;
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+uniform int lightCount = 0;
+// index of the material of the drawn object
+uniform int materialIndex = 0;
+
+vec3 CalculateLightSource(LightSource lightSource, Material material, vec3 lightNormal, vec3 viewDirection);
+
+void main()
+{
+	vec4 baseColor = fragmentObjectColor;
+	if ((bUseTexture == true) && (fragmentTextureLayer >= 0.0f))
+	{
+		baseColor = texture(objectTexture, vec3(fragmentTextureCoordinate * UVscale, fragmentTextureLayer));
+	}
+
+	// the material opacity applies with and without lighting, as
+	// it decides whether the object is drawn in the transparent pass
+	Material material = materials[materialIndex];
+	if (bUseLighting == true)
+	{
+		vec3 lightNormal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+		vec3 phongResult = vec3(0.0f);
+
+		for (int i = 0; i < lightCount; i++)
+		{
+			phongResult += CalculateLightSource(lightSources[i], material, lightNormal, viewDirection);
+		}
+
+		outFragmentColor = vec4(phongResult * baseColor.rgb, baseColor.a * material.opacity);
+	}
+	else
+	{
+		outFragmentColor = vec4(baseColor.rgb, baseColor.a * material.opacity);
+	}
+}
+
+// Phong lighting of the fragment by one light source
+vec3 CalculateLightSource(LightSource lightSource, Material material, vec3 lightNormal, vec3 viewDirection)
+{
+	// ambient lighting
+	vec3 ambient = lightSource.ambientColor * material.ambientColor * material.ambientStrength;
+
+	// diffuse lighting
+	vec3 lightDirection = normalize(lightSource.position - fragmentPosition);
+	float impact = max(dot(lightNormal, lightDirection), 0.0f);
+	vec3 diffuse = impact * lightSource.diffuseColor * material.diffuseColor;
+
+	// specular lighting, sharpened by both the light focus and the material shininess
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), max(lightSource.focalStrength, material.shininess));
+	vec3 specular = lightSource.specularIntensity * specularComponent * lightSource.specularColor * material.specularColor;
+
+	return(ambient + diffuse + specular);
+}
@@ -0,0 +1,33 @@
+#version 440 core
+
+// vertex attributes of the basic shape meshes
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+// per-instance values, the model matrix takes locations 3 to 6
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in vec4 inInstanceColor;
+// layer of the texture array, negative for no texture
+layout (location = 8) in float inInstanceTextureLayer;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out vec4 fragmentObjectColor;
+flat out float fragmentTextureLayer;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+	// transform the vertex into world space and then into clip space
+	vec4 worldPosition = inInstanceModel * vec4(inVertexPosition, 1.0f);
+	gl_Position = projection * view * worldPosition;
+
+	fragmentPosition = vec3(worldPosition);
+	fragmentVertexNormal = mat3(transpose(inverse(inInstanceModel))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+	fragmentObjectColor = inInstanceColor;
+	fragmentTextureLayer = inInstanceTextureLayer;
+}
@@ -0,0 +1,287 @@
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE, malloc, free
+#include <cstring>          // strcmp
+#include <atomic>           // allocation counter
+#include <new>              // std::bad_alloc
+
+#include <GL/glew.h>        // GLEW library
+#include "GLFW/glfw3.h"     // GLFW library
+
+#include "ViewManager.h"
+#include "ShaderManager.h"
+#include "Benchmarks.h"
+
+// Namespace for declaring global variables
+namespace
+{
+	const char* const WINDOW_TITLE = "Scene Benchmark";
+
+	// frames measured per scene when no count is given
+	const int g_DefaultFrameCount = 120;
+
+	// calls of operator new on any thread, for checking that the
+	// frames make no heap allocations
+	std::atomic<unsigned long long> g_AllocationCount(0);
+
+	/***********************************************************
+	 *  GetAllocationCount()
+	 *
+	 *  This function is used for reading the allocation counter.
+	 ***********************************************************/
+	unsigned long long GetAllocationCount()
+	{
+		return(g_AllocationCount.load(std::memory_order_relaxed));
+	}
+}
+
+/***********************************************************
+ *  operator new(size_t)
+ *
+ *  This function replaces the global operator new of the
+ *  benchmark, counting every call.  The array and sized
+ *  forms end up here and in operator delete as well.
+ ***********************************************************/
+void* operator new(std::size_t size)
+{
+	g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* pMemory = malloc((size > 0) ? size : 1);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+/***********************************************************
+ *  operator delete(void*)
+ *
+ *  This function frees the memory of the counting operator
+ *  new.
+ ***********************************************************/
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+/***********************************************************
+ *  operator delete(void*, size_t)
+ *
+ *  This function frees the memory of the counting operator
+ *  new when the size is passed in, which malloc does not
+ *  need.
+ ***********************************************************/
+void operator delete(void* pMemory, std::size_t size) noexcept
+{
+	(void)size;
+	free(pMemory);
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the benchmark has been
+ *  launched.  It creates a hidden window for an OpenGL
+ *  context, loads the shaders and renders the generated
+ *  benchmark scenes, writing the results as JSON.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	int frameCount = g_DefaultFrameCount;
+	const char* outputFilename = NULL;
+	bool bRecordScaling = false;
+	bool bPipeline = false;
+	bool bStreaming = false;
+	bool bAllocations = false;
+	bool bTransformCache = false;
+	bool bLights = false;
+	bool bTransforms = false;
+	bool bBvh = false;
+	bool bJobs = false;
+	// time loading textures, from this image file or from a
+	// generated one when it is not given
+	bool bTextures = false;
+	const char* imageFilename = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		bool bHasValue = (i + 1 < argc);
+		if ((strcmp(argv[i], "--frames") == 0) && (bHasValue == true))
+		{
+			frameCount = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--output") == 0) && (bHasValue == true))
+		{
+			outputFilename = argv[++i];
+		}
+		else if (strcmp(argv[i], "--record-scaling") == 0)
+		{
+			bRecordScaling = true;
+		}
+		else if (strcmp(argv[i], "--pipeline") == 0)
+		{
+			bPipeline = true;
+		}
+		else if (strcmp(argv[i], "--streaming") == 0)
+		{
+			bStreaming = true;
+		}
+		else if (strcmp(argv[i], "--allocations") == 0)
+		{
+			bAllocations = true;
+		}
+		else if (strcmp(argv[i], "--transform-cache") == 0)
+		{
+			bTransformCache = true;
+		}
+		else if (strcmp(argv[i], "--lights") == 0)
+		{
+			bLights = true;
+		}
+		else if (strcmp(argv[i], "--transforms") == 0)
+		{
+			bTransforms = true;
+		}
+		else if (strcmp(argv[i], "--bvh") == 0)
+		{
+			bBvh = true;
+		}
+		else if (strcmp(argv[i], "--jobs") == 0)
+		{
+			bJobs = true;
+		}
+		else if (strcmp(argv[i], "--textures") == 0)
+		{
+			bTextures = true;
+		}
+		else if ((strcmp(argv[i], "--image") == 0) && (bHasValue == true))
+		{
+			imageFilename = argv[++i];
+		}
+		else
+		{
+			std::cout << "Usage: " << argv[0] << " [--frames N] [--output FILE] [--record-scaling | --pipeline | --streaming | --allocations |\n"
+				<< "       --transform-cache | --lights | --transforms | --bvh | --jobs | --textures [--image FILE]]\n"
+				<< "  --frames N        frames measured per scene (" << g_DefaultFrameCount << ")\n"
+				<< "  --output FILE     write the JSON results to FILE instead of the output\n"
+				<< "  --record-scaling  time recording the draws with 1 to 16 threads instead\n"
+				<< "  --pipeline        time frames with pipelining off and on instead\n"
+				<< "  --streaming       time streaming the instances through mapped buffers instead\n"
+				<< "  --allocations     count the heap allocations of every frame instead\n"
+				<< "  --transform-cache time the cached model matrices against building them per draw instead\n"
+				<< "  --lights          time uploading 1, 16 and 256 lights instead\n"
+				<< "  --transforms      time building model matrices with every SIMD kernel and with glm instead\n"
+				<< "  --bvh             time the bounding volume hierarchy instead\n"
+				<< "  --jobs            stress test and time the job system instead\n"
+				<< "  --textures        time loading, storing and streaming textures instead\n"
+				<< "  --image FILE      image file the texture benchmark loads" << std::endl;
+			return(EXIT_FAILURE);
+		}
+	}
+	if (frameCount <= 0)
+	{
+		std::cout << "The frame count must be positive" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	// the CPU benchmarks run without an OpenGL context
+	if (bTransforms == true)
+	{
+		return((Benchmarks::RunTransformKernelBenchmark() == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	if (bBvh == true)
+	{
+		Benchmarks::RunBvhBenchmark();
+		return(EXIT_SUCCESS);
+	}
+	if (bJobs == true)
+	{
+		return((Benchmarks::RunJobSystemBenchmark() == true) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// the benchmark renders offscreen, as --headless does
+#ifdef GLFW_PLATFORM_NULL
+	glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	// the renderer needs OpenGL 4.4, which macOS does not have
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+	ShaderManager* pShaderManager = new ShaderManager();
+	ViewManager* pViewManager = new ViewManager(pShaderManager);
+	if (pViewManager->CreateHeadlessWindow(WINDOW_TITLE, 1, 1) == NULL)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	GLenum GLEWInitResult = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLEW built for GLX loads the OpenGL functions before it
+	// looks for an X display, which headless EGL contexts lack
+	if (GLEW_ERROR_NO_GLX_DISPLAY == GLEWInitResult)
+	{
+		GLEWInitResult = GLEW_OK;
+	}
+#endif
+	if (GLEW_OK != GLEWInitResult)
+	{
+		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
+		return(EXIT_FAILURE);
+	}
+	if (GLEW_VERSION_4_4 == GL_FALSE)
+	{
+		std::cout << "OpenGL 4.4 or newer is required, the context provides " << glGetString(GL_VERSION) << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	pShaderManager->LoadShaders(
+		"Shaders/vertexShader.glsl",
+		"Shaders/fragmentShader.glsl");
+	pShaderManager->use();
+
+	bool bBenchmarked = false;
+	if (bRecordScaling == true)
+	{
+		bBenchmarked = Benchmarks::RunRecordScalingBenchmark(pShaderManager, frameCount, outputFilename);
+	}
+	else if (bPipeline == true)
+	{
+		bBenchmarked = Benchmarks::RunPipelineBenchmark(pShaderManager, frameCount, outputFilename);
+	}
+	else if (bStreaming == true)
+	{
+		bBenchmarked = Benchmarks::RunStreamingBufferBenchmark(frameCount, outputFilename);
+	}
+	else if (bAllocations == true)
+	{
+		bBenchmarked = Benchmarks::RunAllocationBenchmark(pShaderManager, frameCount, GetAllocationCount);
+	}
+	else if (bTransformCache == true)
+	{
+		bBenchmarked = Benchmarks::RunTransformCacheBenchmark(frameCount, outputFilename);
+	}
+	else if (bLights == true)
+	{
+		bBenchmarked = Benchmarks::RunLightBenchmark(frameCount, outputFilename);
+	}
+	else if (bTextures == true)
+	{
+		bBenchmarked = Benchmarks::RunTextureBenchmark(imageFilename) &&
+			Benchmarks::RunTextureArrayBenchmark() &&
+			Benchmarks::RunTextureStreamingBenchmark();
+	}
+	else
+	{
+		bBenchmarked = Benchmarks::RunSceneBenchmark(pShaderManager, frameCount, outputFilename);
+	}
+
+	delete pViewManager;
+	delete pShaderManager;
+	glfwTerminate();
+
+	return(bBenchmarked ? EXIT_SUCCESS : EXIT_FAILURE);
+}
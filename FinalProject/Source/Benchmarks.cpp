@@ -0,0 +1,2398 @@
+#include "Benchmarks.h"
+#include "SceneBVH.h"
+#include "CullingKernels.h"
+#include "TextureLoader.h"
+#include "TextureArrayManager.h"
+#include "TextureStreamer.h"
+#include "ImageWriter.h"
+#include "SceneManager.h"
+#include "SceneDescription.h"
+#include "OffscreenTarget.h"
+#include "JobSystem.h"
+#include "LightManager.h"
+#include "StreamingBuffer.h"
+#include "TransformCache.h"
+#include "TransformKernels.h"
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// object counts of the generated scenes
+	const int g_BvhSceneSizes[] = { 1000, 10000, 100000 };
+	// seed of the generated scenes
+	const unsigned int g_RandomSeed = 330;
+	// camera directions the frustum queries are averaged over
+	const int g_FrustumQueries = 16;
+	// far plane distances of the frustum queries, relative to
+	// the scene size, for seeing much and little of the scene
+	const float g_FrustumFarScales[] = { 0.5f, 0.1f };
+	// rays the ray queries are averaged over
+	const int g_RayQueries = 1000;
+	// part of the objects moved before refitting
+	const float g_MovedFraction = 0.1f;
+	// texture counts loaded at startup
+	const int g_TextureCounts[] = { 3, 16, 64 };
+	// size of the generated texture image
+	const int g_TextureImageSize = 1024;
+	// generated texture image, written for the benchmark and
+	// removed again
+	const char* g_GeneratedImageFilename = "benchmark_texture.png";
+	// textures stored in the texture arrays
+	const int g_TextureArrayTextureCount = 4096;
+	// sizes most of them share, and one texture in this many
+	// has one of the odd sizes instead
+	const int g_TextureArrayCommonSizes[] = { 64, 128, 256 };
+	const int g_TextureArrayOddSizeInterval = 64;
+	const int g_TextureArrayOddSizeCount = 20;
+	// streamed textures, their size, and the memory budget they
+	// are streamed within, a third of their full size
+	const int g_StreamingTextureCount = 64;
+	const int g_StreamingTextureSize = 512;
+	const size_t g_StreamingMemoryBudget = 4 * 1024 * 1024;
+	// frames the camera takes to pass all the textures, and the
+	// textures in view at once
+	const int g_StreamingFrames = 600;
+	const int g_StreamingVisibleTextures = 8;
+	// object counts of the rendered scenes
+	const int g_RenderSceneSizes[] = { 100, 10000, 1000000 };
+	// size of the rendered frames
+	const int g_RenderWidth = 1280;
+	const int g_RenderHeight = 720;
+	// frames rendered before the measured ones, while the
+	// buffers and caches settle
+	const int g_RenderWarmupFrames = 10;
+	// distance between the objects, which stand on a grid, and
+	// how far they are moved off it
+	const float g_RenderObjectSpacing = 2.0f;
+	const float g_RenderObjectJitter = 0.4f;
+	// camera path circling the middle of every scene, with a far
+	// plane that keeps about the same number of objects in view
+	// in the larger scenes
+	const float g_RenderOrbitRadius = 20.0f;
+	const float g_RenderOrbitHeight = 10.0f;
+	const float g_RenderFieldOfView = 45.0f;
+	const float g_RenderFarPlane = 100.0f;
+	// meshes and materials the objects are drawn with, one object
+	// in this many is glass and drawn in the transparent pass
+	const SceneDescription::MESH_ID g_RenderMeshes[] = {
+		SceneDescription::MESH_PLANE, SceneDescription::MESH_BOX, SceneDescription::MESH_CYLINDER,
+		SceneDescription::MESH_CONE, SceneDescription::MESH_TORUS };
+	const char* const g_RenderMaterials[] = { "plastic", "felt_wool", "leather", "wood", "metal", "matte" };
+	const int g_RenderGlassInterval = 10;
+	// objects of the scene the draws are recorded for with 1 to
+	// 16 threads, seen from the same camera path looking level
+	// across the scene, with a far plane past its edges
+	const int g_RecordScalingObjects = 200000;
+	const int g_RecordScalingThreads[] = { 1, 2, 4, 8, 16 };
+	const float g_RecordScalingFarPlane = 1000.0f;
+	// objects of the scene rendered with pipelining off and on,
+	// seen from the camera path of the scene benchmark
+	const int g_PipelineObjects = 200000;
+	// instances streamed per frame, each frame into its own
+	// block of a ring holding the frames in flight
+	const int g_StreamingInstances[] = { 1000, 10000, 200000 };
+	const int g_StreamingFramesInFlight = 3;
+	// objects whose model matrices every frame draws with, and
+	// the part of them moved every frame
+	const int g_TransformCacheSizes[] = { 1000, 10000, 100000 };
+	const float g_TransformMovedFraction = 0.01f;
+	// objects whose model matrices the kernels build, the
+	// matrices built per timing, repeating the smaller batch,
+	// and the largest difference from the glm matrices allowed
+	const int g_TransformKernelSizes[] = { 1000, 100000 };
+	const int g_TransformKernelMatrices = 4000000;
+	const float g_TransformKernelTolerance = 1.0e-4f;
+	// lights in the light buffer, up to the most it holds, and
+	// the binding point it is bound to
+	const int g_LightCounts[] = { 1, 16, LightManager::MAX_LIGHTS };
+	const GLuint g_LightBenchmarkBinding = 1;
+	// object counts of the scenes whose frames are checked for
+	// heap allocations
+	const int g_AllocationSceneSizes[] = { 100, 10000 };
+	// rounds of every job system stress test, the most tasks of
+	// a stressed parallel loop, the shape of the stressed job
+	// trees, the length of the continuation chains, and the
+	// background jobs queued during the loops
+	const int g_StressRounds = 200;
+	const int g_StressMaxTasks = 5000;
+	const int g_StressTreeFanout = 4;
+	const int g_StressTreeDepth = 5;
+	const int g_StressChainLength = 64;
+	const int g_StressBackgroundJobs = 64;
+	// empty jobs timed per batch and batches, and tasks of the
+	// timed parallel loop
+	const int g_OverheadBatchJobs = 1000;
+	const int g_OverheadBatches = 200;
+	const int g_OverheadLoopTasks = 1000000;
+	// threads the job system is tested and timed with
+	const int g_JobSystemThreads[] = { 1, 2, 4, 8 };
+
+	typedef std::chrono::steady_clock Clock;
+
+	// measurements of rendering one generated scene
+	struct RENDER_RESULT
+	{
+		int objectCount;
+		double generateMs;
+		double prepareMs;
+		// time spent in RenderScene, per measured frame
+		double submitAverageMs;
+		double submitP50Ms;
+		double submitP95Ms;
+		double submitMaxMs;
+		double framesPerSecond;
+		// counters per measured frame
+		double visibleObjects;
+		double drawCalls;
+		double drawCommands;
+		double passChanges;
+		double textureChanges;
+		double materialChanges;
+		double uniformUploads;
+		double uniformUploadsSkipped;
+	};
+
+	// time recording the draws of the scaling scene takes with
+	// a number of threads
+	struct RECORD_RESULT
+	{
+		int threadCount;
+		double recordAverageMs;
+		double recordP50Ms;
+		double recordMaxMs;
+		// average time with one thread over the average time
+		double speedup;
+	};
+
+	// frame times and latency of rendering the pipeline scene
+	// with pipelining off or on
+	struct PIPELINE_RESULT
+	{
+		bool bPipelined;
+		// time from the start of one frame to the next
+		double frameAverageMs;
+		double frameP50Ms;
+		double frameP95Ms;
+		// time from the camera of a frame being set to the frame
+		// being submitted
+		double latencyAverageMs;
+		double latencyP95Ms;
+		double framesPerSecond;
+	};
+
+	// ways of streaming the instances of every frame
+	enum STREAMING_MODE
+	{
+		STREAMING_BUFFER_SUBDATA,
+		STREAMING_ORPHANED,
+		STREAMING_PERSISTENT,
+		STREAMING_MODE_COUNT
+	};
+
+	// throughput of streaming a number of instances per frame
+	// one way
+	struct STREAMING_RESULT
+	{
+		int mode;
+		int instanceCount;
+		// persistently mapped, when buffer storage is supported
+		bool bPersistent;
+		double frameMegabytes;
+		// time spent writing the instances, per frame
+		double uploadAverageMs;
+		double megabytesPerSecond;
+		unsigned int fenceWaits;
+		unsigned int orphans;
+	};
+
+	// time getting the model matrices of every object for a
+	// frame, built for every draw or read from the cache
+	struct TRANSFORM_CACHE_RESULT
+	{
+		int objectCount;
+		// built from the values of every object for every draw, as
+		// SetTransformations() did
+		double perDrawMs;
+		// read from the cache with no object moved, and with some
+		// of them moved and rebuilt first
+		double cachedMs;
+		int movedObjects;
+		double movedMs;
+		// time per draw over time from the cache
+		double speedup;
+		// largest difference of a cached matrix element from the
+		// one built per draw
+		float maxError;
+	};
+
+	// time uploading the lights of a frame, with some of them
+	// moved every frame
+	struct LIGHT_RESULT
+	{
+		int lightCount;
+		int movedLights;
+		// CPU time of LightManager::Update(), per frame
+		double updateAverageUs;
+		double updateP95Us;
+		double uploadsPerFrame;
+		double bytesPerFrame;
+	};
+
+	// objects of a generated scene, as boxes and as the spheres
+	// enclosing them
+	struct BENCHMARK_SCENE
+	{
+		std::vector<glm::vec3> boundsMin;
+		std::vector<glm::vec3> boundsMax;
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+		float size;
+	};
+
+	/***********************************************************
+	 *  GetMilliseconds()
+	 *
+	 *  Get the time since a start point in milliseconds.
+	 ***********************************************************/
+	double GetMilliseconds(Clock::time_point start)
+	{
+		return(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+	}
+
+	/***********************************************************
+	 *  GenerateRenderScene()
+	 *
+	 *  Stand colored objects of every mesh and material on a
+	 *  square grid around the origin, so every scene is equally
+	 *  dense, each moved, turned and sized a little at random.
+	 ***********************************************************/
+	void GenerateRenderScene(int objectCount, std::mt19937& random, SceneDescription& scene)
+	{
+		int gridSize = (int)std::ceil(std::sqrt((float)objectCount));
+		std::uniform_int_distribution<int> pickMesh(0, (int)(sizeof(g_RenderMeshes) / sizeof(g_RenderMeshes[0])) - 1);
+		std::uniform_int_distribution<int> pickMaterial(0, (int)(sizeof(g_RenderMaterials) / sizeof(g_RenderMaterials[0])) - 1);
+		std::uniform_real_distribution<float> jitter(-g_RenderObjectJitter, g_RenderObjectJitter);
+		std::uniform_real_distribution<float> size(0.3f, 0.8f);
+		std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+		std::uniform_real_distribution<float> color(0.2f, 1.0f);
+
+		for (int i = 0; i < objectCount; i++)
+		{
+			SceneDescription::DRAW_RECORD record;
+			record.meshID = (uint32_t)g_RenderMeshes[pickMesh(random)];
+			record.color[0] = color(random);
+			record.color[1] = color(random);
+			record.color[2] = color(random);
+			record.color[3] = 1.0f;
+
+			float scale = size(random);
+			record.scaleXYZ[0] = scale;
+			record.scaleXYZ[1] = scale;
+			record.scaleXYZ[2] = scale;
+			record.rotationDegreesXYZ[0] = 0.0f;
+			record.rotationDegreesXYZ[1] = angle(random);
+			record.rotationDegreesXYZ[2] = 0.0f;
+			record.positionXYZ[0] = ((i % gridSize) - gridSize * 0.5f) * g_RenderObjectSpacing + jitter(random);
+			record.positionXYZ[1] = scale * 0.5f;
+			record.positionXYZ[2] = ((i / gridSize) - gridSize * 0.5f) * g_RenderObjectSpacing + jitter(random);
+
+			const char* material = ((i % g_RenderGlassInterval) == 0) ? "glass" : g_RenderMaterials[pickMaterial(random)];
+			scene.AddRecord(record, material, "");
+		}
+	}
+
+	/***********************************************************
+	 *  WriteRenderResults()
+	 *
+	 *  Write the results of the scene benchmark as JSON, with
+	 *  the settings and renderer they were measured with.
+	 ***********************************************************/
+	void WriteRenderResults(std::ostream& output, const std::vector<RENDER_RESULT>& results, int frameCount)
+	{
+		output << std::fixed << std::setprecision(4);
+		output << "{\n"
+			<< "  \"benchmark\": \"scenes\",\n"
+#ifdef NDEBUG
+			<< "  \"build\": \"release\",\n"
+#else
+			<< "  \"build\": \"debug\",\n"
+#endif
+			<< "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+			<< "  \"glVersion\": \"" << glGetString(GL_VERSION) << "\",\n"
+			<< "  \"seed\": " << g_RandomSeed << ",\n"
+			<< "  \"width\": " << g_RenderWidth << ",\n"
+			<< "  \"height\": " << g_RenderHeight << ",\n"
+			<< "  \"frames\": " << frameCount << ",\n"
+			<< "  \"warmupFrames\": " << g_RenderWarmupFrames << ",\n"
+			<< "  \"scenes\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const RENDER_RESULT& result = results[i];
+			output << ((i == 0) ? "\n" : ",\n")
+				<< "    {\n"
+				<< "      \"objects\": " << result.objectCount << ",\n"
+				<< "      \"generateMs\": " << result.generateMs << ",\n"
+				<< "      \"prepareMs\": " << result.prepareMs << ",\n"
+				<< "      \"cpuSubmitMs\": { \"average\": " << result.submitAverageMs << ", \"p50\": " << result.submitP50Ms
+				<< ", \"p95\": " << result.submitP95Ms << ", \"max\": " << result.submitMaxMs << " },\n"
+				<< "      \"framesPerSecond\": " << result.framesPerSecond << ",\n"
+				<< "      \"visibleObjectsPerFrame\": " << result.visibleObjects << ",\n"
+				<< "      \"drawCallsPerFrame\": " << result.drawCalls << ",\n"
+				<< "      \"drawCommandsPerFrame\": " << result.drawCommands << ",\n"
+				<< "      \"stateChangesPerFrame\": " << (result.passChanges + result.textureChanges + result.materialChanges) << ",\n"
+				<< "      \"passChangesPerFrame\": " << result.passChanges << ",\n"
+				<< "      \"textureChangesPerFrame\": " << result.textureChanges << ",\n"
+				<< "      \"materialChangesPerFrame\": " << result.materialChanges << ",\n"
+				<< "      \"uniformUploadsPerFrame\": " << result.uniformUploads << ",\n"
+				<< "      \"uniformUploadsSkippedPerFrame\": " << result.uniformUploadsSkipped << "\n"
+				<< "    }";
+		}
+		output << "\n  ]\n}\n";
+	}
+
+	/***********************************************************
+	 *  WriteRecordResults()
+	 *
+	 *  Write the results of the record scaling benchmark as
+	 *  JSON, with the settings they were measured with.
+	 ***********************************************************/
+	void WriteRecordResults(std::ostream& output, const std::vector<RECORD_RESULT>& results, int frameCount, double visibleObjects)
+	{
+		output << std::fixed << std::setprecision(4);
+		output << "{\n"
+			<< "  \"benchmark\": \"record_scaling\",\n"
+#ifdef NDEBUG
+			<< "  \"build\": \"release\",\n"
+#else
+			<< "  \"build\": \"debug\",\n"
+#endif
+			<< "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+			<< "  \"seed\": " << g_RandomSeed << ",\n"
+			<< "  \"objects\": " << g_RecordScalingObjects << ",\n"
+			<< "  \"visibleObjectsPerFrame\": " << visibleObjects << ",\n"
+			<< "  \"frames\": " << frameCount << ",\n"
+			<< "  \"warmupFrames\": " << g_RenderWarmupFrames << ",\n"
+			<< "  \"threads\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const RECORD_RESULT& result = results[i];
+			output << ((i == 0) ? "\n" : ",\n")
+				<< "    { \"threads\": " << result.threadCount
+				<< ", \"cpuRecordMs\": { \"average\": " << result.recordAverageMs << ", \"p50\": " << result.recordP50Ms
+				<< ", \"max\": " << result.recordMaxMs << " }, \"speedup\": " << result.speedup << " }";
+		}
+		output << "\n  ]\n}\n";
+	}
+
+	/***********************************************************
+	 *  WritePipelineResults()
+	 *
+	 *  Write the results of the pipeline benchmark as JSON,
+	 *  with the settings they were measured with.
+	 ***********************************************************/
+	void WritePipelineResults(std::ostream& output, const std::vector<PIPELINE_RESULT>& results, int frameCount)
+	{
+		output << std::fixed << std::setprecision(4);
+		output << "{\n"
+			<< "  \"benchmark\": \"pipeline\",\n"
+#ifdef NDEBUG
+			<< "  \"build\": \"release\",\n"
+#else
+			<< "  \"build\": \"debug\",\n"
+#endif
+			<< "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+			<< "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n"
+			<< "  \"seed\": " << g_RandomSeed << ",\n"
+			<< "  \"objects\": " << g_PipelineObjects << ",\n"
+			<< "  \"width\": " << g_RenderWidth << ",\n"
+			<< "  \"height\": " << g_RenderHeight << ",\n"
+			<< "  \"frames\": " << frameCount << ",\n"
+			<< "  \"warmupFrames\": " << g_RenderWarmupFrames << ",\n"
+			<< "  \"modes\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const PIPELINE_RESULT& result = results[i];
+			output << ((i == 0) ? "\n" : ",\n")
+				<< "    { \"pipelined\": " << (result.bPipelined ? "true" : "false")
+				<< ", \"frameMs\": { \"average\": " << result.frameAverageMs << ", \"p50\": " << result.frameP50Ms
+				<< ", \"p95\": " << result.frameP95Ms << " }, \"latencyMs\": { \"average\": " << result.latencyAverageMs
+				<< ", \"p95\": " << result.latencyP95Ms << " }, \"framesPerSecond\": " << result.framesPerSecond << " }";
+		}
+		output << "\n  ]";
+		// pipelining on against off, the first mode being off
+		if (results.size() == 2)
+		{
+			output << ",\n  \"pipelinedOverSequential\": { \"frameMsSaved\": "
+				<< (results[0].frameAverageMs - results[1].frameAverageMs)
+				<< ", \"frameSpeedup\": " << ((results[1].frameAverageMs > 0.0) ? (results[0].frameAverageMs / results[1].frameAverageMs) : 0.0)
+				<< ", \"latencyMsAdded\": " << (results[1].latencyAverageMs - results[0].latencyAverageMs) << " }";
+		}
+		output << "\n}\n";
+	}
+
+	/***********************************************************
+	 *  GetStreamingModeName()
+	 *
+	 *  Get the name of a way of streaming, as written to the
+	 *  results.
+	 ***********************************************************/
+	const char* GetStreamingModeName(int mode)
+	{
+		switch (mode)
+		{
+		case STREAMING_BUFFER_SUBDATA:
+			return("bufferSubData");
+		case STREAMING_ORPHANED:
+			return("orphaned");
+		default:
+			return("persistent");
+		}
+	}
+
+	/***********************************************************
+	 *  WriteStreamingResults()
+	 *
+	 *  Write the results of the streaming buffer benchmark as
+	 *  JSON, with the settings they were measured with.
+	 ***********************************************************/
+	void WriteStreamingResults(std::ostream& output, const std::vector<STREAMING_RESULT>& results, int frameCount)
+	{
+		output << std::fixed << std::setprecision(4);
+		output << "{\n"
+			<< "  \"benchmark\": \"streaming\",\n"
+#ifdef NDEBUG
+			<< "  \"build\": \"release\",\n"
+#else
+			<< "  \"build\": \"debug\",\n"
+#endif
+			<< "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+			<< "  \"instanceBytes\": " << sizeof(MeshLibrary::INSTANCE_DATA) << ",\n"
+			<< "  \"framesInFlight\": " << g_StreamingFramesInFlight << ",\n"
+			<< "  \"frames\": " << frameCount << ",\n"
+			<< "  \"warmupFrames\": " << g_RenderWarmupFrames << ",\n"
+			<< "  \"runs\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const STREAMING_RESULT& result = results[i];
+			output << ((i == 0) ? "\n" : ",\n")
+				<< "    { \"mode\": \"" << GetStreamingModeName(result.mode) << "\", \"persistent\": "
+				<< (result.bPersistent ? "true" : "false") << ", \"instances\": " << result.instanceCount
+				<< ", \"frameMegabytes\": " << result.frameMegabytes << ", \"cpuUploadMs\": " << result.uploadAverageMs
+				<< ", \"megabytesPerSecond\": " << result.megabytesPerSecond << ", \"fenceWaits\": " << result.fenceWaits
+				<< ", \"orphans\": " << result.orphans << " }";
+		}
+		output << "\n  ]\n}\n";
+	}
+
+	/***********************************************************
+	 *  WriteTransformCacheResults()
+	 *
+	 *  Write the results of the transform cache benchmark as
+	 *  JSON, with the settings they were measured with.
+	 ***********************************************************/
+	void WriteTransformCacheResults(std::ostream& output, const std::vector<TRANSFORM_CACHE_RESULT>& results, int frameCount)
+	{
+		output << std::fixed << std::setprecision(4);
+		output << "{\n"
+			<< "  \"benchmark\": \"transformCache\",\n"
+#ifdef NDEBUG
+			<< "  \"build\": \"release\",\n"
+#else
+			<< "  \"build\": \"debug\",\n"
+#endif
+			<< "  \"frames\": " << frameCount << ",\n"
+			<< "  \"movedFraction\": " << g_TransformMovedFraction << ",\n"
+			<< "  \"scenes\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const TRANSFORM_CACHE_RESULT& result = results[i];
+			output << ((i == 0) ? "\n" : ",\n")
+				<< "    { \"objects\": " << result.objectCount << ", \"perDrawMs\": " << result.perDrawMs
+				<< ", \"cachedMs\": " << result.cachedMs << ", \"movedObjects\": " << result.movedObjects
+				<< ", \"movedMs\": " << result.movedMs << ", \"speedup\": " << result.speedup
+				<< ", \"maxError\": " << std::scientific << result.maxError << std::fixed << " }";
+		}
+		output << "\n  ]\n}\n";
+	}
+
+	/***********************************************************
+	 *  WriteLightResults()
+	 *
+	 *  Write the results of the light benchmark as JSON, with
+	 *  the settings they were measured with.
+	 ***********************************************************/
+	void WriteLightResults(std::ostream& output, const std::vector<LIGHT_RESULT>& results, int frameCount)
+	{
+		output << std::fixed << std::setprecision(4);
+		output << "{\n"
+			<< "  \"benchmark\": \"lights\",\n"
+#ifdef NDEBUG
+			<< "  \"build\": \"release\",\n"
+#else
+			<< "  \"build\": \"debug\",\n"
+#endif
+			<< "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+			<< "  \"lightBytes\": " << sizeof(LightManager::LIGHT_SOURCE) << ",\n"
+			<< "  \"frames\": " << frameCount << ",\n"
+			<< "  \"warmupFrames\": " << g_RenderWarmupFrames << ",\n"
+			<< "  \"runs\": [";
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const LIGHT_RESULT& result = results[i];
+			output << ((i == 0) ? "\n" : ",\n")
+				<< "    { \"lights\": " << result.lightCount << ", \"movedLights\": " << result.movedLights
+				<< ", \"cpuUpdateUs\": " << result.updateAverageUs << ", \"cpuUpdateP95Us\": " << result.updateP95Us
+				<< ", \"uploadsPerFrame\": " << result.uploadsPerFrame << ", \"bytesPerFrame\": " << result.bytesPerFrame << " }";
+		}
+		output << "\n  ]\n}\n";
+	}
+
+	/***********************************************************
+	 *  StreamInstances()
+	 *
+	 *  Stream a number of instances every frame one way, with
+	 *  the GPU copying every frame out of the buffer it was
+	 *  written into, as a draw would read it.  The upload time
+	 *  and the bytes per second until the GPU has copied the
+	 *  last frame are measured.
+	 ***********************************************************/
+	STREAMING_RESULT StreamInstances(int mode, int instanceCount, int frameCount)
+	{
+		STREAMING_RESULT result = STREAMING_RESULT();
+		result.mode = mode;
+		result.instanceCount = instanceCount;
+
+		std::vector<MeshLibrary::INSTANCE_DATA> instances(instanceCount);
+		for (int i = 0; i < instanceCount; i++)
+		{
+			instances[i].model = glm::translate(glm::vec3((float)i, 0.0f, 0.0f));
+			instances[i].color = glm::vec4(1.0f);
+			instances[i].textureLayer = (float)(i % 16);
+		}
+		const GLsizeiptr frameBytes = (GLsizeiptr)sizeof(MeshLibrary::INSTANCE_DATA) * instanceCount;
+		const GLsizeiptr instanceSize = (GLsizeiptr)sizeof(MeshLibrary::INSTANCE_DATA);
+
+		// the GPU copies every frame into the sink
+		GLuint sinkBuffer = 0;
+		glGenBuffers(1, &sinkBuffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, sinkBuffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, frameBytes, NULL, GL_STATIC_COPY);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		GLuint uploadBuffer = 0;
+		StreamingBuffer stream;
+		if (mode == STREAMING_BUFFER_SUBDATA)
+		{
+			glGenBuffers(1, &uploadBuffer);
+			glBindBuffer(GL_COPY_READ_BUFFER, uploadBuffer);
+			glBufferData(GL_COPY_READ_BUFFER, frameBytes, NULL, GL_STREAM_DRAW);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+		else
+		{
+			stream.Create(frameBytes * g_StreamingFramesInFlight, (mode == STREAMING_PERSISTENT));
+			result.bPersistent = stream.IsPersistent();
+		}
+
+		double uploadTime = 0.0;
+		Clock::time_point start = Clock::now();
+		for (int frame = -g_RenderWarmupFrames; frame < frameCount; frame++)
+		{
+			if (frame == 0)
+			{
+				glFinish();
+				stream.ResetStats();
+				uploadTime = 0.0;
+				start = Clock::now();
+			}
+
+			Clock::time_point uploadStart = Clock::now();
+			GLuint sourceBuffer = uploadBuffer;
+			GLintptr sourceOffset = 0;
+			if (mode == STREAMING_BUFFER_SUBDATA)
+			{
+				glBindBuffer(GL_COPY_READ_BUFFER, uploadBuffer);
+				glBufferSubData(GL_COPY_READ_BUFFER, 0, frameBytes, &instances[0]);
+			}
+			else
+			{
+				StreamingBuffer::ALLOCATION block;
+				if (stream.Allocate(frameBytes, instanceSize, block) == false)
+				{
+					break;
+				}
+				memcpy(block.pData, &instances[0], (size_t)block.size);
+				stream.Commit(block);
+				sourceBuffer = stream.GetBuffer();
+				sourceOffset = block.offset;
+			}
+			uploadTime += GetMilliseconds(uploadStart);
+
+			glBindBuffer(GL_COPY_READ_BUFFER, sourceBuffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, sinkBuffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, 0, frameBytes);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+			if (mode != STREAMING_BUFFER_SUBDATA)
+			{
+				stream.EndFrame();
+			}
+			glFlush();
+		}
+		glFinish();
+		double totalTime = GetMilliseconds(start);
+
+		StreamingBuffer::STREAMING_STATS stats = stream.GetStats();
+		result.frameMegabytes = frameBytes / (1024.0 * 1024.0);
+		result.uploadAverageMs = uploadTime / frameCount;
+		result.megabytesPerSecond = (totalTime > 0.0) ? (result.frameMegabytes * frameCount * 1000.0 / totalTime) : 0.0;
+		result.fenceWaits = stats.fenceWaits;
+		result.orphans = stats.orphans;
+
+		stream.Destroy();
+		if (uploadBuffer != 0)
+		{
+			glDeleteBuffers(1, &uploadBuffer);
+		}
+		glDeleteBuffers(1, &sinkBuffer);
+		return(result);
+	}
+
+	/***********************************************************
+	 *  WriteResults()
+	 *
+	 *  Write benchmark results to the passed in file, or to the
+	 *  output without one.
+	 ***********************************************************/
+	template <typename WRITER>
+	bool WriteResults(const char* outputFilename, WRITER writeResults)
+	{
+		if (NULL == outputFilename)
+		{
+			writeResults(std::cout);
+			return(true);
+		}
+
+		std::ofstream output(outputFilename);
+		if (output)
+		{
+			writeResults(output);
+		}
+		if (!output)
+		{
+			std::cout << "Could not write the benchmark results to " << outputFilename << std::endl;
+			return(false);
+		}
+		std::cout << "Wrote the benchmark results to " << outputFilename << std::endl;
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  UpdateSpheres()
+	 *
+	 *  Place the sphere of every object around its box.
+	 ***********************************************************/
+	void UpdateSpheres(BENCHMARK_SCENE& scene)
+	{
+		for (size_t i = 0; i < scene.boundsMin.size(); i++)
+		{
+			glm::vec3 center = (scene.boundsMin[i] + scene.boundsMax[i]) * 0.5f;
+			scene.centerX[i] = center.x;
+			scene.centerY[i] = center.y;
+			scene.centerZ[i] = center.z;
+			scene.radius[i] = glm::length(scene.boundsMax[i] - scene.boundsMin[i]) * 0.5f;
+		}
+	}
+
+	/***********************************************************
+	 *  GenerateScene()
+	 *
+	 *  Scatter boxes of varying size through a cube that grows
+	 *  with the object count, so every scene is equally dense.
+	 ***********************************************************/
+	void GenerateScene(int objectCount, std::mt19937& random, BENCHMARK_SCENE& scene)
+	{
+		scene.size = 4.0f * std::cbrt((float)objectCount);
+		std::uniform_real_distribution<float> position(-scene.size * 0.5f, scene.size * 0.5f);
+		std::uniform_real_distribution<float> halfSize(0.25f, 1.0f);
+
+		scene.boundsMin.resize(objectCount);
+		scene.boundsMax.resize(objectCount);
+		scene.centerX.resize(objectCount);
+		scene.centerY.resize(objectCount);
+		scene.centerZ.resize(objectCount);
+		scene.radius.resize(objectCount);
+		for (int i = 0; i < objectCount; i++)
+		{
+			glm::vec3 center(position(random), position(random), position(random));
+			glm::vec3 extent(halfSize(random), halfSize(random), halfSize(random));
+			scene.boundsMin[i] = center - extent;
+			scene.boundsMax[i] = center + extent;
+		}
+		UpdateSpheres(scene);
+	}
+
+	/***********************************************************
+	 *  RaycastScan()
+	 *
+	 *  Find the nearest box a ray hits by testing every box.
+	 ***********************************************************/
+	int RaycastScan(
+		const BENCHMARK_SCENE& scene,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& outDistance)
+	{
+		glm::vec3 inverseDirection;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			inverseDirection[axis] = (direction[axis] != 0.0f) ? (1.0f / direction[axis]) : FLT_MAX;
+		}
+
+		int nearestObject = -1;
+		outDistance = maxDistance;
+		for (size_t i = 0; i < scene.boundsMin.size(); i++)
+		{
+			float enter = 0.0f;
+			float leave = outDistance;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float t0 = (scene.boundsMin[i][axis] - origin[axis]) * inverseDirection[axis];
+				float t1 = (scene.boundsMax[i][axis] - origin[axis]) * inverseDirection[axis];
+				enter = std::max(enter, std::min(t0, t1));
+				leave = std::min(leave, std::max(t0, t1));
+			}
+			if (enter <= leave)
+			{
+				outDistance = enter;
+				nearestObject = (int)i;
+			}
+		}
+
+		return(nearestObject);
+	}
+
+	/***********************************************************
+	 *  GenerateTextureImage()
+	 *
+	 *  Write a texture image of color gradients and noise, so
+	 *  that the rows do not repeat.
+	 ***********************************************************/
+	bool GenerateTextureImage(const char* filename, int size, std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> noise(0, 15);
+		std::vector<unsigned char> pixels((size_t)size * size * 3);
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				unsigned char* pixel = &pixels[((size_t)y * size + x) * 3];
+				pixel[0] = (unsigned char)((x * 255 / size) ^ noise(random));
+				pixel[1] = (unsigned char)((y * 255 / size) ^ noise(random));
+				pixel[2] = (unsigned char)(((x + y) & 0xFF) ^ noise(random));
+			}
+		}
+
+		return(ImageWriter::WritePNG(filename, size, size, pixels));
+	}
+
+	/***********************************************************
+	 *  LoadTextures()
+	 *
+	 *  Create textures and load the image into each of them
+	 *  through the texture loader, the way the scene loads its
+	 *  textures.  The time until the scene could first render,
+	 *  with colors in place of the textures, and until every
+	 *  image is uploaded are returned.
+	 ***********************************************************/
+	void LoadTextures(
+		TextureLoader& loader,
+		const char* imageFile,
+		int textureCount,
+		double& outFirstFrameTime,
+		double& outTotalTime)
+	{
+		std::vector<GLuint> textures(textureCount);
+
+		Clock::time_point start = Clock::now();
+		glGenTextures(textureCount, &textures[0]);
+		for (int i = 0; i < textureCount; i++)
+		{
+			loader.Request(imageFile, i);
+		}
+		outFirstFrameTime = GetMilliseconds(start);
+
+		TextureLoader::DECODED_IMAGE image;
+		while (loader.WaitDecoded(image) == true)
+		{
+			TextureLoader::UploadTexture(textures[image.requestID], image);
+			TextureLoader::FreeImage(image);
+		}
+		glFinish();
+		outTotalTime = GetMilliseconds(start);
+
+		glDeleteTextures(textureCount, &textures[0]);
+	}
+
+	/***********************************************************
+	 *  GetStreamingImageFilename()
+	 *
+	 *  Get the file of a generated streaming benchmark image.
+	 ***********************************************************/
+	std::string GetStreamingImageFilename(int textureIndex)
+	{
+		return("benchmark_stream_" + std::to_string(textureIndex) + ".png");
+	}
+
+	/***********************************************************
+	 *  StressParallelFor()
+	 *
+	 *  Run parallel loops of random sizes, each task counting
+	 *  its own index and a counter shared by all of them, and
+	 *  check that every task ran exactly once.
+	 ***********************************************************/
+	bool StressParallelFor(JobSystem& jobSystem, std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> pickTaskCount(1, g_StressMaxTasks);
+		std::vector<int> runCounts;
+		for (int round = 0; round < g_StressRounds; round++)
+		{
+			int taskCount = pickTaskCount(random);
+			runCounts.assign(taskCount, 0);
+			std::atomic<int> totalRuns(0);
+			jobSystem.ParallelFor(taskCount, [&runCounts, &totalRuns](int index)
+				{
+					runCounts[index]++;
+					totalRuns++;
+				});
+
+			if ((totalRuns != taskCount) || (std::count(runCounts.begin(), runCounts.end(), 1) != taskCount))
+			{
+				std::cout << "  parallel loop of " << taskCount << " tasks ran " << totalRuns << " of them" << std::endl;
+				return(false);
+			}
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  SpawnJobTree()
+	 *
+	 *  Count a job of a tree and queue the jobs below it down
+	 *  to the passed in depth, from the job itself.  The jobs
+	 *  are all children of the root, which only finishes once
+	 *  the whole tree has, as every job queues the jobs below
+	 *  it before it finishes.
+	 ***********************************************************/
+	void SpawnJobTree(JobSystem& jobSystem, JobSystem::JOB* pRoot, int depth, std::atomic<int>& jobCount)
+	{
+		jobCount++;
+		if (depth <= 1)
+		{
+			return;
+		}
+
+		for (int i = 0; i < g_StressTreeFanout; i++)
+		{
+			jobSystem.Run(jobSystem.CreateJob([&jobSystem, pRoot, depth, &jobCount]()
+				{
+					SpawnJobTree(jobSystem, pRoot, depth - 1, jobCount);
+				}, pRoot));
+		}
+	}
+
+	/***********************************************************
+	 *  StressJobTrees()
+	 *
+	 *  Run trees of jobs that queue more jobs on whichever
+	 *  thread runs them and check that the root only finished
+	 *  once every job of the tree ran.
+	 ***********************************************************/
+	bool StressJobTrees(JobSystem& jobSystem)
+	{
+		int expectedJobs = 0;
+		int levelJobs = 1;
+		for (int depth = 0; depth < g_StressTreeDepth; depth++)
+		{
+			expectedJobs += levelJobs;
+			levelJobs *= g_StressTreeFanout;
+		}
+
+		for (int round = 0; round < g_StressRounds; round++)
+		{
+			std::atomic<int> jobCount(0);
+			JobSystem::JOB* pRoot = jobSystem.CreateJob(std::function<void()>(), NULL);
+			jobSystem.Run(jobSystem.CreateJob([&jobSystem, pRoot, &jobCount]()
+				{
+					SpawnJobTree(jobSystem, pRoot, g_StressTreeDepth, jobCount);
+				}, pRoot));
+			jobSystem.Run(pRoot);
+			jobSystem.Wait(pRoot);
+
+			if (jobCount != expectedJobs)
+			{
+				std::cout << "  job tree finished after " << jobCount << " of " << expectedJobs << " jobs" << std::endl;
+				return(false);
+			}
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  StressContinuations()
+	 *
+	 *  Run chains of jobs, each the continuation of the one
+	 *  before, and jobs that continue three others, and check
+	 *  that no job ran before the jobs it continues.
+	 ***********************************************************/
+	bool StressContinuations(JobSystem& jobSystem)
+	{
+		for (int round = 0; round < g_StressRounds; round++)
+		{
+			std::mutex orderMutex;
+			std::vector<int> order;
+			std::vector<JobSystem::JOB*> chain(g_StressChainLength);
+			for (int i = 0; i < g_StressChainLength; i++)
+			{
+				chain[i] = jobSystem.CreateJob([&orderMutex, &order, i]()
+					{
+						std::lock_guard<std::mutex> lock(orderMutex);
+						order.push_back(i);
+					}, NULL);
+				if ((i > 0) && (jobSystem.AddContinuation(chain[i - 1], chain[i]) == false))
+				{
+					return(false);
+				}
+			}
+
+			// the joined job continues a parent of three jobs
+			std::atomic<int> doneJobs(0);
+			std::atomic<int> joinedAfter(-1);
+			JobSystem::JOB* pParent = jobSystem.CreateJob(std::function<void()>(), NULL);
+			JobSystem::JOB* pJoined = jobSystem.CreateJob([&doneJobs, &joinedAfter]() { joinedAfter = doneJobs.load(); }, NULL);
+			jobSystem.AddContinuation(pParent, pJoined);
+			for (int i = 0; i < 3; i++)
+			{
+				jobSystem.Run(jobSystem.CreateJob([&doneJobs]() { doneJobs++; }, pParent));
+			}
+			jobSystem.Run(pParent);
+			jobSystem.Run(chain[0]);
+			jobSystem.Wait(chain[g_StressChainLength - 1]);
+			jobSystem.Wait(pJoined);
+
+			bool bOrdered = ((int)order.size() == g_StressChainLength);
+			for (size_t i = 0; (bOrdered == true) && (i < order.size()); i++)
+			{
+				bOrdered = (order[i] == (int)i);
+			}
+			if ((bOrdered == false) || (joinedAfter != 3))
+			{
+				std::cout << "  a continuation ran before the jobs it continues" << std::endl;
+				return(false);
+			}
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  StressBackgroundJobs()
+	 *
+	 *  Queue background jobs while parallel loops keep the
+	 *  threads busy, and check that every background job runs
+	 *  once and that none ran on the waiting thread.
+	 ***********************************************************/
+	bool StressBackgroundJobs(JobSystem& jobSystem, std::mt19937& random)
+	{
+		std::atomic<int> backgroundRuns(0);
+		std::atomic<int> callerRuns(0);
+		std::thread::id callerThread = std::this_thread::get_id();
+		for (int i = 0; i < g_StressBackgroundJobs; i++)
+		{
+			jobSystem.RunBackground([&backgroundRuns, &callerRuns, callerThread]()
+				{
+					backgroundRuns++;
+					if (std::this_thread::get_id() == callerThread)
+					{
+						callerRuns++;
+					}
+				});
+		}
+		if (StressParallelFor(jobSystem, random) == false)
+		{
+			return(false);
+		}
+
+		// the workers take the background jobs once the loops end
+		Clock::time_point start = Clock::now();
+		while ((backgroundRuns < g_StressBackgroundJobs) && (GetMilliseconds(start) < 10000.0))
+		{
+			std::this_thread::yield();
+		}
+		bool bWorkers = (jobSystem.GetThreadCount() > 1);
+		if ((backgroundRuns != g_StressBackgroundJobs) || ((bWorkers == true) && (callerRuns != 0)))
+		{
+			std::cout << "  " << backgroundRuns << " of " << g_StressBackgroundJobs << " background jobs ran, "
+				<< callerRuns << " on the waiting thread" << std::endl;
+			return(false);
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  TimeJobOverhead()
+	 *
+	 *  Time queueing batches of empty jobs from one thread and
+	 *  waiting for them, and a parallel loop of empty tasks, in
+	 *  nanoseconds per job or task, and count the jobs the
+	 *  other threads stole.
+	 ***********************************************************/
+	void TimeJobOverhead(JobSystem& jobSystem, double& outJobNs, double& outLoopTaskNs, unsigned int& outStolenJobs)
+	{
+		jobSystem.ResetStats();
+		Clock::time_point start = Clock::now();
+		for (int batch = 0; batch < g_OverheadBatches; batch++)
+		{
+			JobSystem::JOB* pRoot = jobSystem.CreateJob(std::function<void()>(), NULL);
+			for (int i = 0; i < g_OverheadBatchJobs; i++)
+			{
+				jobSystem.Run(jobSystem.CreateJob([]() {}, pRoot));
+			}
+			jobSystem.Run(pRoot);
+			jobSystem.Wait(pRoot);
+		}
+		outJobNs = GetMilliseconds(start) * 1000000.0 / ((double)g_OverheadBatches * g_OverheadBatchJobs);
+		outStolenJobs = jobSystem.GetStats().jobsStolen;
+
+		std::atomic<int> taskSum(0);
+		start = Clock::now();
+		jobSystem.ParallelFor(g_OverheadLoopTasks, [&taskSum](int index)
+			{
+				if (index == 0)
+				{
+					taskSum++;
+				}
+			});
+		outLoopTaskNs = GetMilliseconds(start) * 1000000.0 / g_OverheadLoopTasks;
+	}
+
+	/***********************************************************
+	 *  BuildNoiseTexture()
+	 *
+	 *  Build a block compressed texture of random colors.
+	 ***********************************************************/
+	bool BuildNoiseTexture(int width, int height, std::mt19937& random, CompiledTexture& outTexture)
+	{
+		std::uniform_int_distribution<int> color(0, 255);
+		std::vector<unsigned char> pixels((size_t)width * height * 3);
+		for (size_t i = 0; i < pixels.size(); i++)
+		{
+			pixels[i] = (unsigned char)color(random);
+		}
+		return(outTexture.Build(&pixels[0], width, height, 3, true));
+	}
+}
+
+/***********************************************************
+ *  RunBvhBenchmark()
+ *
+ *  This function is used for timing the bounding volume
+ *  hierarchy on generated scenes.  For every scene size the
+ *  tree is built, refit after moving some of the objects,
+ *  and queried with camera frustums and rays.  The queries
+ *  are compared against testing the spheres of all objects
+ *  with the culling kernels, and against testing the boxes
+ *  of all objects one by one for the rays.
+ ***********************************************************/
+void Benchmarks::RunBvhBenchmark()
+{
+	std::cout << "BVH benchmark, times in milliseconds per operation" << std::endl;
+	std::cout << std::fixed;
+
+	for (int sceneSize : g_BvhSceneSizes)
+	{
+		std::mt19937 random(g_RandomSeed);
+		BENCHMARK_SCENE scene;
+		GenerateScene(sceneSize, random, scene);
+
+		// build the tree a few times and keep the average
+		SceneBVH bvh;
+		const int buildRuns = 5;
+		Clock::time_point start = Clock::now();
+		for (int run = 0; run < buildRuns; run++)
+		{
+			bvh.Build(&scene.boundsMin[0], &scene.boundsMax[0], sceneSize);
+		}
+		double buildTime = GetMilliseconds(start) / buildRuns;
+
+		// move some of the objects a little and refit, as when
+		// objects are animated from one frame to the next
+		std::uniform_int_distribution<int> pickObject(0, sceneSize - 1);
+		std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+		const int refitRuns = 20;
+		double refitTime = 0.0;
+		for (int run = 0; run < refitRuns; run++)
+		{
+			for (int moved = 0; moved < (int)(sceneSize * g_MovedFraction); moved++)
+			{
+				int object = pickObject(random);
+				glm::vec3 move(offset(random), offset(random), offset(random));
+				scene.boundsMin[object] += move;
+				scene.boundsMax[object] += move;
+			}
+
+			start = Clock::now();
+			bvh.Refit(&scene.boundsMin[0], &scene.boundsMax[0]);
+			refitTime += GetMilliseconds(start);
+		}
+		refitTime /= refitRuns;
+		UpdateSpheres(scene);
+
+		std::cout << std::setprecision(3)
+			<< sceneSize << " objects, " << bvh.GetNodeCount() << " nodes" << std::endl
+			<< "  build " << buildTime << ", refit " << refitTime
+			<< " with " << (int)(g_MovedFraction * 100.0f) << "% moved, cost ratio " << bvh.GetCostRatio()
+			<< ", " << (bvh.GetBuildCount() - buildRuns) << " rebuilds in " << refitRuns << " refits" << std::endl;
+
+		// look around from the middle of the scene
+		CullingKernels::SPHERE_SOA spheres;
+		spheres.centerX = &scene.centerX[0];
+		spheres.centerY = &scene.centerY[0];
+		spheres.centerZ = &scene.centerZ[0];
+		spheres.radius = &scene.radius[0];
+		std::vector<unsigned char> visible(sceneSize);
+		for (float farScale : g_FrustumFarScales)
+		{
+			glm::mat4 projection = glm::perspective(glm::radians(60.0f), 1.25f, 0.1f, scene.size * farScale);
+			double bvhTime = 0.0;
+			double simdTime = 0.0;
+			double scalarTime = 0.0;
+			int visibleCount = 0;
+			for (int query = 0; query < g_FrustumQueries; query++)
+			{
+				float angle = glm::radians(360.0f * query / g_FrustumQueries);
+				glm::mat4 view = glm::lookAt(glm::vec3(0.0f),
+					glm::vec3(std::cos(angle), 0.25f, std::sin(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+				CullingKernels::FRUSTUM frustum;
+				CullingKernels::ExtractFrustum(projection * view, frustum);
+
+				start = Clock::now();
+				visibleCount += bvh.QueryFrustum(frustum, &visible[0]);
+				bvhTime += GetMilliseconds(start);
+
+				start = Clock::now();
+				CullingKernels::CullSpheres(frustum, spheres, sceneSize, &visible[0]);
+				simdTime += GetMilliseconds(start);
+
+				start = Clock::now();
+				CullingKernels::CullSpheres(TransformKernels::KERNEL_SCALAR, frustum, spheres, sceneSize, &visible[0]);
+				scalarTime += GetMilliseconds(start);
+			}
+
+			std::cout << std::setprecision(4)
+				<< "  frustum to " << (int)(farScale * 100.0f) << "% of the scene, "
+				<< visibleCount / g_FrustumQueries << " visible: bvh " << bvhTime / g_FrustumQueries
+				<< ", sphere scan " << simdTime / g_FrustumQueries
+				<< " (" << TransformKernels::GetKernelName(TransformKernels::GetDefaultKernel()) << "), "
+				<< scalarTime / g_FrustumQueries << " (scalar)" << std::endl;
+		}
+
+		// rays from random points in random directions, checking
+		// that the tree finds the same hits as the scan
+		std::uniform_real_distribution<float> rayOrigin(-scene.size * 0.5f, scene.size * 0.5f);
+		std::normal_distribution<float> rayDirection(0.0f, 1.0f);
+		double rayBvhTime = 0.0;
+		double rayScanTime = 0.0;
+		int mismatches = 0;
+		for (int query = 0; query < g_RayQueries; query++)
+		{
+			glm::vec3 origin(rayOrigin(random), rayOrigin(random), rayOrigin(random));
+			glm::vec3 direction = glm::normalize(glm::vec3(rayDirection(random), rayDirection(random), rayDirection(random)));
+			float bvhDistance = 0.0f;
+			float scanDistance = 0.0f;
+
+			start = Clock::now();
+			int bvhObject = bvh.Raycast(origin, direction, scene.size, bvhDistance);
+			rayBvhTime += GetMilliseconds(start);
+
+			start = Clock::now();
+			int scanObject = RaycastScan(scene, origin, direction, scene.size, scanDistance);
+			rayScanTime += GetMilliseconds(start);
+
+			if ((bvhObject != scanObject) && (bvhDistance != scanDistance))
+			{
+				mismatches++;
+			}
+		}
+
+		std::cout << "  ray: bvh " << rayBvhTime / g_RayQueries
+			<< ", box scan " << rayScanTime / g_RayQueries << std::endl;
+		if (mismatches > 0)
+		{
+			std::cout << "  " << mismatches << " rays hit a different object than the scan" << std::endl;
+		}
+	}
+}
+
+/***********************************************************
+ *  RunTransformKernelBenchmark()
+ *
+ *  This function is used for timing the kernels that build
+ *  the model matrices, at every instruction set the
+ *  processor supports, against building them one object at a
+ *  time with the glm chain of ComposeModelMatrix(), for 1k
+ *  and 100k generated objects.  The smaller batch is built
+ *  over and over until as many matrices are built as for
+ *  the larger one.  The matrices per second are printed, and
+ *  false is returned when a kernel does not match the glm
+ *  matrices.
+ ***********************************************************/
+bool Benchmarks::RunTransformKernelBenchmark()
+{
+	std::cout << "Transform kernel benchmark, default kernel "
+		<< TransformKernels::GetKernelName(TransformKernels::GetDefaultKernel())
+		<< ", millions of matrices per second" << std::endl;
+
+	bool bMatched = true;
+	for (int objectCount : g_TransformKernelSizes)
+	{
+		std::mt19937 random(g_RandomSeed);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::vector<float> values[9];
+		for (int component = 0; component < 9; component++)
+		{
+			values[component].resize(objectCount);
+		}
+		for (int i = 0; i < objectCount; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				values[axis][i] = scale(random);
+				values[3 + axis][i] = angle(random);
+				values[6 + axis][i] = position(random);
+			}
+		}
+		TransformKernels::TRANSFORM_SOA transforms;
+		transforms.scaleX = &values[0][0];
+		transforms.scaleY = &values[1][0];
+		transforms.scaleZ = &values[2][0];
+		transforms.rotationDegreesX = &values[3][0];
+		transforms.rotationDegreesY = &values[4][0];
+		transforms.rotationDegreesZ = &values[5][0];
+		transforms.positionX = &values[6][0];
+		transforms.positionY = &values[7][0];
+		transforms.positionZ = &values[8][0];
+
+		int runs = std::max(1, g_TransformKernelMatrices / objectCount);
+		double matrixCount = (double)objectCount * runs;
+
+		std::vector<glm::mat4> glmMatrices(objectCount);
+		Clock::time_point start = Clock::now();
+		for (int run = 0; run < runs; run++)
+		{
+			for (int i = 0; i < objectCount; i++)
+			{
+				glmMatrices[i] = TransformCache::ComposeModelMatrix(
+					glm::vec3(values[0][i], values[1][i], values[2][i]),
+					values[3][i], values[4][i], values[5][i],
+					glm::vec3(values[6][i], values[7][i], values[8][i]));
+			}
+		}
+		double glmRate = matrixCount / (GetMilliseconds(start) * 1000.0);
+
+		std::cout << std::fixed << std::setprecision(2)
+			<< objectCount << " objects, glm " << glmRate;
+
+		std::vector<float> matrices((size_t)objectCount * 16);
+		for (int kernel = 0; kernel < TransformKernels::KERNEL_COUNT; kernel++)
+		{
+			TransformKernels::KERNEL kernelID = (TransformKernels::KERNEL)kernel;
+			if (TransformKernels::IsKernelSupported(kernelID) == false)
+			{
+				std::cout << ", " << TransformKernels::GetKernelName(kernelID) << " unsupported";
+				continue;
+			}
+
+			start = Clock::now();
+			for (int run = 0; run < runs; run++)
+			{
+				TransformKernels::ComposeModelMatrices(kernelID, transforms, 0, objectCount, &matrices[0]);
+			}
+			double kernelRate = matrixCount / (GetMilliseconds(start) * 1000.0);
+
+			float maxError = 0.0f;
+			for (int i = 0; i < objectCount; i++)
+			{
+				const float* pGlmMatrix = &glmMatrices[i][0][0];
+				for (int element = 0; element < 16; element++)
+				{
+					maxError = std::max(maxError, std::fabs(matrices[(size_t)i * 16 + element] - pGlmMatrix[element]));
+				}
+			}
+			if (maxError > g_TransformKernelTolerance)
+			{
+				bMatched = false;
+			}
+
+			std::cout << ", " << TransformKernels::GetKernelName(kernelID) << " " << kernelRate
+				<< " (" << std::setprecision(1) << (kernelRate / glmRate) << "x"
+				<< ((maxError > g_TransformKernelTolerance) ? ", does not match glm" : "") << ")" << std::setprecision(2);
+		}
+		std::cout << std::endl;
+	}
+
+	return(bMatched);
+}
+
+/***********************************************************
+ *  RunTextureBenchmark()
+ *
+ *  This function is used for timing loading textures at
+ *  startup, with the images decoded one after the other on
+ *  the OpenGL thread as before, and on the decode threads
+ *  of the texture loader with the OpenGL thread uploading
+ *  them as they are ready, and mapped from the texture cache
+ *  with block compression.  Without an image file a 1024x1024
+ *  PNG is generated, which is stored without compression and
+ *  so decodes faster than most texture files.
+ ***********************************************************/
+bool Benchmarks::RunTextureBenchmark(const char* imageFile)
+{
+	std::mt19937 random(g_RandomSeed);
+	bool bGenerated = (imageFile == NULL);
+	if (bGenerated == true)
+	{
+		imageFile = g_GeneratedImageFilename;
+		if (GenerateTextureImage(imageFile, g_TextureImageSize, random) == false)
+		{
+			return(false);
+		}
+	}
+
+	// decode the image once up front, so the file is cached and
+	// the first run is not slower than the others
+	TextureLoader loader;
+	loader.Start(NULL);
+	loader.Request(imageFile, 0);
+	TextureLoader::DECODED_IMAGE image;
+	if ((loader.WaitDecoded(image) == false) || (TextureLoader::IsLoaded(image) == false))
+	{
+		std::cout << "Could not load image:" << imageFile << std::endl;
+		TextureLoader::FreeImage(image);
+		return(false);
+	}
+	std::cout << "Texture loading benchmark, " << imageFile << " " << image.width << "x" << image.height
+		<< ", times in milliseconds" << std::endl;
+	TextureLoader::FreeImage(image);
+
+	// compile the image into the texture cache before timing the
+	// cached loads, checking it against the decoded image
+	if (TextureLoader::BuildCache(imageFile, true) == false)
+	{
+		return(false);
+	}
+	std::cout << std::fixed << std::setprecision(1);
+
+	JobSystem jobSystem;
+	jobSystem.Start(-1);
+	for (size_t countIndex = 0; countIndex < sizeof(g_TextureCounts) / sizeof(g_TextureCounts[0]); countIndex++)
+	{
+		int textureCount = g_TextureCounts[countIndex];
+		double serialFirstFrame = 0.0;
+		double serialTotal = 0.0;
+		double parallelFirstFrame = 0.0;
+		double parallelTotal = 0.0;
+		double cachedFirstFrame = 0.0;
+		double cachedTotal = 0.0;
+
+		loader.SetCache(false, false);
+		loader.Start(NULL);
+		LoadTextures(loader, imageFile, textureCount, serialFirstFrame, serialTotal);
+		loader.Start(&jobSystem);
+		LoadTextures(loader, imageFile, textureCount, parallelFirstFrame, parallelTotal);
+		loader.SetCache(true, true);
+		loader.Start(&jobSystem);
+		LoadTextures(loader, imageFile, textureCount, cachedFirstFrame, cachedTotal);
+
+		std::cout << "  " << textureCount << " textures: serial " << serialTotal
+			<< ", parallel " << parallelTotal << " on " << loader.GetThreadCount() << " decode threads"
+			<< ", cached " << cachedTotal << ", first frame after " << parallelFirstFrame << std::endl;
+	}
+	loader.Stop();
+
+	if (bGenerated == true)
+	{
+		std::remove(CompiledTexture::GetCacheFilename(imageFile).c_str());
+		std::remove(imageFile);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  RunTextureArrayBenchmark()
+ *
+ *  This function is used for timing storing thousands of
+ *  textures as layers of the texture arrays.  Most of them
+ *  share a few sizes, the rest have odd sizes, more than
+ *  there are texture units for, so some of them go to the
+ *  fallback array.  The textures are compiled up front, so
+ *  only storing them and growing the arrays is timed.
+ ***********************************************************/
+bool Benchmarks::RunTextureArrayBenchmark()
+{
+	std::mt19937 random(g_RandomSeed);
+	const int commonSizeCount = sizeof(g_TextureArrayCommonSizes) / sizeof(g_TextureArrayCommonSizes[0]);
+
+	std::vector<CompiledTexture> textures(commonSizeCount + g_TextureArrayOddSizeCount);
+	for (int i = 0; i < (int)textures.size(); i++)
+	{
+		int size = (i < commonSizeCount) ? g_TextureArrayCommonSizes[i] : 36 + (i - commonSizeCount) * 12;
+		if (BuildNoiseTexture(size, size, random, textures[i]) == false)
+		{
+			return(false);
+		}
+	}
+
+	TextureArrayManager textureArrays;
+	if (textureArrays.Create(0) == false)
+	{
+		return(false);
+	}
+
+	Clock::time_point start = Clock::now();
+	int storedCount = 0;
+	for (int i = 0; i < g_TextureArrayTextureCount; i++)
+	{
+		int textureIndex = i % commonSizeCount;
+		if ((i % g_TextureArrayOddSizeInterval) == g_TextureArrayOddSizeInterval - 1)
+		{
+			textureIndex = commonSizeCount + (i / g_TextureArrayOddSizeInterval) % g_TextureArrayOddSizeCount;
+		}
+
+		TextureArrayManager::TEXTURE_LOCATION location;
+		if (textureArrays.AddTexture(textures[textureIndex], location) == true)
+		{
+			storedCount++;
+		}
+	}
+	glFinish();
+	double totalTime = GetMilliseconds(start);
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Texture array benchmark, stored " << storedCount << " of " << g_TextureArrayTextureCount
+		<< " textures in " << totalTime << " ms, " << totalTime * 1000.0 / g_TextureArrayTextureCount
+		<< " us per texture" << std::endl;
+	textureArrays.PrintMemoryReport();
+	textureArrays.Destroy();
+
+	return(storedCount == g_TextureArrayTextureCount);
+}
+
+/***********************************************************
+ *  RunTextureStreamingBenchmark()
+ *
+ *  This function is used for streaming more texture data
+ *  than the memory budget holds.  A camera passes a row of
+ *  textured objects, a few of them in view at once and
+ *  growing as they come closer, and the texture memory is
+ *  checked against the budget every frame.  The images are
+ *  decoded on the calling thread, so every run streams the
+ *  same way.
+ ***********************************************************/
+bool Benchmarks::RunTextureStreamingBenchmark()
+{
+	std::mt19937 random(g_RandomSeed);
+	for (int i = 0; i < g_StreamingTextureCount; i++)
+	{
+		if (GenerateTextureImage(GetStreamingImageFilename(i).c_str(), g_StreamingTextureSize, random) == false)
+		{
+			return(false);
+		}
+	}
+
+	TextureStreamer streamer;
+	if (streamer.Create(g_StreamingMemoryBudget, 0, NULL, true) == false)
+	{
+		return(false);
+	}
+	for (int i = 0; i < g_StreamingTextureCount; i++)
+	{
+		streamer.AddTexture(GetStreamingImageFilename(i));
+	}
+
+	// the first pass compiles the images into the texture cache
+	size_t maxMemorySize = 0;
+	double firstPassTime = 0.0;
+	double secondPassTime = 0.0;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		Clock::time_point start = Clock::now();
+		for (int frame = 0; frame < g_StreamingFrames; frame++)
+		{
+			// the camera position along the row of textures, the
+			// nearest texture in view is drawn the largest
+			float position = (float)frame * (g_StreamingTextureCount - g_StreamingVisibleTextures) / g_StreamingFrames;
+			int firstVisible = (int)position;
+
+			streamer.BeginFrame();
+			for (int i = 0; i < g_StreamingVisibleTextures; i++)
+			{
+				float distance = 1.0f + (firstVisible + i) - position;
+				streamer.MarkVisible(firstVisible + i, 1024.0f / distance);
+			}
+			streamer.Update(-1);
+			maxMemorySize = std::max(maxMemorySize, streamer.GetStats().allocatedBytes);
+		}
+		glFinish();
+		if (pass == 0)
+		{
+			firstPassTime = GetMilliseconds(start);
+		}
+		else
+		{
+			secondPassTime = GetMilliseconds(start);
+		}
+	}
+
+	TextureStreamer::STREAMING_STATS stats = streamer.GetStats();
+	size_t fullSize = 0;
+	CompiledTexture compiled;
+	if (compiled.Load(CompiledTexture::GetCacheFilename(GetStreamingImageFilename(0).c_str()).c_str(),
+		GetStreamingImageFilename(0).c_str()) == true)
+	{
+		fullSize = compiled.GetDataSize() * g_StreamingTextureCount;
+	}
+	compiled.Clear();
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Texture streaming benchmark, " << g_StreamingTextureCount << " textures of " << g_StreamingTextureSize
+		<< "x" << g_StreamingTextureSize << ", " << fullSize / 1048576.0 << " MB in all, within "
+		<< g_StreamingMemoryBudget / 1048576.0 << " MB" << std::endl;
+	std::cout << "  " << g_StreamingFrames << " frames in " << firstPassTime << " ms compiling the cache, "
+		<< secondPassTime << " ms from the cache" << std::endl;
+	std::cout << "  most memory " << maxMemorySize / 1048576.0 << " MB, " << stats.uploads << " uploads, "
+		<< stats.evictions << " evictions, " << (float)stats.evictions / (2 * g_StreamingFrames) << " per frame" << std::endl;
+	streamer.PrintStats();
+	streamer.Destroy();
+
+	for (int i = 0; i < g_StreamingTextureCount; i++)
+	{
+		std::remove(CompiledTexture::GetCacheFilename(GetStreamingImageFilename(i).c_str()).c_str());
+		std::remove(GetStreamingImageFilename(i).c_str());
+	}
+
+	if (maxMemorySize > g_StreamingMemoryBudget)
+	{
+		std::cout << "Texture memory exceeded the budget" << std::endl;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  RunSceneBenchmark()
+ *
+ *  This function is used for timing the renderer on scenes
+ *  of 100, 10k and 1M generated objects.  Each scene goes
+ *  through the scene manager like the loaded scene does and
+ *  is rendered offscreen from a camera circling its middle.
+ *  The time spent submitting every frame, the frames per
+ *  second until the GPU finished them, and the draw calls
+ *  and state changes per frame are printed and written as
+ *  JSON, to the passed in file or else to the output.
+ ***********************************************************/
+bool Benchmarks::RunSceneBenchmark(ShaderManager* pShaderManager, int frameCount, const char* outputFilename)
+{
+	if ((NULL == pShaderManager) || (frameCount <= 0))
+	{
+		return(false);
+	}
+
+	OffscreenTarget target;
+	if (target.Create(g_RenderWidth, g_RenderHeight) == false)
+	{
+		return(false);
+	}
+
+	std::cout << "Scene benchmark, " << frameCount << " frames of " << g_RenderWidth << "x" << g_RenderHeight
+		<< " with " << glGetString(GL_RENDERER) << ", times in milliseconds" << std::endl;
+
+	JobSystem jobSystem;
+	jobSystem.Start(-1);
+	glm::mat4 projection = glm::perspective(glm::radians(g_RenderFieldOfView),
+		(float)g_RenderWidth / (float)g_RenderHeight, 0.1f, g_RenderFarPlane);
+	std::vector<RENDER_RESULT> results;
+	for (int sceneSize : g_RenderSceneSizes)
+	{
+		RENDER_RESULT result = RENDER_RESULT();
+		result.objectCount = sceneSize;
+
+		std::mt19937 random(g_RandomSeed);
+		SceneDescription scene;
+		Clock::time_point start = Clock::now();
+		GenerateRenderScene(sceneSize, random, scene);
+		result.generateMs = GetMilliseconds(start);
+
+		SceneManager* pSceneManager = new SceneManager(pShaderManager, &jobSystem);
+		start = Clock::now();
+		pSceneManager->PrepareScene(scene);
+		result.prepareMs = GetMilliseconds(start);
+
+		target.Bind();
+		std::vector<double> submitTimes;
+		submitTimes.reserve(frameCount);
+		for (int frame = -g_RenderWarmupFrames; frame < frameCount; frame++)
+		{
+			// the measured frames start once the warm up frames
+			// are done on the GPU
+			if (frame == 0)
+			{
+				glFinish();
+				start = Clock::now();
+			}
+
+			float angle = glm::two_pi<float>() * frame / frameCount;
+			glm::vec3 position(std::cos(angle) * g_RenderOrbitRadius, g_RenderOrbitHeight, std::sin(angle) * g_RenderOrbitRadius);
+			glm::mat4 view = glm::lookAt(position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			pShaderManager->setMat4Value("view", view);
+			pShaderManager->setMat4Value("projection", projection);
+			pShaderManager->setVec3Value("viewPosition", position);
+
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			pSceneManager->SetCameraView(view, projection);
+			Clock::time_point submitStart = Clock::now();
+			pSceneManager->RenderScene();
+			double submitTime = GetMilliseconds(submitStart);
+
+			if (frame >= 0)
+			{
+				const SceneManager::RENDER_STATS& stats = pSceneManager->GetRenderStats();
+				submitTimes.push_back(submitTime);
+				result.visibleObjects += stats.visibleObjects;
+				result.drawCalls += stats.drawCalls;
+				result.drawCommands += stats.drawCommands;
+				result.passChanges += stats.passChanges;
+				result.textureChanges += stats.textureChanges;
+				result.materialChanges += stats.materialChanges;
+				result.uniformUploads += stats.uniformUploads;
+				result.uniformUploadsSkipped += stats.uniformUploadsSkipped;
+			}
+		}
+		glFinish();
+		double totalTime = GetMilliseconds(start);
+		target.Unbind();
+		delete pSceneManager;
+
+		std::sort(submitTimes.begin(), submitTimes.end());
+		for (double submitTime : submitTimes)
+		{
+			result.submitAverageMs += submitTime;
+		}
+		result.submitAverageMs /= frameCount;
+		result.submitP50Ms = submitTimes[(frameCount - 1) / 2];
+		result.submitP95Ms = submitTimes[(int)((frameCount - 1) * 0.95)];
+		result.submitMaxMs = submitTimes.back();
+		result.framesPerSecond = (totalTime > 0.0) ? (frameCount * 1000.0 / totalTime) : 0.0;
+		result.visibleObjects /= frameCount;
+		result.drawCalls /= frameCount;
+		result.drawCommands /= frameCount;
+		result.passChanges /= frameCount;
+		result.textureChanges /= frameCount;
+		result.materialChanges /= frameCount;
+		result.uniformUploads /= frameCount;
+		result.uniformUploadsSkipped /= frameCount;
+		results.push_back(result);
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< sceneSize << " objects, generated in " << result.generateMs << ", prepared in " << result.prepareMs << std::endl
+			<< "  submit " << result.submitAverageMs << " average, " << result.submitP50Ms << " p50, "
+			<< result.submitP95Ms << " p95, " << result.submitMaxMs << " worst, "
+			<< std::setprecision(1) << result.framesPerSecond << " frames per second" << std::endl
+			<< "  " << result.visibleObjects << " visible objects, " << result.drawCalls << " draw calls of "
+			<< result.drawCommands << " draws, "
+			<< (result.passChanges + result.textureChanges + result.materialChanges) << " state changes per frame" << std::endl
+			<< "  " << result.uniformUploads << " uniform uploads sent, " << result.uniformUploadsSkipped
+			<< " skipped as unchanged per frame" << std::endl;
+	}
+
+	return(WriteResults(outputFilename, [&results, frameCount](std::ostream& output)
+		{
+			WriteRenderResults(output, results, frameCount);
+		}));
+}
+
+/***********************************************************
+ *  RunRecordScalingBenchmark()
+ *
+ *  This function is used for timing how recording the draws
+ *  of a frame scales with the job threads.  A generated
+ *  scene of 200k objects is recorded from a camera circling
+ *  its middle with 1, 2, 4, 8 and 16 threads, without being
+ *  drawn, so only the CPU side of the frame is timed.  The
+ *  culling, queueing and instance filling are split across
+ *  the threads, the sort and batching are not.  The times
+ *  and the speedups over one thread are printed and written
+ *  as JSON, to the passed in file or else to the output.
+ ***********************************************************/
+bool Benchmarks::RunRecordScalingBenchmark(ShaderManager* pShaderManager, int frameCount, const char* outputFilename)
+{
+	if ((NULL == pShaderManager) || (frameCount <= 0))
+	{
+		return(false);
+	}
+
+	std::cout << "Record scaling benchmark, " << frameCount << " frames of " << g_RecordScalingObjects
+		<< " objects with " << std::thread::hardware_concurrency() << " hardware threads, times in milliseconds" << std::endl;
+
+	std::mt19937 random(g_RandomSeed);
+	SceneDescription scene;
+	GenerateRenderScene(g_RecordScalingObjects, random, scene);
+	JobSystem jobSystem;
+	SceneManager* pSceneManager = new SceneManager(pShaderManager, &jobSystem);
+	pSceneManager->PrepareScene(scene);
+
+	glm::mat4 projection = glm::perspective(glm::radians(g_RenderFieldOfView),
+		(float)g_RenderWidth / (float)g_RenderHeight, 0.1f, g_RecordScalingFarPlane);
+	std::vector<RECORD_RESULT> results;
+	double visibleObjects = 0.0;
+	for (int threadCount : g_RecordScalingThreads)
+	{
+		RECORD_RESULT result = RECORD_RESULT();
+		result.threadCount = threadCount;
+		jobSystem.Start(threadCount - 1);
+
+		std::vector<double> recordTimes;
+		recordTimes.reserve(frameCount);
+		visibleObjects = 0.0;
+		for (int frame = -g_RenderWarmupFrames; frame < frameCount; frame++)
+		{
+			float angle = glm::two_pi<float>() * frame / frameCount;
+			glm::vec3 position(std::cos(angle) * g_RenderOrbitRadius, g_RenderOrbitHeight, std::sin(angle) * g_RenderOrbitRadius);
+			glm::vec3 target(0.0f, g_RenderOrbitHeight, 0.0f);
+			pSceneManager->SetCameraView(glm::lookAt(position, target, glm::vec3(0.0f, 1.0f, 0.0f)), projection);
+
+			Clock::time_point start = Clock::now();
+			pSceneManager->RecordScene();
+			double recordTime = GetMilliseconds(start);
+
+			if (frame >= 0)
+			{
+				recordTimes.push_back(recordTime);
+				visibleObjects += pSceneManager->GetRenderStats().visibleObjects;
+			}
+		}
+		visibleObjects /= frameCount;
+
+		std::sort(recordTimes.begin(), recordTimes.end());
+		for (double recordTime : recordTimes)
+		{
+			result.recordAverageMs += recordTime;
+		}
+		result.recordAverageMs /= frameCount;
+		result.recordP50Ms = recordTimes[(frameCount - 1) / 2];
+		result.recordMaxMs = recordTimes.back();
+		result.speedup = results.empty() ? 1.0 : (results[0].recordAverageMs / result.recordAverageMs);
+		results.push_back(result);
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< threadCount << " threads, record " << result.recordAverageMs << " average, " << result.recordP50Ms << " p50, "
+			<< result.recordMaxMs << " worst, " << std::setprecision(2) << result.speedup << "x" << std::endl;
+	}
+	delete pSceneManager;
+
+	std::cout << std::setprecision(1) << visibleObjects << " visible objects per frame" << std::endl;
+
+	return(WriteResults(outputFilename, [&results, frameCount, visibleObjects](std::ostream& output)
+		{
+			WriteRecordResults(output, results, frameCount, visibleObjects);
+		}));
+}
+
+/***********************************************************
+ *  RunPipelineBenchmark()
+ *
+ *  This function is used for timing pipelined rendering
+ *  against rendering every frame in turn.  A generated scene
+ *  of 200k objects is rendered offscreen along the camera
+ *  path of the scene benchmark, first recording and
+ *  submitting each frame one after the other, then recording
+ *  the next frame on the job threads while the last one is
+ *  submitted.  The time between frames and the latency from
+ *  setting the camera of a frame to submitting it are
+ *  printed and written as JSON, to the passed in file or
+ *  else to the output.
+ ***********************************************************/
+bool Benchmarks::RunPipelineBenchmark(ShaderManager* pShaderManager, int frameCount, const char* outputFilename)
+{
+	if ((NULL == pShaderManager) || (frameCount <= 0))
+	{
+		return(false);
+	}
+
+	OffscreenTarget target;
+	if (target.Create(g_RenderWidth, g_RenderHeight) == false)
+	{
+		return(false);
+	}
+
+	std::cout << "Pipeline benchmark, " << frameCount << " frames of " << g_PipelineObjects << " objects with "
+		<< std::thread::hardware_concurrency() << " hardware threads, times in milliseconds" << std::endl;
+
+	std::mt19937 random(g_RandomSeed);
+	SceneDescription scene;
+	GenerateRenderScene(g_PipelineObjects, random, scene);
+	JobSystem jobSystem;
+	jobSystem.Start(-1);
+	SceneManager* pSceneManager = new SceneManager(pShaderManager, &jobSystem);
+	pSceneManager->PrepareScene(scene);
+
+	glm::mat4 projection = glm::perspective(glm::radians(g_RenderFieldOfView),
+		(float)g_RenderWidth / (float)g_RenderHeight, 0.1f, g_RenderFarPlane);
+	std::vector<PIPELINE_RESULT> results;
+	target.Bind();
+	for (int mode = 0; mode < 2; mode++)
+	{
+		PIPELINE_RESULT result = PIPELINE_RESULT();
+		result.bPipelined = (mode == 1);
+		pSceneManager->SetPipelined(result.bPipelined);
+
+		// a pipelined frame is submitted during the next one
+		std::vector<Clock::time_point> cameraTimes(frameCount);
+		std::vector<double> frameTimes;
+		std::vector<double> latencies;
+		frameTimes.reserve(frameCount);
+		latencies.reserve(frameCount);
+		Clock::time_point start = Clock::now();
+		for (int frame = -g_RenderWarmupFrames; frame < frameCount; frame++)
+		{
+			if (frame == 0)
+			{
+				glFinish();
+				start = Clock::now();
+			}
+			Clock::time_point frameStart = Clock::now();
+
+			float angle = glm::two_pi<float>() * frame / frameCount;
+			glm::vec3 position(std::cos(angle) * g_RenderOrbitRadius, g_RenderOrbitHeight, std::sin(angle) * g_RenderOrbitRadius);
+			glm::mat4 view = glm::lookAt(position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			pShaderManager->setMat4Value("view", view);
+			pShaderManager->setMat4Value("projection", projection);
+			pShaderManager->setVec3Value("viewPosition", position);
+			if (frame >= 0)
+			{
+				cameraTimes[frame] = Clock::now();
+			}
+
+			glEnable(GL_DEPTH_TEST);
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			pSceneManager->SetCameraView(view, projection);
+			pSceneManager->RenderScene();
+			glFlush();
+
+			int submittedFrame = result.bPipelined ? (frame - 1) : frame;
+			if (submittedFrame >= 0)
+			{
+				latencies.push_back(GetMilliseconds(cameraTimes[submittedFrame]));
+			}
+			if (frame >= 0)
+			{
+				frameTimes.push_back(GetMilliseconds(frameStart));
+			}
+		}
+		if (result.bPipelined == true)
+		{
+			pSceneManager->SubmitScene();
+			latencies.push_back(GetMilliseconds(cameraTimes[frameCount - 1]));
+		}
+		glFinish();
+		double totalTime = GetMilliseconds(start);
+
+		std::sort(frameTimes.begin(), frameTimes.end());
+		std::sort(latencies.begin(), latencies.end());
+		for (double frameTime : frameTimes)
+		{
+			result.frameAverageMs += frameTime;
+		}
+		result.frameAverageMs /= frameTimes.size();
+		result.frameP50Ms = frameTimes[(frameTimes.size() - 1) / 2];
+		result.frameP95Ms = frameTimes[(int)((frameTimes.size() - 1) * 0.95)];
+		for (double latency : latencies)
+		{
+			result.latencyAverageMs += latency;
+		}
+		result.latencyAverageMs /= latencies.size();
+		result.latencyP95Ms = latencies[(int)((latencies.size() - 1) * 0.95)];
+		result.framesPerSecond = (totalTime > 0.0) ? (frameCount * 1000.0 / totalTime) : 0.0;
+		results.push_back(result);
+
+		std::cout << std::fixed << std::setprecision(3)
+			<< "pipelining " << (result.bPipelined ? "on" : "off") << ", frame " << result.frameAverageMs << " average, "
+			<< result.frameP50Ms << " p50, " << result.frameP95Ms << " p95, latency " << result.latencyAverageMs
+			<< " average, " << result.latencyP95Ms << " p95, " << std::setprecision(1) << result.framesPerSecond
+			<< " frames per second" << std::endl;
+	}
+	target.Unbind();
+	delete pSceneManager;
+
+	std::cout << std::fixed << std::setprecision(3) << std::showpos
+		<< "pipelining on against off, frame " << (results[1].frameAverageMs - results[0].frameAverageMs)
+		<< " ms, latency " << (results[1].latencyAverageMs - results[0].latencyAverageMs) << " ms" << std::noshowpos
+		<< ", " << std::setprecision(2) << (results[0].frameAverageMs / results[1].frameAverageMs) << "x the frame rate" << std::endl;
+
+	return(WriteResults(outputFilename, [&results, frameCount](std::ostream& output)
+		{
+			WritePipelineResults(output, results, frameCount);
+		}));
+}
+
+/***********************************************************
+ *  RunStreamingBufferBenchmark()
+ *
+ *  This function is used for timing streaming the instances
+ *  of every frame through a persistently mapped ring, the
+ *  same ring orphaned on every wrap where buffer storage is
+ *  missing, and glBufferSubData into one buffer, which waits
+ *  for the GPU to finish reading the last frame.  1k, 10k and
+ *  200k instances are streamed per frame, and the megabytes
+ *  per second are printed and written as JSON, to the passed
+ *  in file or else to the output.
+ ***********************************************************/
+bool Benchmarks::RunStreamingBufferBenchmark(int frameCount, const char* outputFilename)
+{
+	if (frameCount <= 0)
+	{
+		return(false);
+	}
+
+	std::cout << "Streaming buffer benchmark, " << frameCount << " frames of "
+		<< sizeof(MeshLibrary::INSTANCE_DATA) << " byte instances, megabytes per second" << std::endl;
+
+	std::vector<STREAMING_RESULT> results;
+	for (int instanceCount : g_StreamingInstances)
+	{
+		for (int mode = 0; mode < STREAMING_MODE_COUNT; mode++)
+		{
+			STREAMING_RESULT result = StreamInstances(mode, instanceCount, frameCount);
+			results.push_back(result);
+
+			std::cout << std::fixed << std::setprecision(3)
+				<< std::setw(7) << instanceCount << " instances, " << std::setw(13) << GetStreamingModeName(mode)
+				<< (((mode == STREAMING_PERSISTENT) && (result.bPersistent == false)) ? " (orphaned)" : "")
+				<< ", upload " << result.uploadAverageMs << " ms, " << std::setprecision(1)
+				<< result.megabytesPerSecond << " MB/s, " << result.fenceWaits << " fence waits, "
+				<< result.orphans << " orphans" << std::endl;
+		}
+	}
+
+	return(WriteResults(outputFilename, [&results, frameCount](std::ostream& output)
+		{
+			WriteStreamingResults(output, results, frameCount);
+		}));
+}
+
+/***********************************************************
+ *  RunAllocationBenchmark()
+ *
+ *  This function is used for checking that rendering a frame
+ *  makes no heap allocations.  Generated scenes of 100 and
+ *  10k objects are rendered offscreen along the camera path
+ *  of the scene benchmark, with pipelining off and on.  The
+ *  first time round the path grows the buffers of the frames
+ *  to the busiest view, and the operator new calls of the
+ *  second time round, on any thread, are counted through the
+ *  passed in counter and printed per frame.
+ ***********************************************************/
+bool Benchmarks::RunAllocationBenchmark(ShaderManager* pShaderManager, int frameCount, unsigned long long (*pGetAllocationCount)())
+{
+	if ((NULL == pShaderManager) || (frameCount <= 0) || (NULL == pGetAllocationCount))
+	{
+		return(false);
+	}
+
+	OffscreenTarget target;
+	if (target.Create(g_RenderWidth, g_RenderHeight) == false)
+	{
+		return(false);
+	}
+
+	std::cout << "Allocation benchmark, " << frameCount << " frames of " << g_RenderWidth << "x" << g_RenderHeight
+		<< " counted after as many warm up frames" << std::endl;
+
+	JobSystem jobSystem;
+	jobSystem.Start(-1);
+	glm::mat4 projection = glm::perspective(glm::radians(g_RenderFieldOfView),
+		(float)g_RenderWidth / (float)g_RenderHeight, 0.1f, g_RenderFarPlane);
+	bool bNoAllocations = true;
+	for (int sceneSize : g_AllocationSceneSizes)
+	{
+		std::mt19937 random(g_RandomSeed);
+		SceneDescription scene;
+		GenerateRenderScene(sceneSize, random, scene);
+		SceneManager* pSceneManager = new SceneManager(pShaderManager, &jobSystem);
+		pSceneManager->PrepareScene(scene);
+
+		target.Bind();
+		for (int mode = 0; mode < 2; mode++)
+		{
+			bool bPipelined = (mode == 1);
+			pSceneManager->SetPipelined(bPipelined);
+
+			unsigned long long allocations = 0;
+			for (int frame = -frameCount; frame < frameCount; frame++)
+			{
+				float angle = glm::two_pi<float>() * frame / frameCount;
+				glm::vec3 position(std::cos(angle) * g_RenderOrbitRadius, g_RenderOrbitHeight, std::sin(angle) * g_RenderOrbitRadius);
+				glm::mat4 view = glm::lookAt(position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+				pShaderManager->setMat4Value("view", view);
+				pShaderManager->setMat4Value("projection", projection);
+				pShaderManager->setVec3Value("viewPosition", position);
+
+				glEnable(GL_DEPTH_TEST);
+				glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+				unsigned long long allocationsBefore = pGetAllocationCount();
+				pSceneManager->SetCameraView(view, projection);
+				pSceneManager->RenderScene();
+				if (frame >= 0)
+				{
+					allocations += pGetAllocationCount() - allocationsBefore;
+				}
+			}
+			if (bPipelined == true)
+			{
+				pSceneManager->SubmitScene();
+			}
+			glFinish();
+
+			std::cout << std::fixed << std::setprecision(2)
+				<< sceneSize << " objects, pipelining " << (bPipelined ? "on" : "off") << ", "
+				<< allocations << " allocations, " << ((double)allocations / frameCount) << " per frame" << std::endl;
+			if (allocations > 0)
+			{
+				bNoAllocations = false;
+			}
+		}
+		target.Unbind();
+		delete pSceneManager;
+	}
+
+	return(bNoAllocations);
+}
+
+/***********************************************************
+ *  RunTransformCacheBenchmark()
+ *
+ *  This function is used for timing the model matrices of a
+ *  frame read from the transform cache against building them
+ *  for every draw, as SetTransformations() did before the
+ *  cache, for 1k, 10k and 100k generated objects.  The
+ *  matrices built per draw come from ComposeModelMatrix(),
+ *  the scalar glm reference the cached ones are also checked
+ *  against.  The cache is timed with no object moved and
+ *  with 1% of them moved every frame.  The times per frame
+ *  are printed and written as JSON, to the passed in file or
+ *  else to the output.
+ ***********************************************************/
+bool Benchmarks::RunTransformCacheBenchmark(int frameCount, const char* outputFilename)
+{
+	if (frameCount <= 0)
+	{
+		return(false);
+	}
+
+	std::cout << "Transform cache benchmark, " << frameCount << " frames, times in milliseconds per frame" << std::endl;
+
+	std::vector<TRANSFORM_CACHE_RESULT> results;
+	for (int objectCount : g_TransformCacheSizes)
+	{
+		TRANSFORM_CACHE_RESULT result = TRANSFORM_CACHE_RESULT();
+		result.objectCount = objectCount;
+		result.movedObjects = std::max(1, (int)(objectCount * g_TransformMovedFraction));
+
+		std::mt19937 random(g_RandomSeed);
+		std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+		std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::vector<glm::vec3> scales(objectCount);
+		std::vector<glm::vec3> rotations(objectCount);
+		std::vector<glm::vec3> positions(objectCount);
+		TransformCache cache;
+		for (int i = 0; i < objectCount; i++)
+		{
+			scales[i] = glm::vec3(scale(random), scale(random), scale(random));
+			rotations[i] = glm::vec3(angle(random), angle(random), angle(random));
+			positions[i] = glm::vec3(position(random), position(random), position(random));
+			cache.AddTransform(scales[i], rotations[i], positions[i]);
+		}
+		cache.Update(NULL);
+
+		// the matrices are copied out as the instances of a frame
+		// are filled, so both ways end with the same writes
+		std::vector<glm::mat4> perDrawMatrices(objectCount);
+		std::vector<glm::mat4> cachedMatrices(objectCount);
+
+		Clock::time_point start = Clock::now();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			for (int i = 0; i < objectCount; i++)
+			{
+				perDrawMatrices[i] = TransformCache::ComposeModelMatrix(
+					scales[i], rotations[i].x, rotations[i].y, rotations[i].z, positions[i]);
+			}
+		}
+		result.perDrawMs = GetMilliseconds(start) / frameCount;
+
+		start = Clock::now();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			cache.Update(NULL);
+			for (int i = 0; i < objectCount; i++)
+			{
+				cachedMatrices[i] = cache.GetModelMatrix(i);
+			}
+		}
+		result.cachedMs = GetMilliseconds(start) / frameCount;
+
+		for (int i = 0; i < objectCount; i++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					result.maxError = std::max(result.maxError,
+						std::fabs(cachedMatrices[i][column][row] - perDrawMatrices[i][column][row]));
+				}
+			}
+		}
+
+		// a different run of objects moves up and back every frame
+		start = Clock::now();
+		for (int frame = 0; frame < frameCount; frame++)
+		{
+			glm::vec3 move(0.0f, ((frame & 1) == 0) ? 0.1f : 0.0f, 0.0f);
+			for (int moved = 0; moved < result.movedObjects; moved++)
+			{
+				int object = (int)(((int64_t)frame * result.movedObjects + moved) % objectCount);
+				cache.SetTransform(object, scales[object], rotations[object], positions[object] + move);
+			}
+			cache.Update(NULL);
+			for (int i = 0; i < objectCount; i++)
+			{
+				cachedMatrices[i] = cache.GetModelMatrix(i);
+			}
+		}
+		result.movedMs = GetMilliseconds(start) / frameCount;
+		result.speedup = (result.cachedMs > 0.0) ? (result.perDrawMs / result.cachedMs) : 0.0;
+		results.push_back(result);
+
+		std::cout << std::fixed << std::setprecision(4)
+			<< objectCount << " objects, per draw " << result.perDrawMs << ", cached " << result.cachedMs
+			<< ", cached with " << result.movedObjects << " moved " << result.movedMs << ", "
+			<< std::setprecision(1) << result.speedup << "x, largest difference "
+			<< std::scientific << std::setprecision(2) << result.maxError << std::endl;
+	}
+
+	return(WriteResults(outputFilename, [&results, frameCount](std::ostream& output)
+		{
+			WriteTransformCacheResults(output, results, frameCount);
+		}));
+}
+
+/***********************************************************
+ *  RunLightBenchmark()
+ *
+ *  This function is used for timing the light uploads of a
+ *  frame with 1, 16 and 256 lights in the light buffer, the
+ *  most it holds.  Every frame moves all the lights, one of
+ *  them or none, and the CPU time LightManager::Update()
+ *  takes to upload the lights that changed is measured.  The
+ *  times, uploads and bytes per frame are printed and written
+ *  as JSON, to the passed in file or else to the output.
+ ***********************************************************/
+bool Benchmarks::RunLightBenchmark(int frameCount, const char* outputFilename)
+{
+	if (frameCount <= 0)
+	{
+		return(false);
+	}
+
+	std::cout << "Light benchmark, " << frameCount << " frames of " << sizeof(LightManager::LIGHT_SOURCE)
+		<< " byte lights, times in microseconds" << std::endl;
+
+	std::vector<LIGHT_RESULT> results;
+	for (int lightCount : g_LightCounts)
+	{
+		// all the lights moved, one of them and none, where moving
+		// one of one light is moving them all
+		const int movedCounts[] = { lightCount, 1, 0 };
+		for (int run = 0; run < 3; run++)
+		{
+			int movedLights = movedCounts[run];
+			if ((run == 1) && (lightCount == 1))
+			{
+				continue;
+			}
+
+			LIGHT_RESULT result = LIGHT_RESULT();
+			result.lightCount = lightCount;
+			result.movedLights = movedLights;
+
+			LightManager lightManager;
+			if (lightManager.Create(g_LightBenchmarkBinding) == false)
+			{
+				return(false);
+			}
+			std::vector<int> lightHandles(lightCount);
+			for (int i = 0; i < lightCount; i++)
+			{
+				LightManager::LIGHT_SOURCE light = LightManager::LIGHT_SOURCE();
+				light.position = glm::vec3((float)i, 10.0f, 0.0f);
+				light.focalStrength = 32.0f;
+				light.ambientColor = glm::vec3(0.05f);
+				light.specularIntensity = 0.5f;
+				light.diffuseColor = glm::vec3(0.8f);
+				light.specularColor = glm::vec3(1.0f);
+				lightHandles[i] = lightManager.AddLight(light);
+			}
+			lightManager.Update();
+
+			std::vector<double> updateTimes;
+			updateTimes.reserve(frameCount);
+			unsigned int firstUploadCount = 0;
+			unsigned long long firstUploadedBytes = 0;
+			for (int frame = -g_RenderWarmupFrames; frame < frameCount; frame++)
+			{
+				if (frame == 0)
+				{
+					glFinish();
+					firstUploadCount = lightManager.GetUploadCount();
+					firstUploadedBytes = lightManager.GetUploadedBytes();
+				}
+
+				// the lights circle the middle of the scene
+				float angle = glm::two_pi<float>() * frame / frameCount;
+				for (int i = 0; i < movedLights; i++)
+				{
+					float lightAngle = angle + glm::two_pi<float>() * i / lightCount;
+					lightManager.SetLightPosition(lightHandles[i],
+						glm::vec3(std::cos(lightAngle) * g_RenderOrbitRadius, 10.0f, std::sin(lightAngle) * g_RenderOrbitRadius));
+				}
+
+				Clock::time_point start = Clock::now();
+				lightManager.Update();
+				double updateTime = GetMilliseconds(start) * 1000.0;
+				if (frame >= 0)
+				{
+					updateTimes.push_back(updateTime);
+				}
+			}
+			glFinish();
+
+			std::sort(updateTimes.begin(), updateTimes.end());
+			for (double updateTime : updateTimes)
+			{
+				result.updateAverageUs += updateTime;
+			}
+			result.updateAverageUs /= frameCount;
+			result.updateP95Us = updateTimes[(int)((frameCount - 1) * 0.95)];
+			result.uploadsPerFrame = (double)(lightManager.GetUploadCount() - firstUploadCount) / frameCount;
+			result.bytesPerFrame = (double)(lightManager.GetUploadedBytes() - firstUploadedBytes) / frameCount;
+			results.push_back(result);
+
+			std::cout << std::fixed << std::setprecision(2)
+				<< std::setw(3) << lightCount << " lights, " << std::setw(3) << movedLights << " moved, update "
+				<< result.updateAverageUs << " average, " << result.updateP95Us << " p95, "
+				<< result.uploadsPerFrame << " uploads of " << std::setprecision(0) << result.bytesPerFrame
+				<< " bytes per frame" << std::endl;
+		}
+	}
+
+	return(WriteResults(outputFilename, [&results, frameCount](std::ostream& output)
+		{
+			WriteLightResults(output, results, frameCount);
+		}));
+}
+
+/***********************************************************
+ *  RunJobSystemBenchmark()
+ *
+ *  This function is used for stress testing the job system
+ *  with 1, 2, 4 and 8 threads, more than there are cores
+ *  on small machines so the threads contend for the deques,
+ *  and timing the cost of a job.  Parallel loops, trees of
+ *  jobs queueing jobs, continuations and background jobs
+ *  are checked for running every job exactly once and in
+ *  order.  The time per empty job, per empty loop task and
+ *  the jobs stolen are printed.
+ ***********************************************************/
+bool Benchmarks::RunJobSystemBenchmark()
+{
+	std::cout << "Job system benchmark, " << std::thread::hardware_concurrency() << " hardware threads, "
+		<< g_StressRounds << " rounds of every test, times in nanoseconds" << std::endl;
+
+	bool bPassed = true;
+	for (int threadCount : g_JobSystemThreads)
+	{
+		std::mt19937 random(g_RandomSeed);
+		JobSystem jobSystem;
+		jobSystem.Start(threadCount - 1);
+
+		bool bLoops = StressParallelFor(jobSystem, random);
+		bool bTrees = StressJobTrees(jobSystem);
+		bool bContinuations = StressContinuations(jobSystem);
+		bool bBackground = StressBackgroundJobs(jobSystem, random);
+
+		double jobNs = 0.0;
+		double loopTaskNs = 0.0;
+		unsigned int stolenJobs = 0;
+		TimeJobOverhead(jobSystem, jobNs, loopTaskNs, stolenJobs);
+
+		std::cout << std::fixed << std::setprecision(1)
+			<< "  " << threadCount << " threads: loops " << (bLoops ? "passed" : "FAILED")
+			<< ", trees " << (bTrees ? "passed" : "FAILED")
+			<< ", continuations " << (bContinuations ? "passed" : "FAILED")
+			<< ", background " << (bBackground ? "passed" : "FAILED") << std::endl
+			<< "    " << jobNs << " per job, " << loopTaskNs << " per loop task, "
+			<< stolenJobs << " of " << (g_OverheadBatches * g_OverheadBatchJobs) << " jobs stolen" << std::endl;
+
+		bPassed = bPassed && bLoops && bTrees && bContinuations && bBackground;
+	}
+
+	return(bPassed);
+}
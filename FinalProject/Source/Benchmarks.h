@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmarks.h
+// ============
+// measure the scene data structures outside of the render loop
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+class ShaderManager;
+
+/***********************************************************
+ *  Benchmarks
+ *
+ *  These functions time the scene data structures and
+ *  loading on generated data.  The data comes from a fixed
+ *  random seed and is the same on every run.
+ ***********************************************************/
+namespace Benchmarks
+{
+	// time building, refitting and querying the bounding volume
+	// hierarchy against testing every object, for 1k, 10k and
+	// 100k objects, and print the results
+	void RunBvhBenchmark();
+	// time building model matrices with every supported kernel
+	// against the glm chain, for 1k and 100k objects, and print
+	// the matrices per second, false when a kernel does not
+	// match glm
+	bool RunTransformKernelBenchmark();
+	// stress test the job system with 1 to 8 threads, checking
+	// that every job runs once and after the jobs it continues,
+	// and print the time per job, false when a test failed
+	bool RunJobSystemBenchmark();
+	// time loading 3, 16 and 64 textures with the images decoded
+	// one after the other, in parallel and from the texture cache,
+	// and print the results, needs an OpenGL context
+	bool RunTextureBenchmark(const char* imageFile);
+	// time storing 4096 textures of mostly the same few sizes in
+	// the texture arrays and print the memory of every array,
+	// needs an OpenGL context
+	bool RunTextureArrayBenchmark();
+	// stream 64 textures, three times the memory budget, past a
+	// moving camera and print the memory and loading counters,
+	// needs an OpenGL context
+	bool RunTextureStreamingBenchmark();
+	// render generated scenes of 100, 10k and 1M objects from a
+	// fixed camera path and write the submit times, frame rates,
+	// draw calls and state changes as JSON, to the passed in file
+	// or else the output, needs an OpenGL context with the
+	// shaders loaded
+	bool RunSceneBenchmark(ShaderManager* pShaderManager, int frameCount, const char* outputFilename);
+	// record the draws of a generated scene of 200k objects with
+	// 1 to 16 job threads and write the record times and speedups
+	// as JSON, the same way, needs an OpenGL context with the
+	// shaders loaded
+	bool RunRecordScalingBenchmark(ShaderManager* pShaderManager, int frameCount, const char* outputFilename);
+	// render a generated scene of 200k objects with pipelining
+	// off and on and write the frame times and latencies as
+	// JSON, the same way, needs an OpenGL context with the
+	// shaders loaded
+	bool RunPipelineBenchmark(ShaderManager* pShaderManager, int frameCount, const char* outputFilename);
+	// stream 1k, 10k and 200k instances per frame through a
+	// persistently mapped ring, an orphaned ring and
+	// glBufferSubData and write the megabytes per second as
+	// JSON, the same way, needs an OpenGL context
+	bool RunStreamingBufferBenchmark(int frameCount, const char* outputFilename);
+	// render generated scenes of 100 and 10k objects along the
+	// camera path twice, with pipelining off and on, and count
+	// the heap allocations of the second time round through the
+	// passed in counter of every operator new, false when a frame
+	// allocated, needs an OpenGL context with the shaders loaded
+	bool RunAllocationBenchmark(ShaderManager* pShaderManager, int frameCount, unsigned long long (*pGetAllocationCount)());
+	// time getting the model matrices of 1k, 10k and 100k objects
+	// for a frame from the transform cache against building them
+	// for every draw, and write the times per frame as JSON, the
+	// same way
+	bool RunTransformCacheBenchmark(int frameCount, const char* outputFilename);
+	// time uploading 1, 16 and 256 lights with all, one or none
+	// of them moved every frame, and write the CPU times per
+	// frame as JSON, the same way, needs an OpenGL context
+	bool RunLightBenchmark(int frameCount, const char* outputFilename);
+}
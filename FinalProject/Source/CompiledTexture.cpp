@@ -0,0 +1,822 @@
+#include "CompiledTexture.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// identification of the texture cache file format
+	const char g_CacheMagic[4] = { 'T', 'E', 'X', 'B' };
+	const uint32_t g_CacheVersion = 1;
+	// directory the cache files are written to
+	const char* g_CacheDirectory = "TextureCache";
+	// most mip levels, enough for 2^31 texels on a side
+	const uint32_t g_MaxMipLevels = 32;
+
+	// header at the start of a cache file, followed by the path
+	// of the source image, the level table and the 16-byte
+	// aligned texel data of every level
+	struct CACHE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipCount;
+		uint32_t sourcePathLength;
+		uint32_t levelTableOffset;
+		int64_t sourceTime;
+	};
+
+	// entry of the level table
+	struct LEVEL_ENTRY
+	{
+		uint32_t width;
+		uint32_t height;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	/***********************************************************
+	 *  GetLevelSize()
+	 *
+	 *  Get the size in bytes of a mip level of a format.
+	 ***********************************************************/
+	size_t GetLevelSize(CompiledTexture::FORMAT format, int width, int height)
+	{
+		size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+		switch (format)
+		{
+		case CompiledTexture::FORMAT_RGB8:
+			return((size_t)width * height * 3);
+		case CompiledTexture::FORMAT_RGBA8:
+			return((size_t)width * height * 4);
+		case CompiledTexture::FORMAT_BC1:
+			return(blocks * 8);
+		case CompiledTexture::FORMAT_BC3:
+			return(blocks * 16);
+		}
+
+		return(0);
+	}
+
+	/***********************************************************
+	 *  Pack565()
+	 *
+	 *  Round an 8-bit color to 5 bits red, 6 green and 5 blue.
+	 ***********************************************************/
+	uint16_t Pack565(const int* color)
+	{
+		int r = (color[0] * 31 + 127) / 255;
+		int g = (color[1] * 63 + 127) / 255;
+		int b = (color[2] * 31 + 127) / 255;
+
+		return((uint16_t)((r << 11) | (g << 5) | b));
+	}
+
+	/***********************************************************
+	 *  Unpack565()
+	 *
+	 *  Expand a 5:6:5 color back to 8 bits per channel.
+	 ***********************************************************/
+	void Unpack565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	/***********************************************************
+	 *  CompressColorBlock()
+	 *
+	 *  Encode the colors of 16 RGBA pixels as a BC1 block.  The
+	 *  endpoints are the corners of the bounding box of the
+	 *  colors along the diagonal that follows how red and blue
+	 *  vary with green, pulled in slightly so the two in-between
+	 *  colors land nearer the pixels.
+	 ***********************************************************/
+	void CompressColorBlock(const unsigned char* block, unsigned char* output)
+	{
+		int minColor[3] = { 255, 255, 255 };
+		int maxColor[3] = { 0, 0, 0 };
+		int mean[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				minColor[c] = std::min(minColor[c], (int)block[i * 4 + c]);
+				maxColor[c] = std::max(maxColor[c], (int)block[i * 4 + c]);
+				mean[c] += block[i * 4 + c];
+			}
+		}
+
+		int covarianceRG = 0;
+		int covarianceBG = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			int g = block[i * 4 + 1] * 16 - mean[1];
+			covarianceRG += (block[i * 4] * 16 - mean[0]) * g;
+			covarianceBG += (block[i * 4 + 2] * 16 - mean[2]) * g;
+		}
+		if (covarianceRG < 0)
+		{
+			std::swap(minColor[0], maxColor[0]);
+		}
+		if (covarianceBG < 0)
+		{
+			std::swap(minColor[2], maxColor[2]);
+		}
+
+		for (int c = 0; c < 3; c++)
+		{
+			int inset = (maxColor[c] - minColor[c]) / 16;
+			maxColor[c] -= inset;
+			minColor[c] += inset;
+		}
+
+		uint16_t color0 = Pack565(maxColor);
+		uint16_t color1 = Pack565(minColor);
+		// the first endpoint must be the larger for four colors
+		if (color0 < color1)
+		{
+			std::swap(color0, color1);
+		}
+
+		int palette[4][3];
+		Unpack565(color0, palette[0]);
+		Unpack565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = INT32_MAX;
+				for (int p = 0; p < 4; p++)
+				{
+					int distance = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int difference = block[i * 4 + c] - palette[p][c];
+						distance += difference * difference;
+					}
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint32_t)bestIndex << (i * 2);
+			}
+		}
+
+		output[0] = (unsigned char)(color0 & 0xFF);
+		output[1] = (unsigned char)(color0 >> 8);
+		output[2] = (unsigned char)(color1 & 0xFF);
+		output[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			output[4 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	/***********************************************************
+	 *  CompressAlphaBlock()
+	 *
+	 *  Encode the alpha of 16 RGBA pixels as the alpha half of
+	 *  a BC3 block, with eight steps between the extremes.
+	 ***********************************************************/
+	void CompressAlphaBlock(const unsigned char* block, unsigned char* output)
+	{
+		int minAlpha = 255;
+		int maxAlpha = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			minAlpha = std::min(minAlpha, (int)block[i * 4 + 3]);
+			maxAlpha = std::max(maxAlpha, (int)block[i * 4 + 3]);
+		}
+
+		int palette[8];
+		palette[0] = maxAlpha;
+		palette[1] = minAlpha;
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+		}
+
+		uint64_t indices = 0;
+		if (maxAlpha != minAlpha)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int distance = std::abs(block[i * 4 + 3] - palette[p]);
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint64_t)bestIndex << (i * 3);
+			}
+		}
+
+		output[0] = (unsigned char)maxAlpha;
+		output[1] = (unsigned char)minAlpha;
+		for (int i = 0; i < 6; i++)
+		{
+			output[2 + i] = (unsigned char)(indices >> (i * 8));
+		}
+	}
+
+	/***********************************************************
+	 *  DecodeColorBlock()
+	 *
+	 *  Decode a BC1 color block into 16 RGBA pixels.  BC3
+	 *  blocks always use four colors, BC1 blocks use three and
+	 *  transparent black when the first endpoint is smaller.
+	 ***********************************************************/
+	void DecodeColorBlock(const unsigned char* input, bool bFourColors, unsigned char* block)
+	{
+		uint16_t color0 = (uint16_t)(input[0] | (input[1] << 8));
+		uint16_t color1 = (uint16_t)(input[2] | (input[3] << 8));
+		uint32_t indices = input[4] | (input[5] << 8) | (input[6] << 16) | ((uint32_t)input[7] << 24);
+
+		int palette[4][4];
+		Unpack565(color0, palette[0]);
+		Unpack565(color1, palette[1]);
+		palette[0][3] = 255;
+		palette[1][3] = 255;
+		palette[2][3] = 255;
+		palette[3][3] = 255;
+		for (int c = 0; c < 3; c++)
+		{
+			if ((bFourColors == true) || (color0 > color1))
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+				palette[3][3] = 0;
+			}
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int index = (indices >> (i * 2)) & 3;
+			for (int c = 0; c < 4; c++)
+			{
+				block[i * 4 + c] = (unsigned char)palette[index][c];
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  DecodeAlphaBlock()
+	 *
+	 *  Decode the alpha half of a BC3 block into the alpha of
+	 *  16 RGBA pixels.
+	 ***********************************************************/
+	void DecodeAlphaBlock(const unsigned char* input, unsigned char* block)
+	{
+		int palette[8];
+		palette[0] = input[0];
+		palette[1] = input[1];
+		if (palette[0] > palette[1])
+		{
+			for (int i = 1; i < 7; i++)
+			{
+				palette[i + 1] = ((7 - i) * palette[0] + i * palette[1]) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+			{
+				palette[i + 1] = ((5 - i) * palette[0] + i * palette[1]) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= (uint64_t)input[2 + i] << (i * 8);
+		}
+		for (int i = 0; i < 16; i++)
+		{
+			block[i * 4 + 3] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+		}
+	}
+
+	/***********************************************************
+	 *  CompressLevel()
+	 *
+	 *  Encode a mip level as BC1 or BC3 blocks.  Blocks that
+	 *  reach past the edge of the level repeat its last row
+	 *  and column.
+	 ***********************************************************/
+	void CompressLevel(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int channels,
+		CompiledTexture::FORMAT format,
+		unsigned char* output)
+	{
+		size_t blockSize = (format == CompiledTexture::FORMAT_BC3) ? 16 : 8;
+		unsigned char block[16 * 4];
+		for (int blockY = 0; blockY < height; blockY += 4)
+		{
+			for (int blockX = 0; blockX < width; blockX += 4)
+			{
+				for (int i = 0; i < 16; i++)
+				{
+					int x = std::min(blockX + (i & 3), width - 1);
+					int y = std::min(blockY + (i >> 2), height - 1);
+					const unsigned char* pixel = &pixels[((size_t)y * width + x) * channels];
+					block[i * 4] = pixel[0];
+					block[i * 4 + 1] = pixel[1];
+					block[i * 4 + 2] = pixel[2];
+					block[i * 4 + 3] = (channels == 4) ? pixel[3] : 255;
+				}
+
+				if (format == CompiledTexture::FORMAT_BC3)
+				{
+					CompressAlphaBlock(block, output);
+					CompressColorBlock(block, output + 8);
+				}
+				else
+				{
+					CompressColorBlock(block, output);
+				}
+				output += blockSize;
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  BuildNextLevel()
+	 *
+	 *  Halve a mip level by averaging every 2x2 pixels.  An odd
+	 *  last row or column is averaged with itself.
+	 ***********************************************************/
+	void BuildNextLevel(
+		const std::vector<unsigned char>& pixels,
+		int width,
+		int height,
+		int channels,
+		std::vector<unsigned char>& outPixels)
+	{
+		int nextWidth = std::max(1, width / 2);
+		int nextHeight = std::max(1, height / 2);
+		outPixels.resize((size_t)nextWidth * nextHeight * channels);
+
+		for (int y = 0; y < nextHeight; y++)
+		{
+			const unsigned char* row0 = &pixels[(size_t)std::min(y * 2, height - 1) * width * channels];
+			const unsigned char* row1 = &pixels[(size_t)std::min(y * 2 + 1, height - 1) * width * channels];
+			unsigned char* output = &outPixels[(size_t)y * nextWidth * channels];
+			for (int x = 0; x < nextWidth; x++)
+			{
+				int x0 = std::min(x * 2, width - 1) * channels;
+				int x1 = std::min(x * 2 + 1, width - 1) * channels;
+				for (int c = 0; c < channels; c++)
+				{
+					output[x * channels + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  CreateCacheDirectory()
+	 *
+	 *  Create the directory of the cache files if it is
+	 *  missing.
+	 ***********************************************************/
+	void CreateCacheDirectory()
+	{
+#ifdef _WIN32
+		_mkdir(g_CacheDirectory);
+#else
+		mkdir(g_CacheDirectory, 0755);
+#endif
+	}
+}
+
+/***********************************************************
+ *  CompiledTexture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CompiledTexture::CompiledTexture()
+{
+	m_format = FORMAT_RGBA8;
+}
+
+/***********************************************************
+ *  ~CompiledTexture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CompiledTexture::~CompiledTexture()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the full mip chain of a
+ *  texture from its decoded pixels.  With bCompress, images
+ *  without alpha are stored as BC1 and images with alpha as
+ *  BC3, which take an eighth and a quarter of the memory of
+ *  RGBA pixels.
+ ***********************************************************/
+bool CompiledTexture::Build(const unsigned char* pixels, int width, int height, int channels, bool bCompress)
+{
+	Clear();
+
+	if ((pixels == NULL) || (width <= 0) || (height <= 0) || ((channels != 3) && (channels != 4)))
+	{
+		std::cout << "Cannot compile a " << width << "x" << height << " texture with " << channels << " channels" << std::endl;
+		return(false);
+	}
+
+	if (bCompress == true)
+	{
+		m_format = (channels == 4) ? FORMAT_BC3 : FORMAT_BC1;
+	}
+	else
+	{
+		m_format = (channels == 4) ? FORMAT_RGBA8 : FORMAT_RGB8;
+	}
+
+	// levels are stored 16-byte aligned, as in the cache file
+	std::vector<size_t> offsets;
+	std::vector<unsigned char> level(pixels, pixels + (size_t)width * height * channels);
+	std::vector<unsigned char> nextLevel;
+	int levelWidth = width;
+	int levelHeight = height;
+	while (true)
+	{
+		size_t offset = (m_storage.size() + 15) & ~(size_t)15;
+		size_t size = GetLevelSize(m_format, levelWidth, levelHeight);
+		m_storage.resize(offset + size);
+		if ((m_format == FORMAT_BC1) || (m_format == FORMAT_BC3))
+		{
+			CompressLevel(&level[0], levelWidth, levelHeight, channels, m_format, &m_storage[offset]);
+		}
+		else
+		{
+			memcpy(&m_storage[offset], &level[0], size);
+		}
+
+		MIP_LEVEL mipLevel;
+		mipLevel.width = levelWidth;
+		mipLevel.height = levelHeight;
+		mipLevel.pData = NULL;
+		mipLevel.size = size;
+		m_levels.push_back(mipLevel);
+		offsets.push_back(offset);
+
+		if ((levelWidth == 1) && (levelHeight == 1))
+		{
+			break;
+		}
+		BuildNextLevel(level, levelWidth, levelHeight, channels, nextLevel);
+		level.swap(nextLevel);
+		levelWidth = std::max(1, levelWidth / 2);
+		levelHeight = std::max(1, levelHeight / 2);
+	}
+
+	// the storage no longer moves, so the levels can point into it
+	for (size_t i = 0; i < m_levels.size(); i++)
+	{
+		m_levels[i].pData = &m_storage[offsets[i]];
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the built texture to a
+ *  cache file, along with the path and modification time of
+ *  the source image it was built from.
+ ***********************************************************/
+bool CompiledTexture::Save(const char* filename, const char* sourceFilename) const
+{
+	if (m_storage.empty())
+	{
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, g_CacheMagic, sizeof(g_CacheMagic));
+	header.version = g_CacheVersion;
+	header.format = (uint32_t)m_format;
+	header.width = (uint32_t)m_levels[0].width;
+	header.height = (uint32_t)m_levels[0].height;
+	header.mipCount = (uint32_t)m_levels.size();
+	header.sourcePathLength = (uint32_t)strlen(sourceFilename);
+	header.levelTableOffset = (uint32_t)((sizeof(header) + header.sourcePathLength + 7) & ~(size_t)7);
+	header.sourceTime = MappedFile::GetModificationTime(sourceFilename);
+
+	// the texel data follows the level table, 16-byte aligned
+	size_t dataOffset = (header.levelTableOffset + sizeof(LEVEL_ENTRY) * m_levels.size() + 15) & ~(size_t)15;
+	std::vector<LEVEL_ENTRY> levelTable(m_levels.size());
+	for (size_t i = 0; i < m_levels.size(); i++)
+	{
+		levelTable[i].width = (uint32_t)m_levels[i].width;
+		levelTable[i].height = (uint32_t)m_levels[i].height;
+		levelTable[i].offset = dataOffset + (m_levels[i].pData - &m_storage[0]);
+		levelTable[i].size = m_levels[i].size;
+	}
+	std::vector<char> padding(16, 0);
+
+	CreateCacheDirectory();
+	std::ofstream cacheFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!cacheFile)
+	{
+		std::cout << "Could not write texture cache file:" << filename << std::endl;
+		return(false);
+	}
+
+	cacheFile.write((const char*)&header, sizeof(header));
+	cacheFile.write(sourceFilename, header.sourcePathLength);
+	cacheFile.write(&padding[0], header.levelTableOffset - sizeof(header) - header.sourcePathLength);
+	cacheFile.write((const char*)&levelTable[0], sizeof(LEVEL_ENTRY) * levelTable.size());
+	cacheFile.write(&padding[0], dataOffset - header.levelTableOffset - sizeof(LEVEL_ENTRY) * levelTable.size());
+	cacheFile.write((const char*)&m_storage[0], m_storage.size());
+
+	return(cacheFile.good());
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for mapping a cache file into memory.
+ *  The file is only used if it was built from the passed in
+ *  source image as it is now, and the levels are used from
+ *  the mapped file without being copied.
+ ***********************************************************/
+bool CompiledTexture::Load(const char* filename, const char* sourceFilename)
+{
+	Clear();
+
+	if (m_mappedFile.Open(filename) == false)
+	{
+		return(false);
+	}
+
+	const unsigned char* pData = m_mappedFile.GetData();
+	size_t fileSize = m_mappedFile.GetSize();
+
+	// a cache of another image or an older version of this one
+	// is not an error, the texture is compiled again
+	CACHE_HEADER header;
+	size_t sourcePathLength = strlen(sourceFilename);
+	bool bCurrent = (fileSize >= sizeof(header));
+	if (bCurrent)
+	{
+		memcpy(&header, pData, sizeof(header));
+		bCurrent = (memcmp(header.magic, g_CacheMagic, sizeof(g_CacheMagic)) == 0) &&
+			(header.version == g_CacheVersion) &&
+			(header.sourcePathLength == sourcePathLength) &&
+			(sizeof(header) + sourcePathLength <= fileSize) &&
+			(memcmp(pData + sizeof(header), sourceFilename, sourcePathLength) == 0) &&
+			(header.sourceTime == MappedFile::GetModificationTime(sourceFilename));
+	}
+	if (bCurrent == false)
+	{
+		Clear();
+		return(false);
+	}
+
+	// validate the level table and the extents of the levels
+	bool bValid = (header.format <= FORMAT_BC3) &&
+		(header.mipCount > 0) && (header.mipCount <= g_MaxMipLevels) &&
+		(header.levelTableOffset % 8 == 0) &&
+		(header.levelTableOffset + (uint64_t)header.mipCount * sizeof(LEVEL_ENTRY) <= fileSize);
+	if (bValid)
+	{
+		m_format = (FORMAT)header.format;
+		const LEVEL_ENTRY* pLevelTable = (const LEVEL_ENTRY*)(pData + header.levelTableOffset);
+		for (uint32_t i = 0; (i < header.mipCount) && (bValid == true); i++)
+		{
+			const LEVEL_ENTRY& entry = pLevelTable[i];
+			bValid = (entry.width > 0) && (entry.height > 0) &&
+				(entry.size == GetLevelSize(m_format, (int)entry.width, (int)entry.height)) &&
+				(entry.offset + entry.size <= fileSize);
+
+			MIP_LEVEL mipLevel;
+			mipLevel.width = (int)entry.width;
+			mipLevel.height = (int)entry.height;
+			mipLevel.pData = pData + entry.offset;
+			mipLevel.size = (size_t)entry.size;
+			m_levels.push_back(mipLevel);
+		}
+	}
+
+	if (bValid == false)
+	{
+		std::cout << "Invalid texture cache file:" << filename << std::endl;
+		Clear();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for releasing the built texture or
+ *  the mapped cache file.
+ ***********************************************************/
+void CompiledTexture::Clear()
+{
+	m_levels.clear();
+	m_storage.clear();
+	m_mappedFile.Close();
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for uploading every mip level into
+ *  the passed in texture, replacing what it held before.
+ *  The active texture unit is left without a texture bound.
+ ***********************************************************/
+bool CompiledTexture::Upload(GLuint textureID) const
+{
+	if (m_levels.empty())
+	{
+		return(false);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	// rows of RGB pixels are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (size_t i = 0; i < m_levels.size(); i++)
+	{
+		const MIP_LEVEL& level = m_levels[i];
+		switch (m_format)
+		{
+		case FORMAT_RGB8:
+			glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGB8, level.width, level.height, 0, GL_RGB, GL_UNSIGNED_BYTE, level.pData);
+			break;
+		case FORMAT_RGBA8:
+			glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level.pData);
+			break;
+		case FORMAT_BC1:
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+				level.width, level.height, 0, (GLsizei)level.size, level.pData);
+			break;
+		case FORMAT_BC3:
+			glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+				level.width, level.height, 0, (GLsizei)level.size, level.pData);
+			break;
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)m_levels.size() - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DecodeLevel()
+ *
+ *  This method is used for decoding a mip level back to
+ *  RGBA pixels, in the row order they were built from, for
+ *  comparing the cached texture with the source image.
+ ***********************************************************/
+bool CompiledTexture::DecodeLevel(int level, std::vector<unsigned char>& outPixels) const
+{
+	if ((level < 0) || (level >= (int)m_levels.size()))
+	{
+		return(false);
+	}
+
+	const MIP_LEVEL& mipLevel = m_levels[level];
+	outPixels.resize((size_t)mipLevel.width * mipLevel.height * 4);
+
+	if ((m_format == FORMAT_RGB8) || (m_format == FORMAT_RGBA8))
+	{
+		int channels = (m_format == FORMAT_RGBA8) ? 4 : 3;
+		for (size_t i = 0; i < (size_t)mipLevel.width * mipLevel.height; i++)
+		{
+			outPixels[i * 4] = mipLevel.pData[i * channels];
+			outPixels[i * 4 + 1] = mipLevel.pData[i * channels + 1];
+			outPixels[i * 4 + 2] = mipLevel.pData[i * channels + 2];
+			outPixels[i * 4 + 3] = (channels == 4) ? mipLevel.pData[i * channels + 3] : 255;
+		}
+		return(true);
+	}
+
+	const unsigned char* input = mipLevel.pData;
+	unsigned char block[16 * 4];
+	for (int blockY = 0; blockY < mipLevel.height; blockY += 4)
+	{
+		for (int blockX = 0; blockX < mipLevel.width; blockX += 4)
+		{
+			if (m_format == FORMAT_BC3)
+			{
+				DecodeColorBlock(input + 8, true, block);
+				DecodeAlphaBlock(input, block);
+				input += 16;
+			}
+			else
+			{
+				DecodeColorBlock(input, false, block);
+				input += 8;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int x = blockX + (i & 3);
+				int y = blockY + (i >> 2);
+				if ((x < mipLevel.width) && (y < mipLevel.height))
+				{
+					memcpy(&outPixels[((size_t)y * mipLevel.width + x) * 4], &block[i * 4], 4);
+				}
+			}
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetDataSize()
+ *
+ *  This method is used for getting the size in bytes of all
+ *  the mip levels, which is what the texture takes on the
+ *  GPU.
+ ***********************************************************/
+size_t CompiledTexture::GetDataSize() const
+{
+	size_t size = 0;
+	for (size_t i = 0; i < m_levels.size(); i++)
+	{
+		size += m_levels[i].size;
+	}
+
+	return(size);
+}
+
+/***********************************************************
+ *  GetCacheFilename()
+ *
+ *  This method is used for getting the cache file for a
+ *  source image, named after the FNV-1a hash of its path.
+ ***********************************************************/
+std::string CompiledTexture::GetCacheFilename(const char* sourceFilename)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (const char* pCharacter = sourceFilename; *pCharacter != '\0'; pCharacter++)
+	{
+		hash ^= (unsigned char)*pCharacter;
+		hash *= 1099511628211ull;
+	}
+
+	std::ostringstream filename;
+	filename << g_CacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << hash << ".texb";
+
+	return(filename.str());
+}
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// compiledtexture.h
+// ============
+// cache textures with their mipmaps in a format ready for upload
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  CompiledTexture
+ *
+ *  This class contains the code for building a texture with
+ *  its full mip chain from decoded pixels, optionally block
+ *  compressed, and for saving it to and mapping it from a
+ *  cache file.  A cached texture is uploaded straight from
+ *  the mapped file, without decoding the image or
+ *  generating mipmaps.
+ *
+ *  Cache files are named after a hash of the source image
+ *  path and remember the path and modification time of the
+ *  image, so a changed image is compiled again.
+ ***********************************************************/
+class CompiledTexture
+{
+public:
+	// constructor
+	CompiledTexture();
+	// destructor
+	~CompiledTexture();
+
+	// layout of the texel data of every mip level
+	enum FORMAT
+	{
+		FORMAT_RGB8 = 0,
+		FORMAT_RGBA8,
+		// 4x4 blocks of 8 bytes, for images without alpha
+		FORMAT_BC1,
+		// 4x4 blocks of 16 bytes, for images with alpha
+		FORMAT_BC3
+	};
+
+	// one level of the mip chain
+	struct MIP_LEVEL
+	{
+		int width;
+		int height;
+		const unsigned char* pData;
+		size_t size;
+	};
+
+	// build the mip chain from decoded RGB or RGBA pixels
+	bool Build(const unsigned char* pixels, int width, int height, int channels, bool bCompress);
+	// write the built texture to a cache file
+	bool Save(const char* filename, const char* sourceFilename) const;
+	// map a cache file, failing if it is not for the current
+	// contents of the source image
+	bool Load(const char* filename, const char* sourceFilename);
+	// release the built or mapped texture
+	void Clear();
+
+	// upload every mip level into the passed in texture
+	bool Upload(GLuint textureID) const;
+	// decode a mip level to RGBA pixels, rows from bottom to top
+	bool DecodeLevel(int level, std::vector<unsigned char>& outPixels) const;
+
+	// get the texture layout
+	FORMAT GetFormat() const { return m_format; }
+	int GetMipCount() const { return (int)m_levels.size(); }
+	const MIP_LEVEL& GetLevel(int level) const { return m_levels[level]; }
+	// get the size of all mip levels in bytes
+	size_t GetDataSize() const;
+
+	// get the cache file for a source image
+	static std::string GetCacheFilename(const char* sourceFilename);
+
+private:
+	FORMAT m_format;
+	// mip levels, pointing into one of the two below
+	std::vector<MIP_LEVEL> m_levels;
+	// storage for a built texture
+	std::vector<unsigned char> m_storage;
+	// mapping of a cache file, used in place
+	MappedFile m_mappedFile;
+
+	// compiled textures may point into their own storage, so
+	// they cannot be copied
+	CompiledTexture(const CompiledTexture&);
+	CompiledTexture& operator=(const CompiledTexture&);
+};
@@ -0,0 +1,220 @@
+#include "CullingKernels.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CULLING_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+// MSVC allows AVX2 intrinsics in any function
+#define KERNEL_TARGET_AVX2
+#else
+// GCC and Clang need AVX2 code generation enabled per function
+#define KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// declaration of global variables
+namespace
+{
+	const int g_PlaneCount = 6;
+
+	/***********************************************************
+	 *  CullScalar()
+	 *
+	 *  Test spheres [first, first + count) one at a time.
+	 ***********************************************************/
+	int CullScalar(
+		const CullingKernels::FRUSTUM& frustum,
+		const CullingKernels::SPHERE_SOA& s,
+		int first,
+		int count,
+		unsigned char* out)
+	{
+		int visibleCount = 0;
+		for (int i = first; i < first + count; i++)
+		{
+			bool bVisible = true;
+			for (int p = 0; (p < g_PlaneCount) && (bVisible == true); p++)
+			{
+				const float* plane = frustum.planes[p];
+				float distance = plane[0] * s.centerX[i] + plane[1] * s.centerY[i] + plane[2] * s.centerZ[i] + plane[3];
+				bVisible = (distance >= -s.radius[i]);
+			}
+			out[i] = bVisible ? 1 : 0;
+			visibleCount += out[i];
+		}
+
+		return(visibleCount);
+	}
+
+#ifdef CULLING_KERNELS_X86
+	/***********************************************************
+	 *  CullSSE()
+	 *
+	 *  Test spheres 4 at a time, finishing the remainder with
+	 *  the scalar kernel.
+	 ***********************************************************/
+	int CullSSE(
+		const CullingKernels::FRUSTUM& frustum,
+		const CullingKernels::SPHERE_SOA& s,
+		int first,
+		int count,
+		unsigned char* out)
+	{
+		int visibleCount = 0;
+		int i = first;
+		for (; i + 4 <= first + count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(s.centerX + i);
+			__m128 y = _mm_loadu_ps(s.centerY + i);
+			__m128 z = _mm_loadu_ps(s.centerZ + i);
+			__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(s.radius + i));
+
+			// set for spheres fully outside any of the planes
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < g_PlaneCount; p++)
+			{
+				const float* plane = frustum.planes[p];
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), x), _mm_mul_ps(_mm_set1_ps(plane[1]), y)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), z), _mm_set1_ps(plane[3])));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+			}
+
+			int outsideMask = _mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				out[i + lane] = ((outsideMask >> lane) & 1) ? 0 : 1;
+				visibleCount += out[i + lane];
+			}
+		}
+
+		return(visibleCount + CullScalar(frustum, s, i, first + count - i, out));
+	}
+
+	/***********************************************************
+	 *  CullAVX2()
+	 *
+	 *  Test spheres 8 at a time, finishing the remainder with
+	 *  the SSE kernel.
+	 ***********************************************************/
+	KERNEL_TARGET_AVX2 int CullAVX2(
+		const CullingKernels::FRUSTUM& frustum,
+		const CullingKernels::SPHERE_SOA& s,
+		int first,
+		int count,
+		unsigned char* out)
+	{
+		int visibleCount = 0;
+		int i = first;
+		for (; i + 8 <= first + count; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(s.centerX + i);
+			__m256 y = _mm256_loadu_ps(s.centerY + i);
+			__m256 z = _mm256_loadu_ps(s.centerZ + i);
+			__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(s.radius + i));
+
+			// set for spheres fully outside any of the planes
+			__m256 outside = _mm256_setzero_ps();
+			for (int p = 0; p < g_PlaneCount; p++)
+			{
+				const float* plane = frustum.planes[p];
+				__m256 distance = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), x), _mm256_mul_ps(_mm256_set1_ps(plane[1]), y)),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[2]), z), _mm256_set1_ps(plane[3])));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negativeRadius, _CMP_LT_OQ));
+			}
+
+			int outsideMask = _mm256_movemask_ps(outside);
+			for (int lane = 0; lane < 8; lane++)
+			{
+				out[i + lane] = ((outsideMask >> lane) & 1) ? 0 : 1;
+				visibleCount += out[i + lane];
+			}
+		}
+
+		return(visibleCount + CullSSE(frustum, s, i, first + count - i, out));
+	}
+#endif
+}
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This function is used for getting the six frustum planes
+ *  from the rows of a view-projection matrix.  A point is
+ *  inside the clip volume when -w <= x, y, z <= w, and each
+ *  of those six inequalities is one plane.
+ ***********************************************************/
+void CullingKernels::ExtractFrustum(const glm::mat4& viewProjection, FRUSTUM& frustum)
+{
+	// glm matrices are column-major, so row r is m[0][r] .. m[3][r]
+	for (int axis = 0; axis < 3; axis++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			float sign = (side == 0) ? 1.0f : -1.0f;
+			float* plane = frustum.planes[axis * 2 + side];
+			for (int column = 0; column < 4; column++)
+			{
+				plane[column] = viewProjection[column][3] + sign * viewProjection[column][axis];
+			}
+
+			float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			if (length > 0.0f)
+			{
+				for (int column = 0; column < 4; column++)
+				{
+					plane[column] /= length;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  CullSpheres()
+ *
+ *  This function is used for testing bounding spheres
+ *  against the frustum with the fastest supported kernel.
+ ***********************************************************/
+int CullingKernels::CullSpheres(
+	const FRUSTUM& frustum,
+	const SPHERE_SOA& spheres,
+	int count,
+	unsigned char* outVisible)
+{
+	return(CullSpheres(TransformKernels::GetDefaultKernel(), frustum, spheres, count, outVisible));
+}
+
+/***********************************************************
+ *  CullSpheres()
+ *
+ *  This function is used for testing bounding spheres
+ *  against the frustum with the passed in kernel.
+ ***********************************************************/
+int CullingKernels::CullSpheres(
+	TransformKernels::KERNEL kernel,
+	const FRUSTUM& frustum,
+	const SPHERE_SOA& spheres,
+	int count,
+	unsigned char* outVisible)
+{
+	if (count <= 0)
+	{
+		return(0);
+	}
+
+	switch (kernel)
+	{
+#ifdef CULLING_KERNELS_X86
+	case TransformKernels::KERNEL_AVX2:
+		return(CullAVX2(frustum, spheres, 0, count, outVisible));
+	case TransformKernels::KERNEL_SSE:
+		return(CullSSE(frustum, spheres, 0, count, outVisible));
+#endif
+	default:
+		return(CullScalar(frustum, spheres, 0, count, outVisible));
+	}
+}
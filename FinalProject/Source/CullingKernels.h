@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// cullingkernels.h
+// ============
+// test many bounding spheres against the view frustum at once
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TransformKernels.h"
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  CullingKernels
+ *
+ *  These functions extract the six planes of the view
+ *  frustum from a view-projection matrix and test packed
+ *  bounding spheres against them, 4 at a time with SSE or 8
+ *  at a time with AVX2.  The instruction set is picked the
+ *  same way as for the transform kernels.
+ ***********************************************************/
+namespace CullingKernels
+{
+	// planes of the view frustum - left, right, bottom, top,
+	// near and far - as normalized (a, b, c, d) with points
+	// inside the frustum where a*x + b*y + c*z + d >= 0
+	struct FRUSTUM
+	{
+		float planes[6][4];
+	};
+
+	// world space bounding spheres, one array per component
+	struct SPHERE_SOA
+	{
+		const float* centerX;
+		const float* centerY;
+		const float* centerZ;
+		const float* radius;
+	};
+
+	// extract the frustum planes from a view-projection matrix
+	void ExtractFrustum(const glm::mat4& viewProjection, FRUSTUM& frustum);
+
+	// test spheres [0, count) against the frustum, writing 1 to
+	// outVisible for spheres that are at least partly inside
+	// and 0 for the others, using the fastest supported kernel,
+	// and get the number of visible spheres
+	int CullSpheres(
+		const FRUSTUM& frustum,
+		const SPHERE_SOA& spheres,
+		int count,
+		unsigned char* outVisible);
+
+	// same as above with an explicitly chosen kernel, which
+	// must be supported by the processor
+	int CullSpheres(
+		TransformKernels::KERNEL kernel,
+		const FRUSTUM& frustum,
+		const SPHERE_SOA& spheres,
+		int count,
+		unsigned char* outVisible);
+}
@@ -0,0 +1,367 @@
+#include "FrameCapture.h"
+#include "ImageWriter.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// how long one wait for a read back fence lasts before it is
+	// retried, in nanoseconds
+	const GLuint64 g_FenceWaitNanoseconds = 1000000000;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	m_firstSlot = 0;
+	m_slotsInFlight = 0;
+	m_width = 0;
+	m_height = 0;
+	m_bDropWhenFull = false;
+	m_maxJobs = 0;
+	m_jobsWriting = 0;
+	m_bStopWriter = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_totalLatencyMs = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the ring of pixel buffer
+ *  objects the frames are read back into and starting the
+ *  writer thread.  When bDropWhenFull is set, frames are
+ *  dropped rather than waited for once the ring or the
+ *  writer falls behind.
+ ***********************************************************/
+bool FrameCapture::Create(int width, int height, int ringSize, bool bDropWhenFull)
+{
+	Destroy();
+
+	if ((width <= 0) || (height <= 0) || (ringSize <= 0))
+	{
+		std::cout << "Invalid frame capture size " << width << "x" << height
+			<< " with " << ringSize << " buffers" << std::endl;
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_bDropWhenFull = bDropWhenFull;
+
+	m_slots.resize(ringSize);
+	for (int i = 0; i < ringSize; i++)
+	{
+		glGenBuffers(1, &m_slots[i].pixelBuffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].pixelBuffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+		m_slots[i].fence = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_firstSlot = 0;
+	m_slotsInFlight = 0;
+
+	// frames waiting to be written hold as much memory as the ring
+	m_maxJobs = ringSize;
+	m_jobsWriting = 0;
+	m_bStopWriter = false;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_totalLatencyMs = 0.0;
+	m_writer = std::thread(&FrameCapture::WriterThread, this);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for writing the frames that are
+ *  still in flight, stopping the writer thread and freeing
+ *  the pixel buffer objects.
+ ***********************************************************/
+void FrameCapture::Destroy()
+{
+	if (m_slots.empty())
+	{
+		return;
+	}
+
+	Flush();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopWriter = true;
+	}
+	m_jobReady.notify_all();
+	m_writer.join();
+
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		glDeleteBuffers(1, &m_slots[i].pixelBuffer);
+	}
+	m_slots.clear();
+	m_freeBuffers.clear();
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is used for starting the read back of the
+ *  color buffer of the passed in framebuffer, 0 for the
+ *  window, into the next pixel buffer object.  The read runs
+ *  on the GPU and a fence marks when it is done, so nothing
+ *  waits here unless the whole ring is still in flight.
+ ***********************************************************/
+bool FrameCapture::CaptureFrame(GLuint framebuffer, const std::string& filename)
+{
+	if (m_slots.empty())
+	{
+		return(false);
+	}
+
+	Update();
+
+	if (m_slotsInFlight == (int)m_slots.size())
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (m_bDropWhenFull == true)
+		{
+			m_stats.droppedFrames++;
+			return(false);
+		}
+		m_stats.stalledFrames++;
+		lock.unlock();
+
+		RetireSlot(m_slots[m_firstSlot], true);
+	}
+
+	READBACK_SLOT& slot = m_slots[(m_firstSlot + m_slotsInFlight) % m_slots.size()];
+
+	// rows of RGBA pixels need no conversion or padding, which
+	// keeps the read on the driver's fast path
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// flush so the fence is sure to signal without being waited on
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+	slot.filename = filename;
+	slot.captureTime = Clock::now();
+	m_slotsInFlight++;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stats.capturedFrames++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for handing every read back that has
+ *  finished to the writer thread, oldest first, without
+ *  waiting for the ones that have not.
+ ***********************************************************/
+void FrameCapture::Update()
+{
+	while ((m_slotsInFlight > 0) && (RetireSlot(m_slots[m_firstSlot], false) == true))
+	{
+	}
+}
+
+/***********************************************************
+ *  Flush()
+ *
+ *  This method is used for waiting until every captured
+ *  frame has been read back and written to disk.
+ ***********************************************************/
+void FrameCapture::Flush()
+{
+	while (m_slotsInFlight > 0)
+	{
+		RetireSlot(m_slots[m_firstSlot], true);
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_jobDone.wait(lock, [this] { return (m_jobs.empty() && (m_jobsWriting == 0)); });
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the counters of the
+ *  frames captured so far and how long they took to reach
+ *  the disk.
+ ***********************************************************/
+FrameCapture::CAPTURE_STATS FrameCapture::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	CAPTURE_STATS stats = m_stats;
+	if (stats.writtenFrames > 0)
+	{
+		stats.averageLatencyMs = m_totalLatencyMs / stats.writtenFrames;
+	}
+
+	return(stats);
+}
+
+/***********************************************************
+ *  RetireSlot()
+ *
+ *  This method is used for copying the pixels of a finished
+ *  read back out of the oldest pixel buffer object and
+ *  queueing them for the writer thread.  Without bWait it
+ *  returns false at once if the GPU has not finished the
+ *  read.  A full writer queue is waited for, or the frame is
+ *  dropped when dropping is allowed.
+ ***********************************************************/
+bool FrameCapture::RetireSlot(READBACK_SLOT& slot, bool bWait)
+{
+	GLenum waitResult = glClientWaitSync(slot.fence, 0, 0);
+	while ((bWait == true) && (waitResult == GL_TIMEOUT_EXPIRED))
+	{
+		waitResult = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceWaitNanoseconds);
+	}
+	if (waitResult == GL_TIMEOUT_EXPIRED)
+	{
+		return(false);
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	m_firstSlot = (m_firstSlot + 1) % m_slots.size();
+	m_slotsInFlight--;
+
+	WRITE_JOB job;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (waitResult == GL_WAIT_FAILED)
+		{
+			std::cout << "Could not read back frame " << slot.filename << std::endl;
+			m_stats.failedFrames++;
+			return(true);
+		}
+		if (m_jobs.size() >= m_maxJobs)
+		{
+			if (m_bDropWhenFull == true)
+			{
+				m_stats.droppedFrames++;
+				return(true);
+			}
+			m_stats.stalledFrames++;
+			m_jobDone.wait(lock, [this] { return (m_jobs.size() < m_maxJobs); });
+		}
+		if (m_freeBuffers.empty() == false)
+		{
+			job.pixels.swap(m_freeBuffers.back());
+			m_freeBuffers.pop_back();
+		}
+	}
+
+	size_t imageSize = (size_t)m_width * m_height * 4;
+	job.pixels.resize(imageSize);
+	job.filename = slot.filename;
+	job.captureTime = slot.captureTime;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+	void* mappedPixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, imageSize, GL_MAP_READ_BIT);
+	bool bMapped = (mappedPixels != NULL);
+	if (bMapped == true)
+	{
+		memcpy(&job.pixels[0], mappedPixels, imageSize);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (bMapped == false)
+	{
+		std::cout << "Could not map the read back of frame " << slot.filename << std::endl;
+		m_stats.failedFrames++;
+		m_freeBuffers.push_back(std::move(job.pixels));
+		return(true);
+	}
+	m_jobs.push_back(std::move(job));
+	m_jobReady.notify_one();
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriterThread()
+ *
+ *  This method is used for encoding and writing the queued
+ *  frames on the writer thread.  OpenGL reads the bottom row
+ *  first, so the rows are flipped while the alpha channel is
+ *  dropped.
+ ***********************************************************/
+void FrameCapture::WriterThread()
+{
+	std::vector<unsigned char> rgbPixels((size_t)m_width * m_height * 3);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_jobReady.wait(lock, [this] { return (m_bStopWriter || (m_jobs.empty() == false)); });
+		if (m_jobs.empty())
+		{
+			break;
+		}
+
+		WRITE_JOB job = std::move(m_jobs.front());
+		m_jobs.pop_front();
+		m_jobsWriting++;
+		lock.unlock();
+		m_jobDone.notify_all();
+
+		for (int y = 0; y < m_height; y++)
+		{
+			const unsigned char* source = &job.pixels[(size_t)(m_height - 1 - y) * m_width * 4];
+			unsigned char* destination = &rgbPixels[(size_t)y * m_width * 3];
+			for (int x = 0; x < m_width; x++)
+			{
+				destination[x * 3] = source[x * 4];
+				destination[x * 3 + 1] = source[x * 4 + 1];
+				destination[x * 3 + 2] = source[x * 4 + 2];
+			}
+		}
+		bool bWritten = ImageWriter::WriteImage(job.filename.c_str(), m_width, m_height, rgbPixels);
+		double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - job.captureTime).count();
+
+		lock.lock();
+		if (bWritten == true)
+		{
+			m_stats.writtenFrames++;
+			m_totalLatencyMs += latencyMs;
+			if (latencyMs > m_stats.maxLatencyMs)
+			{
+				m_stats.maxLatencyMs = latencyMs;
+			}
+		}
+		else
+		{
+			m_stats.failedFrames++;
+		}
+		m_freeBuffers.push_back(std::move(job.pixels));
+		m_jobsWriting--;
+		m_jobDone.notify_all();
+	}
+}
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// save rendered frames to disk without stalling the render loop
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class reads frames back through a ring of pixel
+ *  buffer objects.  Each read is started on the GPU and
+ *  guarded by a fence, and the pixels are only mapped once
+ *  the fence has signalled, a frame or more later.  The
+ *  mapped pixels are handed to a writer thread which flips,
+ *  converts and encodes them, so the render loop only waits
+ *  when every buffer in the ring is still being read back,
+ *  or it drops the frame instead when asked to.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+	struct CAPTURE_STATS
+	{
+		// frames whose read back was started
+		unsigned int capturedFrames;
+		// frames saved to disk
+		unsigned int writtenFrames;
+		// frames skipped because the ring or writer was full
+		unsigned int droppedFrames;
+		// frames that waited for a full ring or writer
+		unsigned int stalledFrames;
+		// frames the writer could not save
+		unsigned int failedFrames;
+		// time from capturing a frame to its file being written
+		double averageLatencyMs;
+		double maxLatencyMs;
+	};
+
+	// create the ring of read back buffers for frames of the
+	// passed in size and start the writer thread
+	bool Create(int width, int height, int ringSize, bool bDropWhenFull);
+	// write the frames still in flight and free the buffers
+	void Destroy();
+
+	// start reading back the color buffer of the passed in
+	// framebuffer, returning false if the frame was dropped
+	bool CaptureFrame(GLuint framebuffer, const std::string& filename);
+	// hand the finished read backs to the writer thread
+	void Update();
+	// wait until every captured frame has been written
+	void Flush();
+
+	// get the counters of the frames captured so far
+	CAPTURE_STATS GetStats();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// one pixel buffer object of the ring
+	struct READBACK_SLOT
+	{
+		GLuint pixelBuffer;
+		GLsync fence;
+		std::string filename;
+		Clock::time_point captureTime;
+	};
+
+	// pixels waiting for the writer thread
+	struct WRITE_JOB
+	{
+		std::vector<unsigned char> pixels;
+		std::string filename;
+		Clock::time_point captureTime;
+	};
+
+	// copy a finished read back to the writer thread
+	bool RetireSlot(READBACK_SLOT& slot, bool bWait);
+	// encode and write the queued frames
+	void WriterThread();
+
+	std::vector<READBACK_SLOT> m_slots;
+	// oldest slot in flight and the number in flight
+	int m_firstSlot;
+	int m_slotsInFlight;
+	int m_width;
+	int m_height;
+	bool m_bDropWhenFull;
+
+	std::thread m_writer;
+	std::mutex m_mutex;
+	// signalled when a job is queued or the writer should stop
+	std::condition_variable m_jobReady;
+	// signalled when the writer finishes a job
+	std::condition_variable m_jobDone;
+	std::deque<WRITE_JOB> m_jobs;
+	// pixel buffers returned by the writer for reuse
+	std::vector<std::vector<unsigned char>> m_freeBuffers;
+	size_t m_maxJobs;
+	int m_jobsWriting;
+	bool m_bStopWriter;
+	CAPTURE_STATS m_stats;
+	double m_totalLatencyMs;
+};
@@ -0,0 +1,288 @@
+#include "FrameScheduler.h"
+
+#ifdef _WIN32
+// the system timer period, which sleeps are rounded up to
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// width of one frame time histogram bucket and the number of
+	// buckets, in milliseconds, frames from 250 ms on share the
+	// last bucket
+	const double g_BucketWidthMs = 0.1;
+	const int g_BucketCount = 2500;
+	// most simulation steps in one frame, the time of any more
+	// is dropped so a long stall is not followed by a burst of
+	// steps that make the next frame late as well
+	const int g_MaxStepsPerFrame = 8;
+	// the first guess of how long a 1 ms sleep lasts, and how
+	// much each sleep moves the running average towards its time
+	const double g_InitialSleepDuration = 0.002;
+	const double g_SleepAverageWeight = 0.1;
+}
+
+/***********************************************************
+ *  FrameScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameScheduler::FrameScheduler()
+{
+	m_timeStep = 1.0 / 120.0;
+	m_minFrameTime = 0.0;
+	m_bVsync = false;
+	m_frameStart = -1.0;
+	m_nextFrameStart = 0.0;
+	m_accumulator = 0.0;
+	m_sleepDuration = g_InitialSleepDuration;
+	m_bTimerPeriodSet = false;
+	m_histogram.assign(g_BucketCount, 0);
+	m_frameCount = 0;
+	m_totalFrameTime = 0.0;
+	m_maxFrameTime = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameScheduler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameScheduler::~FrameScheduler()
+{
+	SetMaxFrameRate(0.0);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for setting how many simulation steps
+ *  run per second and the most frames per second, 0 for no
+ *  limit.  The frame times are counted from the next frame.
+ ***********************************************************/
+bool FrameScheduler::Create(double updateRate, double maxFrameRate)
+{
+	if ((updateRate <= 0.0) || (maxFrameRate < 0.0))
+	{
+		std::cout << "Invalid update rate " << updateRate << " or frame limit " << maxFrameRate << std::endl;
+		return(false);
+	}
+
+	m_timeStep = 1.0 / updateRate;
+	SetMaxFrameRate(maxFrameRate);
+	m_frameStart = -1.0;
+	m_accumulator = 0.0;
+	ResetStats();
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetMaxFrameRate()
+ *
+ *  This method is used for changing the most frames per
+ *  second, 0 for no limit.  Windows rounds sleeps up to its
+ *  timer period, 15.6 ms unless asked for less, so the period
+ *  is lowered while the frames are limited.
+ ***********************************************************/
+void FrameScheduler::SetMaxFrameRate(double maxFrameRate)
+{
+	m_minFrameTime = (maxFrameRate > 0.0) ? (1.0 / maxFrameRate) : 0.0;
+
+	bool bTimerPeriodWanted = (m_minFrameTime > 0.0);
+	if (bTimerPeriodWanted != m_bTimerPeriodSet)
+	{
+#ifdef _WIN32
+		if (bTimerPeriodWanted == true)
+		{
+			timeBeginPeriod(1);
+		}
+		else
+		{
+			timeEndPeriod(1);
+		}
+#endif
+		m_bTimerPeriodSet = bTimerPeriodWanted;
+	}
+}
+
+/***********************************************************
+ *  SetVsync()
+ *
+ *  This method is used for turning vertical sync of the
+ *  current OpenGL context on or off.  With it on, swapping
+ *  the buffers waits for the display, which also bounds the
+ *  frame rate.
+ ***********************************************************/
+void FrameScheduler::SetVsync(bool bVsync)
+{
+	glfwSwapInterval((bVsync == true) ? 1 : 0);
+	m_bVsync = bVsync;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame.  The time since
+ *  the last frame started is counted in the histogram and
+ *  added to the time still to simulate, and the number of
+ *  whole steps that fit in it is returned.
+ ***********************************************************/
+int FrameScheduler::BeginFrame()
+{
+	double now = glfwGetTime();
+
+	// the first frame has nothing to simulate or count
+	if (m_frameStart < 0.0)
+	{
+		m_frameStart = now;
+		m_nextFrameStart = now + m_minFrameTime;
+		return(0);
+	}
+
+	double frameTime = now - m_frameStart;
+	m_frameStart = now;
+
+	double frameTimeMs = frameTime * 1000.0;
+	int bucket = std::min((int)(frameTimeMs / g_BucketWidthMs), g_BucketCount - 1);
+	m_histogram[bucket]++;
+	m_frameCount++;
+	m_totalFrameTime += frameTimeMs;
+	m_maxFrameTime = std::max(m_maxFrameTime, frameTimeMs);
+
+	m_accumulator += frameTime;
+	int stepCount = (int)(m_accumulator / m_timeStep);
+	if (stepCount > g_MaxStepsPerFrame)
+	{
+		stepCount = g_MaxStepsPerFrame;
+		m_accumulator = stepCount * m_timeStep;
+	}
+	m_accumulator -= stepCount * m_timeStep;
+
+	return(stepCount);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for waiting until the next frame may
+ *  start under the frame limit.  The frames are paced from
+ *  when the last one was due rather than when it started, so
+ *  the rate does not drift, unless a frame ran late.  Short
+ *  sleeps are used while the wait is longer than twice the
+ *  time a sleep takes on average, and the rest is spun.
+ ***********************************************************/
+void FrameScheduler::EndFrame()
+{
+	if (m_minFrameTime <= 0.0)
+	{
+		return;
+	}
+
+	double now = glfwGetTime();
+	while (m_nextFrameStart - now > m_sleepDuration * 2.0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		double wakeTime = glfwGetTime();
+		m_sleepDuration += (wakeTime - now - m_sleepDuration) * g_SleepAverageWeight;
+		now = wakeTime;
+	}
+	while (now < m_nextFrameStart)
+	{
+		std::this_thread::yield();
+		now = glfwGetTime();
+	}
+
+	m_nextFrameStart += m_minFrameTime;
+	if (m_nextFrameStart < now)
+	{
+		m_nextFrameStart = now + m_minFrameTime;
+	}
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the number of frames and
+ *  their average, longest and percentile frame times since
+ *  the counters were reset.
+ ***********************************************************/
+FrameScheduler::FRAME_STATS FrameScheduler::GetStats() const
+{
+	FRAME_STATS stats;
+	stats.frameCount = m_frameCount;
+	stats.averageMs = (m_frameCount > 0) ? (m_totalFrameTime / m_frameCount) : 0.0;
+	stats.p50Ms = GetPercentile(0.50);
+	stats.p95Ms = GetPercentile(0.95);
+	stats.p99Ms = GetPercentile(0.99);
+	stats.maxMs = m_maxFrameTime;
+
+	return(stats);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for clearing the frame time counters.
+ ***********************************************************/
+void FrameScheduler::ResetStats()
+{
+	std::fill(m_histogram.begin(), m_histogram.end(), 0);
+	m_frameCount = 0;
+	m_totalFrameTime = 0.0;
+	m_maxFrameTime = 0.0;
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the frame time counters.
+ ***********************************************************/
+void FrameScheduler::PrintStats() const
+{
+	FRAME_STATS stats = GetStats();
+	std::cout << "  frame time over " << stats.frameCount << " frames: " << stats.averageMs
+		<< " ms average, p50 " << stats.p50Ms << " ms, p95 " << stats.p95Ms
+		<< " ms, p99 " << stats.p99Ms << " ms, worst " << stats.maxMs << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  GetPercentile()
+ *
+ *  This method is used for getting the frame time that the
+ *  passed in share of the frames took no longer than.  It is
+ *  the middle of the histogram bucket the share falls in, no
+ *  longer than the longest frame.
+ ***********************************************************/
+double FrameScheduler::GetPercentile(double fraction) const
+{
+	if (m_frameCount == 0)
+	{
+		return(0.0);
+	}
+
+	unsigned int rank = (unsigned int)(fraction * m_frameCount + 0.5);
+	rank = std::max(rank, 1u);
+	unsigned int counted = 0;
+	for (int bucket = 0; bucket < g_BucketCount; bucket++)
+	{
+		counted += m_histogram[bucket];
+		if (counted >= rank)
+		{
+			return(std::min((bucket + 0.5) * g_BucketWidthMs, m_maxFrameTime));
+		}
+	}
+
+	return(m_maxFrameTime);
+}
@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// framescheduler.h
+// ============
+// pace the frames and step the simulation at a fixed rate
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+/***********************************************************
+ *  FrameScheduler
+ *
+ *  This class times the frames in double precision and
+ *  splits the time between them into fixed simulation steps,
+ *  so movement does not depend on the frame rate.  The time
+ *  left over after the last step is returned as a fraction
+ *  of a step, for drawing the frame between the last two
+ *  simulated states.
+ *
+ *  The frames can be held to a most frames per second by
+ *  sleeping, and then spinning for the last part of the
+ *  wait that a sleep might overshoot, and vertical sync can
+ *  be turned on or off.  The time between frames is counted
+ *  in a histogram the percentiles are read from.
+ ***********************************************************/
+class FrameScheduler
+{
+public:
+	// constructor
+	FrameScheduler();
+	// destructor
+	~FrameScheduler();
+
+	// frame time counters, in milliseconds
+	struct FRAME_STATS
+	{
+		unsigned int frameCount;
+		double averageMs;
+		double p50Ms;
+		double p95Ms;
+		double p99Ms;
+		double maxMs;
+	};
+
+	// set the rate of the simulation steps and the most frames
+	// per second, 0 for no limit
+	bool Create(double updateRate, double maxFrameRate);
+	// change the most frames per second, 0 for no limit
+	void SetMaxFrameRate(double maxFrameRate);
+	// turn vertical sync of the current OpenGL context on or off
+	void SetVsync(bool bVsync);
+	bool GetVsync() const { return m_bVsync; }
+
+	// start a frame, returning the number of simulation steps
+	// to run before drawing it
+	int BeginFrame();
+	// wait until the next frame may start under the frame limit
+	void EndFrame();
+
+	// get the time of one simulation step in seconds
+	double GetTimeStep() const { return m_timeStep; }
+	// get how far the frame is past the last simulation step,
+	// from 0 to 1 of a step
+	float GetInterpolation() const { return (float)(m_accumulator / m_timeStep); }
+
+	// get the frame time counters since the last reset
+	FRAME_STATS GetStats() const;
+	// start counting the frame times again
+	void ResetStats();
+	// print the frame time counters
+	void PrintStats() const;
+
+private:
+	// get the frame time below which a share of the frames fall
+	double GetPercentile(double fraction) const;
+
+	double m_timeStep;
+	// shortest time between frames, 0 for no limit
+	double m_minFrameTime;
+	bool m_bVsync;
+	// time the last frame started and the next one may start
+	double m_frameStart;
+	double m_nextFrameStart;
+	// time not yet simulated, less than one step after a frame
+	// has started
+	double m_accumulator;
+	// running average of how long a short sleep takes
+	double m_sleepDuration;
+	// the system timer period was lowered for the frame limit
+	bool m_bTimerPeriodSet;
+	// frames counted in buckets of frame time, the last bucket
+	// holds every longer frame
+	std::vector<unsigned int> m_histogram;
+	unsigned int m_frameCount;
+	double m_totalFrameTime;
+	double m_maxFrameTime;
+};
@@ -0,0 +1,246 @@
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// largest block of stored, uncompressed deflate data
+	const size_t g_MaxStoredBlock = 65535;
+	// bytes the Adler-32 sums can take before they could overflow
+	// and have to be reduced
+	const size_t g_AdlerRunLength = 5552;
+
+	/***********************************************************
+	 *  UpdateCRC()
+	 *
+	 *  Continue the CRC-32 of PNG chunks over more bytes.
+	 ***********************************************************/
+	uint32_t UpdateCRC(uint32_t crc, const unsigned char* data, size_t size)
+	{
+		static uint32_t table[256];
+		static bool bTableReady = false;
+		if (bTableReady == false)
+		{
+			for (uint32_t n = 0; n < 256; n++)
+			{
+				uint32_t c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				table[n] = c;
+			}
+			bTableReady = true;
+		}
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(~crc);
+	}
+
+	/***********************************************************
+	 *  AppendBigEndian()
+	 *
+	 *  Append a 32-bit value with the most significant byte
+	 *  first, as PNG stores them.
+	 ***********************************************************/
+	void AppendBigEndian(std::vector<unsigned char>& data, uint32_t value)
+	{
+		data.push_back((unsigned char)(value >> 24));
+		data.push_back((unsigned char)(value >> 16));
+		data.push_back((unsigned char)(value >> 8));
+		data.push_back((unsigned char)value);
+	}
+
+	/***********************************************************
+	 *  WriteChunk()
+	 *
+	 *  Write a PNG chunk - its length, type, data and the CRC
+	 *  of the type and data.
+	 ***********************************************************/
+	void WriteChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+	{
+		std::vector<unsigned char> header;
+		AppendBigEndian(header, (uint32_t)data.size());
+		header.insert(header.end(), type, type + 4);
+
+		uint32_t crc = UpdateCRC(0, (const unsigned char*)type, 4);
+		if (data.empty() == false)
+		{
+			crc = UpdateCRC(crc, &data[0], data.size());
+		}
+		std::vector<unsigned char> footer;
+		AppendBigEndian(footer, crc);
+
+		file.write((const char*)&header[0], header.size());
+		if (data.empty() == false)
+		{
+			file.write((const char*)&data[0], data.size());
+		}
+		file.write((const char*)&footer[0], footer.size());
+	}
+}
+
+/***********************************************************
+ *  WritePPM()
+ *
+ *  This function is used for saving RGB pixels as a binary
+ *  PPM image.
+ ***********************************************************/
+bool ImageWriter::WritePPM(
+	const char* filename,
+	int width,
+	int height,
+	const std::vector<unsigned char>& pixels)
+{
+	if (pixels.size() < (size_t)width * height * 3)
+	{
+		std::cout << "Not enough pixels to write " << filename << std::endl;
+		return(false);
+	}
+
+	std::ofstream imageFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!imageFile)
+	{
+		std::cout << "Could not open image file for writing: " << filename << std::endl;
+		return(false);
+	}
+
+	imageFile << "P6\n" << width << " " << height << "\n255\n";
+	imageFile.write((const char*)&pixels[0], (std::streamsize)width * height * 3);
+	imageFile.close();
+
+	if (!imageFile)
+	{
+		std::cout << "Could not write image file: " << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  WritePNG()
+ *
+ *  This function is used for saving RGB pixels as a PNG
+ *  image.  Every row gets the "none" filter and the zlib
+ *  stream is made of stored deflate blocks, so the image
+ *  data is copied rather than compressed.
+ ***********************************************************/
+bool ImageWriter::WritePNG(
+	const char* filename,
+	int width,
+	int height,
+	const std::vector<unsigned char>& pixels)
+{
+	size_t rowSize = (size_t)width * 3;
+	if (pixels.size() < rowSize * height)
+	{
+		std::cout << "Not enough pixels to write " << filename << std::endl;
+		return(false);
+	}
+
+	std::ofstream imageFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!imageFile)
+	{
+		std::cout << "Could not open image file for writing: " << filename << std::endl;
+		return(false);
+	}
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	imageFile.write((const char*)signature, sizeof(signature));
+
+	// 8-bit RGB, no interlacing
+	std::vector<unsigned char> header;
+	AppendBigEndian(header, (uint32_t)width);
+	AppendBigEndian(header, (uint32_t)height);
+	header.push_back(8);
+	header.push_back(2);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	WriteChunk(imageFile, "IHDR", header);
+
+	// the filtered rows, each with a leading filter type byte
+	std::vector<unsigned char> filtered((rowSize + 1) * height);
+	for (int y = 0; y < height; y++)
+	{
+		filtered[y * (rowSize + 1)] = 0;
+		memcpy(&filtered[y * (rowSize + 1) + 1], &pixels[y * rowSize], rowSize);
+	}
+
+	// zlib header, stored blocks and the Adler-32 of the rows
+	std::vector<unsigned char> compressed;
+	compressed.reserve(filtered.size() + filtered.size() / g_MaxStoredBlock * 5 + 16);
+	compressed.push_back(0x78);
+	compressed.push_back(0x01);
+	uint32_t adlerLow = 1;
+	uint32_t adlerHigh = 0;
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = std::min(g_MaxStoredBlock, filtered.size() - offset);
+		bool bLastBlock = (offset + blockSize == filtered.size());
+		compressed.push_back(bLastBlock ? 1 : 0);
+		compressed.push_back((unsigned char)(blockSize & 0xFF));
+		compressed.push_back((unsigned char)(blockSize >> 8));
+		compressed.push_back((unsigned char)(~blockSize & 0xFF));
+		compressed.push_back((unsigned char)((~blockSize >> 8) & 0xFF));
+		compressed.insert(compressed.end(), filtered.begin() + offset, filtered.begin() + offset + blockSize);
+
+		for (size_t run = offset; run < offset + blockSize; run += g_AdlerRunLength)
+		{
+			size_t runEnd = std::min(run + g_AdlerRunLength, offset + blockSize);
+			for (size_t i = run; i < runEnd; i++)
+			{
+				adlerLow += filtered[i];
+				adlerHigh += adlerLow;
+			}
+			adlerLow %= 65521;
+			adlerHigh %= 65521;
+		}
+		offset += blockSize;
+	} while (offset < filtered.size());
+	AppendBigEndian(compressed, (adlerHigh << 16) | adlerLow);
+	WriteChunk(imageFile, "IDAT", compressed);
+
+	WriteChunk(imageFile, "IEND", std::vector<unsigned char>());
+	imageFile.close();
+
+	if (!imageFile)
+	{
+		std::cout << "Could not write image file: " << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This function is used for saving RGB pixels in the image
+ *  format the file name asks for.
+ ***********************************************************/
+bool ImageWriter::WriteImage(
+	const char* filename,
+	int width,
+	int height,
+	const std::vector<unsigned char>& pixels)
+{
+	size_t length = strlen(filename);
+	if ((length >= 4) && (strcmp(filename + length - 4, ".png") == 0))
+	{
+		return(WritePNG(filename, width, height, pixels));
+	}
+
+	return(WritePPM(filename, width, height, pixels));
+}
@@ -0,0 +1,39 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.h
+// ============
+// save rendered frames as image files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+/***********************************************************
+ *  ImageWriter
+ *
+ *  These functions save 8-bit RGB pixels, rows from top to
+ *  bottom, as binary PPM or PNG images.  Neither needs an
+ *  image library - the PNG data is stored without
+ *  compression, trading file size for encoding speed.
+ ***********************************************************/
+namespace ImageWriter
+{
+	// write a binary PPM image
+	bool WritePPM(
+		const char* filename,
+		int width,
+		int height,
+		const std::vector<unsigned char>& pixels);
+	// write a PNG image
+	bool WritePNG(
+		const char* filename,
+		int width,
+		int height,
+		const std::vector<unsigned char>& pixels);
+	// write a PNG image for names ending in .png, otherwise PPM
+	bool WriteImage(
+		const char* filename,
+		int width,
+		int height,
+		const std::vector<unsigned char>& pixels);
+}
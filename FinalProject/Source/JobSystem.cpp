@@ -0,0 +1,693 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// run jobs on a pool of threads that steal work from each other
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// most worker threads started for the hardware threads
+	const int g_MaxWorkerThreads = 15;
+	// jobs in the ring of every thread, and the size of the
+	// deques, powers of two
+	const int g_JobPoolSize = 4096;
+	const int g_DequeSize = 4096;
+	// most continuations of one job
+	const int g_MaxContinuations = 4;
+	// most jobs a parallel loop is split into, each running a
+	// range of the task indices
+	const int g_MaxParallelForJobs = 256;
+	// times an idle worker looks for jobs before it sleeps
+	const int g_IdleSpins = 64;
+
+	// job system and thread index of the calling worker thread
+	thread_local const JobSystem* t_pJobSystem = NULL;
+	thread_local int t_threadIndex = 0;
+	// state of the random victim picks of the calling thread
+	thread_local uint32_t t_stealSeed = 0;
+}
+
+// a function to run, with the jobs to run after it
+struct JobSystem::JOB
+{
+	std::function<void()> function;
+	// range of a parallel loop, run instead of the function
+	// when set, so the loop needs no function object per job
+	TASK_RANGE_FUNCTION pRangeFunction;
+	const void* pTask;
+	int firstTask;
+	int lastTask;
+	JOB* pParent;
+	// the job itself and its unfinished children
+	std::atomic<int> unfinishedJobs;
+	std::atomic<int> continuationCount;
+	JOB* continuations[g_MaxContinuations];
+};
+
+// jobs, deque and counters of one thread - the owner pushes
+// and pops at the bottom of the deque, other threads steal
+// from the top
+struct JobSystem::THREAD_STATE
+{
+	std::unique_ptr<JOB[]> jobPool;
+	unsigned int allocatedJobs;
+	std::unique_ptr<std::atomic<JOB*>[]> deque;
+	std::atomic<int64_t> top;
+	// keeps the stolen end and the owned end of the deque on
+	// separate cache lines
+	char padding[64];
+	std::atomic<int64_t> bottom;
+	std::atomic<unsigned int> jobsRun;
+	std::atomic<unsigned int> jobsStolen;
+	std::atomic<unsigned int> backgroundJobsRun;
+
+	THREAD_STATE()
+		: jobPool(new JOB[g_JobPoolSize]), allocatedJobs(0), deque(new std::atomic<JOB*>[g_DequeSize]),
+		top(0), bottom(0), jobsRun(0), jobsStolen(0), backgroundJobsRun(0)
+	{
+		for (int i = 0; i < g_JobPoolSize; i++)
+		{
+			jobPool[i].unfinishedJobs = 0;
+		}
+	}
+
+	// queue a job, false when the deque is full
+	bool Push(JOB* pJob)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= g_DequeSize)
+		{
+			return(false);
+		}
+		deque[b & (g_DequeSize - 1)].store(pJob, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return(true);
+	}
+
+	// take back the newest job, racing thieves for the last one
+	JOB* Pop()
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return(NULL);
+		}
+
+		JOB* pJob = deque[b & (g_DequeSize - 1)].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+			{
+				pJob = NULL;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return(pJob);
+	}
+
+	// take the oldest job, NULL when empty or another thread
+	// took it first
+	JOB* Steal()
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+		{
+			return(NULL);
+		}
+
+		JOB* pJob = deque[t & (g_DequeSize - 1)].load(std::memory_order_relaxed);
+		if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed) == false)
+		{
+			return(NULL);
+		}
+		return(pJob);
+	}
+
+	// check for queued jobs
+	bool IsEmpty() const
+	{
+		return(top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire));
+	}
+};
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem()
+{
+	m_bStopping = false;
+	m_backgroundCount = 0;
+	m_sleepingWorkers = 0;
+	m_wakeUps = 0;
+
+	// the jobs of the thread that starts the job system, which
+	// runs them itself until workers are started
+	m_threadStates.push_back(std::unique_ptr<THREAD_STATE>(new THREAD_STATE()));
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the worker threads.
+ *  With -1 one hardware thread is left for the calling
+ *  thread, which runs jobs while it waits for them.
+ ***********************************************************/
+void JobSystem::Start(int threadCount)
+{
+	Stop();
+
+	if (threadCount < 0)
+	{
+		threadCount = (int)std::thread::hardware_concurrency() - 1;
+		threadCount = std::max(0, std::min(threadCount, g_MaxWorkerThreads));
+	}
+
+	m_threadStates.resize(1);
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_threadStates.push_back(std::unique_ptr<THREAD_STATE>(new THREAD_STATE()));
+	}
+
+	m_bStopping = false;
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&JobSystem::WorkerThread, this, i + 1));
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the worker threads once
+ *  they finish the job they are running.  Background jobs
+ *  still queued are run on the calling thread, as the
+ *  threads that queued them may be waiting for them.
+ ***********************************************************/
+void JobSystem::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bStopping = true;
+	}
+	m_wakeCondition.notify_all();
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i].join();
+	}
+	m_threads.clear();
+
+	for (;;)
+	{
+		std::function<void()> function;
+		{
+			std::lock_guard<std::mutex> lock(m_backgroundMutex);
+			if (m_backgroundJobs.empty())
+			{
+				break;
+			}
+			function = m_backgroundJobs.front();
+			m_backgroundJobs.pop_front();
+			m_backgroundCount--;
+		}
+		function();
+	}
+}
+
+/***********************************************************
+ *  CreateJob()
+ *
+ *  This method is used for creating a job from the ring of
+ *  the calling thread.  A child job has to be created
+ *  before its parent finishes, that is before the parent is
+ *  queued or from the function of the parent.  A thread
+ *  with more unfinished jobs than its ring holds would
+ *  overwrite one of them, so it runs queued jobs until the
+ *  oldest is done instead, which hangs if that job was
+ *  never queued.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::CreateJob(const std::function<void()>& function, JOB* pParent)
+{
+	int threadIndex = GetThreadIndex();
+	THREAD_STATE& state = *m_threadStates[threadIndex];
+	JOB* pJob = &state.jobPool[state.allocatedJobs & (g_JobPoolSize - 1)];
+	assert(IsFinished(pJob) == true);
+	if (IsFinished(pJob) == false)
+	{
+		std::cout << "Thread " << threadIndex << " has more than " << g_JobPoolSize
+			<< " unfinished jobs, waiting for the oldest to reuse its slot" << std::endl;
+		Wait(pJob);
+	}
+	state.allocatedJobs++;
+
+	pJob->function = function;
+	pJob->pRangeFunction = NULL;
+	pJob->pParent = pParent;
+	pJob->unfinishedJobs.store(1, std::memory_order_relaxed);
+	pJob->continuationCount.store(0, std::memory_order_relaxed);
+	if (NULL != pParent)
+	{
+		pParent->unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return(pJob);
+}
+
+/***********************************************************
+ *  AddContinuation()
+ *
+ *  This method is used for queueing a job once another one
+ *  and its children finish, such as a job that needs their
+ *  results.  False is returned when the other job has no
+ *  room for more continuations.
+ ***********************************************************/
+bool JobSystem::AddContinuation(JOB* pJob, JOB* pContinuation)
+{
+	int index = pJob->continuationCount.fetch_add(1, std::memory_order_relaxed);
+	if (index >= g_MaxContinuations)
+	{
+		pJob->continuationCount.fetch_sub(1, std::memory_order_relaxed);
+		return(false);
+	}
+
+	pJob->continuations[index] = pContinuation;
+	return(true);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for queueing a job on the deque of
+ *  the calling thread.  Without workers, or with the deque
+ *  full, the job runs right away instead.
+ ***********************************************************/
+void JobSystem::Run(JOB* pJob)
+{
+	int threadIndex = GetThreadIndex();
+	if ((m_threads.empty()) || (m_threadStates[threadIndex]->Push(pJob) == false))
+	{
+		Execute(pJob, threadIndex);
+		return;
+	}
+
+	WakeWorker();
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used for running queued jobs, the calling
+ *  thread's own first, until a job and all its children
+ *  have finished.  Background jobs are left to the workers.
+ ***********************************************************/
+void JobSystem::Wait(const JOB* pJob)
+{
+	int threadIndex = GetThreadIndex();
+	while (IsFinished(pJob) == false)
+	{
+		JOB* pOtherJob = FindJob(threadIndex);
+		if (NULL != pOtherJob)
+		{
+			Execute(pOtherJob, threadIndex);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  IsFinished()
+ *
+ *  This method is used for checking whether a job and all
+ *  its children have finished.
+ ***********************************************************/
+bool JobSystem::IsFinished(const JOB* pJob)
+{
+	return(pJob->unfinishedJobs.load(std::memory_order_acquire) == 0);
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a task for every index
+ *  below the task count and waiting for them all.  The
+ *  indices are split into ranges, each run by one child job
+ *  of an empty parent, so that idle threads steal ranges.
+ *  The range jobs point at the task of the caller, which
+ *  outlives them as the loop waits for them, instead of
+ *  holding a function object each.  A loop of one task, or
+ *  without workers, runs on the calling thread alone.
+ ***********************************************************/
+void JobSystem::ParallelFor(int taskCount, TASK_RANGE_FUNCTION pRangeFunction, const void* pTask)
+{
+	if (taskCount <= 0)
+	{
+		return;
+	}
+	if ((taskCount == 1) || (m_threads.empty()))
+	{
+		pRangeFunction(pTask, 0, taskCount);
+		return;
+	}
+
+	int threadIndex = GetThreadIndex();
+	JOB* pLoop = CreateJob(std::function<void()>(), NULL);
+	int jobCount = std::min(taskCount, g_MaxParallelForJobs);
+	for (int i = 0; i < jobCount; i++)
+	{
+		int firstTask = (int)((int64_t)taskCount * i / jobCount);
+		int lastTask = (int)((int64_t)taskCount * (i + 1) / jobCount);
+		JOB* pRange = CreateJob(std::function<void()>(), pLoop);
+		pRange->pRangeFunction = pRangeFunction;
+		pRange->pTask = pTask;
+		pRange->firstTask = firstTask;
+		pRange->lastTask = lastTask;
+		Run(pRange);
+	}
+
+	// the loop job itself has nothing to run
+	Finish(pLoop, threadIndex);
+	Wait(pLoop);
+}
+
+/***********************************************************
+ *  RunBackground()
+ *
+ *  This method is used for queueing a long function that a
+ *  worker runs once it has no jobs, in the order they were
+ *  queued.  Without workers it runs right away.
+ ***********************************************************/
+void JobSystem::RunBackground(const std::function<void()>& function)
+{
+	if (m_threads.empty())
+	{
+		function();
+		m_threadStates[GetThreadIndex()]->backgroundJobsRun++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_backgroundMutex);
+		m_backgroundJobs.push_back(function);
+		m_backgroundCount++;
+	}
+	WakeWorker();
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for adding up the job counters of
+ *  all the threads.
+ ***********************************************************/
+JobSystem::JOB_STATS JobSystem::GetStats() const
+{
+	JOB_STATS stats = JOB_STATS();
+	for (size_t i = 0; i < m_threadStates.size(); i++)
+	{
+		stats.jobsRun += m_threadStates[i]->jobsRun.load(std::memory_order_relaxed);
+		stats.jobsStolen += m_threadStates[i]->jobsStolen.load(std::memory_order_relaxed);
+		stats.backgroundJobsRun += m_threadStates[i]->backgroundJobsRun.load(std::memory_order_relaxed);
+	}
+
+	return(stats);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for clearing the job counters.
+ ***********************************************************/
+void JobSystem::ResetStats()
+{
+	for (size_t i = 0; i < m_threadStates.size(); i++)
+	{
+		m_threadStates[i]->jobsRun = 0;
+		m_threadStates[i]->jobsStolen = 0;
+		m_threadStates[i]->backgroundJobsRun = 0;
+	}
+}
+
+/***********************************************************
+ *  GetThreadIndex()
+ *
+ *  This method is used for getting the index of the state of
+ *  the calling thread - its worker index on the workers of
+ *  this job system and 0 on any other thread.
+ ***********************************************************/
+int JobSystem::GetThreadIndex() const
+{
+	return((t_pJobSystem == this) ? t_threadIndex : 0);
+}
+
+/***********************************************************
+ *  FindJob()
+ *
+ *  This method is used for taking the newest job of the
+ *  thread's own deque, or else stealing the oldest job of
+ *  another thread's deque, starting from a random one so
+ *  the thieves spread out.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::FindJob(int threadIndex)
+{
+	THREAD_STATE& state = *m_threadStates[threadIndex];
+	JOB* pJob = state.Pop();
+	if (NULL != pJob)
+	{
+		return(pJob);
+	}
+
+	int threadCount = (int)m_threadStates.size();
+	if (threadCount < 2)
+	{
+		return(NULL);
+	}
+
+	// xorshift, seeded apart for every thread
+	if (t_stealSeed == 0)
+	{
+		t_stealSeed = 2463534242u + (uint32_t)threadIndex * 7919u;
+	}
+	t_stealSeed ^= t_stealSeed << 13;
+	t_stealSeed ^= t_stealSeed >> 17;
+	t_stealSeed ^= t_stealSeed << 5;
+
+	int firstVictim = (int)(t_stealSeed % (uint32_t)threadCount);
+	for (int i = 0; i < threadCount; i++)
+	{
+		int victim = (firstVictim + i) % threadCount;
+		if (victim == threadIndex)
+		{
+			continue;
+		}
+
+		pJob = m_threadStates[victim]->Steal();
+		if (NULL != pJob)
+		{
+			state.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+			return(pJob);
+		}
+	}
+
+	return(NULL);
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method is used for running the function of a job
+ *  and finishing the job.
+ ***********************************************************/
+void JobSystem::Execute(JOB* pJob, int threadIndex)
+{
+	if (NULL != pJob->pRangeFunction)
+	{
+		pJob->pRangeFunction(pJob->pTask, pJob->firstTask, pJob->lastTask);
+	}
+	else if (pJob->function)
+	{
+		pJob->function();
+	}
+	m_threadStates[threadIndex]->jobsRun.fetch_add(1, std::memory_order_relaxed);
+
+	Finish(pJob, threadIndex);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for counting down the unfinished
+ *  part of a job.  Once the job and all its children are
+ *  done, its continuations are queued and its parent counts
+ *  down in turn.
+ ***********************************************************/
+void JobSystem::Finish(JOB* pJob, int threadIndex)
+{
+	// the continuations and parent are read before the job is
+	// marked finished, after which its slot may be reused
+	JOB* pParent = pJob->pParent;
+	int continuationCount = pJob->continuationCount.load(std::memory_order_relaxed);
+	JOB* continuations[g_MaxContinuations];
+	for (int i = 0; i < continuationCount; i++)
+	{
+		continuations[i] = pJob->continuations[i];
+	}
+
+	if (pJob->unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	for (int i = 0; i < continuationCount; i++)
+	{
+		Run(continuations[i]);
+	}
+	if (NULL != pParent)
+	{
+		Finish(pParent, threadIndex);
+	}
+}
+
+/***********************************************************
+ *  HasWork()
+ *
+ *  This method is used for checking whether any deque or the
+ *  background queue holds a job.
+ ***********************************************************/
+bool JobSystem::HasWork() const
+{
+	if (m_backgroundCount.load() > 0)
+	{
+		return(true);
+	}
+	for (size_t i = 0; i < m_threadStates.size(); i++)
+	{
+		if (m_threadStates[i]->IsEmpty() == false)
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  WakeWorker()
+ *
+ *  This method is used for waking one sleeping worker, if
+ *  any, after a job was queued.  The queued job is visible
+ *  to a worker that starts sleeping after the check, as it
+ *  looks for jobs once more before it sleeps.
+ ***********************************************************/
+void JobSystem::WakeWorker()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_sleepingWorkers.load() == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_wakeUps = std::min(m_wakeUps + 1, (int)m_threads.size());
+	}
+	m_wakeCondition.notify_one();
+}
+
+/***********************************************************
+ *  WorkerThread()
+ *
+ *  This method is used for running jobs on a worker thread
+ *  - its own, stolen ones, then background ones - and
+ *  sleeping once it found none for a while, until the job
+ *  system is stopped.
+ ***********************************************************/
+void JobSystem::WorkerThread(int threadIndex)
+{
+	t_pJobSystem = this;
+	t_threadIndex = threadIndex;
+	THREAD_STATE& state = *m_threadStates[threadIndex];
+
+	int idleSpins = 0;
+	while (m_bStopping == false)
+	{
+		JOB* pJob = FindJob(threadIndex);
+		if (NULL != pJob)
+		{
+			Execute(pJob, threadIndex);
+			idleSpins = 0;
+			continue;
+		}
+
+		std::function<void()> function;
+		if (m_backgroundCount.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_backgroundMutex);
+			if (m_backgroundJobs.empty() == false)
+			{
+				function = m_backgroundJobs.front();
+				m_backgroundJobs.pop_front();
+				m_backgroundCount--;
+			}
+		}
+		if (function)
+		{
+			function();
+			state.backgroundJobsRun.fetch_add(1, std::memory_order_relaxed);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < g_IdleSpins)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// look once more after counting as sleeping, so a job
+		// queued meanwhile either is seen here or wakes us
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepingWorkers++;
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if ((HasWork() == false) && (m_bStopping == false))
+		{
+			m_wakeCondition.wait(lock, [this] { return ((m_wakeUps > 0) || m_bStopping); });
+			if (m_wakeUps > 0)
+			{
+				m_wakeUps--;
+			}
+		}
+		m_sleepingWorkers--;
+		idleSpins = 0;
+	}
+
+	t_pJobSystem = NULL;
+}
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// run jobs on a pool of threads that steal work from each other
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs jobs on a pool of worker threads.  Every
+ *  thread queues the jobs it creates on its own deque,
+ *  taking them back last in first out, while threads that
+ *  run out of jobs steal the oldest ones from the deques of
+ *  the others, so a deque is only contended once its owner
+ *  has more jobs than it can run.  The deques are lock free.
+ *
+ *  A job can have child jobs, and only finishes once they
+ *  have too, and continuations, which are queued once it
+ *  finishes.  A thread waiting for a job runs other jobs
+ *  in the meantime.  Long jobs, such as decoding images,
+ *  run in the background instead - they are only taken by
+ *  workers with nothing else to do and never by a waiting
+ *  thread, so they do not hold up a frame.
+ *
+ *  Jobs are created and queued by the thread that started
+ *  the job system and by the jobs themselves.  Each thread
+ *  reuses a ring of g_JobPoolSize jobs, so no more than that
+ *  many of its jobs may be unfinished at once.  Without
+ *  workers, every job runs on the thread that queues it.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor
+	JobSystem();
+	// destructor
+	~JobSystem();
+
+	// a function to run, with the jobs to run after it
+	struct JOB;
+
+	// job system counters
+	struct JOB_STATS
+	{
+		unsigned int jobsRun;
+		unsigned int jobsStolen;
+		unsigned int backgroundJobsRun;
+	};
+
+	// start the worker threads, 0 to run every job on the
+	// thread that queues it and -1 for one less than the
+	// hardware threads
+	void Start(int threadCount);
+	// stop the worker threads, running the background jobs
+	// still queued on the calling thread
+	void Stop();
+	// get the number of threads running jobs, the workers and
+	// the thread that started them
+	int GetThreadCount() const { return (int)m_threads.size() + 1; }
+
+	// create a job, as a child of a parent job that has not
+	// finished when one is passed in
+	JOB* CreateJob(const std::function<void()>& function, JOB* pParent);
+	// queue a job once another job finishes, added before the
+	// other job is queued
+	bool AddContinuation(JOB* pJob, JOB* pContinuation);
+	// queue a job on the deque of the calling thread
+	void Run(JOB* pJob);
+	// run jobs until a job and its children have finished
+	void Wait(const JOB* pJob);
+	// check whether a job and its children have finished
+	static bool IsFinished(const JOB* pJob);
+
+	// run a task for every index below the task count and wait
+	// for them all, calling the task where it is rather than
+	// through a copy, so the loop allocates nothing
+	template<typename TASK>
+	void ParallelFor(int taskCount, const TASK& task)
+	{
+		ParallelFor(taskCount, &RunTaskRange<TASK>, &task);
+	}
+	// run a long function on a worker when it has nothing else
+	// to do, or right away without workers
+	void RunBackground(const std::function<void()>& function);
+
+	// get the job counters
+	JOB_STATS GetStats() const;
+	void ResetStats();
+
+private:
+	// jobs, deque and counters of one thread
+	struct THREAD_STATE;
+
+	// runs the task of a parallel loop for a range of indices
+	typedef void (*TASK_RANGE_FUNCTION)(const void* pTask, int firstTask, int lastTask);
+
+	// run the task of a parallel loop, of the type it was
+	// passed in with, for a range of indices
+	template<typename TASK>
+	static void RunTaskRange(const void* pTask, int firstTask, int lastTask)
+	{
+		const TASK& task = *(const TASK*)pTask;
+		for (int index = firstTask; index < lastTask; index++)
+		{
+			task(index);
+		}
+	}
+	// split a parallel loop into range jobs and wait for them
+	void ParallelFor(int taskCount, TASK_RANGE_FUNCTION pRangeFunction, const void* pTask);
+
+	// get the index of the calling thread, 0 for the thread
+	// that started the job system
+	int GetThreadIndex() const;
+	// take a job from the deque of the thread or steal one
+	JOB* FindJob(int threadIndex);
+	// run a job and finish it
+	void Execute(JOB* pJob, int threadIndex);
+	// count a job or child as finished, queueing the
+	// continuations and finishing the parent once all are
+	void Finish(JOB* pJob, int threadIndex);
+	// check for jobs queued on any deque or in the background
+	bool HasWork() const;
+	// wake a sleeping worker after queueing a job
+	void WakeWorker();
+	// run jobs until the job system is stopped
+	void WorkerThread(int threadIndex);
+
+	std::vector<std::thread> m_threads;
+	// one state per thread, the thread that started the job
+	// system first
+	std::vector<std::unique_ptr<THREAD_STATE>> m_threadStates;
+	std::atomic<bool> m_bStopping;
+	// background functions, taken in the order they were queued
+	std::mutex m_backgroundMutex;
+	std::deque<std::function<void()>> m_backgroundJobs;
+	std::atomic<int> m_backgroundCount;
+	// workers sleeping until a job is queued, and the wake ups
+	// handed to them
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<int> m_sleepingWorkers;
+	int m_wakeUps;
+};
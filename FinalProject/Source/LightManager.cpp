@@ -0,0 +1,265 @@
+#include "LightManager.h"
+
+#include <chrono>
+#include <iostream>
+
+/***********************************************************
+ *  LightManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightManager::LightManager()
+{
+	m_lightBuffer = 0;
+	m_firstDirty = 0;
+	m_lastDirty = -1;
+	m_uploadCount = 0;
+	m_uploadedBytes = 0;
+	m_lastUploadMicroseconds = 0.0;
+}
+
+LightManager::~LightManager()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the light buffer with
+ *  room for the maximum number of lights and binding it to
+ *  the passed in uniform buffer binding point.
+ ***********************************************************/
+bool LightManager::Create(GLuint bindingPoint)
+{
+	if (m_lightBuffer == 0)
+	{
+		glGenBuffers(1, &m_lightBuffer);
+	}
+	if (m_lightBuffer == 0)
+	{
+		std::cout << "Could not create the light buffer" << std::endl;
+		return(false);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(LIGHT_SOURCE) * MAX_LIGHTS, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_lightBuffer);
+
+	// the new buffer holds nothing yet, so every light is uploaded
+	if (!m_lights.empty())
+	{
+		MarkDirty(0);
+		MarkDirty((int)m_lights.size() - 1);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the light buffer.
+ ***********************************************************/
+void LightManager::Destroy()
+{
+	if (m_lightBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightBuffer);
+		m_lightBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  FindLightIndex()
+ *
+ *  This method is used for getting the packed index of the
+ *  light with the passed in handle.
+ ***********************************************************/
+int LightManager::FindLightIndex(int lightHandle) const
+{
+	if ((lightHandle < 0) || (lightHandle >= (int)m_handleIndices.size()))
+	{
+		return(-1);
+	}
+
+	return(m_handleIndices[lightHandle]);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for widening the range of packed
+ *  lights that need to be uploaded.
+ ***********************************************************/
+void LightManager::MarkDirty(int index)
+{
+	if (m_firstDirty > m_lastDirty)
+	{
+		m_firstDirty = index;
+		m_lastDirty = index;
+	}
+	else
+	{
+		if (index < m_firstDirty)
+			m_firstDirty = index;
+		if (index > m_lastDirty)
+			m_lastDirty = index;
+	}
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light to the end of the
+ *  packed lights.  INVALID_LIGHT is returned when the light
+ *  buffer is full.
+ ***********************************************************/
+int LightManager::AddLight(const LIGHT_SOURCE& light)
+{
+	if ((int)m_lights.size() >= MAX_LIGHTS)
+	{
+		std::cout << "Could not add light: the light buffer holds at most " << MAX_LIGHTS << " lights" << std::endl;
+		return(INVALID_LIGHT);
+	}
+
+	int lightHandle = 0;
+	if (!m_freeHandles.empty())
+	{
+		lightHandle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+	else
+	{
+		lightHandle = (int)m_handleIndices.size();
+		m_handleIndices.push_back(-1);
+	}
+
+	int index = (int)m_lights.size();
+	m_lights.push_back(light);
+	m_lightHandles.push_back(lightHandle);
+	m_handleIndices[lightHandle] = index;
+	MarkDirty(index);
+
+	return(lightHandle);
+}
+
+/***********************************************************
+ *  RemoveLight()
+ *
+ *  This method is used for removing a light.  The last light
+ *  is moved into its place so the lights stay packed, which
+ *  means only that one slot has to be uploaded again.
+ ***********************************************************/
+void LightManager::RemoveLight(int lightHandle)
+{
+	int index = FindLightIndex(lightHandle);
+	if (index < 0)
+	{
+		return;
+	}
+
+	int lastIndex = (int)m_lights.size() - 1;
+	if (index != lastIndex)
+	{
+		m_lights[index] = m_lights[lastIndex];
+		m_lightHandles[index] = m_lightHandles[lastIndex];
+		m_handleIndices[m_lightHandles[index]] = index;
+		MarkDirty(index);
+	}
+
+	m_lights.pop_back();
+	m_lightHandles.pop_back();
+	m_handleIndices[lightHandle] = -1;
+	m_freeHandles.push_back(lightHandle);
+
+	// the light past the end does not need uploading any more
+	if (m_lastDirty >= (int)m_lights.size())
+	{
+		m_lastDirty = (int)m_lights.size() - 1;
+	}
+}
+
+/***********************************************************
+ *  SetLight()
+ *
+ *  This method is used for changing all the values of a
+ *  light.
+ ***********************************************************/
+void LightManager::SetLight(int lightHandle, const LIGHT_SOURCE& light)
+{
+	int index = FindLightIndex(lightHandle);
+	if (index < 0)
+	{
+		return;
+	}
+
+	m_lights[index] = light;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  SetLightPosition()
+ *
+ *  This method is used for moving a light.
+ ***********************************************************/
+void LightManager::SetLightPosition(int lightHandle, const glm::vec3& position)
+{
+	int index = FindLightIndex(lightHandle);
+	if ((index < 0) || (m_lights[index].position == position))
+	{
+		return;
+	}
+
+	m_lights[index].position = position;
+	MarkDirty(index);
+}
+
+/***********************************************************
+ *  GetLight()
+ *
+ *  This method is used for getting the values of a light, or
+ *  NULL when the handle does not belong to a light.
+ ***********************************************************/
+const LightManager::LIGHT_SOURCE* LightManager::GetLight(int lightHandle) const
+{
+	int index = FindLightIndex(lightHandle);
+	if (index < 0)
+	{
+		return(NULL);
+	}
+
+	return(&m_lights[index]);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the range of lights
+ *  that changed since the last update with a single buffer
+ *  update.  Nothing is sent when no light changed.
+ ***********************************************************/
+void LightManager::Update()
+{
+	if ((m_lightBuffer == 0) || (m_firstDirty > m_lastDirty))
+	{
+		return;
+	}
+
+	std::chrono::high_resolution_clock::time_point startTime = std::chrono::high_resolution_clock::now();
+
+	GLintptr offset = (GLintptr)(sizeof(LIGHT_SOURCE) * m_firstDirty);
+	GLsizeiptr size = (GLsizeiptr)(sizeof(LIGHT_SOURCE) * (m_lastDirty - m_firstDirty + 1));
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, size, &m_lights[m_firstDirty]);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_lastUploadMicroseconds = std::chrono::duration<double, std::micro>(
+		std::chrono::high_resolution_clock::now() - startTime).count();
+	m_uploadCount++;
+	m_uploadedBytes += (unsigned long long)size;
+
+	m_firstDirty = 0;
+	m_lastDirty = -1;
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.h
+// ============
+// manage the light sources of the 3D scene in a uniform buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightManager
+ *
+ *  This class keeps the scene light sources in one packed
+ *  array that mirrors the light uniform buffer of the shader.
+ *  Lights can be added, removed and moved at any time, and
+ *  only the range of lights that changed is uploaded, once
+ *  per frame.
+ ***********************************************************/
+class LightManager
+{
+public:
+	// constructor
+	LightManager();
+	// destructor
+	~LightManager();
+
+	// maximum number of lights in the light buffer, must match
+	// MAX_LIGHTS in the fragment shader
+	static const int MAX_LIGHTS = 256;
+	// handle returned when a light could not be added
+	static const int INVALID_LIGHT = -1;
+
+	// one light source in the std140 layout of the light block,
+	// each vec3 shares its 16 bytes with the float after it
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		float focalStrength;
+		glm::vec3 ambientColor;
+		float specularIntensity;
+		glm::vec3 diffuseColor;
+		float padding0;
+		glm::vec3 specularColor;
+		float padding1;
+	};
+
+	// create the light buffer and bind it to the light block
+	bool Create(GLuint bindingPoint);
+	// free the light buffer
+	void Destroy();
+
+	// add a light and get a handle that stays valid until
+	// the light is removed
+	int AddLight(const LIGHT_SOURCE& light);
+	// remove a light
+	void RemoveLight(int lightHandle);
+	// change all the values of a light
+	void SetLight(int lightHandle, const LIGHT_SOURCE& light);
+	// move a light
+	void SetLightPosition(int lightHandle, const glm::vec3& position);
+	// get the values of a light
+	const LIGHT_SOURCE* GetLight(int lightHandle) const;
+
+	// upload the lights that changed since the last update
+	void Update();
+
+	// get the number of lights in the scene
+	int GetLightCount() const { return (int)m_lights.size(); }
+
+	// upload statistics
+	unsigned int GetUploadCount() const { return m_uploadCount; }
+	unsigned long long GetUploadedBytes() const { return m_uploadedBytes; }
+	double GetLastUploadMicroseconds() const { return m_lastUploadMicroseconds; }
+
+private:
+	// uniform buffer holding the lights
+	GLuint m_lightBuffer;
+	// packed lights, in the same order as in the light buffer
+	std::vector<LIGHT_SOURCE> m_lights;
+	// light handle of each packed light
+	std::vector<int> m_lightHandles;
+	// packed index of each light handle, -1 for free handles
+	std::vector<int> m_handleIndices;
+	// handles of removed lights, ready to be reused
+	std::vector<int> m_freeHandles;
+	// range of packed lights that changed, empty when the
+	// first index is past the last one
+	int m_firstDirty;
+	int m_lastDirty;
+	// upload statistics
+	unsigned int m_uploadCount;
+	unsigned long long m_uploadedBytes;
+	double m_lastUploadMicroseconds;
+
+	// get the packed index of a light handle, or -1
+	int FindLightIndex(int lightHandle) const;
+	// add a packed light to the range to upload
+	void MarkDirty(int index);
+};
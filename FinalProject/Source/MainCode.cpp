@@ -1,5 +1,12 @@
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <cmath>
+#include <fstream>          // camera path files
+#include <iomanip>          // image file numbering
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -8,11 +15,17 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
 
 #include "SceneManager.h"
 #include "ViewManager.h"
-#include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "OffscreenTarget.h"
+#include "FrameCapture.h"
+#include "FrameScheduler.h"
+#include "Profiler.h"
+#include "TextureLoader.h"
+#include "JobSystem.h"
 
 // Namespace for declaring global variables
 namespace
@@ -20,6 +33,10 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// least OpenGL version the renderer runs with
+	const int g_RequiredGLMajor = 4;
+	const int g_RequiredGLMinor = 4;
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -29,12 +46,82 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// job system for spreading the loading and per-frame work across the cores
+	JobSystem* g_JobSystem = nullptr;
+
+	// frames rendered around the scene by --orbit when no frame
+	// count is given
+	const int g_DefaultOrbitFrames = 60;
+
+	// pixel buffer objects frames are read back through, so the
+	// GPU can run this many frames ahead of the image writer
+	const int g_CaptureRingSize = 3;
+
+	// how often the frame time percentiles are shown in the
+	// window title, in seconds
+	const double g_TitleStatsInterval = 1.0;
+
+	// options read from the command line
+	struct COMMAND_LINE
+	{
+		// image files to compile into the texture cache
+		std::vector<std::string> cacheImages;
+		bool bCompressTextures = true;
+		// GPU memory the textures are streamed within in megabytes,
+		// -1 for the scene default and 0 for no limit
+		int textureBudgetMB = -1;
+		// render frames offscreen instead of opening a window
+		bool bHeadless = false;
+		int width = 1000;
+		int height = 800;
+		// frames to render, 0 for one per camera path pose or a
+		// single frame without a camera path
+		int frameCount = 0;
+		// images are written as <prefix>_0000.ppm and so on, or
+		// not at all when the prefix is empty
+		std::string outputPrefix = "frame";
+		// write PNG rather than PPM images
+		bool bPngImages = false;
+		// record the frames shown in the window as <prefix>_0000.ppm
+		// and so on, dropping frames the disk cannot keep up with
+		std::string capturePrefix;
+		// text file of camera poses to render the frames from
+		std::string cameraPathFile;
+		// circle the camera around the scene
+		bool bOrbit = false;
+		// simulation steps per second, most frames per second in
+		// the window, 0 for no limit, and vertical sync
+		double updateRate = 120.0;
+		double maxFrameRate = 0.0;
+		bool bVsync = true;
+		// record the next frame on the job threads while the window
+		// submits the current one, off by default as it shows the
+		// camera a frame late for little gain in a small scene
+		bool bPipelined = false;
+		// write the profiled zones of the frames to this Chrome
+		// trace file, or do not profile when it is empty
+		std::string profileFile;
+	};
+
+	// camera position and the point it looks at for one frame
+	struct CAMERA_POSE
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+	};
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
+bool InitializeGLFW(bool bHeadless);
 bool InitializeGLEW();
+bool ParseCommandLine(int argc, char* argv[], COMMAND_LINE& options);
+void PrintUsage(const char* programName);
+bool LoadCameraPath(const char* filename, std::vector<CAMERA_POSE>& cameraPath);
+bool RenderHeadless(const COMMAND_LINE& options);
+std::string GetImageFilename(const std::string& prefix, int frame, bool bPng);
+void PrintCaptureStats(FrameCapture& capture);
+void ShowFrameStats(const FrameScheduler& scheduler, int pickedObject);
 
 
 /***********************************************************
@@ -45,8 +132,30 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	COMMAND_LINE options;
+	if (ParseCommandLine(argc, argv, options) == false)
+	{
+		PrintUsage(argv[0]);
+		return(EXIT_FAILURE);
+	}
+
+	// the texture cache is built without a window, the cache
+	// files are only uploaded when the scene loads them
+	if (options.cacheImages.empty() == false)
+	{
+		int exitCode = EXIT_SUCCESS;
+		for (size_t i = 0; i < options.cacheImages.size(); i++)
+		{
+			if (TextureLoader::BuildCache(options.cacheImages[i].c_str(), options.bCompressTextures) == false)
+			{
+				exitCode = EXIT_FAILURE;
+			}
+		}
+		return(exitCode);
+	}
+
 	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
+	if (InitializeGLFW(options.bHeadless) == false)
 	{
 		return(EXIT_FAILURE);
 	}
@@ -57,8 +166,20 @@ int main(int argc, char* argv[])
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
-	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	// try to create the main display window, or a hidden one
+	// when rendering headless
+	if (options.bHeadless == true)
+	{
+		g_Window = g_ViewManager->CreateHeadlessWindow(WINDOW_TITLE, options.width, options.height);
+	}
+	else
+	{
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
+	if (g_Window == NULL)
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -68,18 +189,79 @@ int main(int argc, char* argv[])
 
 	// load the shader code from the external GLSL files
 	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
+		"Shaders/vertexShader.glsl",
+		"Shaders/fragmentShader.glsl");
 	g_ShaderManager->use();
 
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
+	// start the job system, then create a new scene manager object and
+	// prepare the 3D scene with it
+	g_JobSystem = new JobSystem();
+	g_JobSystem->Start(-1);
+	g_SceneManager = new SceneManager(g_ShaderManager, g_JobSystem);
+	if (options.textureBudgetMB >= 0)
+	{
+		g_SceneManager->SetTextureMemoryBudget((size_t)options.textureBudgetMB * 1024 * 1024);
+	}
 	g_SceneManager->PrepareScene();
 
+	// the frames are profiled from here, loading the scene is not
+	if ((options.profileFile.empty() == false) && (Profiler::Instance().Start(true) == false))
+	{
+		options.profileFile.clear();
+	}
+
+	// headless runs render their frames without the window loop
+	int exitCode = EXIT_SUCCESS;
+	if ((options.bHeadless == true) && (RenderHeadless(options) == false))
+	{
+		exitCode = EXIT_FAILURE;
+	}
+
+	// frames shown in the window are recorded when asked to
+	FrameCapture windowCapture;
+	int capturedFrame = 0;
+	if ((options.bHeadless == false) && (options.capturePrefix.empty() == false))
+	{
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
+		if (windowCapture.Create(framebufferWidth, framebufferHeight, g_CaptureRingSize, true) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+
+	// the camera moves in fixed steps and the frames are paced
+	// to bound the time spent on them
+	FrameScheduler scheduler;
+	if (options.bHeadless == false)
+	{
+		if (scheduler.Create(options.updateRate, options.maxFrameRate) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+		scheduler.SetVsync(options.bVsync);
+		// a pipelined frame shows the camera of the frame before
+		// it, so captured frames are rendered one at a time
+		g_SceneManager->SetPipelined((options.bPipelined == true) && (options.capturePrefix.empty() == true));
+	}
+	double titleStatsTime = glfwGetTime();
+	// scene object last clicked on, -1 for none
+	int pickedObject = -1;
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	while ((options.bHeadless == false) && (!glfwWindowShouldClose(g_Window)))
 	{
+		PROFILE_ZONE("Frame");
+
+		// move the camera for the time since the last frame
+		int stepCount = scheduler.BeginFrame();
+		for (int step = 0; step < stepCount; step++)
+		{
+			g_ViewManager->UpdateCamera(scheduler.GetTimeStep());
+		}
+
 		// Enable z-depth
 		glEnable(GL_DEPTH_TEST);
 
@@ -88,17 +270,70 @@ int main(int argc, char* argv[])
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		g_ViewManager->PrepareSceneView(scheduler.GetInterpolation());
+		g_SceneManager->SetCameraView(g_ViewManager->GetViewMatrix(), g_ViewManager->GetProjectionMatrix());
+
+		// select the scene object clicked on, or none when the
+		// click misses, and show it in the title straight away
+		glm::vec3 pickOrigin;
+		glm::vec3 pickDirection;
+		if (g_ViewManager->GetPickRay(pickOrigin, pickDirection) == true)
+		{
+			pickedObject = g_SceneManager->PickObject(pickOrigin, pickDirection);
+			titleStatsTime = 0.0;
+		}
 
 		// refresh the 3D scene
 		g_SceneManager->RenderScene();
 
+		// start reading the frame back before it is swapped away
+		if (options.capturePrefix.empty() == false)
+		{
+			PROFILE_GPU_ZONE("CaptureFrame");
+			windowCapture.CaptureFrame(0, GetImageFilename(options.capturePrefix, capturedFrame++, options.bPngImages));
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		{
+			PROFILE_GPU_ZONE("SwapBuffers");
+			glfwSwapBuffers(g_Window);
+		}
 
 		// query the latest GLFW events
-		glfwPollEvents();
+		{
+			PROFILE_ZONE("PollEvents");
+			glfwPollEvents();
+		}
+
+		if (glfwGetTime() - titleStatsTime >= g_TitleStatsInterval)
+		{
+			ShowFrameStats(scheduler, pickedObject);
+			titleStatsTime = glfwGetTime();
+		}
+
+		// wait out the rest of the frame under the frame limit
+		{
+			PROFILE_ZONE("WaitForFrame");
+			scheduler.EndFrame();
+		}
+		PROFILE_END_FRAME();
+	}
+
+	if (options.capturePrefix.empty() == false)
+	{
+		windowCapture.Flush();
+		PrintCaptureStats(windowCapture);
+		windowCapture.Destroy();
+	}
+	if ((options.bHeadless == false) && (NULL != g_SceneManager))
+	{
+		scheduler.PrintStats();
+		g_SceneManager->GetTextureStreamer().PrintStats();
+	}
+	if ((options.profileFile.empty() == false) &&
+		(Profiler::Instance().WriteTrace(options.profileFile.c_str()) == false))
+	{
+		exitCode = EXIT_FAILURE;
 	}
 
 	// clear the allocated manager objects from memory
@@ -107,6 +342,11 @@ int main(int argc, char* argv[])
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
+	if (NULL != g_JobSystem)
+	{
+		delete g_JobSystem;
+		g_JobSystem = NULL;
+	}
 	if (NULL != g_ViewManager)
 	{
 		delete g_ViewManager;
@@ -118,8 +358,8 @@ int main(int argc, char* argv[])
 		g_ShaderManager = NULL;
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program
+	exit(exitCode); 
 }
 
 /***********************************************************
@@ -127,23 +367,34 @@ int main(int argc, char* argv[])
  * 
  *  This function is used to initialize the GLFW library.   
  ***********************************************************/
-bool InitializeGLFW()
+bool InitializeGLFW(bool bHeadless)
 {
 	// GLFW: initialize and configure library
 	// --------------------------------------
-	glfwInit();
-
-#ifdef __APPLE__
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef GLFW_PLATFORM_NULL
+	// GLFW 3.4 and later can run without a display server, so
+	// headless rendering works on machines without one
+	if (bHeadless == true)
+	{
+		glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+	}
 #endif
+	if (glfwInit() == GLFW_FALSE)
+	{
+		std::cout << "Failed to initialize GLFW" << std::endl;
+		return(false);
+	}
+
+	// set the version of OpenGL and profile to use - the
+	// shaders bind their blocks in the layout, and the instances
+	// and draws are streamed through persistently mapped buffers,
+	// so OpenGL 4.4 is the least the renderer runs with.  macOS
+	// stops at OpenGL 4.1, so the window fails to open there.
+	// llvmpipe, the software rasteriser Mesa falls back to on
+	// machines without a GPU, provides OpenGL 4.5
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, g_RequiredGLMajor);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, g_RequiredGLMinor);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 	// GLFW: end -------------------------------
 
 	return(true);
@@ -162,6 +413,14 @@ bool InitializeGLEW()
 
 	// try to initialize the GLEW library
 	GLEWInitResult = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	// GLEW built for GLX loads the OpenGL functions before it
+	// looks for an X display, which headless EGL contexts lack
+	if (GLEW_ERROR_NO_GLX_DISPLAY == GLEWInitResult)
+	{
+		GLEWInitResult = GLEW_OK;
+	}
+#endif
 	if (GLEW_OK != GLEWInitResult)
 	{
 		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
@@ -169,9 +428,391 @@ bool InitializeGLEW()
 	}
 	// GLEW: end -------------------------------
 
+	if (GLEW_VERSION_4_4 == GL_FALSE)
+	{
+		std::cout << "OpenGL " << g_RequiredGLMajor << "." << g_RequiredGLMinor << " or newer is required, the context provides "
+			<< glGetString(GL_VERSION) << std::endl;
+		return(false);
+	}
+
 	// Displays a successful OpenGL initialization message
 	std::cout << "INFO: OpenGL Successfully Initialized\n";
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the options from the
+ *  command line arguments.
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[], COMMAND_LINE& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* argument = argv[i];
+		bool bHasValue = (i + 1 < argc);
+
+		if ((strcmp(argument, "--build-texture-cache") == 0) && (bHasValue == true))
+		{
+			options.cacheImages.push_back(argv[++i]);
+		}
+		else if (strcmp(argument, "--no-texture-compression") == 0)
+		{
+			options.bCompressTextures = false;
+		}
+		else if ((strcmp(argument, "--texture-budget") == 0) && (bHasValue == true))
+		{
+			options.textureBudgetMB = atoi(argv[++i]);
+		}
+		else if (strcmp(argument, "--headless") == 0)
+		{
+			options.bHeadless = true;
+		}
+		else if ((strcmp(argument, "--width") == 0) && (bHasValue == true))
+		{
+			options.width = atoi(argv[++i]);
+		}
+		else if ((strcmp(argument, "--height") == 0) && (bHasValue == true))
+		{
+			options.height = atoi(argv[++i]);
+		}
+		else if ((strcmp(argument, "--frames") == 0) && (bHasValue == true))
+		{
+			options.frameCount = atoi(argv[++i]);
+		}
+		else if ((strcmp(argument, "--output") == 0) && (bHasValue == true))
+		{
+			options.outputPrefix = argv[++i];
+		}
+		else if (strcmp(argument, "--no-output") == 0)
+		{
+			options.outputPrefix.clear();
+		}
+		else if (strcmp(argument, "--png") == 0)
+		{
+			options.bPngImages = true;
+		}
+		else if ((strcmp(argument, "--capture") == 0) && (bHasValue == true))
+		{
+			options.capturePrefix = argv[++i];
+		}
+		else if ((strcmp(argument, "--camera-path") == 0) && (bHasValue == true))
+		{
+			options.cameraPathFile = argv[++i];
+		}
+		else if (strcmp(argument, "--orbit") == 0)
+		{
+			options.bOrbit = true;
+		}
+		else if ((strcmp(argument, "--update-rate") == 0) && (bHasValue == true))
+		{
+			options.updateRate = atof(argv[++i]);
+		}
+		else if ((strcmp(argument, "--profile") == 0) && (bHasValue == true))
+		{
+			options.profileFile = argv[++i];
+		}
+		else if ((strcmp(argument, "--fps-cap") == 0) && (bHasValue == true))
+		{
+			options.maxFrameRate = atof(argv[++i]);
+		}
+		else if ((strcmp(argument, "--vsync") == 0) && (bHasValue == true) &&
+			((strcmp(argv[i + 1], "on") == 0) || (strcmp(argv[i + 1], "off") == 0)))
+		{
+			options.bVsync = (strcmp(argv[++i], "on") == 0);
+		}
+		else if ((strcmp(argument, "--pipeline") == 0) && (bHasValue == true) &&
+			((strcmp(argv[i + 1], "on") == 0) || (strcmp(argv[i + 1], "off") == 0)))
+		{
+			options.bPipelined = (strcmp(argv[++i], "on") == 0);
+		}
+		else
+		{
+			std::cout << "Unknown or incomplete argument: " << argument << std::endl;
+			return(false);
+		}
+	}
+
+	if ((options.width <= 0) || (options.height <= 0) || (options.frameCount < 0))
+	{
+		std::cout << "The frame size and count must be positive" << std::endl;
+		return(false);
+	}
+	if ((options.updateRate <= 0.0) || (options.maxFrameRate < 0.0))
+	{
+		std::cout << "The update rate must be positive and the frame limit not negative" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	PrintUsage()
+ *
+ *  This function is used to print the command line options.
+ ***********************************************************/
+void PrintUsage(const char* programName)
+{
+	std::cout << "Usage: " << programName << " [options]\n"
+		<< "  --headless            render offscreen without a window and exit\n"
+		<< "  --width N, --height N size of the headless frames (1000x800)\n"
+		<< "  --frames N            number of headless frames to render\n"
+		<< "  --output PREFIX       write the frames as PREFIX_0000.ppm ... (frame)\n"
+		<< "  --no-output           render the frames without writing them\n"
+		<< "  --png                 write PNG images instead of PPM\n"
+		<< "  --capture PREFIX      record the window's frames as PREFIX_0000.ppm ...\n"
+		<< "  --camera-path FILE    camera poses, one per line: px py pz tx ty tz\n"
+		<< "  --orbit               circle the camera around the scene\n"
+		<< "  --update-rate HZ      camera movement steps per second (120)\n"
+		<< "  --fps-cap N           most frames per second in the window, 0 for no\n"
+		<< "                        limit (0)\n"
+		<< "  --vsync on|off        wait for the display when swapping frames (on)\n"
+		<< "  --pipeline on|off     record the next frame on the job threads while the\n"
+		<< "                        window submits the current one, a frame behind (off,\n"
+		<< "                        always off while capturing)\n"
+		<< "  --profile FILE        time the parts of every frame on the CPU and GPU and\n"
+		<< "                        write them to FILE as a Chrome trace (chrome://tracing)\n"
+		<< "  --build-texture-cache F  compile an image into the texture cache, check\n"
+		<< "                        it against the image and exit, can be repeated\n"
+		<< "  --no-texture-compression  build the texture cache without block compression\n"
+		<< "  --texture-budget MB   GPU memory to stream the textures within (256), 0 for\n"
+		<< "                        no limit\n"
+		<< "Headless rendering needs no display server or GPU with GLFW 3.4 and\n"
+		<< "Mesa, set LIBGL_ALWAYS_SOFTWARE=1 to force the software rasteriser." << std::endl;
+}
+
+/***********************************************************
+ *	LoadCameraPath()
+ *
+ *  This function is used to read camera poses from a text
+ *  file.  Every line holds the camera position and the point
+ *  it looks at as six numbers, and lines starting with # are
+ *  comments.
+ ***********************************************************/
+bool LoadCameraPath(const char* filename, std::vector<CAMERA_POSE>& cameraPath)
+{
+	std::ifstream pathFile(filename);
+	if (!pathFile)
+	{
+		std::cout << "Could not open camera path file: " << filename << std::endl;
+		return(false);
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(pathFile, line))
+	{
+		lineNumber++;
+		size_t first = line.find_first_not_of(" \t\r");
+		if ((first == std::string::npos) || (line[first] == '#'))
+		{
+			continue;
+		}
+
+		std::istringstream values(line);
+		CAMERA_POSE pose;
+		if (!(values >> pose.position.x >> pose.position.y >> pose.position.z
+			>> pose.target.x >> pose.target.y >> pose.target.z))
+		{
+			std::cout << filename << ":" << lineNumber << ": expected six numbers" << std::endl;
+			return(false);
+		}
+		cameraPath.push_back(pose);
+	}
+
+	if (cameraPath.empty())
+	{
+		std::cout << "Camera path file has no poses: " << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	RenderHeadless()
+ *
+ *  This function is used to render the scene into an
+ *  offscreen framebuffer for the requested frames, following
+ *  the camera path if there is one, and write every frame to
+ *  an image file.  The frames are read back asynchronously
+ *  and written on another thread, so rendering only waits
+ *  when the capture ring is full.  The frame rate and the
+ *  capture counters are reported at the end.
+ ***********************************************************/
+bool RenderHeadless(const COMMAND_LINE& options)
+{
+	OffscreenTarget target;
+	if (target.Create(options.width, options.height) == false)
+	{
+		return(false);
+	}
+
+	std::vector<CAMERA_POSE> cameraPath;
+	if ((options.cameraPathFile.empty() == false) &&
+		(LoadCameraPath(options.cameraPathFile.c_str(), cameraPath) == false))
+	{
+		return(false);
+	}
+
+	int frameCount = options.frameCount;
+	if ((cameraPath.empty() == true) && (options.bOrbit == true))
+	{
+		// circle the middle of the scene from slightly above
+		glm::vec3 boundsMin(-1.0f);
+		glm::vec3 boundsMax(1.0f);
+		g_SceneManager->GetSceneBounds(boundsMin, boundsMax);
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = glm::max(glm::length(boundsMax - boundsMin) * 0.75f, 1.0f);
+
+		int orbitFrames = (frameCount > 0) ? frameCount : g_DefaultOrbitFrames;
+		for (int frame = 0; frame < orbitFrames; frame++)
+		{
+			float angle = glm::two_pi<float>() * frame / orbitFrames;
+			CAMERA_POSE pose;
+			pose.position = center + glm::vec3(std::cos(angle) * radius, radius * 0.5f, std::sin(angle) * radius);
+			pose.target = center;
+			cameraPath.push_back(pose);
+		}
+	}
+	if (frameCount == 0)
+	{
+		frameCount = cameraPath.empty() ? 1 : (int)cameraPath.size();
+	}
+
+	// the frames should show the textures, not their placeholders
+	g_SceneManager->FinishTextureLoads();
+
+	std::cout << "Rendering " << frameCount << " frames of " << options.width << "x" << options.height
+		<< " headless with " << glGetString(GL_RENDERER) << std::endl;
+
+	// every frame is wanted, so a full capture ring is waited for
+	FrameCapture capture;
+	bool bWriteImages = (options.outputPrefix.empty() == false);
+	if ((bWriteImages == true) &&
+		(capture.Create(options.width, options.height, g_CaptureRingSize, false) == false))
+	{
+		return(false);
+	}
+
+	// the headless frames are not paced, only timed
+	FrameScheduler scheduler;
+	scheduler.Create(options.updateRate, 0.0);
+
+	target.Bind();
+	double captureSeconds = 0.0;
+	double startTime = glfwGetTime();
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		PROFILE_ZONE("Frame");
+		scheduler.BeginFrame();
+
+		if (cameraPath.empty() == false)
+		{
+			const CAMERA_POSE& pose = cameraPath[frame % cameraPath.size()];
+			g_ViewManager->SetCameraPose(pose.position, pose.target);
+		}
+
+		glEnable(GL_DEPTH_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		g_ViewManager->PrepareSceneView(1.0f);
+		g_SceneManager->SetCameraView(g_ViewManager->GetViewMatrix(), g_ViewManager->GetProjectionMatrix());
+		g_SceneManager->RenderScene();
+
+		if (bWriteImages == true)
+		{
+			PROFILE_GPU_ZONE("CaptureFrame");
+			double captureStart = glfwGetTime();
+			capture.CaptureFrame(target.GetFramebuffer(),
+				GetImageFilename(options.outputPrefix, frame, options.bPngImages));
+			captureSeconds += glfwGetTime() - captureStart;
+		}
+		PROFILE_END_FRAME();
+	}
+	glFinish();
+	double renderSeconds = glfwGetTime() - startTime;
+	target.Unbind();
+
+	// the last frames are still being written
+	if (bWriteImages == true)
+	{
+		capture.Flush();
+	}
+	double totalSeconds = glfwGetTime() - startTime;
+
+	std::cout << "Rendered " << frameCount << " frames in " << totalSeconds << " seconds, "
+		<< ((totalSeconds > 0.0) ? (frameCount / totalSeconds) : 0.0) << " frames per second" << std::endl;
+	std::cout << "  render loop " << (renderSeconds * 1000.0 / frameCount) << " ms per frame ("
+		<< ((renderSeconds > 0.0) ? (frameCount / renderSeconds) : 0.0) << " frames per second), of which capturing "
+		<< (captureSeconds * 1000.0 / frameCount) << " ms per frame" << std::endl;
+	scheduler.PrintStats();
+	g_SceneManager->GetTextureStreamer().PrintStats();
+	if (bWriteImages == true)
+	{
+		PrintCaptureStats(capture);
+		if (capture.GetStats().failedFrames > 0)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	GetImageFilename()
+ *
+ *  This function is used to build the numbered image file
+ *  name of a frame.
+ ***********************************************************/
+std::string GetImageFilename(const std::string& prefix, int frame, bool bPng)
+{
+	std::ostringstream filename;
+	filename << prefix << "_" << std::setw(4) << std::setfill('0') << frame << (bPng ? ".png" : ".ppm");
+
+	return(filename.str());
+}
+
+/***********************************************************
+ *	PrintCaptureStats()
+ *
+ *  This function is used to report how many frames were
+ *  captured, dropped and waited for, and how long they took
+ *  to reach the disk.
+ ***********************************************************/
+void PrintCaptureStats(FrameCapture& capture)
+{
+	FrameCapture::CAPTURE_STATS stats = capture.GetStats();
+	std::cout << "  captured " << stats.capturedFrames << " frames, wrote " << stats.writtenFrames
+		<< ", dropped " << stats.droppedFrames << ", stalled " << stats.stalledFrames
+		<< ", failed " << stats.failedFrames << std::endl;
+	std::cout << "  capture latency " << stats.averageLatencyMs << " ms average, "
+		<< stats.maxLatencyMs << " ms worst" << std::endl;
+}
+
+/***********************************************************
+ *	ShowFrameStats()
+ *
+ *  This function is used to show the frame rate, frame
+ *  time percentiles and selected scene object in the window
+ *  title while it runs.
+ ***********************************************************/
+void ShowFrameStats(const FrameScheduler& scheduler, int pickedObject)
+{
+	FrameScheduler::FRAME_STATS stats = scheduler.GetStats();
+	std::ostringstream title;
+	title << std::fixed << std::setprecision(1) << WINDOW_TITLE << " - "
+		<< ((stats.averageMs > 0.0) ? (1000.0 / stats.averageMs) : 0.0) << " fps, p50 "
+		<< stats.p50Ms << " ms, p95 " << stats.p95Ms << " ms, p99 " << stats.p99Ms << " ms";
+	if (pickedObject >= 0)
+	{
+		title << " - object " << pickedObject << " selected";
+	}
+	glfwSetWindowTitle(g_Window, title.str().c_str());
+}
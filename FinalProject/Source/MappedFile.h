@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// map a read-only file into memory so that its contents can be used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class wraps the platform calls for mapping a whole
+ *  file into the address space as read-only memory.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the contents of the passed in file into memory
+	bool Open(const char* filename);
+	// unmap the file and release the handles
+	void Close();
+
+	// get the start of the mapped file contents
+	const unsigned char* GetData() const { return m_pData; }
+	// get the size in bytes of the mapped file contents
+	size_t GetSize() const { return m_size; }
+
+	// get the last modification time of a file, -1 if it is missing
+	static long long GetModificationTime(const char* filename);
+
+private:
+	// start of the mapped memory, NULL when nothing is mapped
+	const unsigned char* m_pData;
+	// size of the mapped memory
+	size_t m_size;
+#ifdef _WIN32
+	// platform handles for the open file and its mapping
+	void* m_hFile;
+	void* m_hMapping;
+#else
+	// descriptor of the open file
+	int m_fileDescriptor;
+#endif
+
+	// mapped files own their handles, so they cannot be copied
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
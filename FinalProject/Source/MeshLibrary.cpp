@@ -0,0 +1,512 @@
+#include "MeshLibrary.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// number of sides around the round shapes
+	const int g_RoundSides = 36;
+	// number of segments around the tube of the torus, must be
+	// even so the half torus is the first half of its indices
+	const int g_TorusRingSegments = 36;
+	const int g_TorusTubeSegments = 18;
+	// radius of the torus ring and of its tube
+	const float g_TorusMainRadius = 1.0f;
+	const float g_TorusTubeRadius = 0.2f;
+
+	// first attribute location of the per-instance values
+	const GLuint g_InstanceModelLocation = 3;
+	const GLuint g_InstanceColorLocation = 7;
+	const GLuint g_InstanceTextureLayerLocation = 8;
+}
+
+/***********************************************************
+ *  MeshLibrary()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshLibrary::MeshLibrary()
+{
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_bMultiDrawIndirect = false;
+	m_currentMesh = 0;
+	for (int i = 0; i < SceneDescription::MESH_COUNT; i++)
+	{
+		m_meshes[i].baseVertex = 0;
+		m_meshes[i].firstIndex = 0;
+		m_meshes[i].indexCount = 0;
+		m_meshes[i].boundsMin = glm::vec3(0.0f);
+		m_meshes[i].boundsMax = glm::vec3(0.0f);
+	}
+}
+
+MeshLibrary::~MeshLibrary()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for generating all the basic shapes,
+ *  uploading them into the shared vertex and index buffers
+ *  and describing the vertex layout in the vertex array.
+ ***********************************************************/
+bool MeshLibrary::Create()
+{
+	Destroy();
+
+	m_vertices.clear();
+	m_indices.clear();
+	GeneratePlane();
+	GenerateBox();
+	GenerateFrustum(SceneDescription::MESH_CONE, 1.0f, 0.0f, false);
+	GenerateFrustum(SceneDescription::MESH_CYLINDER, 1.0f, 1.0f, true);
+	GenerateFrustum(SceneDescription::MESH_TAPERED_CYLINDER, 1.0f, 0.5f, true);
+	GenerateTorus();
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glGenBuffers(1, &m_vertexBuffer);
+	glGenBuffers(1, &m_indexBuffer);
+	if ((m_vertexArray == 0) || (m_vertexBuffer == 0) || (m_indexBuffer == 0))
+	{
+		std::cout << "Could not create the mesh buffers" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	glBindVertexArray(m_vertexArray);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(VERTEX) * m_vertices.size(), m_vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * m_indices.size(), m_indices.data(), GL_STATIC_DRAW);
+
+	// position, normal and texture coordinate, as declared in
+	// the vertex shader
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(VERTEX), (void*)offsetof(VERTEX, textureCoordinate));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the draw commands carry a base instance, which indirect
+	// draws read from OpenGL 4.3 on
+	m_bMultiDrawIndirect = ((GLEW_VERSION_4_3) || (GLEW_ARB_multi_draw_indirect));
+
+	std::cout << "Mesh library: " << m_vertices.size() << " vertices, "
+		<< m_indices.size() << " indices" << std::endl;
+
+	// the geometry lives on the GPU now
+	m_vertices.clear();
+	m_vertices.shrink_to_fit();
+	m_indices.clear();
+	m_indices.shrink_to_fit();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the vertex array and the
+ *  shared buffers.
+ ***********************************************************/
+void MeshLibrary::Destroy()
+{
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (m_vertexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_vertexBuffer);
+		m_vertexBuffer = 0;
+	}
+	if (m_indexBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_indexBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  SetInstanceBuffer()
+ *
+ *  This method is used for pointing the per-instance vertex
+ *  attributes at the passed in buffer, which holds one
+ *  INSTANCE_DATA for every instance.  The model matrix is
+ *  read as four column attributes.
+ ***********************************************************/
+void MeshLibrary::SetInstanceBuffer(GLuint instanceBuffer)
+{
+	if (m_vertexArray == 0)
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+
+	for (GLuint column = 0; column < 4; column++)
+	{
+		GLuint location = g_InstanceModelLocation + column;
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA),
+			(void*)(offsetof(INSTANCE_DATA, model) + sizeof(glm::vec4) * column));
+		glVertexAttribDivisor(location, 1);
+	}
+	glEnableVertexAttribArray(g_InstanceColorLocation);
+	glVertexAttribPointer(g_InstanceColorLocation, 4, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA),
+		(void*)offsetof(INSTANCE_DATA, color));
+	glVertexAttribDivisor(g_InstanceColorLocation, 1);
+	glEnableVertexAttribArray(g_InstanceTextureLayerLocation);
+	glVertexAttribPointer(g_InstanceTextureLayerLocation, 1, GL_FLOAT, GL_FALSE, sizeof(INSTANCE_DATA),
+		(void*)offsetof(INSTANCE_DATA, textureLayer));
+	glVertexAttribDivisor(g_InstanceTextureLayerLocation, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the shared vertex array.
+ ***********************************************************/
+void MeshLibrary::Bind() const
+{
+	glBindVertexArray(m_vertexArray);
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for drawing a run of instances from
+ *  the instance buffer with one mesh, in a single draw call.
+ *  The vertex array must be bound.
+ ***********************************************************/
+void MeshLibrary::DrawInstanced(int meshID, GLsizei instanceCount, GLuint baseInstance) const
+{
+	if ((meshID < 0) || (meshID >= SceneDescription::MESH_COUNT) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	const MESH_RANGE& mesh = m_meshes[meshID];
+	glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT,
+		(void*)(sizeof(GLuint) * mesh.firstIndex), instanceCount, mesh.baseVertex, baseInstance);
+}
+
+/***********************************************************
+ *  GetDrawCommand()
+ *
+ *  This method is used for filling in the indirect draw of
+ *  a run of instances with one mesh.  An unknown mesh gets a
+ *  draw without indices, which draws nothing.
+ ***********************************************************/
+void MeshLibrary::GetDrawCommand(int meshID, GLsizei instanceCount, GLuint baseInstance, DRAW_COMMAND& outCommand) const
+{
+	outCommand.indexCount = 0;
+	outCommand.instanceCount = (GLuint)std::max(instanceCount, 0);
+	outCommand.firstIndex = 0;
+	outCommand.baseVertex = 0;
+	outCommand.baseInstance = baseInstance;
+	if ((meshID < 0) || (meshID >= SceneDescription::MESH_COUNT))
+	{
+		return;
+	}
+
+	const MESH_RANGE& mesh = m_meshes[meshID];
+	outCommand.indexCount = (GLuint)mesh.indexCount;
+	outCommand.firstIndex = mesh.firstIndex;
+	outCommand.baseVertex = mesh.baseVertex;
+}
+
+/***********************************************************
+ *  MultiDrawIndirect()
+ *
+ *  This method is used for drawing a run of the commands of
+ *  the bound indirect draw buffer in a single draw call, the
+ *  GPU reading the mesh and instances of every draw from the
+ *  buffer.  The vertex array must be bound.
+ ***********************************************************/
+void MeshLibrary::MultiDrawIndirect(GLintptr offset, GLsizei drawCount) const
+{
+	if (drawCount <= 0)
+	{
+		return;
+	}
+
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, drawCount, sizeof(DRAW_COMMAND));
+}
+
+/***********************************************************
+ *  BeginMesh()
+ *
+ *  This method is used for starting a mesh at the current
+ *  end of the generated vertices and indices.
+ ***********************************************************/
+void MeshLibrary::BeginMesh(int meshID)
+{
+	m_currentMesh = meshID;
+
+	MESH_RANGE& mesh = m_meshes[meshID];
+	mesh.baseVertex = (GLint)m_vertices.size();
+	mesh.firstIndex = (GLuint)m_indices.size();
+	mesh.indexCount = 0;
+	mesh.boundsMin = glm::vec3(0.0f);
+	mesh.boundsMax = glm::vec3(0.0f);
+}
+
+/***********************************************************
+ *  EndMesh()
+ *
+ *  This method is used for finishing a mesh, counting its
+ *  indices and measuring its bounding box.
+ ***********************************************************/
+void MeshLibrary::EndMesh(int meshID)
+{
+	MESH_RANGE& mesh = m_meshes[meshID];
+	mesh.indexCount = (GLsizei)(m_indices.size() - mesh.firstIndex);
+
+	if ((size_t)mesh.baseVertex < m_vertices.size())
+	{
+		mesh.boundsMin = m_vertices[mesh.baseVertex].position;
+		mesh.boundsMax = mesh.boundsMin;
+		for (size_t i = (size_t)mesh.baseVertex; i < m_vertices.size(); i++)
+		{
+			mesh.boundsMin = glm::min(mesh.boundsMin, m_vertices[i].position);
+			mesh.boundsMax = glm::max(mesh.boundsMax, m_vertices[i].position);
+		}
+	}
+}
+
+/***********************************************************
+ *  AddVertex()
+ *
+ *  This method is used for adding a vertex and getting its
+ *  index relative to the base vertex of the current mesh.
+ ***********************************************************/
+GLuint MeshLibrary::AddVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& textureCoordinate)
+{
+	VERTEX vertex;
+	vertex.position = position;
+	vertex.normal = normal;
+	vertex.textureCoordinate = textureCoordinate;
+	m_vertices.push_back(vertex);
+
+	return((GLuint)(m_vertices.size() - 1 - m_meshes[m_currentMesh].baseVertex));
+}
+
+/***********************************************************
+ *  AddQuad()
+ *
+ *  This method is used for adding a quad centered at the
+ *  passed in position and spanning the two passed in axes,
+ *  with the texture stretched across it once.
+ ***********************************************************/
+void MeshLibrary::AddQuad(const glm::vec3& center, const glm::vec3& uAxis, const glm::vec3& vAxis, const glm::vec3& normal)
+{
+	glm::vec3 halfU = uAxis * 0.5f;
+	glm::vec3 halfV = vAxis * 0.5f;
+
+	GLuint first = AddVertex(center - halfU - halfV, normal, glm::vec2(0.0f, 0.0f));
+	AddVertex(center + halfU - halfV, normal, glm::vec2(1.0f, 0.0f));
+	AddVertex(center + halfU + halfV, normal, glm::vec2(1.0f, 1.0f));
+	AddVertex(center - halfU + halfV, normal, glm::vec2(0.0f, 1.0f));
+
+	m_indices.push_back(first);
+	m_indices.push_back(first + 1);
+	m_indices.push_back(first + 2);
+	m_indices.push_back(first);
+	m_indices.push_back(first + 2);
+	m_indices.push_back(first + 3);
+}
+
+/***********************************************************
+ *  GeneratePlane()
+ *
+ *  This method is used for generating a 2 x 2 plane in the
+ *  XZ plane, facing up.
+ ***********************************************************/
+void MeshLibrary::GeneratePlane()
+{
+	BeginMesh(SceneDescription::MESH_PLANE);
+	AddQuad(glm::vec3(0.0f), glm::vec3(2.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -2.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	EndMesh(SceneDescription::MESH_PLANE);
+}
+
+/***********************************************************
+ *  GenerateBox()
+ *
+ *  This method is used for generating a unit box centered
+ *  at the origin, with the texture on every face.
+ ***********************************************************/
+void MeshLibrary::GenerateBox()
+{
+	const glm::vec3 x(1.0f, 0.0f, 0.0f);
+	const glm::vec3 y(0.0f, 1.0f, 0.0f);
+	const glm::vec3 z(0.0f, 0.0f, 1.0f);
+
+	BeginMesh(SceneDescription::MESH_BOX);
+	AddQuad(z * 0.5f, x, y, z);
+	AddQuad(-z * 0.5f, -x, y, -z);
+	AddQuad(x * 0.5f, -z, y, x);
+	AddQuad(-x * 0.5f, z, y, -x);
+	AddQuad(y * 0.5f, x, -z, y);
+	AddQuad(-y * 0.5f, x, z, -y);
+	EndMesh(SceneDescription::MESH_BOX);
+}
+
+/***********************************************************
+ *  GenerateFrustum()
+ *
+ *  This method is used for generating a round shape of unit
+ *  height standing on the origin, narrowing from the bottom
+ *  radius to the top radius.  A top radius of zero makes a
+ *  cone, equal radii make a cylinder.
+ ***********************************************************/
+void MeshLibrary::GenerateFrustum(int meshID, float bottomRadius, float topRadius, bool bTopCap)
+{
+	const float angleStep = glm::two_pi<float>() / g_RoundSides;
+
+	BeginMesh(meshID);
+
+	// side, with the seam duplicated so the texture wraps once
+	GLuint sideStart = 0;
+	for (int i = 0; i <= g_RoundSides; i++)
+	{
+		float angle = angleStep * i;
+		float c = std::cos(angle);
+		float s = -std::sin(angle);
+		glm::vec3 normal = glm::normalize(glm::vec3(c, bottomRadius - topRadius, s));
+		float u = (float)i / g_RoundSides;
+
+		GLuint bottom = AddVertex(glm::vec3(c * bottomRadius, 0.0f, s * bottomRadius), normal, glm::vec2(u, 0.0f));
+		AddVertex(glm::vec3(c * topRadius, 1.0f, s * topRadius), normal, glm::vec2(u, 1.0f));
+		if (i == 0)
+		{
+			sideStart = bottom;
+		}
+	}
+	for (int i = 0; i < g_RoundSides; i++)
+	{
+		GLuint bottom = sideStart + i * 2;
+		m_indices.push_back(bottom);
+		m_indices.push_back(bottom + 2);
+		m_indices.push_back(bottom + 3);
+		// a cone meets at its tip, where this half of the quad has no area
+		if (topRadius > 0.0f)
+		{
+			m_indices.push_back(bottom);
+			m_indices.push_back(bottom + 3);
+			m_indices.push_back(bottom + 1);
+		}
+	}
+
+	// caps, wound to face down and up
+	for (int cap = 0; cap < 2; cap++)
+	{
+		bool bTop = (cap == 1);
+		if (bTop && !bTopCap)
+		{
+			continue;
+		}
+
+		float height = bTop ? 1.0f : 0.0f;
+		float radius = bTop ? topRadius : bottomRadius;
+		glm::vec3 normal(0.0f, bTop ? 1.0f : -1.0f, 0.0f);
+
+		GLuint center = AddVertex(glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+		for (int i = 0; i <= g_RoundSides; i++)
+		{
+			float angle = angleStep * i;
+			float c = std::cos(angle);
+			float s = -std::sin(angle);
+			AddVertex(glm::vec3(c * radius, height, s * radius), normal, glm::vec2(0.5f + 0.5f * c, 0.5f - 0.5f * s));
+		}
+		for (int i = 0; i < g_RoundSides; i++)
+		{
+			GLuint rim = center + 1 + i;
+			m_indices.push_back(center);
+			m_indices.push_back(bTop ? rim : rim + 1);
+			m_indices.push_back(bTop ? rim + 1 : rim);
+		}
+	}
+
+	EndMesh(meshID);
+}
+
+/***********************************************************
+ *  GenerateTorus()
+ *
+ *  This method is used for generating a torus around the Z
+ *  axis, in the XY plane.  The indices are laid out ring
+ *  segment by ring segment starting at the +X axis, so the
+ *  first half of them is the half torus above the X axis,
+ *  which shares the vertices of the full torus.
+ ***********************************************************/
+void MeshLibrary::GenerateTorus()
+{
+	const float ringStep = glm::two_pi<float>() / g_TorusRingSegments;
+	const float tubeStep = glm::two_pi<float>() / g_TorusTubeSegments;
+	const GLuint rowLength = g_TorusTubeSegments + 1;
+
+	BeginMesh(SceneDescription::MESH_TORUS);
+
+	for (int i = 0; i <= g_TorusRingSegments; i++)
+	{
+		float ringAngle = ringStep * i;
+		float ringCos = std::cos(ringAngle);
+		float ringSin = std::sin(ringAngle);
+		for (int j = 0; j <= g_TorusTubeSegments; j++)
+		{
+			float tubeAngle = tubeStep * j;
+			float tubeCos = std::cos(tubeAngle);
+			float tubeSin = std::sin(tubeAngle);
+
+			float distance = g_TorusMainRadius + g_TorusTubeRadius * tubeCos;
+			glm::vec3 position(distance * ringCos, distance * ringSin, g_TorusTubeRadius * tubeSin);
+			glm::vec3 normal(tubeCos * ringCos, tubeCos * ringSin, tubeSin);
+			AddVertex(position, normal, glm::vec2((float)i / g_TorusRingSegments, (float)j / g_TorusTubeSegments));
+		}
+	}
+
+	for (int i = 0; i < g_TorusRingSegments; i++)
+	{
+		for (int j = 0; j < g_TorusTubeSegments; j++)
+		{
+			GLuint current = i * rowLength + j;
+			GLuint next = current + rowLength;
+			m_indices.push_back(current);
+			m_indices.push_back(next);
+			m_indices.push_back(next + 1);
+			m_indices.push_back(current);
+			m_indices.push_back(next + 1);
+			m_indices.push_back(current + 1);
+		}
+	}
+
+	EndMesh(SceneDescription::MESH_TORUS);
+
+	// the half torus is the first half of the torus indices,
+	// so its bounds stop at the X axis
+	MESH_RANGE& halfTorus = m_meshes[SceneDescription::MESH_HALF_TORUS];
+	halfTorus = m_meshes[SceneDescription::MESH_TORUS];
+	halfTorus.indexCount = m_meshes[SceneDescription::MESH_TORUS].indexCount / 2;
+	halfTorus.boundsMin.y = 0.0f;
+}
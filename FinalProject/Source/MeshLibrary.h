@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshlibrary.h
+// ============
+// build the basic shape meshes into one shared vertex and index buffer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneDescription.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MeshLibrary
+ *
+ *  This class generates the basic shapes - plane, box, cone,
+ *  cylinder, tapered cylinder, torus and half torus - with
+ *  the same dimensions as the ShapeMeshes utility, and keeps
+ *  them in a single vertex array with a shared vertex and
+ *  index buffer.  Each mesh is a range of that buffer, so any
+ *  mesh can be drawn instanced with per-instance data read
+ *  from an instance buffer, and the draws of many meshes can
+ *  be submitted at once from an indirect draw buffer.
+ ***********************************************************/
+class MeshLibrary
+{
+public:
+	// constructor
+	MeshLibrary();
+	// destructor
+	~MeshLibrary();
+
+	// per-instance values read by the vertex shader, the model
+	// matrix takes attribute locations 3 to 6, the color 7 and
+	// the texture layer 8
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 color;
+		// layer of the texture array, -1 for no texture
+		float textureLayer;
+	};
+
+	// location of one mesh in the shared buffers
+	struct MESH_RANGE
+	{
+		GLint baseVertex;
+		GLuint firstIndex;
+		GLsizei indexCount;
+		// local space bounding box of the mesh
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// one draw of an indirect draw buffer, laid out the way
+	// glMultiDrawElementsIndirect reads it
+	struct DRAW_COMMAND
+	{
+		GLuint indexCount;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// generate all the meshes and upload them
+	bool Create();
+	// free the vertex array and buffers
+	void Destroy();
+
+	// use the passed in buffer for the per-instance attributes
+	void SetInstanceBuffer(GLuint instanceBuffer);
+
+	// bind the shared vertex array before drawing
+	void Bind() const;
+	// draw instances [baseInstance, baseInstance + instanceCount)
+	// of the instance buffer with the passed in mesh
+	void DrawInstanced(int meshID, GLsizei instanceCount, GLuint baseInstance) const;
+
+	// check whether the draws of an indirect draw buffer can be
+	// submitted in one call
+	bool CanMultiDraw() const { return m_bMultiDrawIndirect; }
+	// fill in the draw of the same instances, for writing into
+	// an indirect draw buffer
+	void GetDrawCommand(int meshID, GLsizei instanceCount, GLuint baseInstance, DRAW_COMMAND& outCommand) const;
+	// draw a run of the draws of the bound indirect draw buffer,
+	// starting at a byte offset, in a single draw call
+	void MultiDrawIndirect(GLintptr offset, GLsizei drawCount) const;
+
+	// get the location and bounds of a mesh
+	const MESH_RANGE& GetMesh(int meshID) const { return m_meshes[meshID]; }
+
+private:
+	// one vertex of the shared vertex buffer
+	struct VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+	};
+
+	// vertex array and buffers
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	// location of every mesh, indexed by mesh ID
+	MESH_RANGE m_meshes[SceneDescription::MESH_COUNT];
+	// set when the context has glMultiDrawElementsIndirect
+	bool m_bMultiDrawIndirect;
+
+	// geometry while it is being generated
+	std::vector<VERTEX> m_vertices;
+	std::vector<GLuint> m_indices;
+	// mesh the generated vertices are added to
+	int m_currentMesh;
+
+	// start and finish the range of a generated mesh
+	void BeginMesh(int meshID);
+	void EndMesh(int meshID);
+	// add a vertex relative to the current mesh
+	GLuint AddVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& textureCoordinate);
+	// add a textured quad with corners counter-clockwise around
+	// the normal, as seen from the front
+	void AddQuad(const glm::vec3& center, const glm::vec3& uAxis, const glm::vec3& vAxis, const glm::vec3& normal);
+
+	// generate the shapes
+	void GeneratePlane();
+	void GenerateBox();
+	void GenerateFrustum(int meshID, float bottomRadius, float topRadius, bool bTopCap);
+	void GenerateTorus();
+};
@@ -0,0 +1,52 @@
+#include "NameRegistry.h"
+
+/***********************************************************
+ *  Intern()
+ *
+ *  This method is used for getting the handle associated
+ *  with the passed in name.  A name that was not registered
+ *  before gets the next free handle.
+ ***********************************************************/
+NameRegistry::HANDLE NameRegistry::Intern(const std::string& name)
+{
+	std::unordered_map<std::string, HANDLE>::const_iterator found = m_handles.find(name);
+	if (found != m_handles.end())
+	{
+		return(found->second);
+	}
+
+	HANDLE handle = (HANDLE)m_names.size();
+	m_names.push_back(name);
+	m_handles[name] = handle;
+
+	return(handle);
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used for getting the handle associated
+ *  with the passed in name, or INVALID_HANDLE when the name
+ *  was never registered.
+ ***********************************************************/
+NameRegistry::HANDLE NameRegistry::Find(const std::string& name) const
+{
+	std::unordered_map<std::string, HANDLE>::const_iterator found = m_handles.find(name);
+	if (found == m_handles.end())
+	{
+		return(INVALID_HANDLE);
+	}
+
+	return(found->second);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for forgetting all registered names.
+ ***********************************************************/
+void NameRegistry::Clear()
+{
+	m_names.clear();
+	m_handles.clear();
+}
@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// nameregistry.h
+// ============
+// intern tag strings into small integer handles
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  NameRegistry
+ *
+ *  This class hands out a small integer handle for every
+ *  distinct name it is given.  Handles are dense and given
+ *  out in registration order, so they can index arrays
+ *  directly.  Names are looked up through a hash table and
+ *  are only needed at load time.
+ ***********************************************************/
+class NameRegistry
+{
+public:
+	typedef uint32_t HANDLE;
+
+	// handle returned when a name is not registered
+	static const HANDLE INVALID_HANDLE = 0xFFFFFFFF;
+
+	// get the handle of a name, registering it if needed
+	HANDLE Intern(const std::string& name);
+	// get the handle of a registered name
+	HANDLE Find(const std::string& name) const;
+	// get the name registered with a handle
+	const std::string& GetName(HANDLE handle) const { return m_names[handle]; }
+	// get the number of registered names
+	int GetCount() const { return (int)m_names.size(); }
+	// forget all the registered names
+	void Clear();
+
+private:
+	// registered names, indexed by handle
+	std::vector<std::string> m_names;
+	// handles, keyed by name
+	std::unordered_map<std::string, HANDLE> m_handles;
+};
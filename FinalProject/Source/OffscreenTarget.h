@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////
+// offscreentarget.h
+// ============
+// render into a framebuffer object and read the frames back
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  OffscreenTarget
+ *
+ *  This class owns a framebuffer object with a color and a
+ *  depth renderbuffer, for rendering without a visible
+ *  window.  Rendered frames can be read back for saving
+ *  with ImageWriter or FrameCapture.
+ ***********************************************************/
+class OffscreenTarget
+{
+public:
+	// constructor
+	OffscreenTarget();
+	// destructor
+	~OffscreenTarget();
+
+	// create the framebuffer with the passed in size
+	bool Create(int width, int height);
+	// free the framebuffer
+	void Destroy();
+
+	// render into the framebuffer, covering all of it
+	void Bind();
+	// render into the default framebuffer again
+	void Unbind();
+
+	// read the last rendered frame as RGB rows from top to bottom
+	void ReadPixels(std::vector<unsigned char>& outPixels);
+
+	// get the size of the framebuffer
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	// get the framebuffer object to read frames back from
+	GLuint GetFramebuffer() const { return m_framebuffer; }
+
+private:
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	int m_width;
+	int m_height;
+};
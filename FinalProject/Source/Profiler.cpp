@@ -0,0 +1,498 @@
+#include "Profiler.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// most frames whose GPU zones are waited for, the zones of
+	// older frames the GPU has not finished are dropped
+	const size_t g_MaxFramesInFlight = 8;
+	// most zones recorded, about 32 MB of them, later ones are
+	// counted but not kept
+	const size_t g_MaxEvents = 1 << 20;
+	// thread ID the GPU zones are shown under in the trace
+	const int g_GpuTrackID = 1000;
+
+	// index of the calling thread in the trace, -1 until it
+	// records its first zone
+	thread_local int t_threadIndex = -1;
+}
+
+/***********************************************************
+ *  Instance()
+ *
+ *  This method is used for getting the profiler of the
+ *  application, which the zones anywhere in the code record
+ *  into.
+ ***********************************************************/
+Profiler& Profiler::Instance()
+{
+	static Profiler profiler;
+
+	return(profiler);
+}
+
+/***********************************************************
+ *  Profiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Profiler::Profiler()
+{
+	m_bRecording = false;
+	m_bGpuTimers = false;
+	m_startTime = std::chrono::steady_clock::now();
+	m_gpuTimeOffset = 0.0;
+	m_threadCount = 0;
+	m_currentFrame.usedQueries = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~Profiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+Profiler::~Profiler()
+{
+	// the OpenGL context is gone by the time the application
+	// exits, so the queries are left to it
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for clearing the recorded zones and
+ *  starting to record.  With bGpuTimers set, the current
+ *  OpenGL context times the GPU zones as well, and the GPU
+ *  clock is lined up with the CPU one.
+ ***********************************************************/
+bool Profiler::Start(bool bGpuTimers)
+{
+#ifndef ENABLE_PROFILER
+	(void)bGpuTimers;
+	std::cout << "The profiler zones were compiled out, build with ENABLE_PROFILER defined to record them" << std::endl;
+	return(false);
+#else
+	Stop();
+
+	{
+		std::lock_guard<std::mutex> lock(m_eventMutex);
+		m_events.clear();
+		m_events.reserve(4096);
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	m_startTime = std::chrono::steady_clock::now();
+	m_bGpuTimers = bGpuTimers;
+	if (bGpuTimers == true)
+	{
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		m_gpuTimeOffset = gpuTime / 1000.0 - GetTime();
+	}
+	m_bRecording = true;
+
+	return(true);
+#endif
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping recording.  The GPU
+ *  zones still in flight are waited for, oldest first, and
+ *  the queries are freed.
+ ***********************************************************/
+void Profiler::Stop()
+{
+	if (m_bRecording == false)
+	{
+		return;
+	}
+
+	if (m_bGpuTimers == true)
+	{
+		for (size_t i = 0; i < m_framesInFlight.size(); i++)
+		{
+			ResolveQueryFrame(m_framesInFlight[i], true);
+		}
+		ResolveQueryFrame(m_currentFrame, true);
+		DeleteQueries();
+	}
+	m_bRecording = false;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for ending the current frame.  The
+ *  GPU zones of the frames the GPU has finished are read
+ *  back, oldest first, and their queries reused.  When the
+ *  GPU falls too far behind, the zones of the oldest frame
+ *  are dropped rather than waited for.  GPU zones must not be
+ *  open when the frame ends.
+ ***********************************************************/
+void Profiler::EndFrame()
+{
+	if (m_bRecording == false)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_eventMutex);
+		m_stats.frames++;
+	}
+	if (m_bGpuTimers == false)
+	{
+		return;
+	}
+
+	m_framesInFlight.push_back(std::move(m_currentFrame));
+	while (m_framesInFlight.empty() == false)
+	{
+		QUERY_FRAME& oldest = m_framesInFlight.front();
+		bool bDone = IsQueryFrameDone(oldest);
+		if ((bDone == false) && (m_framesInFlight.size() <= g_MaxFramesInFlight))
+		{
+			break;
+		}
+		ResolveQueryFrame(oldest, bDone);
+		m_freeFrames.push_back(std::move(oldest));
+		m_framesInFlight.pop_front();
+	}
+
+	if (m_freeFrames.empty() == false)
+	{
+		m_currentFrame = std::move(m_freeFrames.back());
+		m_freeFrames.pop_back();
+	}
+	else
+	{
+		m_currentFrame = QUERY_FRAME();
+		m_currentFrame.usedQueries = 0;
+	}
+}
+
+/***********************************************************
+ *  WriteTrace()
+ *
+ *  This method is used for stopping recording and writing
+ *  the recorded zones as complete events of the Chrome trace
+ *  event format, with times in microseconds.  Each CPU
+ *  thread and the GPU get their own track.
+ ***********************************************************/
+bool Profiler::WriteTrace(const char* filename)
+{
+	Stop();
+
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not write profile trace " << filename << std::endl;
+		return(false);
+	}
+
+	std::lock_guard<std::mutex> lock(m_eventMutex);
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"" << ((i == 0) ? "Main thread" : "Worker thread") << " " << i << "\"}},\n";
+	}
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << g_GpuTrackID
+		<< ",\"args\":{\"name\":\"GPU\"}}";
+	for (size_t i = 0; i < m_events.size(); i++)
+	{
+		const TRACE_EVENT& event = m_events[i];
+		file << ",\n{\"name\":\"";
+		for (const char* c = event.name; *c != '\0'; c++)
+		{
+			if ((*c == '"') || (*c == '\\'))
+			{
+				file << '\\';
+			}
+			file << *c;
+		}
+		file << "\",\"cat\":\"" << ((event.track < 0) ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << event.startTime
+			<< ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":" << ((event.track < 0) ? g_GpuTrackID : event.track) << "}";
+	}
+	file << "\n]}\n";
+
+	if (!file)
+	{
+		std::cout << "Could not write profile trace " << filename << std::endl;
+		return(false);
+	}
+
+	std::cout << "Wrote " << m_events.size() << " profiled zones of " << m_stats.frames << " frames to " << filename;
+	if ((m_stats.droppedGpuZones > 0) || (m_stats.droppedZones > 0))
+	{
+		std::cout << ", dropped " << m_stats.droppedGpuZones << " GPU zones not done in time and "
+			<< m_stats.droppedZones << " over the zone limit";
+	}
+	std::cout << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the recording counters.
+ ***********************************************************/
+Profiler::PROFILER_STATS Profiler::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_eventMutex);
+
+	return(m_stats);
+}
+
+/***********************************************************
+ *  GetTime()
+ *
+ *  This method is used for getting the time since recording
+ *  started in microseconds.
+ ***********************************************************/
+double Profiler::GetTime() const
+{
+	return(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_startTime).count());
+}
+
+/***********************************************************
+ *  AddCpuEvent()
+ *
+ *  This method is used for recording a zone of the calling
+ *  thread, which is given a track the first time it records
+ *  one.
+ ***********************************************************/
+void Profiler::AddCpuEvent(const char* name, double startTime, double endTime)
+{
+	std::lock_guard<std::mutex> lock(m_eventMutex);
+
+	if (t_threadIndex < 0)
+	{
+		t_threadIndex = m_threadCount++;
+	}
+
+	m_stats.cpuZones++;
+	if (m_events.size() >= g_MaxEvents)
+	{
+		m_stats.droppedZones++;
+		return;
+	}
+
+	TRACE_EVENT event;
+	event.name = name;
+	event.startTime = startTime;
+	event.duration = endTime - startTime;
+	event.track = t_threadIndex;
+	m_events.push_back(event);
+}
+
+/***********************************************************
+ *  BeginGpuQuery()
+ *
+ *  This method is used for starting a GPU zone of the
+ *  current frame with a timestamp query, creating queries
+ *  when the frame has none left.  The index of the first of
+ *  the two queries of the zone is returned, or -1 when the
+ *  GPU is not timed.
+ ***********************************************************/
+int Profiler::BeginGpuQuery(const char* name)
+{
+	if ((m_bRecording == false) || (m_bGpuTimers == false))
+	{
+		return(-1);
+	}
+
+	QUERY_FRAME& frame = m_currentFrame;
+	if (frame.usedQueries + 2 > (int)frame.queries.size())
+	{
+		size_t firstNew = frame.queries.size();
+		frame.queries.resize(firstNew + 2);
+		glGenQueries(2, &frame.queries[firstNew]);
+	}
+
+	int query = frame.usedQueries;
+	frame.usedQueries += 2;
+	glQueryCounter(frame.queries[query], GL_TIMESTAMP);
+
+	GPU_ZONE zone;
+	zone.name = name;
+	zone.firstQuery = query;
+	frame.zones.push_back(zone);
+
+	return(query);
+}
+
+/***********************************************************
+ *  EndGpuQuery()
+ *
+ *  This method is used for finishing a GPU zone with its
+ *  second timestamp query.
+ ***********************************************************/
+void Profiler::EndGpuQuery(int query)
+{
+	if ((query < 0) || (m_bRecording == false) || (m_bGpuTimers == false))
+	{
+		return;
+	}
+
+	glQueryCounter(m_currentFrame.queries[query + 1], GL_TIMESTAMP);
+}
+
+/***********************************************************
+ *  IsQueryFrameDone()
+ *
+ *  This method is used for checking whether the GPU has
+ *  passed every query of a frame.  The queries finish in
+ *  order, so when the last one is done they all are.
+ ***********************************************************/
+bool Profiler::IsQueryFrameDone(const QUERY_FRAME& frame) const
+{
+	if (frame.usedQueries == 0)
+	{
+		return(true);
+	}
+
+	GLint bAvailable = GL_FALSE;
+	glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+
+	return(bAvailable != GL_FALSE);
+}
+
+/***********************************************************
+ *  ResolveQueryFrame()
+ *
+ *  This method is used for reading back the timestamps of
+ *  the GPU zones of a frame and recording them on the GPU
+ *  track, which waits for any the GPU has not passed, or
+ *  when bRead is not set, counting them as dropped.  The
+ *  frame is left empty for reuse.
+ ***********************************************************/
+void Profiler::ResolveQueryFrame(QUERY_FRAME& frame, bool bRead)
+{
+	std::lock_guard<std::mutex> lock(m_eventMutex);
+	if (bRead == false)
+	{
+		m_stats.droppedGpuZones += (unsigned int)frame.zones.size();
+	}
+	else
+	{
+		for (size_t i = 0; i < frame.zones.size(); i++)
+		{
+			GLuint64 startTime = 0;
+			GLuint64 endTime = 0;
+			glGetQueryObjectui64v(frame.queries[frame.zones[i].firstQuery], GL_QUERY_RESULT, &startTime);
+			glGetQueryObjectui64v(frame.queries[frame.zones[i].firstQuery + 1], GL_QUERY_RESULT, &endTime);
+
+			m_stats.gpuZones++;
+			if (m_events.size() >= g_MaxEvents)
+			{
+				m_stats.droppedZones++;
+				continue;
+			}
+
+			TRACE_EVENT event;
+			event.name = frame.zones[i].name;
+			event.startTime = startTime / 1000.0 - m_gpuTimeOffset;
+			event.duration = (endTime - startTime) / 1000.0;
+			event.track = -1;
+			m_events.push_back(event);
+		}
+	}
+
+	frame.zones.clear();
+	frame.usedQueries = 0;
+}
+
+/***********************************************************
+ *  DeleteQueries()
+ *
+ *  This method is used for freeing the timestamp queries of
+ *  every frame.
+ ***********************************************************/
+void Profiler::DeleteQueries()
+{
+	m_framesInFlight.push_back(std::move(m_currentFrame));
+	for (size_t i = 0; i < m_freeFrames.size(); i++)
+	{
+		m_framesInFlight.push_back(std::move(m_freeFrames[i]));
+	}
+	for (size_t i = 0; i < m_framesInFlight.size(); i++)
+	{
+		QUERY_FRAME& frame = m_framesInFlight[i];
+		if (frame.queries.empty() == false)
+		{
+			glDeleteQueries((GLsizei)frame.queries.size(), &frame.queries[0]);
+		}
+	}
+	m_framesInFlight.clear();
+	m_freeFrames.clear();
+	m_currentFrame = QUERY_FRAME();
+	m_currentFrame.usedQueries = 0;
+}
+
+/***********************************************************
+ *  CpuZone()
+ *
+ *  The constructor for the class, which starts timing the
+ *  zone while the profiler is recording.
+ ***********************************************************/
+Profiler::CpuZone::CpuZone(const char* name)
+{
+	m_name = NULL;
+	m_startTime = 0.0;
+
+	Profiler& profiler = Profiler::Instance();
+	if (profiler.m_bRecording == true)
+	{
+		m_name = name;
+		m_startTime = profiler.GetTime();
+	}
+}
+
+/***********************************************************
+ *  ~CpuZone()
+ *
+ *  The destructor for the class, which records the zone.
+ ***********************************************************/
+Profiler::CpuZone::~CpuZone()
+{
+	Profiler& profiler = Profiler::Instance();
+	if ((m_name != NULL) && (profiler.m_bRecording == true))
+	{
+		profiler.AddCpuEvent(m_name, m_startTime, profiler.GetTime());
+	}
+}
+
+/***********************************************************
+ *  GpuZone()
+ *
+ *  The constructor for the class, which starts timing the
+ *  zone on the CPU and the GPU.
+ ***********************************************************/
+Profiler::GpuZone::GpuZone(const char* name)
+	: m_cpuZone(name)
+{
+	m_query = Profiler::Instance().BeginGpuQuery(name);
+}
+
+/***********************************************************
+ *  ~GpuZone()
+ *
+ *  The destructor for the class, which ends the GPU timing
+ *  of the zone before the CPU zone records it.
+ ***********************************************************/
+Profiler::GpuZone::~GpuZone()
+{
+	Profiler::Instance().EndGpuQuery(m_query);
+}
@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// profiler.h
+// ============
+// time named zones of the frame on the CPU and GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/***********************************************************
+ *  Profiler
+ *
+ *  This class records how long named zones of the frame take
+ *  while it is recording.  A zone is timed on the CPU from
+ *  where it is declared to the end of its scope, and GPU
+ *  zones are also timed on the GPU with a pair of timestamp
+ *  queries.  The queries of a frame are only read back once
+ *  the GPU has passed them, a frame or more later, so reading
+ *  them never waits.  The recorded zones are written as
+ *  Chrome trace event JSON, which chrome://tracing and
+ *  Perfetto show on a timeline.
+ *
+ *  The zones are declared with the PROFILE_ZONE and
+ *  PROFILE_GPU_ZONE macros, which compile to nothing unless
+ *  ENABLE_PROFILER is defined.  Zone names must be string
+ *  literals, they are kept until the trace is written.
+ ***********************************************************/
+class Profiler
+{
+public:
+	// get the profiler of the application
+	static Profiler& Instance();
+
+	// recording counters
+	struct PROFILER_STATS
+	{
+		unsigned int frames;
+		unsigned int cpuZones;
+		unsigned int gpuZones;
+		// GPU zones whose queries were not done when read, and
+		// zones not recorded once the event limit was reached
+		unsigned int droppedGpuZones;
+		unsigned int droppedZones;
+	};
+
+	// start recording, timing GPU zones as well when asked to
+	bool Start(bool bGpuTimers);
+	// stop recording, reading back the GPU zones still in flight
+	void Stop();
+	bool IsRecording() const { return m_bRecording; }
+	// end the current frame and read back the GPU zones of the
+	// frames the GPU has finished
+	void EndFrame();
+	// write the recorded zones as Chrome trace event JSON
+	bool WriteTrace(const char* filename);
+	// get the recording counters
+	PROFILER_STATS GetStats();
+
+	// time a zone on the CPU
+	class CpuZone
+	{
+	public:
+		explicit CpuZone(const char* name);
+		~CpuZone();
+
+	private:
+		const char* m_name;
+		double m_startTime;
+	};
+
+	// time a zone on the CPU and the GPU
+	class GpuZone
+	{
+	public:
+		explicit GpuZone(const char* name);
+		~GpuZone();
+
+	private:
+		CpuZone m_cpuZone;
+		int m_query;
+	};
+
+private:
+	// constructor
+	Profiler();
+	// destructor
+	~Profiler();
+
+	// one recorded zone
+	struct TRACE_EVENT
+	{
+		const char* name;
+		double startTime;
+		double duration;
+		// index of the CPU thread, or -1 for the GPU
+		int track;
+	};
+
+	// GPU zone of a frame in flight and its timestamp queries
+	struct GPU_ZONE
+	{
+		const char* name;
+		int firstQuery;
+	};
+
+	// timestamp queries and GPU zones of one frame in flight
+	struct QUERY_FRAME
+	{
+		std::vector<GLuint> queries;
+		int usedQueries;
+		std::vector<GPU_ZONE> zones;
+	};
+
+	// get the time since recording started in microseconds
+	double GetTime() const;
+	// record a zone of the calling thread
+	void AddCpuEvent(const char* name, double startTime, double endTime);
+	// start a GPU zone, returning the first of its queries
+	int BeginGpuQuery(const char* name);
+	// finish a GPU zone started with BeginGpuQuery
+	void EndGpuQuery(int query);
+	// check whether the GPU has passed every query of a frame
+	bool IsQueryFrameDone(const QUERY_FRAME& frame) const;
+	// record the GPU zones of a frame, waiting for their queries,
+	// or count them as dropped, and empty the frame for reuse
+	void ResolveQueryFrame(QUERY_FRAME& frame, bool bRead);
+	// free the timestamp queries
+	void DeleteQueries();
+
+	// read by the zones of every thread
+	std::atomic<bool> m_bRecording;
+	bool m_bGpuTimers;
+	std::chrono::steady_clock::time_point m_startTime;
+	// GPU timestamp at the start of recording, in microseconds
+	// on the CPU timeline
+	double m_gpuTimeOffset;
+	std::mutex m_eventMutex;
+	std::vector<TRACE_EVENT> m_events;
+	int m_threadCount;
+	// queries of the current frame, of the ended frames the GPU
+	// may still be working on, oldest first, and of frames read
+	// back that can be reused
+	QUERY_FRAME m_currentFrame;
+	std::deque<QUERY_FRAME> m_framesInFlight;
+	std::vector<QUERY_FRAME> m_freeFrames;
+	PROFILER_STATS m_stats;
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILER_JOIN_NAME(name, line) name##line
+#define PROFILER_ZONE_NAME(name, line) PROFILER_JOIN_NAME(name, line)
+// time the rest of the enclosing scope on the CPU
+#define PROFILE_ZONE(name) Profiler::CpuZone PROFILER_ZONE_NAME(profileZone, __LINE__)(name)
+// time the rest of the enclosing scope on the CPU and the GPU
+#define PROFILE_GPU_ZONE(name) Profiler::GpuZone PROFILER_ZONE_NAME(profileZone, __LINE__)(name)
+// end the profiled frame
+#define PROFILE_END_FRAME() Profiler::Instance().EndFrame()
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_GPU_ZONE(name)
+#define PROFILE_END_FRAME()
+#endif
@@ -0,0 +1,226 @@
+#include "RenderQueue.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// opaque key layout, from the most significant bit down:
+	// pass 2 | shader 4 | texture 10 | material 10 | mesh 6 | depth 32
+	const int g_OpaqueShaderShift = 58;
+	const int g_OpaqueTextureShift = 48;
+	const int g_OpaqueMaterialShift = 38;
+	const int g_OpaqueMeshShift = 32;
+
+	// transparent key layout, ordered by depth first:
+	// pass 2 | inverted depth 32 | shader 4 | texture 10 | material 10 | mesh 6
+	const int g_TransparentDepthShift = 30;
+	const int g_TransparentShaderShift = 26;
+	const int g_TransparentTextureShift = 16;
+	const int g_TransparentMaterialShift = 6;
+	const int g_TransparentMeshShift = 0;
+
+	const int g_PassShift = 62;
+
+	/***********************************************************
+	 *  PackField()
+	 *
+	 *  This function is used for fitting a value that is not
+	 *  negative into a key field of the passed in width.
+	 ***********************************************************/
+	uint64_t PackField(int value, int bits)
+	{
+		uint64_t mask = (1ull << bits) - 1;
+		if (value < 0)
+		{
+			return(0);
+		}
+		return(((uint64_t)value > mask) ? mask : (uint64_t)value);
+	}
+
+	/***********************************************************
+	 *  PackDepth()
+	 *
+	 *  This function is used for turning a depth into 32 bits
+	 *  that sort in the same order.  The bits of a float that
+	 *  is not negative already compare like the float does.
+	 ***********************************************************/
+	uint64_t PackDepth(float depth)
+	{
+		// also catches NaN
+		if (!(depth > 0.0f))
+		{
+			depth = 0.0f;
+		}
+
+		uint32_t bits = 0;
+		memcpy(&bits, &depth, sizeof(bits));
+		return((uint64_t)bits);
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+	m_lastSortPasses = 0;
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for building the sort key of a draw.
+ *  Opaque draws are grouped by state and drawn front to back
+ *  within the same state.  Transparent draws are drawn back
+ *  to front, with state only breaking ties.
+ ***********************************************************/
+uint64_t RenderQueue::MakeKey(
+	PASS pass,
+	int shaderIndex,
+	int textureIndex,
+	int materialIndex,
+	int meshID,
+	float depth)
+{
+	uint64_t key = (uint64_t)pass << g_PassShift;
+
+	// the texture and material index are stored one higher,
+	// so draws without a texture or material come first
+	if (pass == PASS_TRANSPARENT)
+	{
+		key |= (0xFFFFFFFFull - PackDepth(depth)) << g_TransparentDepthShift;
+		key |= PackField(shaderIndex, 4) << g_TransparentShaderShift;
+		key |= PackField(textureIndex + 1, 10) << g_TransparentTextureShift;
+		key |= PackField(materialIndex + 1, 10) << g_TransparentMaterialShift;
+		key |= PackField(meshID, 6) << g_TransparentMeshShift;
+	}
+	else
+	{
+		key |= PackField(shaderIndex, 4) << g_OpaqueShaderShift;
+		key |= PackField(textureIndex + 1, 10) << g_OpaqueTextureShift;
+		key |= PackField(materialIndex + 1, 10) << g_OpaqueMaterialShift;
+		key |= PackField(meshID, 6) << g_OpaqueMeshShift;
+		key |= PackDepth(depth);
+	}
+
+	return(key);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the queued draws,
+ *  keeping the memory for the next frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_keys.clear();
+	m_values.clear();
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for making room for a number of
+ *  draws in the queue and in the scratch buffers of the
+ *  sort, which trade places with the queue as it sorts.
+ ***********************************************************/
+void RenderQueue::Reserve(int count)
+{
+	m_keys.reserve(count);
+	m_values.reserve(count);
+	m_sortKeys.reserve(count);
+	m_sortValues.reserve(count);
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for queueing a draw with its sort key.
+ ***********************************************************/
+void RenderQueue::Submit(uint64_t key, uint32_t value)
+{
+	m_keys.push_back(key);
+	m_values.push_back(value);
+}
+
+/***********************************************************
+ *  Append()
+ *
+ *  This method is used for queueing all the draws of another
+ *  queue after the draws already queued, such as the draws
+ *  recorded into separate queues by several threads.
+ ***********************************************************/
+void RenderQueue::Append(const RenderQueue& other)
+{
+	m_keys.insert(m_keys.end(), other.m_keys.begin(), other.m_keys.end());
+	m_values.insert(m_values.end(), other.m_values.begin(), other.m_values.end());
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the queued draws by key
+ *  with a least significant byte first radix sort.  The
+ *  counts of all eight bytes are taken in one pass over the
+ *  keys, and bytes that are the same in every key are not
+ *  sorted on.  The sort is stable.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	const size_t count = m_keys.size();
+	m_lastSortPasses = 0;
+	if (count < 2)
+	{
+		return;
+	}
+
+	size_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = m_keys[i];
+		for (int byte = 0; byte < 8; byte++)
+		{
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	m_sortKeys.resize(count);
+	m_sortValues.resize(count);
+
+	for (int byte = 0; byte < 8; byte++)
+	{
+		size_t* histogram = histograms[byte];
+		int shift = byte * 8;
+
+		// every key has the same value in this byte
+		if (histogram[(m_keys[0] >> shift) & 0xFF] == count)
+		{
+			continue;
+		}
+
+		// turn the counts into the first output index of each value
+		size_t offset = 0;
+		for (int value = 0; value < 256; value++)
+		{
+			size_t valueCount = histogram[value];
+			histogram[value] = offset;
+			offset += valueCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t target = histogram[(m_keys[i] >> shift) & 0xFF]++;
+			m_sortKeys[target] = m_keys[i];
+			m_sortValues[target] = m_values[i];
+		}
+
+		m_keys.swap(m_sortKeys);
+		m_values.swap(m_sortValues);
+		m_lastSortPasses++;
+	}
+}
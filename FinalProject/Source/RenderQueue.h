@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// order draws by 64-bit state sort keys
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects the draws of a frame as 64-bit sort
+ *  keys, each with a value identifying the draw, and radix
+ *  sorts them.  Opaque keys order by shader, texture,
+ *  material and mesh, then front to back, so draws sharing
+ *  state end up next to each other.  Transparent keys come
+ *  after all opaque keys and order back to front.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+
+	// passes, in drawing order
+	enum PASS
+	{
+		PASS_OPAQUE = 0,
+		PASS_TRANSPARENT,
+		PASS_COUNT
+	};
+
+	// build the sort key of a draw - the indices may be
+	// -1 for none, and depth is the distance in front of the
+	// camera
+	static uint64_t MakeKey(
+		PASS pass,
+		int shaderIndex,
+		int textureIndex,
+		int materialIndex,
+		int meshID,
+		float depth);
+	// get the pass a sort key belongs to
+	static PASS GetPass(uint64_t key) { return (PASS)(key >> 62); }
+
+	// remove all the queued draws
+	void Clear();
+	// make room for a number of draws, so queueing and sorting
+	// up to that many allocates nothing
+	void Reserve(int count);
+	// queue a draw
+	void Submit(uint64_t key, uint32_t value);
+	// queue the draws of another queue after these
+	void Append(const RenderQueue& other);
+	// sort the queued draws by key
+	void Sort();
+
+	// get the queued draws, in sorted order after Sort()
+	int GetCount() const { return (int)m_keys.size(); }
+	uint64_t GetKey(int index) const { return m_keys[index]; }
+	uint32_t GetValue(int index) const { return m_values[index]; }
+
+	// number of byte passes the last sort needed, out of 8
+	int GetLastSortPasses() const { return m_lastSortPasses; }
+
+private:
+	// queued sort keys and their values
+	std::vector<uint64_t> m_keys;
+	std::vector<uint32_t> m_values;
+	// scratch buffers for the radix sort
+	std::vector<uint64_t> m_sortKeys;
+	std::vector<uint32_t> m_sortValues;
+	int m_lastSortPasses;
+};
@@ -0,0 +1,596 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// nodes with this many objects or fewer stay leaves
+	const int g_MaxLeafItems = 8;
+	// number of bins the centroids are sorted into when
+	// looking for the best split
+	const int g_SplitBins = 12;
+	// cost of visiting a node relative to testing one object
+	const float g_TraversalCost = 1.0f;
+	// refitting is given up for a rebuild once it makes the
+	// tree this much more expensive than when it was built
+	const float g_RebuildCostRatio = 1.5f;
+	// nodes this deep stay leaves, so the query stacks
+	// always have room
+	const int g_MaxTreeDepth = 48;
+	const int g_MaxStackDepth = g_MaxTreeDepth + 2;
+
+	/***********************************************************
+	 *  SurfaceArea()
+	 *
+	 *  Get the surface area of a box, used as the chance that
+	 *  a query reaches it.
+	 ***********************************************************/
+	float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+		return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+	}
+
+	// set bits for all six frustum planes
+	const int g_AllPlanes = 0x3F;
+
+	/***********************************************************
+	 *  ClassifyBox()
+	 *
+	 *  Test a box against the frustum planes whose bits are set
+	 *  in planeMask.  Returns false when the box is outside,
+	 *  otherwise clears the bits of the planes the box is fully
+	 *  inside of, so a box with no bits left is fully inside
+	 *  the frustum.
+	 ***********************************************************/
+	bool ClassifyBox(
+		const CullingKernels::FRUSTUM& frustum,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		int& planeMask)
+	{
+		for (int p = 0; p < 6; p++)
+		{
+			if ((planeMask & (1 << p)) == 0)
+			{
+				continue;
+			}
+			const float* plane = frustum.planes[p];
+
+			// the corners furthest along and against the plane normal
+			float farDistance = plane[3];
+			float nearDistance = plane[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float low = plane[axis] * boundsMin[axis];
+				float high = plane[axis] * boundsMax[axis];
+				farDistance += std::max(low, high);
+				nearDistance += std::min(low, high);
+			}
+
+			if (farDistance < 0.0f)
+			{
+				return(false);
+			}
+			if (nearDistance >= 0.0f)
+			{
+				planeMask &= ~(1 << p);
+			}
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  IntersectBox()
+	 *
+	 *  Get the distance at which a ray enters a box, or a
+	 *  negative value when it misses the box within the
+	 *  maximum distance.
+	 ***********************************************************/
+	float IntersectBox(
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax)
+	{
+		float enter = 0.0f;
+		float leave = maxDistance;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			enter = std::max(enter, t0);
+			leave = std::min(leave, t1);
+		}
+
+		return((enter <= leave) ? enter : -1.0f);
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+	m_builtCost = 0.0f;
+	m_currentCost = 0.0f;
+	m_buildCount = 0;
+	m_refitCount = 0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree from scratch.
+ *  Nodes are split top down where the surface area heuristic
+ *  finds a split cheaper than keeping the node a leaf.
+ ***********************************************************/
+void SceneBVH::Build(const glm::vec3* boundsMin, const glm::vec3* boundsMax, int count)
+{
+	m_nodes.clear();
+	m_items.resize(count);
+	m_itemMin.resize(count);
+	m_itemMax.resize(count);
+
+	// the centroids are kept in item order along with the
+	// item bounds, so splitting reads them front to back
+	std::vector<glm::vec3> centroids(count);
+	for (int i = 0; i < count; i++)
+	{
+		m_items[i] = i;
+		centroids[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+		m_itemMin[i] = boundsMin[i];
+		m_itemMax[i] = boundsMax[i];
+	}
+
+	// at most one node per object for the leaves and as many
+	// for the parents
+	m_nodes.reserve((size_t)std::max(1, count * 2));
+
+	NODE root;
+	root.firstItem = 0;
+	root.itemCount = count;
+	root.leftChild = -1;
+	FitNode(root);
+	m_nodes.push_back(root);
+
+	// parents are split before their children are appended,
+	// so walking the node list in order splits every node
+	std::vector<int> depths(1, 0);
+	for (size_t nodeIndex = 0; nodeIndex < m_nodes.size(); nodeIndex++)
+	{
+		if ((depths[nodeIndex] < g_MaxTreeDepth) && (SplitNode((int)nodeIndex, centroids) == true))
+		{
+			depths.push_back(depths[nodeIndex] + 1);
+			depths.push_back(depths[nodeIndex] + 1);
+		}
+	}
+
+	m_builtCost = ComputeCost();
+	m_currentCost = m_builtCost;
+	m_buildCount++;
+}
+
+/***********************************************************
+ *  SplitNode()
+ *
+ *  This method is used for splitting a node along the axis
+ *  where its object centroids spread the most.  The centroids
+ *  are counted into bins, and the bin boundary with the
+ *  lowest surface area heuristic cost is used, but only when
+ *  it is cheaper than testing all the objects of the node.
+ ***********************************************************/
+bool SceneBVH::SplitNode(int nodeIndex, std::vector<glm::vec3>& centroids)
+{
+	NODE node = m_nodes[nodeIndex];
+	if (node.itemCount <= g_MaxLeafItems)
+	{
+		return(false);
+	}
+
+	int first = node.firstItem;
+	int last = node.firstItem + node.itemCount;
+
+	glm::vec3 centroidMin = centroids[first];
+	glm::vec3 centroidMax = centroidMin;
+	for (int i = first + 1; i < last; i++)
+	{
+		centroidMin = glm::min(centroidMin, centroids[i]);
+		centroidMax = glm::max(centroidMax, centroids[i]);
+	}
+
+	glm::vec3 extent = centroidMax - centroidMin;
+	int axis = 0;
+	if (extent.y > extent[axis])
+		axis = 1;
+	if (extent.z > extent[axis])
+		axis = 2;
+	if (extent[axis] <= 0.0f)
+	{
+		// all the centroids are in one spot, nothing to split
+		return(false);
+	}
+
+	// count the objects and grow the bounds of every bin
+	struct BIN
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		int count;
+	};
+	BIN bins[g_SplitBins];
+	for (int b = 0; b < g_SplitBins; b++)
+	{
+		bins[b].boundsMin = glm::vec3(FLT_MAX);
+		bins[b].boundsMax = glm::vec3(-FLT_MAX);
+		bins[b].count = 0;
+	}
+
+	float binScale = g_SplitBins / extent[axis];
+	for (int i = first; i < last; i++)
+	{
+		int b = std::min(g_SplitBins - 1, (int)((centroids[i][axis] - centroidMin[axis]) * binScale));
+		bins[b].boundsMin = glm::min(bins[b].boundsMin, m_itemMin[i]);
+		bins[b].boundsMax = glm::max(bins[b].boundsMax, m_itemMax[i]);
+		bins[b].count++;
+	}
+
+	// sweep from both sides to cost every split between bins
+	float leftArea[g_SplitBins - 1];
+	int leftCount[g_SplitBins - 1];
+	glm::vec3 sweepMin(FLT_MAX);
+	glm::vec3 sweepMax(-FLT_MAX);
+	int sweepCount = 0;
+	for (int b = 0; b < g_SplitBins - 1; b++)
+	{
+		sweepMin = glm::min(sweepMin, bins[b].boundsMin);
+		sweepMax = glm::max(sweepMax, bins[b].boundsMax);
+		sweepCount += bins[b].count;
+		leftArea[b] = (sweepCount > 0) ? SurfaceArea(sweepMin, sweepMax) : 0.0f;
+		leftCount[b] = sweepCount;
+	}
+
+	float bestCost = FLT_MAX;
+	int bestSplit = -1;
+	sweepMin = glm::vec3(FLT_MAX);
+	sweepMax = glm::vec3(-FLT_MAX);
+	sweepCount = 0;
+	for (int b = g_SplitBins - 1; b > 0; b--)
+	{
+		sweepMin = glm::min(sweepMin, bins[b].boundsMin);
+		sweepMax = glm::max(sweepMax, bins[b].boundsMax);
+		sweepCount += bins[b].count;
+		if ((sweepCount == 0) || (leftCount[b - 1] == 0))
+		{
+			continue;
+		}
+
+		float cost = leftArea[b - 1] * leftCount[b - 1] + SurfaceArea(sweepMin, sweepMax) * sweepCount;
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			bestSplit = b;
+		}
+	}
+
+	float parentArea = SurfaceArea(node.boundsMin, node.boundsMax);
+	float leafCost = parentArea * node.itemCount;
+	if ((bestSplit < 0) || (g_TraversalCost * parentArea + bestCost >= leafCost))
+	{
+		return(false);
+	}
+
+	// move the items in the bins left of the split to the front
+	int middle = first;
+	for (int i = first; i < last; i++)
+	{
+		int b = std::min(g_SplitBins - 1, (int)((centroids[i][axis] - centroidMin[axis]) * binScale));
+		if (b < bestSplit)
+		{
+			std::swap(m_items[i], m_items[middle]);
+			std::swap(centroids[i], centroids[middle]);
+			std::swap(m_itemMin[i], m_itemMin[middle]);
+			std::swap(m_itemMax[i], m_itemMax[middle]);
+			middle++;
+		}
+	}
+	if ((middle == first) || (middle == last))
+	{
+		return(false);
+	}
+
+	NODE left;
+	left.firstItem = first;
+	left.itemCount = middle - first;
+	left.leftChild = -1;
+	NODE right;
+	right.firstItem = middle;
+	right.itemCount = last - middle;
+	right.leftChild = -1;
+
+	FitNode(left);
+	FitNode(right);
+
+	m_nodes[nodeIndex].leftChild = (int)m_nodes.size();
+	m_nodes.push_back(left);
+	m_nodes.push_back(right);
+
+	return(true);
+}
+
+/***********************************************************
+ *  FitNode()
+ *
+ *  This method is used for fitting the bounds of a node.
+ *  Leaves are fit around their items and parents around
+ *  their two children.
+ ***********************************************************/
+void SceneBVH::FitNode(NODE& node) const
+{
+	if (node.leftChild >= 0)
+	{
+		const NODE& left = m_nodes[node.leftChild];
+		const NODE& right = m_nodes[node.leftChild + 1];
+		node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+		node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+		return;
+	}
+
+	node.boundsMin = glm::vec3(FLT_MAX);
+	node.boundsMax = glm::vec3(-FLT_MAX);
+	for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+	{
+		node.boundsMin = glm::min(node.boundsMin, m_itemMin[i]);
+		node.boundsMax = glm::max(node.boundsMax, m_itemMax[i]);
+	}
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for moving the tree along with the
+ *  objects.  Every box is refit bottom up around the new
+ *  bounds, keeping the tree structure.  When that leaves the
+ *  tree much more expensive to query than when it was built,
+ *  it is rebuilt.
+ ***********************************************************/
+bool SceneBVH::Refit(const glm::vec3* boundsMin, const glm::vec3* boundsMax)
+{
+	for (size_t i = 0; i < m_items.size(); i++)
+	{
+		m_itemMin[i] = boundsMin[m_items[i]];
+		m_itemMax[i] = boundsMax[m_items[i]];
+	}
+
+	// children always come after their parents
+	for (int nodeIndex = (int)m_nodes.size() - 1; nodeIndex >= 0; nodeIndex--)
+	{
+		FitNode(m_nodes[nodeIndex]);
+	}
+
+	m_currentCost = ComputeCost();
+	m_refitCount++;
+
+	if (m_currentCost > m_builtCost * g_RebuildCostRatio)
+	{
+		Build(boundsMin, boundsMax, (int)m_items.size());
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  ComputeCost()
+ *
+ *  This method is used for getting the surface area
+ *  heuristic cost of the tree - the expected work of a query
+ *  relative to the area of the whole scene.
+ ***********************************************************/
+float SceneBVH::ComputeCost() const
+{
+	if (m_nodes.empty())
+	{
+		return(0.0f);
+	}
+
+	float rootArea = SurfaceArea(m_nodes[0].boundsMin, m_nodes[0].boundsMax);
+	if (rootArea <= 0.0f)
+	{
+		return(0.0f);
+	}
+
+	float cost = 0.0f;
+	for (size_t i = 0; i < m_nodes.size(); i++)
+	{
+		const NODE& node = m_nodes[i];
+		float area = SurfaceArea(node.boundsMin, node.boundsMax);
+		cost += (node.leftChild >= 0) ? (area * g_TraversalCost) : (area * node.itemCount);
+	}
+
+	return(cost / rootArea);
+}
+
+/***********************************************************
+ *  GetCostRatio()
+ *
+ *  This method is used for getting how much more expensive
+ *  the tree has become through refitting.
+ ***********************************************************/
+float SceneBVH::GetCostRatio() const
+{
+	return((m_builtCost > 0.0f) ? (m_currentCost / m_builtCost) : 1.0f);
+}
+
+/***********************************************************
+ *  GetBounds()
+ *
+ *  This method is used for getting the box around all the
+ *  objects, which is the box of the root node.
+ ***********************************************************/
+bool SceneBVH::GetBounds(glm::vec3& outMin, glm::vec3& outMax) const
+{
+	if (m_nodes.empty())
+	{
+		return(false);
+	}
+
+	outMin = m_nodes[0].boundsMin;
+	outMax = m_nodes[0].boundsMax;
+
+	return(true);
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for finding the objects inside the
+ *  view frustum.  Subtrees outside of the frustum are
+ *  skipped, and all the objects of a subtree fully inside it
+ *  are visible without testing them.
+ ***********************************************************/
+int SceneBVH::QueryFrustum(const CullingKernels::FRUSTUM& frustum, unsigned char* outVisible) const
+{
+	if (m_items.empty())
+	{
+		return(0);
+	}
+	memset(outVisible, 0, m_items.size());
+
+	// every node is pushed with the planes its parent was not
+	// fully inside of, which are the only ones it can cross
+	int visibleCount = 0;
+	int stack[g_MaxStackDepth];
+	int stackMasks[g_MaxStackDepth];
+	int stackSize = 0;
+	stack[stackSize] = 0;
+	stackMasks[stackSize++] = g_AllPlanes;
+
+	while (stackSize > 0)
+	{
+		stackSize--;
+		const NODE& node = m_nodes[stack[stackSize]];
+		int planeMask = stackMasks[stackSize];
+
+		if (ClassifyBox(frustum, node.boundsMin, node.boundsMax, planeMask) == false)
+		{
+			continue;
+		}
+
+		if ((planeMask == 0) || (node.leftChild < 0))
+		{
+			for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+			{
+				int itemMask = planeMask;
+				if ((planeMask == 0) || (ClassifyBox(frustum, m_itemMin[i], m_itemMax[i], itemMask) == true))
+				{
+					outVisible[m_items[i]] = 1;
+					visibleCount++;
+				}
+			}
+			continue;
+		}
+
+		stack[stackSize] = node.leftChild + 1;
+		stackMasks[stackSize++] = planeMask;
+		stack[stackSize] = node.leftChild;
+		stackMasks[stackSize++] = planeMask;
+	}
+
+	return(visibleCount);
+}
+
+/***********************************************************
+ *  Raycast()
+ *
+ *  This method is used for finding the nearest object whose
+ *  bounds a ray hits.  The nearer child of every node is
+ *  visited first, and nodes further than the nearest hit so
+ *  far are skipped.
+ ***********************************************************/
+int SceneBVH::Raycast(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& outDistance) const
+{
+	outDistance = maxDistance;
+	if (m_items.empty())
+	{
+		return(-1);
+	}
+
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		inverseDirection[axis] = (direction[axis] != 0.0f) ? (1.0f / direction[axis]) : FLT_MAX;
+	}
+
+	int nearestObject = -1;
+	int stack[g_MaxStackDepth];
+	int stackSize = 0;
+	if (IntersectBox(origin, inverseDirection, outDistance, m_nodes[0].boundsMin, m_nodes[0].boundsMax) >= 0.0f)
+	{
+		stack[stackSize++] = 0;
+	}
+
+	while (stackSize > 0)
+	{
+		const NODE& node = m_nodes[stack[--stackSize]];
+		if (IntersectBox(origin, inverseDirection, outDistance, node.boundsMin, node.boundsMax) < 0.0f)
+		{
+			continue;
+		}
+
+		if (node.leftChild < 0)
+		{
+			for (int i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+			{
+				float distance = IntersectBox(origin, inverseDirection, outDistance, m_itemMin[i], m_itemMax[i]);
+				if (distance >= 0.0f)
+				{
+					outDistance = distance;
+					nearestObject = m_items[i];
+				}
+			}
+			continue;
+		}
+
+		float leftDistance = IntersectBox(origin, inverseDirection, outDistance,
+			m_nodes[node.leftChild].boundsMin, m_nodes[node.leftChild].boundsMax);
+		float rightDistance = IntersectBox(origin, inverseDirection, outDistance,
+			m_nodes[node.leftChild + 1].boundsMin, m_nodes[node.leftChild + 1].boundsMax);
+
+		// push the further child first so the nearer one is next
+		int nearChild = node.leftChild;
+		int farChild = node.leftChild + 1;
+		float nearDistance = leftDistance;
+		float farDistance = rightDistance;
+		if ((rightDistance >= 0.0f) && ((leftDistance < 0.0f) || (rightDistance < leftDistance)))
+		{
+			std::swap(nearChild, farChild);
+			std::swap(nearDistance, farDistance);
+		}
+		if (farDistance >= 0.0f)
+		{
+			stack[stackSize++] = farChild;
+		}
+		if (nearDistance >= 0.0f)
+		{
+			stack[stackSize++] = nearChild;
+		}
+	}
+
+	return(nearestObject);
+}
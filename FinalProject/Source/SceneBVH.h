@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the scene objects
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CullingKernels.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class builds a bounding volume hierarchy of axis
+ *  aligned boxes over the world space bounds of the scene
+ *  objects.  When objects move the boxes are refit bottom up
+ *  and the tree is only rebuilt once refitting has made it
+ *  noticeably worse.  It answers view frustum queries, which
+ *  skip whole subtrees outside the frustum, and ray queries
+ *  for picking.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+
+	// one node of the tree - a leaf when it has no children,
+	// and in both cases the objects below it are the range
+	// [firstItem, firstItem + itemCount) of the item list
+	struct NODE
+	{
+		glm::vec3 boundsMin;
+		int firstItem;
+		glm::vec3 boundsMax;
+		int itemCount;
+		// index of the first child, the second child follows it,
+		// or -1 for a leaf
+		int leftChild;
+	};
+
+	// build the tree over the bounds of objects [0, count)
+	void Build(const glm::vec3* boundsMin, const glm::vec3* boundsMax, int count);
+	// fit the tree to moved bounds of the same objects, and get
+	// whether it had to be rebuilt instead
+	bool Refit(const glm::vec3* boundsMin, const glm::vec3* boundsMax);
+
+	// write 1 to outVisible for objects with bounds at least
+	// partly inside the frustum and 0 for the others, and get
+	// the number of visible objects
+	int QueryFrustum(const CullingKernels::FRUSTUM& frustum, unsigned char* outVisible) const;
+	// find the nearest object whose bounds the ray hits within
+	// the maximum distance, or -1, and its hit distance
+	int Raycast(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& outDistance) const;
+
+	// get the bounds of all the objects
+	bool GetBounds(glm::vec3& outMin, glm::vec3& outMax) const;
+	// get the size of the tree
+	int GetObjectCount() const { return (int)m_items.size(); }
+	int GetNodeCount() const { return (int)m_nodes.size(); }
+	// get the cost of the tree now relative to when it was built
+	float GetCostRatio() const;
+	// get the number of full builds and refits done
+	unsigned int GetBuildCount() const { return m_buildCount; }
+	unsigned int GetRefitCount() const { return m_refitCount; }
+
+private:
+	// nodes, with every parent before its children
+	std::vector<NODE> m_nodes;
+	// object index of every item, grouped by leaf
+	std::vector<int> m_items;
+	// bounds of every item, in item order
+	std::vector<glm::vec3> m_itemMin;
+	std::vector<glm::vec3> m_itemMax;
+	// surface area heuristic cost when built and after refitting
+	float m_builtCost;
+	float m_currentCost;
+	// statistics
+	unsigned int m_buildCount;
+	unsigned int m_refitCount;
+
+	// split a node into two children, or leave it a leaf
+	bool SplitNode(int nodeIndex, std::vector<glm::vec3>& centroids);
+	// fit the bounds of a node around its items or children
+	void FitNode(NODE& node) const;
+	// get the surface area heuristic cost of the whole tree
+	float ComputeCost() const;
+};
@@ -0,0 +1,438 @@
+#include "SceneDescription.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// identification of the compiled scene file format
+	const char g_CompiledMagic[4] = { 'S', 'C', 'N', 'B' };
+	const uint32_t g_CompiledVersion = 1;
+
+	// mesh names used in the text format, in MESH_ID order
+	const char* const g_MeshNames[SceneDescription::MESH_COUNT] =
+	{
+		"plane",
+		"box",
+		"cone",
+		"cylinder",
+		"tapered_cylinder",
+		"torus",
+		"half_torus"
+	};
+
+	// header at the start of the compiled scene file, followed
+	// by the tag table and then the 16-byte aligned records
+	struct COMPILED_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t recordCount;
+		uint32_t materialTagCount;
+		uint32_t textureTagCount;
+		uint32_t tagTableOffset;
+		uint32_t recordOffset;
+		uint32_t reserved;
+	};
+
+	/***********************************************************
+	 *  NextToken()
+	 *
+	 *  Skip the whitespace at the cursor and return the length
+	 *  of the token that follows it on the current line.
+	 ***********************************************************/
+	size_t NextToken(const char*& cursor, const char* lineEnd)
+	{
+		while ((cursor < lineEnd) && ((*cursor == ' ') || (*cursor == '\t') || (*cursor == '\r')))
+		{
+			cursor++;
+		}
+
+		const char* tokenEnd = cursor;
+		while ((tokenEnd < lineEnd) && (*tokenEnd != ' ') && (*tokenEnd != '\t') && (*tokenEnd != '\r'))
+		{
+			tokenEnd++;
+		}
+
+		return((size_t)(tokenEnd - cursor));
+	}
+
+	/***********************************************************
+	 *  ParseFloats()
+	 *
+	 *  Parse the requested number of floating point values from
+	 *  the current line.
+	 ***********************************************************/
+	bool ParseFloats(const char*& cursor, const char* lineEnd, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			size_t length = NextToken(cursor, lineEnd);
+			if (length == 0)
+			{
+				return(false);
+			}
+
+			char* parseEnd = NULL;
+			values[i] = strtof(cursor, &parseEnd);
+			if (parseEnd != cursor + length)
+			{
+				return(false);
+			}
+			cursor += length;
+		}
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  SceneDescription()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneDescription::SceneDescription()
+{
+	m_pRecords = NULL;
+	m_recordCount = 0;
+}
+
+SceneDescription::~SceneDescription()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for releasing any previously loaded
+ *  scene objects and tags.
+ ***********************************************************/
+void SceneDescription::Clear()
+{
+	m_mappedFile.Close();
+	m_records.clear();
+	m_materialTags.clear();
+	m_textureTags.clear();
+	m_pRecords = NULL;
+	m_recordCount = 0;
+}
+
+/***********************************************************
+ *  FindMeshID()
+ *
+ *  This method is used for getting the mesh ID associated
+ *  with the passed in mesh name, or -1 if it is unknown.
+ ***********************************************************/
+int SceneDescription::FindMeshID(const std::string& meshName)
+{
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		if (meshName.compare(g_MeshNames[i]) == 0)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  InternTag()
+ *
+ *  This method is used for getting the index of the passed
+ *  in tag in the tag table, adding the tag when it has not
+ *  been seen before.
+ ***********************************************************/
+int SceneDescription::InternTag(std::vector<std::string>& tags, const std::string& tag)
+{
+	for (int i = 0; i < (int)tags.size(); i++)
+	{
+		if (tags[i].compare(tag) == 0)
+		{
+			return(i);
+		}
+	}
+
+	tags.push_back(tag);
+	return((int)tags.size() - 1);
+}
+
+/***********************************************************
+ *  LoadText()
+ *
+ *  This method is used for parsing the scene objects from
+ *  the text authoring format.
+ ***********************************************************/
+bool SceneDescription::LoadText(const char* filename)
+{
+	Clear();
+
+	std::ifstream sceneFile(filename, std::ios::in | std::ios::binary);
+	if (!sceneFile)
+	{
+		std::cout << "Could not open scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	// read the whole file so the lines can be parsed in place
+	std::string contents;
+	sceneFile.seekg(0, std::ios::end);
+	contents.resize((size_t)sceneFile.tellg());
+	sceneFile.seekg(0, std::ios::beg);
+	sceneFile.read(&contents[0], contents.size());
+
+	const char* cursor = contents.data();
+	const char* fileEnd = cursor + contents.size();
+	int lineNumber = 0;
+
+	while (cursor < fileEnd)
+	{
+		const char* lineEnd = (const char*)memchr(cursor, '\n', (size_t)(fileEnd - cursor));
+		if (lineEnd == NULL)
+		{
+			lineEnd = fileEnd;
+		}
+		lineNumber++;
+
+		// strip any comment from the end of the line
+		const char* comment = (const char*)memchr(cursor, '#', (size_t)(lineEnd - cursor));
+		const char* dataEnd = (comment != NULL) ? comment : lineEnd;
+
+		size_t length = NextToken(cursor, dataEnd);
+		if (length > 0)
+		{
+			DRAW_RECORD record;
+			bool bValid = true;
+
+			// mesh name
+			record.meshID = (uint32_t)FindMeshID(std::string(cursor, length));
+			bValid = (record.meshID < MESH_COUNT);
+			cursor += length;
+
+			// material tag
+			length = NextToken(cursor, dataEnd);
+			bValid = bValid && (length > 0) && (length < TAG_LENGTH);
+			if (bValid)
+			{
+				record.materialIndex = InternTag(m_materialTags, std::string(cursor, length));
+				cursor += length;
+			}
+
+			// texture tag, or '-' when the object is colored
+			length = NextToken(cursor, dataEnd);
+			bValid = bValid && (length > 0) && (length < TAG_LENGTH);
+			if (bValid)
+			{
+				if ((length == 1) && (*cursor == '-'))
+				{
+					record.textureIndex = -1;
+				}
+				else
+				{
+					record.textureIndex = InternTag(m_textureTags, std::string(cursor, length));
+				}
+				cursor += length;
+			}
+
+			bValid = bValid &&
+				ParseFloats(cursor, dataEnd, record.color, 4) &&
+				ParseFloats(cursor, dataEnd, record.scaleXYZ, 3) &&
+				ParseFloats(cursor, dataEnd, record.rotationDegreesXYZ, 3) &&
+				ParseFloats(cursor, dataEnd, record.positionXYZ, 3) &&
+				(NextToken(cursor, dataEnd) == 0);
+
+			if (bValid == false)
+			{
+				std::cout << "Invalid scene object in " << filename << " at line " << lineNumber << std::endl;
+				Clear();
+				return(false);
+			}
+
+			m_records.push_back(record);
+		}
+
+		cursor = lineEnd + 1;
+	}
+
+	m_pRecords = m_records.empty() ? NULL : &m_records[0];
+	m_recordCount = (int)m_records.size();
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddRecord()
+ *
+ *  This method is used for adding a scene object, such as
+ *  for building a scene in code.  The objects of a mapped
+ *  compiled scene are copied into memory first, since the
+ *  mapping cannot grow.
+ ***********************************************************/
+void SceneDescription::AddRecord(const DRAW_RECORD& record, const std::string& materialTag, const std::string& textureTag)
+{
+	if ((m_recordCount > 0) && (m_records.empty() == true))
+	{
+		m_records.assign(m_pRecords, m_pRecords + m_recordCount);
+		m_mappedFile.Close();
+	}
+
+	DRAW_RECORD added = record;
+	added.materialIndex = InternTag(m_materialTags, materialTag);
+	added.textureIndex = textureTag.empty() ? -1 : InternTag(m_textureTags, textureTag);
+	m_records.push_back(added);
+
+	m_pRecords = &m_records[0];
+	m_recordCount = (int)m_records.size();
+}
+
+/***********************************************************
+ *  LoadCompiled()
+ *
+ *  This method is used for mapping the compiled binary scene
+ *  file into memory.  The scene objects are used directly
+ *  from the mapped file without being copied.
+ ***********************************************************/
+bool SceneDescription::LoadCompiled(const char* filename)
+{
+	Clear();
+
+	if (m_mappedFile.Open(filename) == false)
+	{
+		return(false);
+	}
+
+	const unsigned char* pData = m_mappedFile.GetData();
+	size_t fileSize = m_mappedFile.GetSize();
+
+	// validate the header and the extents of the tables
+	COMPILED_HEADER header;
+	bool bValid = (fileSize >= sizeof(header));
+	if (bValid)
+	{
+		memcpy(&header, pData, sizeof(header));
+		uint64_t tagTableSize = ((uint64_t)header.materialTagCount + header.textureTagCount) * TAG_LENGTH;
+		uint64_t recordTableSize = (uint64_t)header.recordCount * sizeof(DRAW_RECORD);
+
+		bValid = (memcmp(header.magic, g_CompiledMagic, sizeof(g_CompiledMagic)) == 0) &&
+			(header.version == g_CompiledVersion) &&
+			(header.tagTableOffset + tagTableSize <= fileSize) &&
+			(header.recordOffset % 16 == 0) &&
+			(header.recordOffset + recordTableSize <= fileSize);
+	}
+
+	if (bValid == false)
+	{
+		std::cout << "Invalid compiled scene file:" << filename << std::endl;
+		Clear();
+		return(false);
+	}
+
+	// copy out the tags, which are few, so they can be resolved
+	const char* pTag = (const char*)(pData + header.tagTableOffset);
+	for (uint32_t i = 0; i < header.materialTagCount; i++, pTag += TAG_LENGTH)
+	{
+		m_materialTags.push_back(std::string(pTag, strnlen(pTag, TAG_LENGTH)));
+	}
+	for (uint32_t i = 0; i < header.textureTagCount; i++, pTag += TAG_LENGTH)
+	{
+		m_textureTags.push_back(std::string(pTag, strnlen(pTag, TAG_LENGTH)));
+	}
+
+	m_pRecords = (const DRAW_RECORD*)(pData + header.recordOffset);
+	m_recordCount = (int)header.recordCount;
+
+	// reject records that reference meshes or tags that do not exist
+	for (int i = 0; i < m_recordCount; i++)
+	{
+		const DRAW_RECORD& record = m_pRecords[i];
+		if ((record.meshID >= MESH_COUNT) ||
+			(record.materialIndex < 0) || (record.materialIndex >= (int32_t)header.materialTagCount) ||
+			(record.textureIndex < -1) || (record.textureIndex >= (int32_t)header.textureTagCount))
+		{
+			std::cout << "Invalid scene object " << i << " in compiled scene file:" << filename << std::endl;
+			Clear();
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SaveCompiled()
+ *
+ *  This method is used for writing the loaded scene objects
+ *  in the compiled binary format.
+ ***********************************************************/
+bool SceneDescription::SaveCompiled(const char* filename) const
+{
+	COMPILED_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, g_CompiledMagic, sizeof(g_CompiledMagic));
+	header.version = g_CompiledVersion;
+	header.recordCount = (uint32_t)m_recordCount;
+	header.materialTagCount = (uint32_t)m_materialTags.size();
+	header.textureTagCount = (uint32_t)m_textureTags.size();
+	header.tagTableOffset = sizeof(header);
+
+	// build the fixed size tag table
+	std::vector<char> tagTable((m_materialTags.size() + m_textureTags.size()) * TAG_LENGTH, 0);
+	size_t tagOffset = 0;
+	for (size_t i = 0; i < m_materialTags.size(); i++, tagOffset += TAG_LENGTH)
+	{
+		memcpy(&tagTable[tagOffset], m_materialTags[i].c_str(), m_materialTags[i].size());
+	}
+	for (size_t i = 0; i < m_textureTags.size(); i++, tagOffset += TAG_LENGTH)
+	{
+		memcpy(&tagTable[tagOffset], m_textureTags[i].c_str(), m_textureTags[i].size());
+	}
+
+	// align the records so they can be used in place when mapped
+	header.recordOffset = (uint32_t)((header.tagTableOffset + tagTable.size() + 15) & ~(size_t)15);
+	std::vector<char> padding(header.recordOffset - header.tagTableOffset - tagTable.size(), 0);
+
+	std::ofstream compiledFile(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!compiledFile)
+	{
+		std::cout << "Could not write compiled scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	compiledFile.write((const char*)&header, sizeof(header));
+	if (!tagTable.empty())
+	{
+		compiledFile.write(&tagTable[0], tagTable.size());
+	}
+	if (!padding.empty())
+	{
+		compiledFile.write(&padding[0], padding.size());
+	}
+	if (m_recordCount > 0)
+	{
+		compiledFile.write((const char*)m_pRecords, sizeof(DRAW_RECORD) * m_recordCount);
+	}
+
+	return(compiledFile.good());
+}
+
+/***********************************************************
+ *  IsCompiledStale()
+ *
+ *  This method is used for checking whether the compiled
+ *  scene file needs to be rebuilt from the text file.
+ ***********************************************************/
+bool SceneDescription::IsCompiledStale(const char* textFilename, const char* compiledFilename)
+{
+	long long compiledTime = MappedFile::GetModificationTime(compiledFilename);
+	if (compiledTime < 0)
+	{
+		return(true);
+	}
+
+	return(MappedFile::GetModificationTime(textFilename) > compiledTime);
+}
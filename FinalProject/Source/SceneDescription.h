@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenedescription.h
+// ============
+// load the data-driven descriptions of the objects in a 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneDescription
+ *
+ *  This class contains the code for reading a scene from
+ *  the text authoring format or from the compiled binary
+ *  format, and for writing the compiled binary format.
+ *
+ *  Text format - one object per line, '#' starts a comment:
+ *
+ *    mesh material texture  r g b a  sx sy sz  rx ry rz  px py pz
+ *
+ *  where texture is a texture tag or '-' for a colored
+ *  object, and the rotations are in degrees.
+ ***********************************************************/
+class SceneDescription
+{
+public:
+	// constructor
+	SceneDescription();
+	// destructor
+	~SceneDescription();
+
+	// maximum length of a material or texture tag, including
+	// the terminating null character
+	static const int TAG_LENGTH = 32;
+
+	// basic shape meshes that a scene object can be drawn with
+	enum MESH_ID
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_CONE,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS,
+		MESH_HALF_TORUS,
+		MESH_COUNT
+	};
+
+	// one scene object, stored exactly like this in the
+	// compiled scene file so it can be used in place
+	struct DRAW_RECORD
+	{
+		uint32_t meshID;
+		// index into the material tag table
+		int32_t materialIndex;
+		// index into the texture tag table, -1 for colored objects
+		int32_t textureIndex;
+		float color[4];
+		float scaleXYZ[3];
+		float rotationDegreesXYZ[3];
+		float positionXYZ[3];
+	};
+
+	// parse the text authoring format
+	bool LoadText(const char* filename);
+	// map the compiled binary format
+	bool LoadCompiled(const char* filename);
+	// write the loaded scene in the compiled binary format
+	bool SaveCompiled(const char* filename) const;
+	// add a scene object to the loaded scene, or to an empty one,
+	// with an empty texture tag for a colored object - the index
+	// fields of the record are replaced by those of the tags
+	void AddRecord(const DRAW_RECORD& record, const std::string& materialTag, const std::string& textureTag);
+	// check whether the compiled file is missing or older
+	// than the text file it was compiled from
+	static bool IsCompiledStale(const char* textFilename, const char* compiledFilename);
+
+	// get the loaded scene objects
+	int GetRecordCount() const { return m_recordCount; }
+	const DRAW_RECORD* GetRecords() const { return m_pRecords; }
+
+	// get the tag tables that the scene objects index into
+	int GetMaterialTagCount() const { return (int)m_materialTags.size(); }
+	const std::string& GetMaterialTag(int index) const { return m_materialTags[index]; }
+	int GetTextureTagCount() const { return (int)m_textureTags.size(); }
+	const std::string& GetTextureTag(int index) const { return m_textureTags[index]; }
+
+	// find the mesh associated with the passed in name
+	static int FindMeshID(const std::string& meshName);
+
+private:
+	// storage for scene objects parsed from the text format
+	std::vector<DRAW_RECORD> m_records;
+	// mapping of the compiled format, used in place
+	MappedFile m_mappedFile;
+	// loaded scene objects, pointing into one of the above
+	const DRAW_RECORD* m_pRecords;
+	int m_recordCount;
+	// material and texture tags referenced by the scene objects
+	std::vector<std::string> m_materialTags;
+	std::vector<std::string> m_textureTags;
+
+	// release any previously loaded scene
+	void Clear();
+	// get the index of a tag, adding it to the table if needed
+	static int InternTag(std::vector<std::string>& tags, const std::string& tag);
+};
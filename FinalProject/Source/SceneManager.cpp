@@ -1,4 +1,5 @@
 #include "SceneManager.h"
+#include "Profiler.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -7,14 +8,68 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// uniform buffer binding points of the material and light
+	// blocks in the shader
+	const GLuint g_MaterialBufferBinding = 0;
+	const GLuint g_LightBufferBinding = 1;
+	// maximum number of materials in the material block, must
+	// match MAX_MATERIALS in the fragment shader
+	const int g_MaxMaterials = 256;
+
+	// std140 layout of one material in the material block
+	struct MATERIAL_STD140
+	{
+		float ambientColor[3];
+		float ambientStrength;
+		float diffuseColor[3];
+		float shininess;
+		float specularColor[3];
+		float opacity;
+	};
+
+	// scene description files for the 3D scene
+	const char* g_SceneFilename = "Scenes/desk.scene";
+	const char* g_CompiledSceneFilename = "Scenes/desk.sceneb";
+
+	// the bounding volume hierarchy culls faster than testing
+	// the spheres of all objects only in large scenes of which
+	// little is visible, past about 10k objects and 5% visible
+	// with the benchmark scenes
+	const int g_BvhCullingMinObjects = 10000;
+	const float g_BvhCullingMaxVisibleRatio = 0.05f;
+	// furthest distance a picking ray reaches
+	const float g_MaxPickDistance = 1000.0f;
+	// most texture images uploaded in one frame while they load,
+	// so a burst of finished images does not stall a frame
+	const int g_MaxTextureUploadsPerFrame = 2;
+	// the texture images are compiled into the texture cache
+	// block compressed, to take less GPU memory
+	const bool g_CompressTextures = true;
+	// first texture unit of the texture arrays
+	const int g_FirstTextureArrayUnit = 0;
+	// GPU memory the textures are streamed within by default
+	const size_t g_TextureMemoryBudget = 256 * 1024 * 1024;
+	// fewest objects or instances recorded as one chunk, below
+	// which waking the job threads costs more than it saves,
+	// and the chunks per thread, so threads that finish early
+	// take the chunks of slower ones
+	const int g_MinRecordChunkItems = 4096;
+	const int g_RecordChunksPerThread = 4;
+	// frames in flight - one recorded, one submitted and one the
+	// GPU may still be drawing - whose instances the instance
+	// ring holds at once
+	const int g_FramesInFlight = 3;
+	// instances and draws of one frame the instance and draw
+	// command rings start out with room for
+	const int g_InitialStreamedInstances = 1024;
+	const int g_InitialDrawCommands = 256;
 }
 
 /***********************************************************
@@ -22,173 +77,179 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager, JobSystem* pJobSystem)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_pJobSystem = pJobSystem;
+	m_textureMemoryBudget = g_TextureMemoryBudget;
+	m_materialBuffer = 0;
+	m_instanceCapacity = 0;
+	m_commandCapacity = 0;
+	m_frames.resize(g_FramesInFlight);
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		m_frames[i].bInstancesFilled = false;
+		m_frames[i].filledRecomputeCount = 0;
+		m_frames[i].firstStreamedInstance = 0;
+		m_frames[i].renderStats = RENDER_STATS();
+	}
+	m_nextFrame = 0;
+	m_recordedFrame = -1;
+	m_recordingFrame = -1;
+	m_pRecordJob = NULL;
+	m_bPipelined = false;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bHasCameraView = false;
+	m_bCullingEnabled = true;
+	m_boundsRecomputeCount = 0;
+	m_bBoundsDirty = false;
+	m_visibleRatio = 0.0f;
+	m_renderStats = RENDER_STATS();
 }
 
 SceneManager::~SceneManager()
 {
+	FinishRecording();
+	DestroyGLTextures();
+	if (m_materialBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_materialBuffer);
+		m_materialBuffer = 0;
+	}
+	m_instanceStream.Destroy();
+	m_commandStream.Destroy();
 	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
+	m_pJobSystem = NULL;
 }
 
 /***********************************************************
  *  CreateGLTexture()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
- ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
-{
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
+ *  This method is used for creating a texture in the next
+ *  texture slot, which the texture streamer loads in the
+ *  background once an object is drawn with it.  The scene
+ *  can render right away, drawing the objects with their
+ *  color as a placeholder until UpdateTextures() stores the
+ *  image in a layer of the texture arrays.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
+{
+	// every tag must identify exactly one texture slot
+	if (m_textureRegistry.Find(tag) != NameRegistry::INVALID_HANDLE)
+	{
+		std::cout << "Texture tag already loaded:" << tag << std::endl;
+		return false;
+	}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	// register the texture and associate it with the special tag string,
+	// the registered handle is the texture slot
+	TEXTURE_INFO texture;
+	texture.tag = tag;
+	m_textures.push_back(texture);
+	m_textureRegistry.Intern(tag);
+	m_textureStreamer.AddTexture(filename);
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	return true;
+}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+/***********************************************************
+ *  UpdateTextures()
+ *
+ *  This method is used for uploading the texture images
+ *  that have been loaded into the texture arrays, up to the
+ *  passed in number of them, or all with -1, and requesting
+ *  the textures drawn in the last frame that are missing or
+ *  need finer mip levels.  Objects with a texture that is
+ *  not resident are drawn with their color.
+ ***********************************************************/
+void SceneManager::UpdateTextures(int maxUploads)
+{
+	PROFILE_GPU_ZONE("UpdateTextures");
 
-		return true;
+	// the instances hold the texture layers, which moved
+	if (m_textureStreamer.Update(maxUploads) > 0)
+	{
+		InvalidateInstances();
 	}
+}
 
-	std::cout << "Could not load image:" << filename << std::endl;
-
-	// Error loading the image
-	return false;
+/***********************************************************
+ *  FinishTextureLoads()
+ *
+ *  This method is used for loading every texture at full
+ *  resolution, as far as the texture memory budget allows,
+ *  and waiting for them, for rendering frames that must not
+ *  show the placeholder colors.
+ ***********************************************************/
+void SceneManager::FinishTextureLoads()
+{
+	FinishRecording();
+	if (m_textureStreamer.FinishLoads() > 0)
+	{
+		InvalidateInstances();
+	}
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for binding the texture arrays to
+ *  their texture units.  Each array keeps its unit, so they
+ *  are bound as they are created and this is only needed
+ *  after other code bound textures to those units.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
-	}
+	m_textureStreamer.GetArrays().BindArrays();
 }
 
 /***********************************************************
  *  DestroyGLTextures()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for stopping the texture loads and
+ *  freeing the memory of the texture arrays holding all the
+ *  loaded textures.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glGenTextures(1, &m_textureIDs[i].ID);
-	}
+	m_textureStreamer.Destroy();
 }
 
 /***********************************************************
  *  FindTextureID()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for getting the ID of the texture
+ *  array holding the previously loaded texture bitmap
+ *  associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const std::string& tag)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	int textureSlot = FindTextureSlot(tag);
+	if (GetTextureArray(textureSlot) < 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		return(-1);
 	}
 
-	return(textureID);
+	return(m_textureStreamer.GetArrays().GetArray(GetTextureArray(textureSlot)).textureID);
 }
 
 /***********************************************************
  *  FindTextureSlot()
  *
  *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  loaded texture bitmap associated with the passed in tag.  The
+ *  slot is the handle the tag was registered with.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const std::string& tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
+	NameRegistry::HANDLE handle = m_textureRegistry.Find(tag);
+	if (handle == NameRegistry::INVALID_HANDLE)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
+		return(-1);
 	}
 
-	return(textureSlot);
+	return((int)handle);
 }
 
 /***********************************************************
@@ -197,117 +258,98 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
 {
-	if (m_objectMaterials.size() == 0)
+	int index = FindMaterialIndex(tag);
+	if (index < 0)
 	{
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
-	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
-	}
+	material = m_objectMaterials[index];
 
 	return(true);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  FindMaterialIndex()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for getting the index in the defined
+ *  materials list of the material associated with the passed
+ *  in tag, or -1 if no such material was defined.  The index
+ *  is the handle the tag was registered with.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+int SceneManager::FindMaterialIndex(const std::string& tag)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
+	NameRegistry::HANDLE handle = m_materialRegistry.Find(tag);
+	if (handle == NameRegistry::INVALID_HANDLE)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		return(-1);
 	}
+
+	return((int)handle);
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  RegisterMaterialTags()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for registering the tags of the
+ *  defined materials, so that every material is found by
+ *  its handle.  A material that repeats an earlier tag could
+ *  never be found, so it is dropped.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+void SceneManager::RegisterMaterialTags()
 {
-	// variables for this method
-	glm::vec4 currentColor;
-
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
+	m_materialRegistry.Clear();
 
-	if (NULL != m_pShaderManager)
+	size_t index = 0;
+	while (index < m_objectMaterials.size())
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		NameRegistry::HANDLE handle = m_materialRegistry.Intern(m_objectMaterials[index].tag);
+		if (handle != (NameRegistry::HANDLE)index)
+		{
+			std::cout << "Ignoring duplicate material tag:" << m_objectMaterials[index].tag << std::endl;
+			m_objectMaterials.erase(m_objectMaterials.begin() + index);
+		}
+		else
+		{
+			index++;
+		}
 	}
 }
 
 /***********************************************************
  *  SetShaderTexture()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for setting the texture array holding
+ *  the texture associated with the passed in tag into the
+ *  shader.  The layer comes with every instance.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const std::string& textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	int textureSlot = FindTextureSlot(textureTag);
+	SetShaderTexture(GetTextureArray(textureSlot));
+}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture unit of the
+ *  passed in texture array into the shader, or turning the
+ *  texture off with -1.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureArray)
+{
+	if (textureArray < 0)
+	{
+		m_uniformCache.SetInt(UniformCache::UNIFORM_USE_TEXTURE, false);
+		return;
 	}
+
+	m_uniformCache.SetInt(UniformCache::UNIFORM_USE_TEXTURE, true);
+	m_uniformCache.SetInt(UniformCache::UNIFORM_OBJECT_TEXTURE, m_textureStreamer.GetArrays().GetTextureUnit(textureArray));
 }
 
 /***********************************************************
@@ -318,13 +360,15 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_uniformCache.SetVec2(UniformCache::UNIFORM_UV_SCALE, glm::vec2(u, v));
 }
 void SceneManager::LoadSceneTextures()
 {
+	// stream the images in on all but one hardware thread once
+	// objects are drawn with them, the scene renders with
+	// placeholders until they are uploaded, and images loaded
+	// before come from the texture cache
+	m_textureStreamer.Create(m_textureMemoryBudget, g_FirstTextureArrayUnit, m_pJobSystem, g_CompressTextures);
 
 	bool bReturn = false;
 
@@ -339,55 +383,100 @@ void SceneManager::LoadSceneTextures()
 	bReturn = CreateGLTexture(
 		"//apporto.com/dfs/SNHU/USERS/vyhuynh11_snhu/Documents/CS330Content/Utilities/textures/ruler.png",
 		"ruler");
-
-	BindGLTextures();
 }
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const std::string& materialTag)
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+	SetShaderMaterial(FindMaterialIndex(materialTag));
+}
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for setting the material at the
+ *  passed in index of the defined materials list into the
+ *  shader.  The material values are already in the material
+ *  buffer, so only the index is sent.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
+{
+	if ((materialIndex >= 0) && (materialIndex < (int)m_objectMaterials.size()))
+	{
+		m_uniformCache.SetInt(UniformCache::UNIFORM_MATERIAL_INDEX, materialIndex);
 	}
 }
-void SceneManager::SetupSceneLights()
+
+/***********************************************************
+ *  CreateMaterialBuffer()
+ *
+ *  This method is used for packing all the defined materials
+ *  into a uniform buffer in the std140 layout and binding it
+ *  to the material block of the shader.  This is done once,
+ *  after which draws select their material by index.
+ ***********************************************************/
+void SceneManager::CreateMaterialBuffer()
 {
+	int materialCount = (int)m_objectMaterials.size();
+	if (materialCount > g_MaxMaterials)
+	{
+		std::cout << "Only the first " << g_MaxMaterials << " of " << materialCount << " materials fit in the material buffer" << std::endl;
+		materialCount = g_MaxMaterials;
+	}
+
+	std::vector<MATERIAL_STD140> packedMaterials(g_MaxMaterials);
+	memset(&packedMaterials[0], 0, sizeof(MATERIAL_STD140) * g_MaxMaterials);
+	for (int i = 0; i < materialCount; i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		MATERIAL_STD140& packed = packedMaterials[i];
+
+		memcpy(packed.ambientColor, &material.ambientColor[0], sizeof(packed.ambientColor));
+		packed.ambientStrength = material.ambientStrength;
+		memcpy(packed.diffuseColor, &material.diffuseColor[0], sizeof(packed.diffuseColor));
+		packed.shininess = material.shininess;
+		memcpy(packed.specularColor, &material.specularColor[0], sizeof(packed.specularColor));
+		packed.opacity = material.opacity;
+	}
 
-	m_pShaderManager->setVec3Value("lightSources[0].position", -3.0f, 4.0f, 6.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.005f, 0.005f, 0.005f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.25f, 0.25f, 0.25f);
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.25f, 0.25f, 0.25f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.1f);
+	if (m_materialBuffer == 0)
+	{
+		glGenBuffers(1, &m_materialBuffer);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(MATERIAL_STD140) * g_MaxMaterials, &packedMaterials[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-	m_pShaderManager->setVec3Value("lightSources[1].position", 3.0f, 4.0f, 6.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.005f, 0.005f, 0.005f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.25f, 0.25f, 0.25f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.25f, 0.25f, 0.25f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.1f);
+	glBindBufferBase(GL_UNIFORM_BUFFER, g_MaterialBufferBinding, m_materialBuffer);
+}
 
-	m_pShaderManager->setVec3Value("lightSources[2].position", 0.0f, 3.0f, 10.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.025f, 0.025f, 0.025f);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 0.25f, 0.25f, 0.25f);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.125f, 0.125f, 0.125f);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 22.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.1f);
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is used for creating the light buffer and
+ *  adding the light sources of the scene to it.  More lights
+ *  can be added, moved or removed later through the light
+ *  manager.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	m_lightManager.Create(g_LightBufferBinding);
 
-	m_pShaderManager->setBoolValue("bUseLighting", true);
+	// position, ambient, diffuse and specular colors, focal strength
+	// and specular intensity of each light source in the scene
+	const LightManager::LIGHT_SOURCE lights[] =
+	{
+		{ glm::vec3(-3.0f, 4.0f, 6.0f), 32.0f, glm::vec3(0.005f), 0.1f, glm::vec3(0.25f), 0.0f, glm::vec3(0.25f), 0.0f },
+		{ glm::vec3(3.0f, 4.0f, 6.0f), 32.0f, glm::vec3(0.005f), 0.1f, glm::vec3(0.25f), 0.0f, glm::vec3(0.25f), 0.0f },
+		{ glm::vec3(0.0f, 3.0f, 10.0f), 22.0f, glm::vec3(0.025f), 0.1f, glm::vec3(0.25f), 0.0f, glm::vec3(0.125f), 0.0f }
+	};
 
+	for (int i = 0; i < (int)(sizeof(lights) / sizeof(lights[0])); i++)
+	{
+		m_lightManager.AddLight(lights[i]);
+	}
 
+	m_uniformCache.SetInt(UniformCache::UNIFORM_USE_LIGHTING, true);
 }
 void SceneManager::DefineObjectMaterials()
 {
@@ -429,6 +518,7 @@ void SceneManager::DefineObjectMaterials()
 	glassMaterial.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);
 	glassMaterial.shininess = 55.0;
 	glassMaterial.tag = "glass";
+	glassMaterial.opacity = 0.5f;
 	m_objectMaterials.push_back(glassMaterial);
 
 	OBJECT_MATERIAL woodMaterial;
@@ -465,379 +555,1129 @@ void SceneManager::DefineObjectMaterials()
 }
 
 
+/***********************************************************
+ *  LoadSceneObjects()
+ *
+ *  This method is used for loading the scene objects from
+ *  the scene description.  The compiled scene file is used
+ *  when it is up to date, otherwise the text scene file is
+ *  parsed and compiled for the next launch.
+ ***********************************************************/
+bool SceneManager::LoadSceneObjects(
+	const char* sceneFilename,
+	const char* compiledFilename)
+{
+	SceneDescription scene;
+	bool bLoaded = false;
+
+	if (SceneDescription::IsCompiledStale(sceneFilename, compiledFilename) == false)
+	{
+		bLoaded = scene.LoadCompiled(compiledFilename);
+	}
+	if (bLoaded == false)
+	{
+		bLoaded = scene.LoadText(sceneFilename);
+		if (bLoaded == true)
+		{
+			scene.SaveCompiled(compiledFilename);
+		}
+	}
+	if (bLoaded == false)
+	{
+		return(false);
+	}
+
+	CreateSceneObjects(scene);
+
+	std::cout << "Loaded " << m_sceneObjects.size() << " scene objects from " << sceneFilename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateSceneObjects()
+ *
+ *  This method is used for creating the scene objects of a
+ *  scene description.  The mesh, material and texture of
+ *  every object are resolved here so that rendering needs
+ *  no lookups.
+ ***********************************************************/
+void SceneManager::CreateSceneObjects(const SceneDescription& scene)
+{
+	// resolve the tags referenced by the scene once
+	std::vector<int> materialIndices(scene.GetMaterialTagCount());
+	for (int i = 0; i < scene.GetMaterialTagCount(); i++)
+	{
+		materialIndices[i] = FindMaterialIndex(scene.GetMaterialTag(i));
+		if (materialIndices[i] < 0)
+		{
+			std::cout << "Scene references undefined material:" << scene.GetMaterialTag(i) << std::endl;
+		}
+	}
+	std::vector<int> textureSlots(scene.GetTextureTagCount());
+	for (int i = 0; i < scene.GetTextureTagCount(); i++)
+	{
+		textureSlots[i] = FindTextureSlot(scene.GetTextureTag(i));
+		if (textureSlots[i] < 0)
+		{
+			std::cout << "Scene references unloaded texture:" << scene.GetTextureTag(i) << std::endl;
+		}
+	}
+
+	const SceneDescription::DRAW_RECORD* pRecords = scene.GetRecords();
+	m_sceneObjects.resize(scene.GetRecordCount());
+	m_transforms.Clear();
+	for (int i = 0; i < scene.GetRecordCount(); i++)
+	{
+		const SceneDescription::DRAW_RECORD& record = pRecords[i];
+		SCENE_OBJECT& object = m_sceneObjects[i];
+
+		object.meshID = (int)record.meshID;
+		object.materialIndex = materialIndices[record.materialIndex];
+		object.textureSlot = (record.textureIndex >= 0) ? textureSlots[record.textureIndex] : -1;
+		object.color = glm::vec4(record.color[0], record.color[1], record.color[2], record.color[3]);
+		object.bTransparent = (object.color.a < 1.0f) ||
+			((object.materialIndex >= 0) && (m_objectMaterials[object.materialIndex].opacity < 1.0f));
+
+		m_transforms.AddTransform(
+			glm::vec3(record.scaleXYZ[0], record.scaleXYZ[1], record.scaleXYZ[2]),
+			glm::vec3(record.rotationDegreesXYZ[0], record.rotationDegreesXYZ[1], record.rotationDegreesXYZ[2]),
+			glm::vec3(record.positionXYZ[0], record.positionXYZ[1], record.positionXYZ[2]));
+	}
+
+	// build all the model matrices up front
+	m_transforms.Update(m_pJobSystem);
+}
+
+/***********************************************************
+ *  CreateInstanceBuffer()
+ *
+ *  This method is used for creating the ring the instances
+ *  are streamed through, which grows to hold the instances
+ *  of the frames in flight as they are submitted, and for
+ *  making room for a draw of every scene object in the
+ *  render queue.
+ ***********************************************************/
+void SceneManager::CreateInstanceBuffer()
+{
+	// the queue and the objects in its order trade places with
+	// their scratch buffers every frame, so all of them hold the
+	// whole scene to keep the frames from allocating
+	int objectCount = (int)m_sceneObjects.size();
+	m_renderQueue.Reserve(objectCount);
+	m_sortedObjects.reserve(objectCount);
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		m_frames[i].instanceObjects.clear();
+		m_frames[i].instanceObjects.reserve(objectCount);
+		m_frames[i].instanceData.clear();
+	}
+
+	m_instanceCapacity = 0;
+	ReserveInstances(std::min((int)m_sceneObjects.size(), g_InitialStreamedInstances));
+	m_commandCapacity = 0;
+	ReserveDrawCommands(g_InitialDrawCommands);
+
+	m_visibleFlags.assign(m_sceneObjects.size(), 1);
+	InvalidateInstances();
+	m_bBoundsDirty = true;
+}
+
+/***********************************************************
+ *  ReserveInstances()
+ *
+ *  This method is used for growing the instance ring so it
+ *  holds the passed in number of instances for every frame
+ *  in flight, by half again at least so it does not grow
+ *  every frame, and no further than every scene object.  A
+ *  frame bigger than its share of the ring would wait for
+ *  the GPU to finish the frames before it.  The ring is
+ *  created anew, and the GPU keeps the old one until it has
+ *  drawn the frames still reading it.
+ ***********************************************************/
+void SceneManager::ReserveInstances(int instanceCount)
+{
+	if ((instanceCount <= m_instanceCapacity) && (m_instanceStream.GetBuffer() != 0))
+	{
+		return;
+	}
+
+	int capacity = std::max(instanceCount, m_instanceCapacity + m_instanceCapacity / 2);
+	capacity = std::max(std::min(capacity, (int)m_sceneObjects.size()), std::max(instanceCount, 1));
+
+	m_instanceStream.Create((GLsizeiptr)sizeof(MeshLibrary::INSTANCE_DATA) * capacity * g_FramesInFlight, true);
+	m_meshLibrary.SetInstanceBuffer(m_instanceStream.GetBuffer());
+	m_instanceCapacity = capacity;
+}
+
+/***********************************************************
+ *  ReserveDrawCommands()
+ *
+ *  This method is used for growing the draw command ring so
+ *  it holds the passed in number of draws for every frame in
+ *  flight, by half again at least, the same way the instance
+ *  ring grows.  The draws are read from the ring with
+ *  glMultiDrawElementsIndirect, so it is only created when
+ *  the context has it.
+ ***********************************************************/
+void SceneManager::ReserveDrawCommands(int commandCount)
+{
+	if (m_meshLibrary.CanMultiDraw() == false)
+	{
+		return;
+	}
+	if ((commandCount <= m_commandCapacity) && (m_commandStream.GetBuffer() != 0))
+	{
+		return;
+	}
+
+	int capacity = std::max(std::max(commandCount, m_commandCapacity + m_commandCapacity / 2), 1);
+	m_commandStream.Create((GLsizeiptr)sizeof(MeshLibrary::DRAW_COMMAND) * capacity * g_FramesInFlight, true);
+	m_commandCapacity = capacity;
+}
+
+/***********************************************************
+ *  InvalidateInstances()
+ *
+ *  This method is used for filling the instances of every
+ *  frame again when they are next recorded, such as after
+ *  the texture layers moved.
+ ***********************************************************/
+void SceneManager::InvalidateInstances()
+{
+	for (size_t i = 0; i < m_frames.size(); i++)
+	{
+		m_frames[i].bInstancesFilled = false;
+	}
+}
+
+/***********************************************************
+ *  UpdateBounds()
+ *
+ *  This method is used for placing the bounding sphere and
+ *  box of every scene object around its mesh.  The sphere
+ *  encloses the bounding box of the mesh, moved by the model
+ *  matrix and grown by its largest scale.  The world box
+ *  encloses the moved mesh box, and the hierarchy over the
+ *  boxes is refit, or built the first time.  The objects are
+ *  placed in chunks on the job threads.
+ ***********************************************************/
+void SceneManager::UpdateBounds()
+{
+	size_t objectCount = m_sceneObjects.size();
+	m_boundsCenterX.resize(objectCount);
+	m_boundsCenterY.resize(objectCount);
+	m_boundsCenterZ.resize(objectCount);
+	m_boundsRadius.resize(objectCount);
+	m_boundsMin.resize(objectCount);
+	m_boundsMax.resize(objectCount);
+
+	int chunkCount = (objectCount > 0) ? GetRecordChunkCount((int)objectCount) : 0;
+	m_pJobSystem->ParallelFor(chunkCount, [this, objectCount, chunkCount](int chunkIndex)
+		{
+			size_t firstObject = objectCount * chunkIndex / chunkCount;
+			size_t lastObject = objectCount * (chunkIndex + 1) / chunkCount;
+			UpdateObjectBounds((int)firstObject, (int)(lastObject - firstObject));
+		});
+
+	if (objectCount > 0)
+	{
+		if (m_bvh.GetObjectCount() != (int)objectCount)
+		{
+			m_bvh.Build(&m_boundsMin[0], &m_boundsMax[0], (int)objectCount);
+		}
+		else
+		{
+			m_bvh.Refit(&m_boundsMin[0], &m_boundsMax[0]);
+		}
+	}
+
+	m_boundsRecomputeCount = m_transforms.GetRecomputeCount();
+	m_bBoundsDirty = false;
+}
+
+/***********************************************************
+ *  UpdateObjectBounds()
+ *
+ *  This method is used for placing the bounding sphere and
+ *  box of a range of the scene objects, on the job threads.
+ ***********************************************************/
+void SceneManager::UpdateObjectBounds(int firstObject, int objectCount)
+{
+	for (int i = firstObject; i < firstObject + objectCount; i++)
+	{
+		const MeshLibrary::MESH_RANGE& mesh = m_meshLibrary.GetMesh(m_sceneObjects[i].meshID);
+		const glm::mat4& model = m_transforms.GetModelMatrix(i);
+
+		glm::vec3 localCenter = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+		float localRadius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f;
+		float scale = glm::max(glm::length(glm::vec3(model[0])),
+			glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+
+		glm::vec4 center = model * glm::vec4(localCenter, 1.0f);
+		m_boundsCenterX[i] = center.x;
+		m_boundsCenterY[i] = center.y;
+		m_boundsCenterZ[i] = center.z;
+		m_boundsRadius[i] = localRadius * scale;
+
+		// the extents of the moved box along each world axis
+		// are the mesh extents through the absolute rotation
+		// and scale
+		glm::vec3 localExtent = (mesh.boundsMax - mesh.boundsMin) * 0.5f;
+		glm::vec3 worldExtent = glm::abs(glm::vec3(model[0])) * localExtent.x
+			+ glm::abs(glm::vec3(model[1])) * localExtent.y
+			+ glm::abs(glm::vec3(model[2])) * localExtent.z;
+		m_boundsMin[i] = glm::vec3(center) - worldExtent;
+		m_boundsMax[i] = glm::vec3(center) + worldExtent;
+	}
+}
+
+/***********************************************************
+ *  RefreshBounds()
+ *
+ *  This method is used for updating the bounding volumes
+ *  only when a scene object moved since they were placed.
+ ***********************************************************/
+void SceneManager::RefreshBounds()
+{
+	if ((m_bBoundsDirty == true) || (m_transforms.GetRecomputeCount() != m_boundsRecomputeCount))
+	{
+		UpdateBounds();
+	}
+}
+
+/***********************************************************
+ *  QueueSceneObjects()
+ *
+ *  This method is used for submitting every scene object in
+ *  the view frustum to the render queue with a key made of
+ *  its pass, texture array, material, mesh and distance in
+ *  front of the camera, and sorting the queue.  Objects with
+ *  a transparent material go to the transparent pass.  The
+ *  textures of the queued objects are marked as drawn, with
+ *  the size of the objects on screen.
+ *
+ *  The objects are recorded in chunks on the job threads,
+ *  each chunk into its own queue, and the chunks are merged
+ *  in order, so the frame is the same with any number of
+ *  threads.  Only the camera of the frame is used, so this
+ *  can run while the rendering thread moves on.
+ ***********************************************************/
+void SceneManager::QueueSceneObjects(FRAME_DATA& frame)
+{
+	PROFILE_ZONE("QueueSceneObjects");
+
+	m_renderQueue.Clear();
+	m_textureStreamer.BeginFrame();
+
+	int objectCount = (int)m_sceneObjects.size();
+	RECORD_VIEW view;
+	view.viewMatrix = frame.viewMatrix;
+	view.bHasCameraView = frame.bHasCameraView;
+	view.bCullingEnabled = frame.bCullingEnabled;
+	view.bCullSpheres = false;
+	bool bCullBvh = false;
+	if ((frame.bCullingEnabled == true) && (frame.bHasCameraView == true) && (objectCount > 0))
+	{
+		RefreshBounds();
+		CullingKernels::ExtractFrustum(frame.projectionMatrix * frame.viewMatrix, view.frustum);
+
+		// the part of the scene visible last frame decides which
+		// way is faster this frame
+		if ((objectCount >= g_BvhCullingMinObjects) && (m_visibleRatio <= g_BvhCullingMaxVisibleRatio))
+		{
+			frame.renderStats.visibleObjects = m_bvh.QueryFrustum(view.frustum, &m_visibleFlags[0]);
+			bCullBvh = true;
+		}
+		else
+		{
+			view.bCullSpheres = true;
+		}
+	}
+	else if (frame.bHasCameraView == true)
+	{
+		RefreshBounds();
+	}
+
+	// pixels per unit of size at unit depth, for the size of the
+	// objects on screen
+	view.pixelScale = frame.projectionMatrix[1][1] * frame.viewportHeight * 0.5f;
+	view.bOrthographic = (frame.projectionMatrix[3][3] == 1.0f);
+
+	int chunkCount = (objectCount > 0) ? GetRecordChunkCount(objectCount) : 0;
+	if ((int)m_recordChunks.size() < chunkCount)
+	{
+		m_recordChunks.resize(chunkCount);
+	}
+	m_pJobSystem->ParallelFor(chunkCount, [this, &view, objectCount, chunkCount](int chunkIndex)
+		{
+			int firstObject = (int)((int64_t)objectCount * chunkIndex / chunkCount);
+			int lastObject = (int)((int64_t)objectCount * (chunkIndex + 1) / chunkCount);
+			RecordSceneObjects(firstObject, lastObject - firstObject, view, m_recordChunks[chunkIndex]);
+		});
+
+	int visibleObjects = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		const RECORD_CHUNK& chunk = m_recordChunks[i];
+		m_renderQueue.Append(chunk.queue);
+		visibleObjects += chunk.visibleObjects;
+		for (size_t slot = 0; slot < chunk.textureSizes.size(); slot++)
+		{
+			if (chunk.textureSizes[slot] >= 0.0f)
+			{
+				m_textureStreamer.MarkVisible((int)slot, chunk.textureSizes[slot]);
+			}
+		}
+	}
+	if (bCullBvh == false)
+	{
+		frame.renderStats.visibleObjects = visibleObjects;
+	}
+	frame.renderStats.culledObjects = objectCount - frame.renderStats.visibleObjects;
+	m_visibleRatio = (objectCount > 0) ? ((float)frame.renderStats.visibleObjects / objectCount) : 1.0f;
+
+	m_renderQueue.Sort();
+}
+
+/***********************************************************
+ *  GetRecordChunkCount()
+ *
+ *  This method is used for splitting a number of objects or
+ *  instances into chunks for the job threads, a few per
+ *  thread but none smaller than the least worth waking the
+ *  threads for.  Small scenes are a single chunk, recorded
+ *  by the rendering thread alone.
+ ***********************************************************/
+int SceneManager::GetRecordChunkCount(int itemCount) const
+{
+	int chunkCount = (itemCount + g_MinRecordChunkItems - 1) / g_MinRecordChunkItems;
+	chunkCount = std::min(chunkCount, m_pJobSystem->GetThreadCount() * g_RecordChunksPerThread);
+
+	return(std::max(chunkCount, 1));
+}
+
+/***********************************************************
+ *  RecordSceneObjects()
+ *
+ *  This method is used for recording the draws of a chunk
+ *  of the scene objects into the queue of the chunk, testing
+ *  their bounding spheres against the frustum first when the
+ *  hierarchy was not used, and keeping the largest size on
+ *  screen of every texture the chunk draws.  It runs on the
+ *  job threads, so it only reads the shared scene state
+ *  and writes to the chunk and the visible flags of its own
+ *  objects.
+ ***********************************************************/
+void SceneManager::RecordSceneObjects(
+	int firstObject,
+	int objectCount,
+	const RECORD_VIEW& view,
+	RECORD_CHUNK& chunk)
+{
+	chunk.queue.Clear();
+	chunk.queue.Reserve(objectCount);
+	chunk.textureSizes.assign(m_textures.size(), -1.0f);
+
+	if (view.bCullSpheres == true)
+	{
+		CullingKernels::SPHERE_SOA spheres;
+		spheres.centerX = &m_boundsCenterX[firstObject];
+		spheres.centerY = &m_boundsCenterY[firstObject];
+		spheres.centerZ = &m_boundsCenterZ[firstObject];
+		spheres.radius = &m_boundsRadius[firstObject];
+		CullingKernels::CullSpheres(view.frustum, spheres, objectCount, &m_visibleFlags[firstObject]);
+	}
+	else if ((view.bCullingEnabled == false) || (view.bHasCameraView == false))
+	{
+		memset(&m_visibleFlags[firstObject], 1, objectCount);
+	}
+
+	int visibleObjects = 0;
+	for (int i = firstObject; i < firstObject + objectCount; i++)
+	{
+		if (m_visibleFlags[i] == 0)
+		{
+			continue;
+		}
+		visibleObjects++;
+
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+
+		// the depth of the object origin, in front of the camera
+		glm::vec4 viewPosition = view.viewMatrix * m_transforms.GetModelMatrix(i)[3];
+		RenderQueue::PASS pass = object.bTransparent ? RenderQueue::PASS_TRANSPARENT : RenderQueue::PASS_OPAQUE;
+
+		chunk.queue.Submit(
+			RenderQueue::MakeKey(pass, 0, GetTextureArray(object.textureSlot), object.materialIndex, object.meshID, -viewPosition.z),
+			(uint32_t)i);
+
+		if (object.textureSlot >= 0)
+		{
+			// the diameter of the bounding sphere in pixels, the
+			// full texture while the size is unknown or the
+			// camera is inside the sphere
+			float screenSize = FLT_MAX;
+			if (view.bHasCameraView == true)
+			{
+				float diameter = m_boundsRadius[i] * 2.0f;
+				if (view.bOrthographic == true)
+				{
+					screenSize = diameter * view.pixelScale;
+				}
+				else if (-viewPosition.z > m_boundsRadius[i])
+				{
+					screenSize = diameter * view.pixelScale / -viewPosition.z;
+				}
+			}
+			float& textureSize = chunk.textureSizes[object.textureSlot];
+			textureSize = std::max(textureSize, screenSize);
+		}
+	}
+	chunk.visibleObjects = visibleObjects;
+}
+
+/***********************************************************
+ *  BuildDrawBatches()
+ *
+ *  This method is used for merging neighboring draws of the
+ *  sorted render queue that share pass, mesh, material and
+ *  texture array into batches, so each batch is drawn with
+ *  one instanced draw call, whatever layers of the array
+ *  its objects use.  The objects of a batch take
+ *  consecutive instances of the instances of the frame, which
+ *  have to be filled again when the order of the objects
+ *  changed since the frame was last recorded.
+ ***********************************************************/
+void SceneManager::BuildDrawBatches(FRAME_DATA& frame)
+{
+	PROFILE_ZONE("BuildDrawBatches");
+
+	// a batch per draw at most, so the batches do not grow
+	// while they are merged, with room for half again as many
+	// like the instance ring, so a busier view than the last
+	// seldom grows them
+	frame.drawBatches.clear();
+	if ((int)frame.drawBatches.capacity() < m_renderQueue.GetCount())
+	{
+		frame.drawBatches.reserve(m_renderQueue.GetCount() + m_renderQueue.GetCount() / 2);
+	}
+	m_sortedObjects.resize(m_renderQueue.GetCount());
+
+	for (int i = 0; i < m_renderQueue.GetCount(); i++)
+	{
+		int objectIndex = (int)m_renderQueue.GetValue(i);
+		const SCENE_OBJECT& object = m_sceneObjects[objectIndex];
+		RenderQueue::PASS pass = RenderQueue::GetPass(m_renderQueue.GetKey(i));
+		m_sortedObjects[i] = objectIndex;
+
+		if (!frame.drawBatches.empty())
+		{
+			DRAW_BATCH& last = frame.drawBatches.back();
+			if ((last.pass == pass) &&
+				(last.meshID == object.meshID) &&
+				(last.materialIndex == object.materialIndex) &&
+				(last.textureArray == GetTextureArray(object.textureSlot)))
+			{
+				last.instanceCount++;
+				continue;
+			}
+		}
+
+		DRAW_BATCH batch;
+		batch.pass = pass;
+		batch.meshID = object.meshID;
+		batch.materialIndex = object.materialIndex;
+		batch.textureArray = GetTextureArray(object.textureSlot);
+		batch.firstInstance = i;
+		batch.instanceCount = 1;
+		frame.drawBatches.push_back(batch);
+	}
+
+	if (m_sortedObjects != frame.instanceObjects)
+	{
+		frame.instanceObjects.swap(m_sortedObjects);
+		frame.bInstancesFilled = false;
+	}
+}
+
+/***********************************************************
+ *  FillInstanceData()
+ *
+ *  This method is used for copying the cached model matrix,
+ *  the color and the texture layer of every queued scene
+ *  object into the instances of a frame, in chunks on the
+ *  job threads.  The instances are streamed by
+ *  StreamInstances() when the frame is submitted.
+ ***********************************************************/
+void SceneManager::FillInstanceData(FRAME_DATA& frame)
+{
+	PROFILE_ZONE("FillInstanceData");
+
+	int instanceCount = (int)frame.instanceObjects.size();
+	frame.instanceData.resize(instanceCount);
+	int chunkCount = (instanceCount > 0) ? GetRecordChunkCount(instanceCount) : 0;
+	m_pJobSystem->ParallelFor(chunkCount, [this, &frame, instanceCount, chunkCount](int chunkIndex)
+		{
+			int firstInstance = (int)((int64_t)instanceCount * chunkIndex / chunkCount);
+			int lastInstance = (int)((int64_t)instanceCount * (chunkIndex + 1) / chunkCount);
+			for (int i = firstInstance; i < lastInstance; i++)
+			{
+				int objectIndex = frame.instanceObjects[i];
+				int textureSlot = m_sceneObjects[objectIndex].textureSlot;
+				frame.instanceData[i].model = m_transforms.GetModelMatrix(objectIndex);
+				frame.instanceData[i].color = m_sceneObjects[objectIndex].color;
+				frame.instanceData[i].textureLayer = (textureSlot >= 0) ? (float)m_textureStreamer.GetLayer(textureSlot) : -1.0f;
+			}
+		});
+
+	frame.filledRecomputeCount = m_transforms.GetRecomputeCount();
+	frame.bInstancesFilled = true;
+}
+
+/***********************************************************
+ *  StreamInstances()
+ *
+ *  This method is used for copying the instances of a frame
+ *  into the next block of the instance ring, every time the
+ *  frame is submitted, so no driver call uploads them.  The
+ *  block is aligned to whole instances, so the draws find
+ *  their instances by the first one of the block.  The ring
+ *  only waits for the GPU when it is a full ring of frames
+ *  behind.
+ ***********************************************************/
+void SceneManager::StreamInstances(int frameIndex)
+{
+	PROFILE_GPU_ZONE("StreamInstances");
+
+	FRAME_DATA& frame = m_frames[frameIndex];
+	frame.firstStreamedInstance = 0;
+	if (frame.instanceData.empty())
+	{
+		return;
+	}
+
+	ReserveInstances((int)frame.instanceData.size());
+
+	const GLsizeiptr instanceSize = (GLsizeiptr)sizeof(MeshLibrary::INSTANCE_DATA);
+	StreamingBuffer::ALLOCATION block;
+	if (m_instanceStream.Allocate(instanceSize * frame.instanceData.size(), instanceSize, block) == false)
+	{
+		std::cout << "Could not stream " << frame.instanceData.size() << " instances" << std::endl;
+		return;
+	}
+	memcpy(block.pData, &frame.instanceData[0], (size_t)block.size);
+	m_instanceStream.Commit(block);
+	frame.firstStreamedInstance = (GLuint)(block.offset / instanceSize);
+}
+
+/***********************************************************
+ *  StreamDrawCommands()
+ *
+ *  This method is used for writing the draw of every batch of
+ *  a frame, in batch order, straight into the next block of
+ *  the draw command ring, with the instances read from the
+ *  block they were streamed into.  The byte offset of the
+ *  first draw is passed back for the indirect draw calls.
+ ***********************************************************/
+bool SceneManager::StreamDrawCommands(int frameIndex, GLintptr& outOffset)
+{
+	PROFILE_ZONE("StreamDrawCommands");
+
+	FRAME_DATA& frame = m_frames[frameIndex];
+	outOffset = 0;
+	if ((m_meshLibrary.CanMultiDraw() == false) || (frame.drawBatches.empty()))
+	{
+		return(false);
+	}
+
+	ReserveDrawCommands((int)frame.drawBatches.size());
+
+	const GLsizeiptr commandSize = (GLsizeiptr)sizeof(MeshLibrary::DRAW_COMMAND);
+	StreamingBuffer::ALLOCATION block;
+	if (m_commandStream.Allocate(commandSize * frame.drawBatches.size(), commandSize, block) == false)
+	{
+		return(false);
+	}
+
+	MeshLibrary::DRAW_COMMAND* pCommands = (MeshLibrary::DRAW_COMMAND*)block.pData;
+	for (size_t i = 0; i < frame.drawBatches.size(); i++)
+	{
+		const DRAW_BATCH& batch = frame.drawBatches[i];
+		m_meshLibrary.GetDrawCommand(batch.meshID, batch.instanceCount,
+			frame.firstStreamedInstance + (GLuint)batch.firstInstance, pCommands[i]);
+	}
+	m_commandStream.Commit(block);
+	outOffset = block.offset;
+	return(true);
+}
+
+/***********************************************************
+ *  DrawBatches()
+ *
+ *  This method is used for drawing the batches in sorted
+ *  order, changing the pass, texture array and material only
+ *  when they differ from the previous batch.  The arrays
+ *  stay bound, so changing the texture only selects another
+ *  unit.  The transparent pass is drawn without writing
+ *  depth, so transparent objects behind each other all
+ *  blend, and with back faces culled, so an object does not
+ *  blend over itself.  The instances are read from the block
+ *  they were streamed into.
+ *
+ *  With multi-draw indirect the draws are written into the
+ *  draw command ring, and every run of batches between state
+ *  changes is submitted in one draw call, so the draw calls
+ *  follow the state changes rather than the meshes drawn.
+ ***********************************************************/
+void SceneManager::DrawBatches(int frameIndex)
+{
+	PROFILE_GPU_ZONE("DrawBatches");
+
+	FRAME_DATA& frame = m_frames[frameIndex];
+	GLuint firstFrameInstance = frame.firstStreamedInstance;
+	int currentPass = -1;
+	int currentTexture = -2;
+	int currentMaterial = -2;
+
+	GLintptr commandOffset = 0;
+	bool bMultiDraw = StreamDrawCommands(frameIndex, commandOffset);
+	size_t firstRunBatch = 0;
+
+	m_meshLibrary.Bind();
+	if (bMultiDraw == true)
+	{
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandStream.GetBuffer());
+	}
+	for (size_t i = 0; i < frame.drawBatches.size(); i++)
+	{
+		const DRAW_BATCH& batch = frame.drawBatches[i];
+
+		// draw the run of batches before the state changes
+		bool bStateChanges = (batch.pass != currentPass) ||
+			(batch.textureArray != currentTexture) || (batch.materialIndex != currentMaterial);
+		if ((bMultiDraw == true) && (bStateChanges == true) && (i > firstRunBatch))
+		{
+			m_meshLibrary.MultiDrawIndirect(commandOffset + sizeof(MeshLibrary::DRAW_COMMAND) * firstRunBatch,
+				(GLsizei)(i - firstRunBatch));
+			frame.renderStats.drawCalls++;
+			firstRunBatch = i;
+		}
+
+		if (batch.pass != currentPass)
+		{
+			// transparent objects show only their front faces, or the
+			// back faces blend over the front ones in index order
+			if (batch.pass == RenderQueue::PASS_TRANSPARENT)
+			{
+				glDepthMask(GL_FALSE);
+				glEnable(GL_CULL_FACE);
+			}
+			else
+			{
+				glDepthMask(GL_TRUE);
+				glDisable(GL_CULL_FACE);
+			}
+			currentPass = batch.pass;
+			frame.renderStats.passChanges++;
+		}
+		if (batch.textureArray != currentTexture)
+		{
+			// the instance colors are used without a texture, or
+			// while its image is still loading
+			SetShaderTexture(batch.textureArray);
+			currentTexture = batch.textureArray;
+			frame.renderStats.textureChanges++;
+		}
+		if (batch.materialIndex != currentMaterial)
+		{
+			SetShaderMaterial(batch.materialIndex);
+			currentMaterial = batch.materialIndex;
+			frame.renderStats.materialChanges++;
+		}
+
+		if (bMultiDraw == false)
+		{
+			m_meshLibrary.DrawInstanced(batch.meshID, batch.instanceCount, firstFrameInstance + (GLuint)batch.firstInstance);
+			frame.renderStats.drawCalls++;
+		}
+		frame.renderStats.drawCommands++;
+	}
+	if ((bMultiDraw == true) && (frame.drawBatches.size() > firstRunBatch))
+	{
+		m_meshLibrary.MultiDrawIndirect(commandOffset + sizeof(MeshLibrary::DRAW_COMMAND) * firstRunBatch,
+			(GLsizei)(frame.drawBatches.size() - firstRunBatch));
+		frame.renderStats.drawCalls++;
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	glDepthMask(GL_TRUE);
+	glDisable(GL_CULL_FACE);
+	glBindVertexArray(0);
+}
+
 void SceneManager::PrepareScene()
+{
+	PrepareSceneAssets();
+
+	// the objects are loaded after the textures and materials
+	// so their tags can be resolved
+	LoadSceneObjects(g_SceneFilename, g_CompiledSceneFilename);
+	CreateInstanceBuffer();
+
+	// build the bounding volume hierarchy over the loaded objects
+	RefreshBounds();
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene with the
+ *  objects of a scene description built in code, such as a
+ *  generated benchmark scene, instead of the scene files.
+ ***********************************************************/
+void SceneManager::PrepareScene(const SceneDescription& scene)
+{
+	PrepareSceneAssets();
+
+	CreateSceneObjects(scene);
+	CreateInstanceBuffer();
+	RefreshBounds();
+}
+
+/***********************************************************
+ *  PrepareSceneAssets()
+ *
+ *  This method is used for loading the textures, materials,
+ *  lights and meshes the scene objects refer to.
+ ***********************************************************/
+void SceneManager::PrepareSceneAssets()
 {
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
 	// in the rendered 3D scene
+	// the shaders are loaded by now, so the uniforms can be resolved
+	m_uniformCache.Initialize();
+
 	LoadSceneTextures();
 	DefineObjectMaterials();
+	RegisterMaterialTags();
+	CreateMaterialBuffer();
 	SetupSceneLights();
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadTaperedCylinderMesh();
-	m_basicMeshes->LoadTorusMesh();
-	m_basicMeshes->LoadBoxMesh();
-
+	m_meshLibrary.Create();
 }
 
 /***********************************************************
  *  RenderScene()
  *
  *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  transforming and drawing the loaded scene objects.  The
+ *  objects are sorted through the render queue and drawn as
+ *  instanced batches, with the model matrix and color of
+ *  each object read from the instance buffer.
+ *
+ *  When pipelined, the frame for the current camera is
+ *  recorded on the job threads while this thread submits
+ *  the frame recorded by the last call, and is left
+ *  recording when this returns, so the CPU work of a frame
+ *  overlaps the submitting and presenting of the one before
+ *  it.  The frames drawn are one behind the camera.  The
+ *  first call has no frame recorded ahead, so it records and
+ *  draws the frame for the current camera itself.
  ***********************************************************/
 void SceneManager::RenderScene()
 {
-	RenderBackground();
-	RenderSharpie();
-	RenderCup();
-	RenderRuler();
-	RenderBattery();
-}
-
-void SceneManager::RenderSharpie()
-{
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	scaleXYZ = glm::vec3(0.6f, 5.5f, 1.0f); //scale for sharpie base
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 30.0f; //rotate the sharpie 30 degree
-	positionXYZ = glm::vec3(0.0f, 0.2f, 1.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderTexture("sharpie");
-	SetShaderMaterial("plastic");
-
-	m_basicMeshes->DrawCylinderMesh(); //draw the base of the sharpie
-
-	scaleXYZ = glm::vec3(0.5f, 1.6f, 1.0f); //scale for the blue part
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 30.0f; //rotate the sharpie 30 degree
-	positionXYZ = glm::vec3(-2.73f, 4.95f, 1.0f); //set pos
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0, 0.282, 0.78, 1); //blue for the body
-	SetShaderMaterial("plastic");
-	m_basicMeshes->DrawCylinderMesh(); //draw the cylinder tip
-
-	scaleXYZ = glm::vec3(0.5f, .6f, 1.0f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 30.0f; //rotate the sharpie 30 degree
-	positionXYZ = glm::vec3(-3.5f, 6.3f, 1.0f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0, 0.282, 0.78, 1); //same blue
-	SetShaderMaterial("plastic");
-	m_basicMeshes->DrawTaperedCylinderMesh(); //draw
-
-
-	scaleXYZ = glm::vec3(.2f, 0.5f, .3f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 00.0f;
-	ZrotationDegrees = 30.0f; //rotate the sharpie 30 degree
-	positionXYZ = glm::vec3(-3.8f, 6.8f, 1.0f); //set pos
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.165, 0.188, 0.282, 1); //dark blue for tip
-	SetShaderMaterial("felt_wool");
-	m_basicMeshes->DrawConeMesh(); //draw the shape
-}
-
-void SceneManager::RenderBackground()
-{
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 10.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, -0.1f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.859, 0.627, 0.196, 1); //set color to yellow
-	SetShaderMaterial("leather");
-
-	m_basicMeshes->DrawPlaneMesh();
-}
-
-void SceneManager::RenderCup()
-{
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	scaleXYZ = glm::vec3(2.6f, 5.5f, 1.0f); 
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f; 
-	positionXYZ = glm::vec3(-6.2f, 0.0f, 0.8f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderTexture("starbucks");
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawCylinderMesh(); //draw cup base
-
-
-	scaleXYZ = glm::vec3(2.0f, 2.0f, 1.0f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = -90.0f;
-	positionXYZ = glm::vec3(-4.0f, 3.0f, 0.8f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(1, 1, 1, 1);
-	SetShaderMaterial("glass"); 
-	m_basicMeshes->DrawHalfTorusMesh();
-
-
-	scaleXYZ = glm::vec3(2.6f, 0.1f, 1.0f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(-6.2f, 5.5f, 0.8f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(1, 1, 1, 1);
-	m_basicMeshes->DrawCylinderMesh();
-}
-
-void SceneManager::RenderRuler()
-{
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	scaleXYZ = glm::vec3(18.0f, 1.5f, 0.2f);
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = -5.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(-1.2f, 0.8f, 2.2f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderTexture("ruler");
-	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
-
-
-	scaleXYZ = glm::vec3(0.25f, 0.0f, .25f);
-	XrotationDegrees = 90.0f;
-	YrotationDegrees = -5.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(-2.4f, 0.9f, 2.25f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.929, 0.659, 0.161, 1);
-	SetShaderMaterial("leather");
-
-	m_basicMeshes->DrawCylinderMesh();
-
-
-	scaleXYZ = glm::vec3(0.27f, 0.0f, .27f);
-	XrotationDegrees = 91.0f;
-	YrotationDegrees = -5.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(-9.4f,0.95f, 1.7f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.929, 0.659, 0.161, 1);
-	SetShaderMaterial("leather");
-
-	m_basicMeshes->DrawCylinderMesh();
-
-	scaleXYZ = glm::vec3(0.22f, 0.0f, .22f);
-	XrotationDegrees = 91.0f;
-	YrotationDegrees = -5.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(-8.0f, 0.9f, 1.75f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.929, 0.659, 0.161, 1);
-	SetShaderMaterial("leather");
-
-	m_basicMeshes->DrawCylinderMesh();
-
-
-	scaleXYZ = glm::vec3(0.22f, 0.0f, .22f);
-	XrotationDegrees = 91.0f;
-	YrotationDegrees = -5.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(5.0f, 0.9f, 2.87f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.929, 0.659, 0.161, 1);
-	SetShaderMaterial("leather");
-
-	m_basicMeshes->DrawCylinderMesh();
-}
-
-void SceneManager::RenderBattery()
-{
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	scaleXYZ = glm::vec3(.5f, .1f, .5f);
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(1.2f, 0.0f, 3.2f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.22, 0.941, 0.157, 1);
-	SetShaderMaterial("matte");
-	m_basicMeshes->DrawCylinderMesh();
-
-
-	scaleXYZ = glm::vec3(.5f, 2.1f, .5f);
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(1.2f, 0.1f, 3.2f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0, 0, 0, 1);
-	SetShaderMaterial("matte");
-	m_basicMeshes->DrawCylinderMesh();
-
-	scaleXYZ = glm::vec3(.5f, .1f, .5f);
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(1.2f, 2.2f, 3.2f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.22, 0.941, 0.157, 1);
-	SetShaderMaterial("matte");
-	m_basicMeshes->DrawCylinderMesh();
-
-
-	scaleXYZ = glm::vec3(.2f, .1f, .2f);
-
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-	positionXYZ = glm::vec3(1.2f, 2.3f, 3.2f);
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderColor(0.667, 0.663, 0.678, 1);
-	SetShaderMaterial("metal");
-	m_basicMeshes->DrawCylinderMesh();
-
-}
\ No newline at end of file
+	PROFILE_GPU_ZONE("RenderScene");
+
+	if (m_bPipelined == false)
+	{
+		RecordScene();
+		SubmitScene();
+		return;
+	}
+
+	FinishRecording();
+
+	// the recorded frame is recorded again, with its camera, if
+	// the texture layers it was recorded with moved
+	UpdateTextures(g_MaxTextureUploadsPerFrame);
+	if ((m_recordedFrame >= 0) && (m_frames[m_recordedFrame].bInstancesFilled == false))
+	{
+		RecordFrame(m_frames[m_recordedFrame]);
+	}
+	else if (m_recordedFrame < 0)
+	{
+		int firstFrameIndex = BeginFrame();
+		RecordFrame(m_frames[firstFrameIndex]);
+		m_recordedFrame = firstFrameIndex;
+	}
+
+	int frameIndex = BeginFrame();
+	m_frames[frameIndex].bPipelined = true;
+	m_recordingFrame = frameIndex;
+	m_pRecordJob = m_pJobSystem->CreateJob([this, frameIndex]()
+		{
+			RecordFrame(m_frames[frameIndex]);
+		}, NULL);
+	m_pJobSystem->Run(m_pRecordJob);
+
+	if (m_recordedFrame >= 0)
+	{
+		SubmitFrame(m_recordedFrame);
+		m_recordedFrame = -1;
+	}
+}
+
+/***********************************************************
+ *  RecordScene()
+ *
+ *  This method is used for the CPU side of rendering a
+ *  frame - rebuilding the moved model matrices, culling and
+ *  queueing the scene objects, merging their draws into
+ *  batches and filling the instances - with the objects and
+ *  instances split into chunks across the job threads.
+ *  The recorded frame is drawn by SubmitScene().
+ ***********************************************************/
+void SceneManager::RecordScene()
+{
+	PROFILE_ZONE("RecordScene");
+
+	FinishRecording();
+
+	// bring in the texture images that finished decoding
+	UpdateTextures(g_MaxTextureUploadsPerFrame);
+
+	int frameIndex = BeginFrame();
+	RecordFrame(m_frames[frameIndex]);
+	m_recordedFrame = frameIndex;
+	m_renderStats = m_frames[frameIndex].renderStats;
+}
+
+/***********************************************************
+ *  SubmitScene()
+ *
+ *  This method is used for replaying the frame recorded by
+ *  RecordScene() on the rendering thread - sending the
+ *  changed lights and instances and drawing the batches.
+ ***********************************************************/
+void SceneManager::SubmitScene()
+{
+	FinishRecording();
+	if (m_recordedFrame >= 0)
+	{
+		SubmitFrame(m_recordedFrame);
+		m_recordedFrame = -1;
+	}
+}
+
+/***********************************************************
+ *  SetPipelined()
+ *
+ *  This method is used for turning pipelined rendering on or
+ *  off.  The frame recorded ahead is kept and drawn by the
+ *  next call of RenderScene() either way.
+ ***********************************************************/
+void SceneManager::SetPipelined(bool bPipelined)
+{
+	FinishRecording();
+	m_bPipelined = bPipelined;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for taking the next frame of the ring
+ *  of frames in flight for recording, with the camera, the
+ *  culling switch and the viewport of the rendering thread,
+ *  so the frame can be recorded on any thread.
+ ***********************************************************/
+int SceneManager::BeginFrame()
+{
+	int frameIndex = m_nextFrame;
+	m_nextFrame = (m_nextFrame + 1) % (int)m_frames.size();
+
+	FRAME_DATA& frame = m_frames[frameIndex];
+	frame.viewMatrix = m_viewMatrix;
+	frame.projectionMatrix = m_projectionMatrix;
+	frame.bHasCameraView = m_bHasCameraView;
+	frame.bCullingEnabled = m_bCullingEnabled;
+	frame.bPipelined = false;
+
+	GLint viewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	frame.viewportHeight = viewport[3];
+
+	return(frameIndex);
+}
+
+/***********************************************************
+ *  RecordFrame()
+ *
+ *  This method is used for recording the draws of a frame
+ *  taken by BeginFrame().  It makes no OpenGL calls, so it
+ *  runs on whichever thread takes the record job, while the
+ *  rendering thread submits the frame before it.  Only one
+ *  frame is recorded at a time.
+ ***********************************************************/
+void SceneManager::RecordFrame(FRAME_DATA& frame)
+{
+	PROFILE_ZONE("RecordFrame");
+
+	// rebuild only the model matrices of objects that moved
+	{
+		PROFILE_ZONE("UpdateTransforms");
+		m_transforms.Update(m_pJobSystem);
+	}
+
+	frame.renderStats = RENDER_STATS();
+	QueueSceneObjects(frame);
+	BuildDrawBatches(frame);
+
+	// fill the instances again only when an object moved or
+	// the drawing order changed since the frame was recorded
+	if ((frame.bInstancesFilled == false) || (m_transforms.GetRecomputeCount() != frame.filledRecomputeCount))
+	{
+		FillInstanceData(frame);
+	}
+}
+
+/***********************************************************
+ *  FinishRecording()
+ *
+ *  This method is used for waiting for the frame being
+ *  recorded on the job threads, running jobs meanwhile,
+ *  before the rendering thread reads or changes the scene.
+ ***********************************************************/
+void SceneManager::FinishRecording()
+{
+	if (NULL == m_pRecordJob)
+	{
+		return;
+	}
+
+	PROFILE_ZONE("FinishRecording");
+	m_pJobSystem->Wait(m_pRecordJob);
+	m_pRecordJob = NULL;
+	m_recordedFrame = m_recordingFrame;
+	m_recordingFrame = -1;
+}
+
+/***********************************************************
+ *  SubmitFrame()
+ *
+ *  This method is used for drawing a recorded frame - with
+ *  its own camera when it was recorded ahead of the one in
+ *  the shader - and ending the frame of the instance ring,
+ *  which fences the block of its instances.
+ ***********************************************************/
+void SceneManager::SubmitFrame(int frameIndex)
+{
+	PROFILE_GPU_ZONE("SubmitScene");
+
+	FRAME_DATA& frame = m_frames[frameIndex];
+	if ((frame.bPipelined == true) && (frame.bHasCameraView == true) && (NULL != m_pShaderManager))
+	{
+		m_pShaderManager->setMat4Value("view", frame.viewMatrix);
+		m_pShaderManager->setMat4Value("projection", frame.projectionMatrix);
+		m_pShaderManager->setVec3Value("viewPosition", glm::vec3(glm::inverse(frame.viewMatrix)[3]));
+	}
+
+	m_uniformCache.ResetCounters();
+
+	// send only the lights that were added, moved or removed
+	{
+		PROFILE_GPU_ZONE("UpdateLights");
+		m_lightManager.Update();
+		m_uniformCache.SetInt(UniformCache::UNIFORM_LIGHT_COUNT, m_lightManager.GetLightCount());
+	}
+
+	StreamInstances(frameIndex);
+	DrawBatches(frameIndex);
+	m_instanceStream.EndFrame();
+	m_commandStream.EndFrame();
+
+	frame.renderStats.uniformUploads = (int)m_uniformCache.GetUploadsIssued();
+	frame.renderStats.uniformUploadsSkipped = (int)m_uniformCache.GetUploadsSkipped();
+	m_renderStats = frame.renderStats;
+}
+
+/***********************************************************
+ *  SetCameraView()
+ *
+ *  This method is used for setting the view and projection
+ *  matrices of the camera, which the draws are culled and
+ *  sorted by depth with.
+ ***********************************************************/
+void SceneManager::SetCameraView(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+{
+	m_viewMatrix = viewMatrix;
+	m_projectionMatrix = projectionMatrix;
+	m_bHasCameraView = true;
+}
+
+/***********************************************************
+ *  PickObject()
+ *
+ *  This method is used for finding the scene object under a
+ *  ray, such as one cast from the camera through the mouse
+ *  cursor.  The nearest object whose bounding box the ray
+ *  hits is returned.
+ ***********************************************************/
+int SceneManager::PickObject(const glm::vec3& origin, const glm::vec3& direction)
+{
+	if (m_sceneObjects.empty())
+	{
+		return(-1);
+	}
+
+	FinishRecording();
+	m_transforms.Update(m_pJobSystem);
+	RefreshBounds();
+
+	float distance = 0.0f;
+	return(m_bvh.Raycast(origin, direction, g_MaxPickDistance, distance));
+}
+
+/***********************************************************
+ *  GetSceneBounds()
+ *
+ *  This method is used for getting the box around all the
+ *  scene objects where they are now.
+ ***********************************************************/
+bool SceneManager::GetSceneBounds(glm::vec3& outMin, glm::vec3& outMax)
+{
+	FinishRecording();
+	m_transforms.Update(m_pJobSystem);
+	RefreshBounds();
+
+	return(m_bvh.GetBounds(outMin, outMax));
+}
+
+/***********************************************************
+ *  SetObjectTransform()
+ *
+ *  This method is used for moving a loaded scene object.
+ *  The model matrix of the object is rebuilt once, the next
+ *  time the scene is rendered.
+ ***********************************************************/
+void SceneManager::SetObjectTransform(
+	int objectIndex,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegreesXYZ,
+	glm::vec3 positionXYZ)
+{
+	FinishRecording();
+	m_transforms.SetTransform(objectIndex, scaleXYZ, rotationDegreesXYZ, positionXYZ);
+}
+
+/***********************************************************
+ *  GetTextureStreamer()
+ *
+ *  This method is used for getting the texture streamer,
+ *  once the frame being recorded is done marking the
+ *  textures it draws.
+ ***********************************************************/
+TextureStreamer& SceneManager::GetTextureStreamer()
+{
+	FinishRecording();
+	return(m_textureStreamer);
+}
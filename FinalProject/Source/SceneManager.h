@@ -10,7 +10,18 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "SceneDescription.h"
+#include "MeshLibrary.h"
+#include "TransformCache.h"
+#include "UniformCache.h"
+#include "NameRegistry.h"
+#include "LightManager.h"
+#include "RenderQueue.h"
+#include "CullingKernels.h"
+#include "StreamingBuffer.h"
+#include "SceneBVH.h"
+#include "TextureStreamer.h"
+#include "JobSystem.h"
 
 #include <string>
 #include <vector>
@@ -25,14 +36,13 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderManager *pShaderManager, JobSystem* pJobSystem);
 	// destructor
 	~SceneManager();
 
 	struct TEXTURE_INFO
 	{
 		std::string tag;
-		uint32_t ID;
 	};
 
 	struct OBJECT_MATERIAL
@@ -43,51 +53,224 @@ public:
 		glm::vec3 specularColor;
 		float shininess;
 		std::string tag;
+		// alpha the material multiplies the object color with,
+		// below 1 for objects drawn in the transparent pass,
+		// back to front
+		float opacity = 1.0f;
+	};
+
+	// one object of the loaded scene, with its mesh, material
+	// and texture already resolved - the transform of the object
+	// is kept at the same index in the transform cache
+	struct SCENE_OBJECT
+	{
+		int meshID;
+		int materialIndex;
+		// texture slot, -1 when the object is drawn with its color
+		int textureSlot;
+		glm::vec4 color;
+		// drawn in the transparent pass
+		bool bTransparent;
+	};
+
+	// run of scene objects that share mesh, material and texture
+	// array, drawn as a single instanced draw
+	struct DRAW_BATCH
+	{
+		RenderQueue::PASS pass;
+		int meshID;
+		int materialIndex;
+		// -1 for objects drawn with their color
+		int textureArray;
+		int firstInstance;
+		int instanceCount;
+	};
+
+	// draw calls and state changes of a rendered frame
+	struct RENDER_STATS
+	{
+		int visibleObjects;
+		int culledObjects;
+		// draw calls, and the draws of batches they submitted,
+		// many to a call with multi-draw indirect
+		int drawCalls;
+		int drawCommands;
+		int passChanges;
+		int textureChanges;
+		int materialChanges;
+		// uniform uploads sent, and skipped as unchanged
+		int uniformUploads;
+		int uniformUploadsSkipped;
 	};
 
 private:
+	// one frame in flight - frames are recorded on the job
+	// threads while the frame before them is submitted, so each
+	// keeps its own camera, draws and instances
+	struct FRAME_DATA
+	{
+		// camera, culling and viewport height the frame is
+		// recorded with, taken on the rendering thread
+		glm::mat4 viewMatrix;
+		glm::mat4 projectionMatrix;
+		bool bHasCameraView;
+		bool bCullingEnabled;
+		int viewportHeight;
+		// recorded ahead of the camera, so the frame sets its own
+		// camera into the shader when it is submitted
+		bool bPipelined;
+		// instanced draw batches, and the scene object drawn by
+		// every instance in batch order
+		std::vector<DRAW_BATCH> drawBatches;
+		std::vector<int> instanceObjects;
+		// per-instance model matrix, color and texture layer, in
+		// instance order
+		std::vector<MeshLibrary::INSTANCE_DATA> instanceData;
+		// transform recompute count when the instances were filled,
+		// and whether they are still filled for the objects
+		unsigned int filledRecomputeCount;
+		bool bInstancesFilled;
+		// first instance of the block the instances were streamed
+		// into when the frame was submitted
+		GLuint firstStreamedInstance;
+		RENDER_STATS renderStats;
+	};
+
+	// view the draws of a frame are recorded for
+	struct RECORD_VIEW
+	{
+		CullingKernels::FRUSTUM frustum;
+		glm::mat4 viewMatrix;
+		bool bHasCameraView;
+		bool bCullingEnabled;
+		// test the bounding spheres while recording, when the
+		// hierarchy did not already flag the visible objects
+		bool bCullSpheres;
+		// pixels per unit of size at unit depth
+		float pixelScale;
+		bool bOrthographic;
+	};
+
+	// draws and texture sizes recorded from one chunk of the
+	// scene objects, by whichever thread took the chunk
+	struct RECORD_CHUNK
+	{
+		RenderQueue queue;
+		// largest size on screen of every texture slot drawn,
+		// negative for the slots the chunk did not draw
+		std::vector<float> textureSizes;
+		int visibleObjects;
+	};
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
+	// basic shape meshes in shared buffers, drawn instanced
+	MeshLibrary m_meshLibrary;
+	// loaded textures info, indexed by texture slot, which is
+	// also the index of the texture in the texture streamer
+	std::vector<TEXTURE_INFO> m_textures;
+	// texture tags, registered with their texture slot as handle
+	NameRegistry m_textureRegistry;
+	// keeps the textures of the visible objects resident in
+	// texture arrays, within the texture memory budget
+	TextureStreamer m_textureStreamer;
+	size_t m_textureMemoryBudget;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// material tags, registered with their material index as handle
+	NameRegistry m_materialRegistry;
+	// uniform buffer holding all the defined materials
+	GLuint m_materialBuffer;
+	// light sources of the scene
+	LightManager m_lightManager;
+	// objects of the loaded scene, in drawing order
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	// cached model matrices of the scene objects
+	TransformCache m_transforms;
+	// shader uniforms resolved by ID with unchanged values skipped
+	UniformCache m_uniformCache;
+	// draws of the frame ordered by state and depth
+	RenderQueue m_renderQueue;
+	// job system of the application, which records the draws,
+	// fills the instances and decodes the textures
+	JobSystem* m_pJobSystem;
+	// draws of every chunk of the scene objects
+	std::vector<RECORD_CHUNK> m_recordChunks;
+	// frames in flight, the next one recorded into, the recorded
+	// one waiting to be submitted, -1 for none, and the one being
+	// recorded by the record job
+	std::vector<FRAME_DATA> m_frames;
+	int m_nextFrame;
+	int m_recordedFrame;
+	int m_recordingFrame;
+	JobSystem::JOB* m_pRecordJob;
+	// record the next frame while the last one is submitted
+	bool m_bPipelined;
+	// view and projection matrices of the camera for the next
+	// frame, for the depth of the draws and the view frustum
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	bool m_bHasCameraView;
+	// skip objects outside of the view frustum
+	bool m_bCullingEnabled;
+	// world space bounding spheres of the scene objects, one
+	// array per component for the culling kernels
+	std::vector<float> m_boundsCenterX;
+	std::vector<float> m_boundsCenterY;
+	std::vector<float> m_boundsCenterZ;
+	std::vector<float> m_boundsRadius;
+	// world space bounding boxes of the scene objects, and the
+	// hierarchy over them for culling large scenes and picking
+	std::vector<glm::vec3> m_boundsMin;
+	std::vector<glm::vec3> m_boundsMax;
+	SceneBVH m_bvh;
+	// transform recompute count when the bounds were updated
+	unsigned int m_boundsRecomputeCount;
+	bool m_bBoundsDirty;
+	// set for scene objects inside the view frustum
+	std::vector<unsigned char> m_visibleFlags;
+	// part of the scene objects visible in the last frame
+	float m_visibleRatio;
+	// scene objects in the order of the sorted render queue
+	std::vector<int> m_sortedObjects;
+	// ring the instances of every submitted frame are streamed
+	// through, and the instances of one frame it has room for
+	// while the frames before it are in flight
+	StreamingBuffer m_instanceStream;
+	int m_instanceCapacity;
+	// ring the indirect draws of every submitted frame are
+	// written into, and the draws of one frame it has room for
+	StreamingBuffer m_commandStream;
+	int m_commandCapacity;
+	// draw calls and state changes of the last rendered frame
+	RENDER_STATS m_renderStats;
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
-	// bind loaded OpenGL textures to slots in memory
+	// create a texture streamed in once an object is drawn with it
+	bool CreateGLTexture(const char* filename, const std::string& tag);
+	// upload the texture images loaded so far and request the
+	// ones the last frame needed
+	void UpdateTextures(int maxUploads);
+	// bind the texture arrays to their texture units
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const std::string& tag);
+	int FindTextureSlot(const std::string& tag);
+	// get the texture array holding the texture in a slot, -1
+	// for no slot or while the image is still loading
+	int GetTextureArray(int textureSlot) const { return (textureSlot >= 0) ? m_textureStreamer.GetArrayIndex(textureSlot) : -1; }
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
-
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
-
-	// set the color values into the shader
-	void SetShaderColor(
-		float redColorValue,
-		float greenColorValue,
-		float blueColorValue,
-		float alphaValue);
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const std::string& tag);
+	// register the tags of the defined materials
+	void RegisterMaterialTags();
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const std::string& textureTag);
+	void SetShaderTexture(
+		int textureArray);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -97,27 +280,124 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const std::string& materialTag);
+	void SetShaderMaterial(
+		int materialIndex);
 
 	void SetupSceneLights();
 
 	void DefineObjectMaterials();
 
+	// upload the defined materials into the material buffer
+	void CreateMaterialBuffer();
+
+	// load the textures, materials, lights and meshes
+	void PrepareSceneAssets();
+	// load the scene objects from the scene description files
+	bool LoadSceneObjects(
+		const char* sceneFilename,
+		const char* compiledFilename);
+	// create the scene objects of a scene description
+	void CreateSceneObjects(const SceneDescription& scene);
+
+	// create the buffer of per-instance values
+	void CreateInstanceBuffer();
+	// grow the instance ring to hold a number of instances in
+	// every frame in flight
+	void ReserveInstances(int instanceCount);
+	// grow the draw command ring to hold a number of draws in
+	// every frame in flight
+	void ReserveDrawCommands(int commandCount);
+	// mark the instances of every frame as needing to be filled
+	void InvalidateInstances();
+	// move the bounding volumes along with the scene objects
+	void UpdateBounds();
+	void UpdateObjectBounds(int firstObject, int objectCount);
+	// update the bounding volumes if any scene object moved
+	void RefreshBounds();
+	// take the next frame with the camera of the rendering
+	// thread, and get its index
+	int BeginFrame();
+	// record the draws of a frame, on any one thread
+	void RecordFrame(FRAME_DATA& frame);
+	// wait for the frame being recorded on the job threads
+	void FinishRecording();
+	// draw a recorded frame on the rendering thread
+	void SubmitFrame(int frameIndex);
+	// submit the scene objects to the render queue and sort it
+	void QueueSceneObjects(FRAME_DATA& frame);
+	// get the number of chunks to record a number of items in,
+	// each taken by one thread
+	int GetRecordChunkCount(int itemCount) const;
+	// record the draws of the visible objects of a chunk
+	void RecordSceneObjects(
+		int firstObject,
+		int objectCount,
+		const RECORD_VIEW& view,
+		RECORD_CHUNK& chunk);
+	// merge the sorted draws into instanced draw batches
+	void BuildDrawBatches(FRAME_DATA& frame);
+	// copy the model matrices and colors into the instances
+	void FillInstanceData(FRAME_DATA& frame);
+	// stream the filled instances of a frame into the next
+	// block of the instance ring
+	void StreamInstances(int frameIndex);
+	// write the draws of the batches of a frame into the next
+	// block of the draw command ring, false when they are drawn
+	// one call at a time instead
+	bool StreamDrawCommands(int frameIndex, GLintptr& outOffset);
+	// draw the batches, changing state only where it differs
+	void DrawBatches(int frameIndex);
+
 public:
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
 	void PrepareScene();
+	// prepare the scene with the objects of a scene description
+	// instead of the scene files
+	void PrepareScene(const SceneDescription& scene);
 	void RenderScene();
+	// record the draws of the frame on the job threads, and
+	// draw the recorded frame on the rendering thread, which
+	// together are RenderScene()
+	void RecordScene();
+	void SubmitScene();
+	// record the next frame on the job threads while the last
+	// one is submitted, a frame behind the camera
+	void SetPipelined(bool bPipelined);
+	bool IsPipelined() const { return m_bPipelined; }
 
-	void RenderSharpie();
-
-	void RenderBackground();
-
-	void RenderCup();
-
-	void RenderRuler();
+	// move a loaded scene object, its model matrix is rebuilt
+	// before the next frame is rendered
+	void SetObjectTransform(
+		int objectIndex,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegreesXYZ,
+		glm::vec3 positionXYZ);
 
-	void RenderBattery();
+	// get the uniform upload counters
+	const UniformCache& GetUniformCache() const { return m_uniformCache; }
+	// get the light sources, for adding, moving or removing lights
+	LightManager& GetLightManager() { return m_lightManager; }
+	// set the view and projection matrices of the camera for
+	// the next frame
+	void SetCameraView(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+	// turn view frustum culling on or off
+	void SetCullingEnabled(bool bEnabled) { m_bCullingEnabled = bEnabled; }
+	// get the nearest scene object whose bounds the ray hits,
+	// or -1 when it hits none
+	int PickObject(const glm::vec3& origin, const glm::vec3& direction);
+	// get the world space box around all the scene objects
+	bool GetSceneBounds(glm::vec3& outMin, glm::vec3& outMax);
+	// wait for every texture image to load and upload it
+	void FinishTextureLoads();
+	// limit the GPU memory of the textures in bytes, 0 for no
+	// limit, set before the scene is prepared
+	void SetTextureMemoryBudget(size_t budget) { m_textureMemoryBudget = budget; }
+	// get the texture streamer, for its memory and loading counters
+	TextureStreamer& GetTextureStreamer();
+	// get the draw calls and state changes of the last frame
+	const RENDER_STATS& GetRenderStats() const { return m_renderStats; }
 
 };
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include "StreamingBuffer.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// how long one wait for the GPU to pass a frame fence lasts
+	// before it is retried, in nanoseconds
+	const GLuint64 g_FenceWaitNanoseconds = 1000000000;
+	// the buffer is bound here while it is created, orphaned and
+	// mapped, leaving the vertex and element bindings alone
+	const GLenum g_StreamingTarget = GL_COPY_WRITE_BUFFER;
+	// flags of the buffer storage and of its one mapping
+	const GLbitfield g_PersistentFlags =
+		GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	// most frames fenced at once, beyond which the oldest is
+	// waited for when a frame ends
+	const int g_MaxFencedFrames = 8;
+}
+
+/***********************************************************
+ *  StreamingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StreamingBuffer::StreamingBuffer()
+{
+	m_buffer = 0;
+	m_capacity = 0;
+	m_bPersistent = false;
+	m_pMappedData = NULL;
+	m_head = 0;
+	m_tail = 0;
+	m_usedBytes = 0;
+	m_frameBytes = 0;
+	m_frames.resize(g_MaxFencedFrames);
+	m_firstFrame = 0;
+	m_fencedFrames = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~StreamingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StreamingBuffer::~StreamingBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the buffer of the ring.
+ *  When buffer storage is supported and bAllowPersistent is
+ *  set, the storage is made immutable and mapped once for
+ *  good, otherwise the buffer is a stream buffer that is
+ *  orphaned when the ring wraps.
+ ***********************************************************/
+bool StreamingBuffer::Create(GLsizeiptr capacity, bool bAllowPersistent)
+{
+	Destroy();
+
+	if (capacity <= 0)
+	{
+		std::cout << "Invalid streaming buffer capacity " << capacity << std::endl;
+		return(false);
+	}
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(g_StreamingTarget, m_buffer);
+
+	if ((bAllowPersistent == true) &&
+		((GLEW_VERSION_4_4) || (GLEW_ARB_buffer_storage)))
+	{
+		glBufferStorage(g_StreamingTarget, capacity, NULL, g_PersistentFlags);
+		m_pMappedData = (unsigned char*)glMapBufferRange(
+			g_StreamingTarget, 0, capacity, g_PersistentFlags);
+		if (m_pMappedData != NULL)
+		{
+			m_bPersistent = true;
+		}
+		else
+		{
+			// immutable storage cannot be orphaned, so a buffer that
+			// fails to map is replaced with a stream buffer
+			std::cout << "Could not map the streaming buffer persistently, orphaning it instead" << std::endl;
+			glDeleteBuffers(1, &m_buffer);
+			glGenBuffers(1, &m_buffer);
+			glBindBuffer(g_StreamingTarget, m_buffer);
+		}
+	}
+
+	if (m_bPersistent == false)
+	{
+		glBufferData(g_StreamingTarget, capacity, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(g_StreamingTarget, 0);
+
+	m_capacity = capacity;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the buffer and the fences
+ *  of the frames in flight.  The GPU keeps the memory of a
+ *  deleted buffer until it has finished reading it, so the
+ *  fences are not waited for.
+ ***********************************************************/
+void StreamingBuffer::Destroy()
+{
+	for (int i = 0; i < m_fencedFrames; i++)
+	{
+		glDeleteSync(m_frames[(m_firstFrame + i) % g_MaxFencedFrames].fence);
+	}
+	m_firstFrame = 0;
+	m_fencedFrames = 0;
+
+	if (m_buffer != 0)
+	{
+		if (m_pMappedData != NULL)
+		{
+			glBindBuffer(g_StreamingTarget, m_buffer);
+			glUnmapBuffer(g_StreamingTarget);
+			glBindBuffer(g_StreamingTarget, 0);
+		}
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	m_buffer = 0;
+	m_capacity = 0;
+	m_bPersistent = false;
+	m_pMappedData = NULL;
+	m_head = 0;
+	m_tail = 0;
+	m_usedBytes = 0;
+	m_frameBytes = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for getting the next block of the
+ *  ring.  A block that does not fit before the end of the
+ *  ring starts over at its beginning.  With buffer storage
+ *  the oldest frames are waited for until the block is clear
+ *  of everything the GPU may still read, and the block is
+ *  written through the persistent mapping.  Without it the
+ *  buffer is orphaned on the wrap, and the block is mapped
+ *  unsynchronized, since no draw has read it since.
+ ***********************************************************/
+bool StreamingBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment, ALLOCATION& outAllocation)
+{
+	outAllocation.pData = NULL;
+	outAllocation.offset = 0;
+	outAllocation.size = 0;
+
+	if ((m_buffer == 0) || (size <= 0) || (size > m_capacity) || (alignment <= 0))
+	{
+		return(false);
+	}
+
+	GLintptr offset = ((m_head + alignment - 1) / alignment) * alignment;
+	if (m_bPersistent == false)
+	{
+		if (offset + size > m_capacity)
+		{
+			glBindBuffer(g_StreamingTarget, m_buffer);
+			glBufferData(g_StreamingTarget, m_capacity, NULL, GL_STREAM_DRAW);
+			glBindBuffer(g_StreamingTarget, 0);
+			offset = 0;
+			m_stats.orphans++;
+		}
+
+		glBindBuffer(g_StreamingTarget, m_buffer);
+		outAllocation.pData = glMapBufferRange(g_StreamingTarget, offset, size,
+			GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		glBindBuffer(g_StreamingTarget, 0);
+		if (outAllocation.pData == NULL)
+		{
+			return(false);
+		}
+
+		m_head = offset + size;
+		m_frameBytes += size;
+	}
+	else
+	{
+		bool bWaited = false;
+		while (true)
+		{
+			// nothing in use lets the ring start over, which keeps a
+			// block from being split needlessly at the end
+			if (m_usedBytes == 0)
+			{
+				m_head = 0;
+				m_tail = 0;
+			}
+
+			offset = ((m_head + alignment - 1) / alignment) * alignment;
+			GLsizeiptr consumed = 0;
+			bool bFits = false;
+			if ((m_head > m_tail) || ((m_head == m_tail) && (m_usedBytes == 0)))
+			{
+				if (offset + size <= m_capacity)
+				{
+					bFits = true;
+					consumed = offset + size - m_head;
+				}
+				else if (size <= m_tail)
+				{
+					// the bytes passed over at the end stay in use until the
+					// frame is retired
+					offset = 0;
+					bFits = true;
+					consumed = m_capacity - m_head + size;
+				}
+			}
+			else if ((m_head < m_tail) && (offset + size <= m_tail))
+			{
+				bFits = true;
+				consumed = offset + size - m_head;
+			}
+
+			if (bFits == true)
+			{
+				m_head = offset + size;
+				m_usedBytes += consumed;
+				m_frameBytes += consumed;
+				break;
+			}
+
+			// the blocks of the current frame fill the ring on their own
+			if (m_fencedFrames == 0)
+			{
+				return(false);
+			}
+			if (RetireOldestFrame() == true)
+			{
+				bWaited = true;
+			}
+		}
+
+		if (bWaited == true)
+		{
+			m_stats.fenceWaits++;
+		}
+		outAllocation.pData = m_pMappedData + offset;
+	}
+
+	outAllocation.offset = offset;
+	outAllocation.size = size;
+	m_stats.streamedBytes += (unsigned long long)size;
+	return(true);
+}
+
+/***********************************************************
+ *  Commit()
+ *
+ *  This method is used for finishing the writes to a block.
+ *  A coherent persistent mapping makes them visible to the
+ *  commands issued after it on its own, while a block mapped
+ *  without buffer storage is unmapped here.
+ ***********************************************************/
+void StreamingBuffer::Commit(const ALLOCATION& allocation)
+{
+	if ((m_bPersistent == true) || (allocation.pData == NULL))
+	{
+		return;
+	}
+
+	glBindBuffer(g_StreamingTarget, m_buffer);
+	glUnmapBuffer(g_StreamingTarget);
+	glBindBuffer(g_StreamingTarget, 0);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the blocks handed out
+ *  since the last frame ended, after the draws reading them
+ *  have been issued.  With the most frames already fenced,
+ *  the oldest one is waited for first.
+ ***********************************************************/
+void StreamingBuffer::EndFrame()
+{
+	if ((m_bPersistent == true) && (m_frameBytes > 0))
+	{
+		if ((m_fencedFrames == g_MaxFencedFrames) && (RetireOldestFrame() == true))
+		{
+			m_stats.fenceWaits++;
+		}
+
+		FRAME_RANGE& frameRange = m_frames[(m_firstFrame + m_fencedFrames) % g_MaxFencedFrames];
+		frameRange.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		frameRange.end = m_head;
+		frameRange.size = m_frameBytes;
+		m_fencedFrames++;
+	}
+
+	m_frameBytes = 0;
+	m_stats.frames++;
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used for clearing the streaming counters.
+ ***********************************************************/
+void StreamingBuffer::ResetStats()
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  RetireOldestFrame()
+ *
+ *  This method is used for waiting for the GPU to pass the
+ *  fence of the oldest frame in flight, then giving the
+ *  bytes of its blocks back to the ring.  It returns true
+ *  when the GPU had not passed the fence yet.
+ ***********************************************************/
+bool StreamingBuffer::RetireOldestFrame()
+{
+	FRAME_RANGE& frameRange = m_frames[m_firstFrame];
+
+	GLenum waitResult = glClientWaitSync(frameRange.fence, 0, 0);
+	bool bWaited = (waitResult == GL_TIMEOUT_EXPIRED);
+	while (waitResult == GL_TIMEOUT_EXPIRED)
+	{
+		waitResult = glClientWaitSync(frameRange.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceWaitNanoseconds);
+	}
+	glDeleteSync(frameRange.fence);
+
+	m_tail = frameRange.end;
+	m_usedBytes -= frameRange.size;
+	m_firstFrame = (m_firstFrame + 1) % g_MaxFencedFrames;
+	m_fencedFrames--;
+	return(bWaited);
+}
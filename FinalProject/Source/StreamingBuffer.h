@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// streamingbuffer.h
+// ============
+// stream per-frame data to the GPU through a ring of mapped buffer memory
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  StreamingBuffer
+ *
+ *  This class hands out blocks of a ring buffer for data
+ *  written once per frame, such as the instances of the
+ *  drawn objects.  With ARB_buffer_storage the buffer is
+ *  mapped once, persistently and coherently, so a block is
+ *  written straight into memory the GPU reads, without a
+ *  driver call per upload.  The blocks of a frame are fenced
+ *  when the frame ends, and the ring only wraps onto them
+ *  once the GPU has passed the fence.
+ *
+ *  Without buffer storage the buffer is orphaned whenever
+ *  the ring wraps, which gives it new memory while the GPU
+ *  still reads the old, and every block is mapped
+ *  unsynchronized until it is committed.
+ *
+ *  The blocks are handed out and committed on the thread
+ *  the OpenGL context is current on.
+ ***********************************************************/
+class StreamingBuffer
+{
+public:
+	// constructor
+	StreamingBuffer();
+	// destructor
+	~StreamingBuffer();
+
+	// block of the ring, written through the pointer until it
+	// is committed
+	struct ALLOCATION
+	{
+		void* pData;
+		GLintptr offset;
+		GLsizeiptr size;
+	};
+
+	// streaming counters
+	struct STREAMING_STATS
+	{
+		// bytes handed out, and frames ended
+		unsigned long long streamedBytes;
+		unsigned int frames;
+		// blocks and frame ends that waited for the GPU to pass a
+		// fence, and orphanings of the buffer without buffer
+		// storage
+		unsigned int fenceWaits;
+		unsigned int orphans;
+	};
+
+	// create the ring with a capacity in bytes, mapped
+	// persistently when supported and allowed
+	bool Create(GLsizeiptr capacity, bool bAllowPersistent);
+	// free the buffer and the fences
+	void Destroy();
+
+	// get a block whose offset is a multiple of the alignment,
+	// which need not be a power of two, false when the ring is
+	// too small for it
+	bool Allocate(GLsizeiptr size, GLsizeiptr alignment, ALLOCATION& outAllocation);
+	// finish writing a block, before drawing from it
+	void Commit(const ALLOCATION& allocation);
+	// fence the blocks of the frame, once its draws are submitted
+	void EndFrame();
+
+	// get the buffer, for binding it as a vertex or other buffer
+	GLuint GetBuffer() const { return m_buffer; }
+	GLsizeiptr GetCapacity() const { return m_capacity; }
+	// check whether the buffer is persistently mapped, rather
+	// than orphaned
+	bool IsPersistent() const { return m_bPersistent; }
+
+	// get the streaming counters
+	STREAMING_STATS GetStats() const { return m_stats; }
+	void ResetStats();
+
+private:
+	// blocks of one ended frame, from the end of the blocks of
+	// the frame before it, until the GPU passes the fence
+	struct FRAME_RANGE
+	{
+		GLsync fence;
+		GLintptr end;
+		GLsizeiptr size;
+	};
+
+	// wait for the GPU to pass the oldest fenced frame and free
+	// its blocks, true when it had to wait
+	bool RetireOldestFrame();
+
+	GLuint m_buffer;
+	GLsizeiptr m_capacity;
+	bool m_bPersistent;
+	// the whole buffer, mapped for good with buffer storage
+	unsigned char* m_pMappedData;
+	// next free byte, and the first byte still in use, with the
+	// bytes in use between them - passed over bytes at the end
+	// of the ring included - and the bytes of the current frame
+	GLintptr m_head;
+	GLintptr m_tail;
+	GLsizeiptr m_usedBytes;
+	GLsizeiptr m_frameBytes;
+	// ring of the fenced frames, from the oldest one, kept at
+	// its size so ending a frame allocates nothing
+	std::vector<FRAME_RANGE> m_frames;
+	int m_firstFrame;
+	int m_fencedFrames;
+	STREAMING_STATS m_stats;
+};
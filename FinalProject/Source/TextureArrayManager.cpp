@@ -0,0 +1,735 @@
+#include "TextureArrayManager.h"
+
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// most texture arrays, one per texture unit
+	const int g_MaxTextureArrays = 16;
+	// layers of a new array, doubled whenever it is full
+	const int g_InitialLayerCapacity = 4;
+	// size the fallback array resizes its textures to
+	const int g_FallbackTextureSize = 512;
+
+	/***********************************************************
+	 *  GetInternalFormat()
+	 *
+	 *  Get the OpenGL storage format of a texture layout.
+	 ***********************************************************/
+	GLenum GetInternalFormat(CompiledTexture::FORMAT format)
+	{
+		switch (format)
+		{
+		case CompiledTexture::FORMAT_RGB8:
+			return(GL_RGB8);
+		case CompiledTexture::FORMAT_RGBA8:
+			return(GL_RGBA8);
+		case CompiledTexture::FORMAT_BC1:
+			return(GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+		case CompiledTexture::FORMAT_BC3:
+			return(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+		}
+		return(GL_RGBA8);
+	}
+
+	/***********************************************************
+	 *  GetFormatName()
+	 *
+	 *  Get the name of a texture layout for the memory report.
+	 ***********************************************************/
+	const char* GetFormatName(CompiledTexture::FORMAT format)
+	{
+		switch (format)
+		{
+		case CompiledTexture::FORMAT_RGB8:
+			return("RGB8");
+		case CompiledTexture::FORMAT_RGBA8:
+			return("RGBA8");
+		case CompiledTexture::FORMAT_BC1:
+			return("BC1");
+		case CompiledTexture::FORMAT_BC3:
+			return("BC3");
+		}
+		return("unknown");
+	}
+
+	/***********************************************************
+	 *  GetLayerSize()
+	 *
+	 *  Get the size of a mip chain in bytes, with block
+	 *  compressed levels stored as whole 4x4 blocks.
+	 ***********************************************************/
+	size_t GetLayerSize(int width, int height, CompiledTexture::FORMAT format, int mipCount)
+	{
+		size_t layerSize = 0;
+		for (int level = 0; level < mipCount; level++)
+		{
+			size_t levelWidth = std::max(width >> level, 1);
+			size_t levelHeight = std::max(height >> level, 1);
+			switch (format)
+			{
+			case CompiledTexture::FORMAT_RGB8:
+				layerSize += levelWidth * levelHeight * 3;
+				break;
+			case CompiledTexture::FORMAT_RGBA8:
+				layerSize += levelWidth * levelHeight * 4;
+				break;
+			case CompiledTexture::FORMAT_BC1:
+				layerSize += ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * 8;
+				break;
+			case CompiledTexture::FORMAT_BC3:
+				layerSize += ((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * 16;
+				break;
+			}
+		}
+		return(layerSize);
+	}
+
+	/***********************************************************
+	 *  SetArrayParameters()
+	 *
+	 *  Set the mapping parameters of the bound texture array.
+	 ***********************************************************/
+	void SetArrayParameters(int mipCount)
+	{
+		// set the texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// set texture filtering parameters
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mipCount - 1);
+	}
+
+	/***********************************************************
+	 *  ResizePixels()
+	 *
+	 *  Resize RGBA pixels with bilinear filtering.
+	 ***********************************************************/
+	void ResizePixels(
+		const std::vector<unsigned char>& pixels,
+		int width,
+		int height,
+		int newWidth,
+		int newHeight,
+		std::vector<unsigned char>& outPixels)
+	{
+		outPixels.resize((size_t)newWidth * newHeight * 4);
+		for (int y = 0; y < newHeight; y++)
+		{
+			// sample at the pixel centers
+			float sourceY = std::max((y + 0.5f) * height / newHeight - 0.5f, 0.0f);
+			int y0 = std::min((int)sourceY, height - 1);
+			int y1 = std::min(y0 + 1, height - 1);
+			float fy = sourceY - y0;
+
+			for (int x = 0; x < newWidth; x++)
+			{
+				float sourceX = std::max((x + 0.5f) * width / newWidth - 0.5f, 0.0f);
+				int x0 = std::min((int)sourceX, width - 1);
+				int x1 = std::min(x0 + 1, width - 1);
+				float fx = sourceX - x0;
+
+				for (int c = 0; c < 4; c++)
+				{
+					float top = pixels[((size_t)y0 * width + x0) * 4 + c] * (1.0f - fx) +
+						pixels[((size_t)y0 * width + x1) * 4 + c] * fx;
+					float bottom = pixels[((size_t)y1 * width + x0) * 4 + c] * (1.0f - fx) +
+						pixels[((size_t)y1 * width + x1) * 4 + c] * fx;
+					outPixels[((size_t)y * newWidth + x) * 4 + c] =
+						(unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  TextureArrayManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureArrayManager::TextureArrayManager()
+{
+	m_firstTextureUnit = 0;
+	m_maxArrays = 0;
+	m_maxLayers = 0;
+	m_memoryBudget = 0;
+}
+
+TextureArrayManager::~TextureArrayManager()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for querying how many texture units
+ *  the fragment shader can use and how many layers an array
+ *  can have, which limit the arrays.
+ ***********************************************************/
+bool TextureArrayManager::Create(int firstTextureUnit)
+{
+	GLint textureUnits = 0;
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	m_firstTextureUnit = firstTextureUnit;
+	m_maxArrays = std::min(g_MaxTextureArrays, (int)textureUnits - firstTextureUnit);
+	m_maxLayers = (int)maxLayers;
+	if ((m_maxArrays < 1) || (m_maxLayers < 1))
+	{
+		std::cout << "No texture units left for texture arrays" << std::endl;
+		m_maxArrays = 0;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing all the texture arrays.
+ ***********************************************************/
+void TextureArrayManager::Destroy()
+{
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		if (m_arrays[i].textureID != 0)
+		{
+			glDeleteTextures(1, &m_arrays[i].textureID);
+		}
+	}
+	m_arrays.clear();
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for storing a texture with its full
+ *  mip chain.
+ ***********************************************************/
+bool TextureArrayManager::AddTexture(const CompiledTexture& texture, TEXTURE_LOCATION& outLocation)
+{
+	return(AddTexture(texture, 0, outLocation));
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for storing the mip chain of a
+ *  texture from the passed in level on in a free layer of
+ *  the array for its size, format and mip count, so a
+ *  texture can be kept at a lower resolution.  The texture
+ *  is resized into the fallback array when there is no
+ *  texture unit left for a new array.  Nothing is stored
+ *  when the array would outgrow the memory budget.
+ ***********************************************************/
+bool TextureArrayManager::AddTexture(const CompiledTexture& texture, int firstLevel, TEXTURE_LOCATION& outLocation)
+{
+	outLocation.arrayIndex = -1;
+	outLocation.layer = -1;
+	if ((firstLevel < 0) || (firstLevel >= texture.GetMipCount()))
+	{
+		return(false);
+	}
+
+	const CompiledTexture::MIP_LEVEL& baseLevel = texture.GetLevel(firstLevel);
+	bool bNoTextureUnit = false;
+	int arrayIndex = FindArray(baseLevel.width, baseLevel.height, texture.GetFormat(), texture.GetMipCount() - firstLevel, bNoTextureUnit);
+	if (arrayIndex < 0)
+	{
+		if (bNoTextureUnit == true)
+		{
+			return(AddFallbackTexture(texture, firstLevel, outLocation));
+		}
+		return(false);
+	}
+
+	int layer = TakeLayer(m_arrays[arrayIndex]);
+	UploadLayer(arrayIndex, layer, texture, firstLevel);
+	outLocation.arrayIndex = arrayIndex;
+	outLocation.layer = layer;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for storing decoded pixels, building
+ *  their mip chain first.
+ ***********************************************************/
+bool TextureArrayManager::AddTexture(const unsigned char* pixels, int width, int height, int channels, TEXTURE_LOCATION& outLocation)
+{
+	outLocation.arrayIndex = -1;
+	outLocation.layer = -1;
+
+	CompiledTexture texture;
+	if (texture.Build(pixels, width, height, channels, false) == false)
+	{
+		return(false);
+	}
+	return(AddTexture(texture, outLocation));
+}
+
+/***********************************************************
+ *  RemoveTexture()
+ *
+ *  This method is used for freeing the layer of a stored
+ *  texture for the next texture of the same layout.  The
+ *  array is freed once none of its layers are in use, and
+ *  its texture unit can take an array of another layout.
+ ***********************************************************/
+void TextureArrayManager::RemoveTexture(const TEXTURE_LOCATION& location)
+{
+	if ((location.arrayIndex < 0) || (location.arrayIndex >= (int)m_arrays.size()))
+	{
+		return;
+	}
+
+	ARRAY_INFO& textureArray = m_arrays[location.arrayIndex];
+	if ((textureArray.textureID == 0) || (location.layer < 0) || (location.layer >= textureArray.layerCount))
+	{
+		return;
+	}
+
+	textureArray.freeLayers.push_back(location.layer);
+	if ((int)textureArray.freeLayers.size() == textureArray.layerCount)
+	{
+		glDeleteTextures(1, &textureArray.textureID);
+		textureArray.textureID = 0;
+		textureArray.layerCount = 0;
+		textureArray.layerCapacity = 0;
+		textureArray.freeLayers.clear();
+	}
+}
+
+/***********************************************************
+ *  IsLayout()
+ *
+ *  This method is used for checking whether an array holds
+ *  textures of the passed in size, format and mip count.
+ ***********************************************************/
+bool TextureArrayManager::IsLayout(const ARRAY_INFO& textureArray, int width, int height, CompiledTexture::FORMAT format, int mipCount)
+{
+	return((textureArray.textureID != 0) &&
+		(textureArray.bFallback == false) &&
+		(textureArray.width == width) &&
+		(textureArray.height == height) &&
+		(textureArray.format == format) &&
+		(textureArray.mipCount == mipCount));
+}
+
+/***********************************************************
+ *  BindArrays()
+ *
+ *  This method is used for binding every texture array to
+ *  its texture unit, in case other code bound textures
+ *  there.
+ ***********************************************************/
+void TextureArrayManager::BindArrays() const
+{
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		if (m_arrays[i].textureID != 0)
+		{
+			glActiveTexture(GL_TEXTURE0 + GetTextureUnit((int)i));
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[i].textureID);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for counting the stored textures.
+ ***********************************************************/
+int TextureArrayManager::GetTextureCount() const
+{
+	int textureCount = 0;
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		textureCount += m_arrays[i].layerCount - (int)m_arrays[i].freeLayers.size();
+	}
+	return(textureCount);
+}
+
+/***********************************************************
+ *  GetMemorySize()
+ *
+ *  This method is used for adding up the GPU memory of the
+ *  allocated layers of all the arrays, used or not.
+ ***********************************************************/
+size_t TextureArrayManager::GetMemorySize() const
+{
+	size_t memorySize = 0;
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		memorySize += m_arrays[i].layerSize * m_arrays[i].layerCapacity;
+	}
+	return(memorySize);
+}
+
+/***********************************************************
+ *  GetUsedMemorySize()
+ *
+ *  This method is used for adding up the GPU memory of the
+ *  layers holding a texture.
+ ***********************************************************/
+size_t TextureArrayManager::GetUsedMemorySize() const
+{
+	size_t memorySize = 0;
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		memorySize += m_arrays[i].layerSize * (m_arrays[i].layerCount - m_arrays[i].freeLayers.size());
+	}
+	return(memorySize);
+}
+
+/***********************************************************
+ *  PrintMemoryReport()
+ *
+ *  This method is used for printing the size, format, used
+ *  and allocated layers and GPU memory of every array.
+ ***********************************************************/
+void TextureArrayManager::PrintMemoryReport() const
+{
+	std::streamsize precision = std::cout.precision();
+	int arrayCount = 0;
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		arrayCount += (m_arrays[i].textureID != 0) ? 1 : 0;
+	}
+
+	std::cout << "Texture arrays: " << GetTextureCount() << " textures in " << arrayCount
+		<< " arrays, " << std::fixed << std::setprecision(1) << GetMemorySize() / 1048576.0 << " MB";
+	if (m_memoryBudget > 0)
+	{
+		std::cout << " of a " << m_memoryBudget / 1048576.0 << " MB budget";
+	}
+	std::cout << std::endl;
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		const ARRAY_INFO& textureArray = m_arrays[i];
+		if (textureArray.textureID == 0)
+		{
+			continue;
+		}
+		std::cout << "  unit " << GetTextureUnit((int)i) << ": " << textureArray.width << "x" << textureArray.height
+			<< " " << GetFormatName(textureArray.format) << ", " << textureArray.mipCount << " mips, "
+			<< textureArray.layerCount - textureArray.freeLayers.size() << "/" << textureArray.layerCapacity << " layers, "
+			<< textureArray.layerSize * textureArray.layerCapacity / 1024.0 << " KB"
+			<< (textureArray.bFallback ? ", fallback" : "") << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout.precision(precision);
+}
+
+/***********************************************************
+ *  FindArray()
+ *
+ *  This method is used for finding an array with a free
+ *  layer for a texture of the passed in layout.  A full
+ *  array is grown, and once it has the most layers allowed
+ *  another array is started.  The last texture unit is kept
+ *  for the fallback array, and running out of the others is
+ *  told apart from running out of memory.
+ ***********************************************************/
+int TextureArrayManager::FindArray(int width, int height, CompiledTexture::FORMAT format, int mipCount, bool& outNoTextureUnit)
+{
+	outNoTextureUnit = false;
+	int regularArrays = 0;
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		ARRAY_INFO& textureArray = m_arrays[i];
+		if ((textureArray.textureID != 0) && (textureArray.bFallback == false))
+		{
+			regularArrays++;
+		}
+		if (IsLayout(textureArray, width, height, format, mipCount) == false)
+		{
+			continue;
+		}
+
+		if ((textureArray.freeLayers.empty() == false) || (textureArray.layerCount < textureArray.layerCapacity))
+		{
+			return((int)i);
+		}
+		if ((textureArray.layerCapacity < m_maxLayers) && (GrowArray((int)i) == true))
+		{
+			return((int)i);
+		}
+	}
+
+	if (regularArrays >= m_maxArrays - 1)
+	{
+		outNoTextureUnit = true;
+		return(-1);
+	}
+	return(CreateArray(width, height, format, mipCount, g_InitialLayerCapacity, false));
+}
+
+/***********************************************************
+ *  FindFallbackArray()
+ *
+ *  This method is used for finding the fallback array with
+ *  a free layer, creating it on a texture unit left free
+ *  for it.
+ ***********************************************************/
+int TextureArrayManager::FindFallbackArray()
+{
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		ARRAY_INFO& textureArray = m_arrays[i];
+		if ((textureArray.textureID == 0) || (textureArray.bFallback == false))
+		{
+			continue;
+		}
+
+		if ((textureArray.freeLayers.empty() == false) ||
+			(textureArray.layerCount < textureArray.layerCapacity) ||
+			((textureArray.layerCapacity < m_maxLayers) && (GrowArray((int)i) == true)))
+		{
+			return((int)i);
+		}
+		// the fallback array is full
+		return(-1);
+	}
+
+	// a full mip chain of the fallback size
+	int mipCount = 1;
+	for (int size = g_FallbackTextureSize; size > 1; size /= 2)
+	{
+		mipCount++;
+	}
+	return(CreateArray(g_FallbackTextureSize, g_FallbackTextureSize, CompiledTexture::FORMAT_RGBA8, mipCount, g_InitialLayerCapacity, true));
+}
+
+/***********************************************************
+ *  CreateArray()
+ *
+ *  This method is used for allocating the immutable storage
+ *  of a texture array, with fewer layers than asked for if
+ *  only those fit in the memory budget, setting its mapping
+ *  parameters and binding it to the texture unit of the
+ *  first freed array or the next one.
+ ***********************************************************/
+int TextureArrayManager::CreateArray(
+	int width,
+	int height,
+	CompiledTexture::FORMAT format,
+	int mipCount,
+	int layerCapacity,
+	bool bFallback)
+{
+	size_t layerSize = GetLayerSize(width, height, format, mipCount);
+	layerCapacity = std::min(std::min(layerCapacity, m_maxLayers), GetAffordableLayers(layerSize));
+	if (layerCapacity < 1)
+	{
+		return(-1);
+	}
+
+	int arrayIndex = 0;
+	while ((arrayIndex < (int)m_arrays.size()) && (m_arrays[arrayIndex].textureID != 0))
+	{
+		arrayIndex++;
+	}
+	if (arrayIndex >= m_maxArrays)
+	{
+		return(-1);
+	}
+	if (arrayIndex == (int)m_arrays.size())
+	{
+		m_arrays.push_back(ARRAY_INFO());
+	}
+
+	ARRAY_INFO& textureArray = m_arrays[arrayIndex];
+	textureArray.width = width;
+	textureArray.height = height;
+	textureArray.format = format;
+	textureArray.mipCount = mipCount;
+	textureArray.layerCount = 0;
+	textureArray.layerCapacity = layerCapacity;
+	textureArray.layerSize = layerSize;
+	textureArray.bFallback = bFallback;
+	textureArray.freeLayers.clear();
+
+	// each array keeps its own texture unit, so binding it there
+	// disturbs no other texture
+	glGenTextures(1, &textureArray.textureID);
+	glActiveTexture(GL_TEXTURE0 + GetTextureUnit(arrayIndex));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.textureID);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipCount, GetInternalFormat(format), width, height, layerCapacity);
+	SetArrayParameters(mipCount);
+
+	return(arrayIndex);
+}
+
+/***********************************************************
+ *  GrowArray()
+ *
+ *  This method is used for reallocating a full array with
+ *  twice the layers, up to the most allowed and the memory
+ *  budget, and copying the layers it holds on the GPU.
+ ***********************************************************/
+bool TextureArrayManager::GrowArray(int arrayIndex)
+{
+	ARRAY_INFO& textureArray = m_arrays[arrayIndex];
+	int layerCapacity = std::min(textureArray.layerCapacity * 2, m_maxLayers);
+	int affordableLayers = GetAffordableLayers(textureArray.layerSize);
+	if (layerCapacity - textureArray.layerCapacity > affordableLayers)
+	{
+		layerCapacity = textureArray.layerCapacity + affordableLayers;
+	}
+	if (layerCapacity <= textureArray.layerCapacity)
+	{
+		return(false);
+	}
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glActiveTexture(GL_TEXTURE0 + GetTextureUnit(arrayIndex));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, textureArray.mipCount, GetInternalFormat(textureArray.format),
+		textureArray.width, textureArray.height, layerCapacity);
+	SetArrayParameters(textureArray.mipCount);
+
+	for (int level = 0; level < textureArray.mipCount; level++)
+	{
+		glCopyImageSubData(
+			textureArray.textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			std::max(textureArray.width >> level, 1), std::max(textureArray.height >> level, 1), textureArray.layerCount);
+	}
+
+	glDeleteTextures(1, &textureArray.textureID);
+	textureArray.textureID = textureID;
+	textureArray.layerCapacity = layerCapacity;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetAffordableLayers()
+ *
+ *  This method is used for getting how many more layers of
+ *  the passed in size the memory budget leaves room for.
+ ***********************************************************/
+int TextureArrayManager::GetAffordableLayers(size_t layerSize) const
+{
+	size_t memorySize = GetMemorySize();
+	if (m_memoryBudget == 0)
+	{
+		return(INT_MAX);
+	}
+	if ((memorySize >= m_memoryBudget) || (layerSize == 0))
+	{
+		return(0);
+	}
+	return((int)std::min((m_memoryBudget - memorySize) / layerSize, (size_t)INT_MAX));
+}
+
+/***********************************************************
+ *  TakeLayer()
+ *
+ *  This method is used for taking a removed layer of an
+ *  array, or the next one never used.
+ ***********************************************************/
+int TextureArrayManager::TakeLayer(ARRAY_INFO& textureArray)
+{
+	if (textureArray.freeLayers.empty() == false)
+	{
+		int layer = textureArray.freeLayers.back();
+		textureArray.freeLayers.pop_back();
+		return(layer);
+	}
+	return(textureArray.layerCount++);
+}
+
+/***********************************************************
+ *  UploadLayer()
+ *
+ *  This method is used for uploading the mip levels of a
+ *  texture from the passed in one on into a layer of an
+ *  array.
+ ***********************************************************/
+void TextureArrayManager::UploadLayer(int arrayIndex, int layer, const CompiledTexture& texture, int firstLevel) const
+{
+	const ARRAY_INFO& textureArray = m_arrays[arrayIndex];
+	glActiveTexture(GL_TEXTURE0 + GetTextureUnit(arrayIndex));
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.textureID);
+
+	// rows of RGB pixels are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int i = 0; i < textureArray.mipCount; i++)
+	{
+		const CompiledTexture::MIP_LEVEL& level = texture.GetLevel(firstLevel + i);
+		switch (textureArray.format)
+		{
+		case CompiledTexture::FORMAT_RGB8:
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1,
+				GL_RGB, GL_UNSIGNED_BYTE, level.pData);
+			break;
+		case CompiledTexture::FORMAT_RGBA8:
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, level.pData);
+			break;
+		case CompiledTexture::FORMAT_BC1:
+		case CompiledTexture::FORMAT_BC3:
+			glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer, level.width, level.height, 1,
+				GetInternalFormat(textureArray.format), (GLsizei)level.size, level.pData);
+			break;
+		}
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+/***********************************************************
+ *  AddFallbackTexture()
+ *
+ *  This method is used for resizing a texture without an
+ *  array of its own to the size of the fallback array,
+ *  building its mip chain again, and storing it there.
+ ***********************************************************/
+bool TextureArrayManager::AddFallbackTexture(const CompiledTexture& texture, int firstLevel, TEXTURE_LOCATION& outLocation)
+{
+	int arrayIndex = FindFallbackArray();
+	if (arrayIndex < 0)
+	{
+		if (m_memoryBudget == 0)
+		{
+			std::cout << "No texture array layer left for texture" << std::endl;
+		}
+		return(false);
+	}
+
+	std::vector<unsigned char> pixels;
+	std::vector<unsigned char> resizedPixels;
+	const CompiledTexture::MIP_LEVEL& baseLevel = texture.GetLevel(firstLevel);
+	if (texture.DecodeLevel(firstLevel, pixels) == false)
+	{
+		return(false);
+	}
+	ResizePixels(pixels, baseLevel.width, baseLevel.height, g_FallbackTextureSize, g_FallbackTextureSize, resizedPixels);
+
+	CompiledTexture resizedTexture;
+	if (resizedTexture.Build(&resizedPixels[0], g_FallbackTextureSize, g_FallbackTextureSize, 4, false) == false)
+	{
+		return(false);
+	}
+
+	int layer = TakeLayer(m_arrays[arrayIndex]);
+	UploadLayer(arrayIndex, layer, resizedTexture, 0);
+	outLocation.arrayIndex = arrayIndex;
+	outLocation.layer = layer;
+
+	return(true);
+}
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearraymanager.h
+// ============
+// pack textures of the same size into layers of texture arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CompiledTexture.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  TextureArrayManager
+ *
+ *  This class stores every texture as a layer of a 2D
+ *  texture array, with textures of the same size, format and
+ *  mip count sharing an array.  Each array stays bound to its
+ *  own texture unit, so drawing with a texture only needs
+ *  the unit of its array and its layer, and the textures of
+ *  one array can be drawn by the same draw call.
+ *
+ *  An array grows by doubling its layers and copying the
+ *  ones it holds.  When every texture unit has an array, a
+ *  texture of a size without an array is resized into the
+ *  layers of a shared fallback array instead.  Removed
+ *  textures leave their layers free for the next texture of
+ *  the same layout, and an array without textures is freed.
+ *
+ *  With a memory budget, arrays are only created and grown
+ *  while the allocated memory stays within it, and adding a
+ *  texture that does not fit fails.
+ ***********************************************************/
+class TextureArrayManager
+{
+public:
+	// constructor
+	TextureArrayManager();
+	// destructor
+	~TextureArrayManager();
+
+	// where a texture is stored
+	struct TEXTURE_LOCATION
+	{
+		int arrayIndex;
+		int layer;
+	};
+
+	// one texture array and the layers in use
+	struct ARRAY_INFO
+	{
+		GLuint textureID;
+		int width;
+		int height;
+		CompiledTexture::FORMAT format;
+		int mipCount;
+		int layerCount;
+		int layerCapacity;
+		// size of the mip chain of one layer in bytes
+		size_t layerSize;
+		// holds resized textures of any size
+		bool bFallback;
+		// layers below layerCount that were removed
+		std::vector<int> freeLayers;
+	};
+
+	// query the texture limits and use the texture units from
+	// the passed in one on for the arrays
+	bool Create(int firstTextureUnit);
+	// free all the texture arrays
+	void Destroy();
+	// limit the memory of all the arrays, 0 for no limit
+	void SetMemoryBudget(size_t budget) { m_memoryBudget = budget; }
+	size_t GetMemoryBudget() const { return m_memoryBudget; }
+
+	// store a texture with its mip chain in a free layer
+	bool AddTexture(const CompiledTexture& texture, TEXTURE_LOCATION& outLocation);
+	// store the mip chain of a texture from one of its levels on
+	bool AddTexture(const CompiledTexture& texture, int firstLevel, TEXTURE_LOCATION& outLocation);
+	// store decoded RGB or RGBA pixels, building their mip chain
+	bool AddTexture(const unsigned char* pixels, int width, int height, int channels, TEXTURE_LOCATION& outLocation);
+	// free the layer of a stored texture
+	void RemoveTexture(const TEXTURE_LOCATION& location);
+	// check whether an array stores textures of this layout
+	static bool IsLayout(const ARRAY_INFO& textureArray, int width, int height, CompiledTexture::FORMAT format, int mipCount);
+
+	// bind every array to its texture unit again
+	void BindArrays() const;
+	// get the texture unit an array is bound to
+	int GetTextureUnit(int arrayIndex) const { return m_firstTextureUnit + arrayIndex; }
+
+	// get the texture arrays, freed ones have no texture ID
+	int GetArrayCount() const { return (int)m_arrays.size(); }
+	const ARRAY_INFO& GetArray(int arrayIndex) const { return m_arrays[arrayIndex]; }
+	// get the number of stored textures
+	int GetTextureCount() const;
+	// get the GPU memory allocated for all the arrays in bytes
+	size_t GetMemorySize() const;
+	// get the GPU memory of the stored textures in bytes
+	size_t GetUsedMemorySize() const;
+	// print the layers and memory of every array
+	void PrintMemoryReport() const;
+
+private:
+	// find an array with a free layer for a texture of this
+	// layout, creating or growing one if needed, -1 if none
+	int FindArray(int width, int height, CompiledTexture::FORMAT format, int mipCount, bool& outNoTextureUnit);
+	// find or create the array for resized textures
+	int FindFallbackArray();
+	// create an array with storage for a number of layers
+	int CreateArray(int width, int height, CompiledTexture::FORMAT format, int mipCount, int layerCapacity, bool bFallback);
+	// reallocate an array with more layers, keeping its layers
+	bool GrowArray(int arrayIndex);
+	// get how many more layers of a size fit in the budget
+	int GetAffordableLayers(size_t layerSize) const;
+	// take a free layer of an array
+	int TakeLayer(ARRAY_INFO& textureArray);
+	// upload the mip chain of a texture into a layer
+	void UploadLayer(int arrayIndex, int layer, const CompiledTexture& texture, int firstLevel) const;
+	// resize a texture into the fallback array
+	bool AddFallbackTexture(const CompiledTexture& texture, int firstLevel, TEXTURE_LOCATION& outLocation);
+
+	std::vector<ARRAY_INFO> m_arrays;
+	int m_firstTextureUnit;
+	// texture units available for arrays, the last one is kept
+	// for the fallback array
+	int m_maxArrays;
+	// layer limit of one array
+	int m_maxLayers;
+	// most memory of all the arrays, 0 for no limit
+	size_t m_memoryBudget;
+};
@@ -0,0 +1,445 @@
+#include "TextureLoader.h"
+#include "JobSystem.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// lowest peak signal to noise ratio, in decibels, accepted
+	// for a block compressed texture against its source image
+	const double g_MinCompressedPSNR = 30.0;
+}
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader()
+{
+	m_pJobSystem = NULL;
+	m_pendingCount = 0;
+	m_runningJobs = 0;
+	m_bStopping = false;
+	m_bUseCache = false;
+	m_bCompress = false;
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting to decode the requested
+ *  images as background jobs of the job system, which its
+ *  workers run while the rendering thread is busy uploading.
+ *  Without a job system, or one without workers, the images
+ *  are decoded as they are requested.
+ ***********************************************************/
+void TextureLoader::Start(JobSystem* pJobSystem)
+{
+	Stop();
+
+	// the flip setting is shared by all threads, so it is set
+	// before any of them decode
+	stbi_set_flip_vertically_on_load(true);
+
+	m_bStopping = false;
+	m_pJobSystem = pJobSystem;
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for dropping the images not being
+ *  decoded yet, waiting for the decode jobs to finish the
+ *  images they are decoding, and freeing the images that
+ *  were never taken.
+ ***********************************************************/
+void TextureLoader::Stop()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+		m_requests.clear();
+		m_jobFinished.wait(lock, [this] { return (m_runningJobs == 0); });
+	}
+	m_pJobSystem = NULL;
+
+	for (size_t i = 0; i < m_decoded.size(); i++)
+	{
+		FreeImage(m_decoded[i]);
+	}
+	m_decoded.clear();
+	m_requests.clear();
+	m_pendingCount = 0;
+	m_imageReady.notify_all();
+}
+
+/***********************************************************
+ *  SetCache()
+ *
+ *  This method is used for choosing whether the images are
+ *  loaded through the texture cache, and whether the cached
+ *  textures are block compressed.  The decode jobs read
+ *  the settings, so they are changed only while stopped.
+ ***********************************************************/
+void TextureLoader::SetCache(bool bUseCache, bool bCompress)
+{
+	Stop();
+
+	m_bUseCache = bUseCache;
+	m_bCompress = bCompress;
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded.  The request ID comes back with the image, for
+ *  telling which texture it belongs to.
+ ***********************************************************/
+void TextureLoader::Request(const std::string& filename, int requestID)
+{
+	DECODED_IMAGE image;
+	image.filename = filename;
+	image.requestID = requestID;
+	image.pixels = NULL;
+	image.pCompiled = NULL;
+	image.width = 0;
+	image.height = 0;
+	image.channels = 0;
+
+	if ((NULL == m_pJobSystem) || (m_pJobSystem->GetThreadCount() == 1))
+	{
+		DecodeImage(image);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_decoded.push_back(image);
+		m_pendingCount++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_requests.push_back(image);
+		m_pendingCount++;
+		m_runningJobs++;
+	}
+	m_pJobSystem->RunBackground([this] { DecodeJob(); });
+}
+
+/***********************************************************
+ *  TakeDecoded()
+ *
+ *  This method is used for getting the next decoded image
+ *  without waiting.  The caller frees its pixels.
+ ***********************************************************/
+bool TextureLoader::TakeDecoded(DECODED_IMAGE& outImage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_decoded.empty())
+	{
+		return(false);
+	}
+
+	outImage = m_decoded.front();
+	m_decoded.pop_front();
+	m_pendingCount--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  WaitDecoded()
+ *
+ *  This method is used for getting the next decoded image,
+ *  waiting for it to be decoded if need be.  The caller
+ *  frees its pixels.
+ ***********************************************************/
+bool TextureLoader::WaitDecoded(DECODED_IMAGE& outImage)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_imageReady.wait(lock, [this] { return ((m_decoded.empty() == false) || (m_pendingCount == 0)); });
+	if (m_decoded.empty())
+	{
+		return(false);
+	}
+
+	outImage = m_decoded.front();
+	m_decoded.pop_front();
+	m_pendingCount--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of images
+ *  requested and not yet taken.
+ ***********************************************************/
+int TextureLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_pendingCount);
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method is used for getting the number of threads
+ *  the images are decoded on, the workers of the job system.
+ ***********************************************************/
+int TextureLoader::GetThreadCount() const
+{
+	return((NULL != m_pJobSystem) ? (m_pJobSystem->GetThreadCount() - 1) : 0);
+}
+
+/***********************************************************
+ *  IsLoaded()
+ *
+ *  This method is used for checking whether an image was
+ *  decoded or compiled, rather than failing to load.
+ ***********************************************************/
+bool TextureLoader::IsLoaded(const DECODED_IMAGE& image)
+{
+	return((image.pixels != NULL) || (image.pCompiled != NULL));
+}
+
+/***********************************************************
+ *  UploadTexture()
+ *
+ *  This method is used for uploading a decoded image into
+ *  the passed in texture, replacing what it held before.
+ *  Compiled images bring their mipmaps along, for the
+ *  others the texture mipmaps are generated.  The active
+ *  texture unit is left without a texture bound.
+ ***********************************************************/
+bool TextureLoader::UploadTexture(GLuint textureID, const DECODED_IMAGE& image)
+{
+	if (image.pCompiled != NULL)
+	{
+		return(image.pCompiled->Upload(textureID));
+	}
+
+	GLenum internalFormat = 0;
+	GLenum pixelFormat = 0;
+	// if the loaded image is in RGB format
+	if (image.channels == 3)
+	{
+		internalFormat = GL_RGB8;
+		pixelFormat = GL_RGB;
+	}
+	// if the loaded image is in RGBA format - it supports transparency
+	else if (image.channels == 4)
+	{
+		internalFormat = GL_RGBA8;
+		pixelFormat = GL_RGBA;
+	}
+	else
+	{
+		std::cout << "Not implemented to handle image with " << image.channels << " channels" << std::endl;
+		return(false);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	// rows of RGB pixels are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, pixelFormat, GL_UNSIGNED_BYTE, image.pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method is used for freeing the pixels of a decoded
+ *  image.
+ ***********************************************************/
+void TextureLoader::FreeImage(DECODED_IMAGE& image)
+{
+	if (image.pixels != NULL)
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+	}
+	if (image.pCompiled != NULL)
+	{
+		delete image.pCompiled;
+		image.pCompiled = NULL;
+	}
+}
+
+/***********************************************************
+ *  BuildCache()
+ *
+ *  This method is used for compiling an image file into the
+ *  texture cache ahead of time.  The cache file is mapped
+ *  again and its first level compared with the decoded
+ *  image - uncompressed textures must match exactly and
+ *  compressed ones closely enough.
+ ***********************************************************/
+bool TextureLoader::BuildCache(const char* filename, bool bCompress)
+{
+	stbi_set_flip_vertically_on_load(true);
+
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	unsigned char* pixels = stbi_load(filename, &width, &height, &channels, 0);
+	if (pixels == NULL)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return(false);
+	}
+
+	std::string cacheFilename = CompiledTexture::GetCacheFilename(filename);
+	CompiledTexture compiled;
+	bool bBuilt = (compiled.Build(pixels, width, height, channels, bCompress) == true) &&
+		(compiled.Save(cacheFilename.c_str(), filename) == true);
+
+	CompiledTexture cached;
+	std::vector<unsigned char> cachedPixels;
+	if ((bBuilt == false) ||
+		(cached.Load(cacheFilename.c_str(), filename) == false) ||
+		(cached.DecodeLevel(0, cachedPixels) == false))
+	{
+		std::cout << "Could not compile image:" << filename << std::endl;
+		stbi_image_free(pixels);
+		return(false);
+	}
+
+	// compare the cached texels with the decoded image
+	int maxError = 0;
+	double squaredError = 0.0;
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			int error = std::abs((int)cachedPixels[i * 4 + c] - (int)pixels[i * channels + c]);
+			maxError = std::max(maxError, error);
+			squaredError += (double)error * error;
+		}
+	}
+	stbi_image_free(pixels);
+
+	double meanSquaredError = squaredError / ((double)width * height * channels);
+	double psnr = (meanSquaredError > 0.0) ? (10.0 * std::log10(255.0 * 255.0 / meanSquaredError)) : INFINITY;
+	const char* formatNames[] = { "RGB8", "RGBA8", "BC1", "BC3" };
+	std::cout << filename << " -> " << cacheFilename << ": " << width << "x" << height << " "
+		<< formatNames[cached.GetFormat()] << ", " << cached.GetMipCount() << " mip levels, "
+		<< cached.GetDataSize() / 1024 << " KB (" << (size_t)width * height * 4 * 4 / 3 / 1024
+		<< " KB as RGBA8), max error " << maxError << ", PSNR " << psnr << " dB" << std::endl;
+
+	bool bCompressed = (cached.GetFormat() == CompiledTexture::FORMAT_BC1) ||
+		(cached.GetFormat() == CompiledTexture::FORMAT_BC3);
+	if (((bCompressed == false) && (maxError > 0)) ||
+		((bCompressed == true) && (psnr < g_MinCompressedPSNR)))
+	{
+		std::cout << "Cached texture does not match the image:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used for parsing the image data from the
+ *  image file.
+ ***********************************************************/
+void TextureLoader::DecodeImage(DECODED_IMAGE& image)
+{
+	if (m_bUseCache == false)
+	{
+		image.pixels = stbi_load(
+			image.filename.c_str(),
+			&image.width,
+			&image.height,
+			&image.channels,
+			0);
+		return;
+	}
+
+	std::string cacheFilename = CompiledTexture::GetCacheFilename(image.filename.c_str());
+	CompiledTexture* pCompiled = new CompiledTexture();
+	bool bCompiled = pCompiled->Load(cacheFilename.c_str(), image.filename.c_str());
+	if (bCompiled == false)
+	{
+		// compile the image for the next launch
+		unsigned char* pixels = stbi_load(
+			image.filename.c_str(),
+			&image.width,
+			&image.height,
+			&image.channels,
+			0);
+		if (pixels != NULL)
+		{
+			bCompiled = pCompiled->Build(pixels, image.width, image.height, image.channels, m_bCompress);
+			if (bCompiled == true)
+			{
+				pCompiled->Save(cacheFilename.c_str(), image.filename.c_str());
+			}
+			stbi_image_free(pixels);
+		}
+	}
+
+	if (bCompiled == false)
+	{
+		delete pCompiled;
+		return;
+	}
+
+	CompiledTexture::FORMAT format = pCompiled->GetFormat();
+	image.pCompiled = pCompiled;
+	image.width = pCompiled->GetLevel(0).width;
+	image.height = pCompiled->GetLevel(0).height;
+	image.channels = ((format == CompiledTexture::FORMAT_RGBA8) || (format == CompiledTexture::FORMAT_BC3)) ? 4 : 3;
+}
+
+/***********************************************************
+ *  DecodeJob()
+ *
+ *  This method is used for decoding the oldest requested
+ *  image in a background job.  One job is queued for every
+ *  request, and it finds nothing left to decode when the
+ *  loader was stopped.
+ ***********************************************************/
+void TextureLoader::DecodeJob()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if ((m_bStopping == false) && (m_requests.empty() == false))
+	{
+		DECODED_IMAGE image = m_requests.front();
+		m_requests.pop_front();
+		lock.unlock();
+
+		DecodeImage(image);
+
+		lock.lock();
+		m_decoded.push_back(image);
+		m_imageReady.notify_all();
+	}
+
+	m_runningJobs--;
+	m_jobFinished.notify_all();
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture images on background threads
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CompiledTexture.h"
+
+#include <GL/glew.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class decodes image files in background jobs of the
+ *  job system.  Decoding is most of the time a texture takes
+ *  to load, and it needs no OpenGL context, so only the
+ *  upload of the decoded pixels is left for the OpenGL
+ *  thread, which takes the images as they become ready.
+ *  Started without a job system, the images are decoded as
+ *  they are requested.
+ *
+ *  With the texture cache in use, an image that was loaded
+ *  before is mapped from its cache file with its mipmaps
+ *  instead of being decoded, and an image that was not is
+ *  compiled into the cache after decoding.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor
+	TextureLoader();
+	// destructor
+	~TextureLoader();
+
+	// pixels of a decoded image, flipped for OpenGL
+	struct DECODED_IMAGE
+	{
+		std::string filename;
+		// identifies the request the image was decoded for
+		int requestID;
+		// decoded pixels, NULL when the image was compiled or
+		// could not be decoded
+		unsigned char* pixels;
+		// the image with its mipmaps when the texture cache is
+		// used, NULL otherwise
+		CompiledTexture* pCompiled;
+		int width;
+		int height;
+		int channels;
+	};
+
+	// start decoding in background jobs of a job system, or on
+	// the calling thread without one
+	void Start(JobSystem* pJobSystem);
+	// stop decoding and free the undelivered images
+	void Stop();
+	// load the images through the texture cache, optionally
+	// block compressed, set before starting
+	void SetCache(bool bUseCache, bool bCompress);
+
+	// queue an image file for decoding
+	void Request(const std::string& filename, int requestID);
+	// get the next decoded image if one is ready
+	bool TakeDecoded(DECODED_IMAGE& outImage);
+	// wait for the next decoded image, false if none are pending
+	bool WaitDecoded(DECODED_IMAGE& outImage);
+	// get the number of images requested and not yet taken
+	int GetPendingCount();
+	// get the number of threads decoding images
+	int GetThreadCount() const;
+
+	// check whether an image was decoded or compiled
+	static bool IsLoaded(const DECODED_IMAGE& image);
+	// upload a decoded image into a texture with its mipmaps
+	static bool UploadTexture(GLuint textureID, const DECODED_IMAGE& image);
+	// free the pixels of a decoded image
+	static void FreeImage(DECODED_IMAGE& image);
+
+	// compile an image file into the texture cache and check the
+	// cached pixels against the decoded ones
+	static bool BuildCache(const char* filename, bool bCompress);
+
+private:
+	// decode an image file or map it from the texture cache
+	void DecodeImage(DECODED_IMAGE& image);
+	// decode the oldest queued image file
+	void DecodeJob();
+
+	// runs the decode jobs, NULL to decode on the calling thread
+	JobSystem* m_pJobSystem;
+	std::mutex m_mutex;
+	// signalled when a decode job has finished
+	std::condition_variable m_jobFinished;
+	// signalled when an image has been decoded
+	std::condition_variable m_imageReady;
+	std::deque<DECODED_IMAGE> m_requests;
+	std::deque<DECODED_IMAGE> m_decoded;
+	int m_pendingCount;
+	// decode jobs queued or running
+	int m_runningJobs;
+	bool m_bStopping;
+	bool m_bUseCache;
+	bool m_bCompress;
+};
@@ -0,0 +1,453 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// frames before a finer level that did not fit is tried again
+	const unsigned int g_RetryFrames = 30;
+}
+
+/***********************************************************
+ *  TextureStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureStreamer::TextureStreamer()
+{
+	// frame 0 stands for never drawn, which new textures start at
+	m_frame = 1;
+	m_movedCount = 0;
+	m_uploadCount = 0;
+	m_evictionCount = 0;
+	m_rateStart = std::chrono::steady_clock::now();
+	m_rateEvictions = 0;
+	m_evictionsPerSecond = 0.0f;
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for preparing the texture arrays
+ *  within the memory budget and starting the loader, which
+ *  decodes the images through the texture cache in jobs of
+ *  the passed in job system.
+ ***********************************************************/
+bool TextureStreamer::Create(size_t memoryBudget, int firstTextureUnit, JobSystem* pJobSystem, bool bCompress)
+{
+	if (m_arrays.Create(firstTextureUnit) == false)
+	{
+		return(false);
+	}
+	m_arrays.SetMemoryBudget(memoryBudget);
+
+	m_loader.SetCache(true, bCompress);
+	m_loader.Start(pJobSystem);
+	m_rateStart = std::chrono::steady_clock::now();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for stopping the loads in progress
+ *  and freeing the texture arrays.
+ ***********************************************************/
+void TextureStreamer::Destroy()
+{
+	m_loader.Stop();
+	m_arrays.Destroy();
+	m_textures.clear();
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for adding a texture image file to
+ *  be loaded once an object is drawn with it.
+ ***********************************************************/
+int TextureStreamer::AddTexture(const std::string& filename)
+{
+	STREAMED_TEXTURE texture;
+	texture.filename = filename;
+	texture.width = 0;
+	texture.height = 0;
+	texture.mipCount = 0;
+	texture.location.arrayIndex = -1;
+	texture.location.layer = -1;
+	texture.residentLevel = -1;
+	texture.screenSize = 0.0f;
+	texture.lastUsedFrame = 0;
+	texture.retryFrame = 0;
+	texture.bLoading = false;
+	texture.bFailed = false;
+	m_textures.push_back(texture);
+
+	return((int)m_textures.size() - 1);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a new frame, so the
+ *  textures drawn in it can be told from the ones that were
+ *  drawn before.
+ ***********************************************************/
+void TextureStreamer::BeginFrame()
+{
+	m_frame++;
+}
+
+/***********************************************************
+ *  MarkVisible()
+ *
+ *  This method is used for marking a texture as drawn this
+ *  frame, keeping the largest size it is drawn at.
+ ***********************************************************/
+void TextureStreamer::MarkVisible(int textureIndex, float screenSize)
+{
+	STREAMED_TEXTURE& texture = m_textures[textureIndex];
+	if (texture.lastUsedFrame != m_frame)
+	{
+		texture.lastUsedFrame = m_frame;
+		texture.screenSize = screenSize;
+	}
+	else
+	{
+		texture.screenSize = std::max(texture.screenSize, screenSize);
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for storing the images loaded so far,
+ *  up to the passed in number of them, or all with -1, and
+ *  requesting the textures drawn in the last frame that are
+ *  not resident or need a finer mip level.
+ ***********************************************************/
+int TextureStreamer::Update(int maxUploads)
+{
+	TextureLoader::DECODED_IMAGE image;
+	int uploads = 0;
+	while (((maxUploads < 0) || (uploads < maxUploads)) && (m_loader.TakeDecoded(image) == true))
+	{
+		StoreImage(image);
+		uploads++;
+	}
+
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		STREAMED_TEXTURE& texture = m_textures[i];
+		if ((texture.lastUsedFrame != m_frame) || (texture.bLoading == true) || (texture.bFailed == true))
+		{
+			continue;
+		}
+
+		if (texture.residentLevel < 0)
+		{
+			RequestLoad((int)i);
+		}
+		else if ((GetWantedLevel(texture) < texture.residentLevel) && (m_frame >= texture.retryFrame))
+		{
+			RequestLoad((int)i);
+		}
+	}
+
+	// the eviction rate is counted over whole seconds
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - m_rateStart).count();
+	if (seconds >= 1.0)
+	{
+		m_evictionsPerSecond = (float)(m_rateEvictions / seconds);
+		m_rateEvictions = 0;
+		m_rateStart = now;
+	}
+
+	int movedCount = m_movedCount;
+	m_movedCount = 0;
+	return(movedCount);
+}
+
+/***********************************************************
+ *  FinishLoads()
+ *
+ *  This method is used for loading every texture at its
+ *  full resolution and waiting for them, for rendering
+ *  frames that must not show placeholder colors.  Textures
+ *  are kept coarser when the budget does not fit them all.
+ ***********************************************************/
+int TextureStreamer::FinishLoads()
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		STREAMED_TEXTURE& texture = m_textures[i];
+		MarkVisible((int)i, FLT_MAX);
+		if ((texture.bLoading == false) && (texture.bFailed == false) && (texture.residentLevel != 0))
+		{
+			RequestLoad((int)i);
+		}
+	}
+
+	TextureLoader::DECODED_IMAGE image;
+	while (m_loader.WaitDecoded(image) == true)
+	{
+		StoreImage(image);
+	}
+	m_arrays.PrintMemoryReport();
+
+	int movedCount = m_movedCount;
+	m_movedCount = 0;
+	return(movedCount);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the memory and loading
+ *  counters.
+ ***********************************************************/
+TextureStreamer::STREAMING_STATS TextureStreamer::GetStats()
+{
+	STREAMING_STATS stats;
+	stats.allocatedBytes = m_arrays.GetMemorySize();
+	stats.residentBytes = m_arrays.GetUsedMemorySize();
+	stats.budgetBytes = m_arrays.GetMemoryBudget();
+	stats.residentTextures = m_arrays.GetTextureCount();
+	stats.pendingLoads = m_loader.GetPendingCount();
+	stats.uploads = m_uploadCount;
+	stats.evictions = m_evictionCount;
+	stats.evictionsPerSecond = m_evictionsPerSecond;
+	return(stats);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the memory and loading
+ *  counters.
+ ***********************************************************/
+void TextureStreamer::PrintStats()
+{
+	STREAMING_STATS stats = GetStats();
+	std::streamsize precision = std::cout.precision();
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Texture streaming: " << stats.residentTextures << " of " << m_textures.size()
+		<< " textures resident, " << stats.residentBytes / 1048576.0 << " MB in "
+		<< stats.allocatedBytes / 1048576.0 << " MB of arrays";
+	if (stats.budgetBytes > 0)
+	{
+		std::cout << ", budget " << stats.budgetBytes / 1048576.0 << " MB";
+	}
+	std::cout << std::endl;
+	std::cout << "  " << stats.uploads << " uploads, " << stats.pendingLoads << " loads pending, "
+		<< stats.evictions << " evictions, " << stats.evictionsPerSecond << " per second" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+	std::cout.precision(precision);
+}
+
+/***********************************************************
+ *  GetWantedLevel()
+ *
+ *  This method is used for getting the first mip level a
+ *  texture needs, where one texel covers about a pixel of
+ *  the largest object it was drawn on.  The texture is
+ *  assumed to be stretched across the object once.
+ ***********************************************************/
+int TextureStreamer::GetWantedLevel(const STREAMED_TEXTURE& texture) const
+{
+	if (texture.mipCount == 0)
+	{
+		return(0);
+	}
+
+	int level = 0;
+	float size = (float)std::max(texture.width, texture.height);
+	while ((level < texture.mipCount - 1) && (size * 0.5f >= texture.screenSize))
+	{
+		size *= 0.5f;
+		level++;
+	}
+	return(level);
+}
+
+/***********************************************************
+ *  StoreImage()
+ *
+ *  This method is used for storing a loaded image from the
+ *  mip level its texture needs on, or the finest level that
+ *  fits the budget.  The resident levels are freed first so
+ *  their memory can be reused, and stored again if nothing
+ *  finer fits.  Images of textures that already have the
+ *  levels needed are dropped.
+ ***********************************************************/
+void TextureStreamer::StoreImage(TextureLoader::DECODED_IMAGE& image)
+{
+	STREAMED_TEXTURE& texture = m_textures[image.requestID];
+	texture.bLoading = false;
+
+	if (TextureLoader::IsLoaded(image) == false)
+	{
+		std::cout << "Could not load image:" << image.filename << std::endl;
+		texture.bFailed = true;
+		TextureLoader::FreeImage(image);
+		return;
+	}
+
+	// images decoded without the texture cache get their mip
+	// chain built here
+	CompiledTexture builtTexture;
+	const CompiledTexture* pCompiled = image.pCompiled;
+	if (pCompiled == NULL)
+	{
+		if (builtTexture.Build(image.pixels, image.width, image.height, image.channels, false) == false)
+		{
+			texture.bFailed = true;
+			TextureLoader::FreeImage(image);
+			return;
+		}
+		pCompiled = &builtTexture;
+	}
+
+	bool bFirstLoad = (texture.mipCount == 0);
+	texture.width = image.width;
+	texture.height = image.height;
+	texture.mipCount = pCompiled->GetMipCount();
+
+	int wantedLevel = GetWantedLevel(texture);
+	int residentLevel = texture.residentLevel;
+	if ((residentLevel >= 0) && (residentLevel <= wantedLevel))
+	{
+		TextureLoader::FreeImage(image);
+		return;
+	}
+
+	if (residentLevel >= 0)
+	{
+		m_arrays.RemoveTexture(texture.location);
+		texture.location.arrayIndex = -1;
+		texture.location.layer = -1;
+		texture.residentLevel = -1;
+	}
+
+	int lastLevel = (residentLevel >= 0) ? residentLevel : texture.mipCount - 1;
+	for (int level = wantedLevel; level <= lastLevel; level++)
+	{
+		if (StoreLevel(image.requestID, *pCompiled, level) == true)
+		{
+			texture.residentLevel = level;
+			break;
+		}
+	}
+
+	if (texture.residentLevel != wantedLevel)
+	{
+		texture.retryFrame = m_frame + g_RetryFrames;
+	}
+	if (texture.residentLevel >= 0)
+	{
+		m_uploadCount++;
+		if (bFirstLoad == true)
+		{
+			std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height
+				<< ", channels:" << image.channels << ", mip level:" << texture.residentLevel << std::endl;
+		}
+	}
+	m_movedCount++;
+	TextureLoader::FreeImage(image);
+}
+
+/***********************************************************
+ *  StoreLevel()
+ *
+ *  This method is used for storing a texture from a mip
+ *  level on, evicting textures until it fits or no texture
+ *  is left to evict.
+ ***********************************************************/
+bool TextureStreamer::StoreLevel(int textureIndex, const CompiledTexture& compiled, int level)
+{
+	STREAMED_TEXTURE& texture = m_textures[textureIndex];
+	const CompiledTexture::MIP_LEVEL& baseLevel = compiled.GetLevel(level);
+	while (m_arrays.AddTexture(compiled, level, texture.location) == false)
+	{
+		if (EvictFor(textureIndex, baseLevel.width, baseLevel.height, compiled.GetFormat(), compiled.GetMipCount() - level) == false)
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  EvictFor()
+ *
+ *  This method is used for evicting the least recently
+ *  drawn texture that was not drawn in the last frame and
+ *  whose removal makes room for a texture of the passed in
+ *  layout - either it frees a layer of an array of that
+ *  layout, or it is the last texture of its array, which
+ *  frees the array.
+ ***********************************************************/
+bool TextureStreamer::EvictFor(int textureIndex, int width, int height, CompiledTexture::FORMAT format, int mipCount)
+{
+	int evictIndex = -1;
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		const STREAMED_TEXTURE& texture = m_textures[i];
+		if (((int)i == textureIndex) || (texture.residentLevel < 0) || (texture.lastUsedFrame >= m_frame))
+		{
+			continue;
+		}
+
+		const TextureArrayManager::ARRAY_INFO& textureArray = m_arrays.GetArray(texture.location.arrayIndex);
+		bool bSameLayout = TextureArrayManager::IsLayout(textureArray, width, height, format, mipCount);
+		bool bLastTexture = (textureArray.layerCount - (int)textureArray.freeLayers.size() == 1);
+		if ((bSameLayout == false) && (bLastTexture == false))
+		{
+			continue;
+		}
+
+		if ((evictIndex < 0) || (texture.lastUsedFrame < m_textures[evictIndex].lastUsedFrame))
+		{
+			evictIndex = (int)i;
+		}
+	}
+
+	if (evictIndex < 0)
+	{
+		return(false);
+	}
+
+	STREAMED_TEXTURE& texture = m_textures[evictIndex];
+	m_arrays.RemoveTexture(texture.location);
+	texture.location.arrayIndex = -1;
+	texture.location.layer = -1;
+	texture.residentLevel = -1;
+	m_evictionCount++;
+	m_rateEvictions++;
+	m_movedCount++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  RequestLoad()
+ *
+ *  This method is used for queueing a texture image file
+ *  for loading in a decode job.
+ ***********************************************************/
+void TextureStreamer::RequestLoad(int textureIndex)
+{
+	m_textures[textureIndex].bLoading = true;
+	m_loader.Request(m_textures[textureIndex].filename, textureIndex);
+}
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturestreamer.h
+// ============
+// keep the textures of visible objects resident within a memory budget
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureLoader.h"
+#include "TextureArrayManager.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureStreamer
+ *
+ *  This class keeps every texture resident from the mip
+ *  level its visible objects need on, rather than loading
+ *  every texture at full resolution up front.  The objects
+ *  drawn each frame report how large they are on screen,
+ *  and textures that need finer mip levels than they have
+ *  are loaded again in the background, from the texture
+ *  cache when it is in use, so only the levels uploaded are
+ *  read from disk.
+ *
+ *  The texture arrays are kept within a memory budget.  When
+ *  a texture does not fit, the least recently drawn textures
+ *  not drawn in the last frame are evicted, and when that
+ *  frees too little the texture is kept at a coarser level.
+ ***********************************************************/
+class TextureStreamer
+{
+public:
+	// constructor
+	TextureStreamer();
+	// destructor
+	~TextureStreamer();
+
+	// memory and loading counters of the streamed textures
+	struct STREAMING_STATS
+	{
+		// GPU memory of the texture arrays, of the textures in
+		// them, and the budget both stay within
+		size_t allocatedBytes;
+		size_t residentBytes;
+		size_t budgetBytes;
+		int residentTextures;
+		int pendingLoads;
+		int uploads;
+		int evictions;
+		// evictions in the last full second
+		float evictionsPerSecond;
+	};
+
+	// prepare the texture arrays within a memory budget in bytes,
+	// 0 for no limit, and start decoding in jobs of a job system,
+	// or on the calling thread without one
+	bool Create(size_t memoryBudget, int firstTextureUnit, JobSystem* pJobSystem, bool bCompress);
+	// stop loading and free all the textures
+	void Destroy();
+
+	// add a texture image file, returning the index of the texture,
+	// nothing is loaded until an object is drawn with it
+	int AddTexture(const std::string& filename);
+
+	// start a frame, the textures drawn in it are marked after
+	void BeginFrame();
+	// mark a texture as drawn this frame on an object of the passed
+	// in size in pixels
+	void MarkVisible(int textureIndex, float screenSize);
+	// upload the loaded textures, up to the passed in number, and
+	// request the ones drawn last frame that need finer levels,
+	// returning the number of textures that moved or went away
+	int Update(int maxUploads);
+	// load every texture at full resolution, as far as the budget
+	// allows, and wait for them
+	int FinishLoads();
+
+	// get where a texture is stored, -1 while it is not resident
+	int GetArrayIndex(int textureIndex) const { return m_textures[textureIndex].location.arrayIndex; }
+	int GetLayer(int textureIndex) const { return m_textures[textureIndex].location.layer; }
+	// get the texture arrays
+	const TextureArrayManager& GetArrays() const { return m_arrays; }
+
+	// get the memory and loading counters
+	STREAMING_STATS GetStats();
+	// print the memory and loading counters
+	void PrintStats();
+
+private:
+	// one texture and the levels of it that are resident
+	struct STREAMED_TEXTURE
+	{
+		std::string filename;
+		// size and mip levels of the full image, 0 until loaded
+		int width;
+		int height;
+		int mipCount;
+		TextureArrayManager::TEXTURE_LOCATION location;
+		// first resident mip level, -1 when not resident
+		int residentLevel;
+		// largest size in pixels it was drawn at in its last frame
+		float screenSize;
+		unsigned int lastUsedFrame;
+		// no finer level is requested before this frame, after
+		// one did not fit
+		unsigned int retryFrame;
+		// a load is queued
+		bool bLoading;
+		// the image could not be loaded, it is not tried again
+		bool bFailed;
+	};
+
+	// get the first mip level a texture needs at its screen size
+	int GetWantedLevel(const STREAMED_TEXTURE& texture) const;
+	// store a loaded image at the level it is needed at, or the
+	// finest one that fits
+	void StoreImage(TextureLoader::DECODED_IMAGE& image);
+	// store a texture from a mip level on, evicting textures to
+	// make room if needed
+	bool StoreLevel(int textureIndex, const CompiledTexture& compiled, int level);
+	// evict the least recently drawn texture whose removal leaves
+	// room for a texture of the passed in layout
+	bool EvictFor(int textureIndex, int width, int height, CompiledTexture::FORMAT format, int mipCount);
+	// queue a texture image file for loading
+	void RequestLoad(int textureIndex);
+
+	std::vector<STREAMED_TEXTURE> m_textures;
+	TextureLoader m_loader;
+	TextureArrayManager m_arrays;
+	unsigned int m_frame;
+	// textures moved or evicted since the last update
+	int m_movedCount;
+	int m_uploadCount;
+	int m_evictionCount;
+	// evictions counted over the current second, and the rate of
+	// the last full second
+	std::chrono::steady_clock::time_point m_rateStart;
+	int m_rateEvictions;
+	float m_evictionsPerSecond;
+};
@@ -0,0 +1,277 @@
+#include "TransformCache.h"
+#include "TransformKernels.h"
+#include "JobSystem.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// when at most one in this many transforms of the dirty range
+	// changed, only those are rebuilt instead of the whole range
+	const int g_SparseDirtyRatio = 8;
+	// fewest transforms of a dense range rebuilt by one job
+	const int g_MinTransformsPerJob = 16384;
+}
+
+/***********************************************************
+ *  TransformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransformCache::TransformCache()
+{
+	m_recomputeCount = 0;
+	Clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the transforms.
+ ***********************************************************/
+void TransformCache::Clear()
+{
+	m_scaleX.clear();
+	m_scaleY.clear();
+	m_scaleZ.clear();
+	m_rotationDegreesX.clear();
+	m_rotationDegreesY.clear();
+	m_rotationDegreesZ.clear();
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_modelMatrices.clear();
+	m_dirtyFlags.clear();
+	m_firstDirty = 0;
+	m_lastDirty = -1;
+	m_dirtyCount = 0;
+}
+
+/***********************************************************
+ *  AddTransform()
+ *
+ *  This method is used for adding a transform to the cache.
+ *  Its model matrix is computed by the next Update().
+ ***********************************************************/
+int TransformCache::AddTransform(
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegreesXYZ,
+	glm::vec3 positionXYZ)
+{
+	int index = (int)m_modelMatrices.size();
+	int newCount = index + 1;
+
+	m_scaleX.resize(newCount);
+	m_scaleY.resize(newCount);
+	m_scaleZ.resize(newCount);
+	m_rotationDegreesX.resize(newCount);
+	m_rotationDegreesY.resize(newCount);
+	m_rotationDegreesZ.resize(newCount);
+	m_positionX.resize(newCount);
+	m_positionY.resize(newCount);
+	m_positionZ.resize(newCount);
+	m_modelMatrices.push_back(glm::mat4(1.0f));
+	m_dirtyFlags.push_back(0);
+
+	StoreValues(index, scaleXYZ, rotationDegreesXYZ, positionXYZ);
+	MarkDirty(index);
+
+	return(index);
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for changing the values of an
+ *  existing transform.  The model matrix is only flagged for
+ *  rebuilding when one of the values actually changed.
+ ***********************************************************/
+void TransformCache::SetTransform(
+	int index,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegreesXYZ,
+	glm::vec3 positionXYZ)
+{
+	if ((index < 0) || (index >= (int)m_modelMatrices.size()))
+	{
+		return;
+	}
+
+	if ((m_scaleX[index] != scaleXYZ.x) || (m_scaleY[index] != scaleXYZ.y) || (m_scaleZ[index] != scaleXYZ.z) ||
+		(m_rotationDegreesX[index] != rotationDegreesXYZ.x) ||
+		(m_rotationDegreesY[index] != rotationDegreesXYZ.y) ||
+		(m_rotationDegreesZ[index] != rotationDegreesXYZ.z) ||
+		(m_positionX[index] != positionXYZ.x) || (m_positionY[index] != positionXYZ.y) || (m_positionZ[index] != positionXYZ.z))
+	{
+		StoreValues(index, scaleXYZ, rotationDegreesXYZ, positionXYZ);
+		MarkDirty(index);
+	}
+}
+
+/***********************************************************
+ *  StoreValues()
+ *
+ *  This method is used for storing the values of a transform
+ *  into the per-component arrays.
+ ***********************************************************/
+void TransformCache::StoreValues(
+	int index,
+	glm::vec3 scaleXYZ,
+	glm::vec3 rotationDegreesXYZ,
+	glm::vec3 positionXYZ)
+{
+	m_scaleX[index] = scaleXYZ.x;
+	m_scaleY[index] = scaleXYZ.y;
+	m_scaleZ[index] = scaleXYZ.z;
+	m_rotationDegreesX[index] = rotationDegreesXYZ.x;
+	m_rotationDegreesY[index] = rotationDegreesXYZ.y;
+	m_rotationDegreesZ[index] = rotationDegreesXYZ.z;
+	m_positionX[index] = positionXYZ.x;
+	m_positionY[index] = positionXYZ.y;
+	m_positionZ[index] = positionXYZ.z;
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for flagging a transform as needing
+ *  its model matrix rebuilt and widening the dirty range.
+ ***********************************************************/
+void TransformCache::MarkDirty(int index)
+{
+	if (m_dirtyFlags[index] != 0)
+	{
+		return;
+	}
+	m_dirtyFlags[index] = 1;
+	m_dirtyCount++;
+
+	if (m_firstDirty > m_lastDirty)
+	{
+		m_firstDirty = index;
+		m_lastDirty = index;
+	}
+	else
+	{
+		if (index < m_firstDirty)
+			m_firstDirty = index;
+		if (index > m_lastDirty)
+			m_lastDirty = index;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for recomputing the model matrices of
+ *  the transforms that changed since the last update.  When
+ *  nothing changed this returns without touching any matrix.
+ *  Dense changes are rebuilt as one batch over the dirty
+ *  range with the SIMD kernels, split across the jobs of
+ *  the job system when one is passed in and the range is
+ *  large, and sparse changes one by one.
+ ***********************************************************/
+void TransformCache::Update(JobSystem* pJobSystem)
+{
+	if (m_dirtyCount == 0)
+	{
+		return;
+	}
+
+	TransformKernels::TRANSFORM_SOA transforms;
+	transforms.scaleX = &m_scaleX[0];
+	transforms.scaleY = &m_scaleY[0];
+	transforms.scaleZ = &m_scaleZ[0];
+	transforms.rotationDegreesX = &m_rotationDegreesX[0];
+	transforms.rotationDegreesY = &m_rotationDegreesY[0];
+	transforms.rotationDegreesZ = &m_rotationDegreesZ[0];
+	transforms.positionX = &m_positionX[0];
+	transforms.positionY = &m_positionY[0];
+	transforms.positionZ = &m_positionZ[0];
+
+	int rangeCount = m_lastDirty - m_firstDirty + 1;
+	if (m_dirtyCount * g_SparseDirtyRatio >= rangeCount)
+	{
+		int firstDirty = m_firstDirty;
+		int jobCount = (NULL != pJobSystem) ? (rangeCount / g_MinTransformsPerJob) : 0;
+		if (jobCount > 1)
+		{
+			pJobSystem->ParallelFor(jobCount, [this, &transforms, firstDirty, rangeCount, jobCount](int jobIndex)
+				{
+					int first = firstDirty + (int)((int64_t)rangeCount * jobIndex / jobCount);
+					int last = firstDirty + (int)((int64_t)rangeCount * (jobIndex + 1) / jobCount);
+					TransformKernels::ComposeModelMatrices(
+						transforms,
+						first,
+						last - first,
+						&m_modelMatrices[first][0][0]);
+				});
+		}
+		else
+		{
+			TransformKernels::ComposeModelMatrices(
+				transforms,
+				firstDirty,
+				rangeCount,
+				&m_modelMatrices[firstDirty][0][0]);
+		}
+		memset(&m_dirtyFlags[m_firstDirty], 0, rangeCount);
+		m_recomputeCount += rangeCount;
+	}
+	else
+	{
+		for (int i = m_firstDirty; i <= m_lastDirty; i++)
+		{
+			if (m_dirtyFlags[i] != 0)
+			{
+				TransformKernels::ComposeModelMatrices(
+					transforms,
+					i,
+					1,
+					&m_modelMatrices[i][0][0]);
+				m_dirtyFlags[i] = 0;
+				m_recomputeCount++;
+			}
+		}
+	}
+
+	m_firstDirty = 0;
+	m_lastDirty = -1;
+	m_dirtyCount = 0;
+}
+
+/***********************************************************
+ *  ComposeModelMatrix()
+ *
+ *  This method is used for building a model matrix from the
+ *  passed in transformation values.  The scale is applied
+ *  first, then the Z, Y and X rotations, then the position.
+ ***********************************************************/
+glm::mat4 TransformCache::ComposeModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 scale;
+	glm::mat4 rotationX;
+	glm::mat4 rotationY;
+	glm::mat4 rotationZ;
+	glm::mat4 translation;
+
+	// set the scale value in the transform buffer
+	scale = glm::scale(scaleXYZ);
+	// set the rotation values in the transform buffer
+	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+	// set the translation value in the transform buffer
+	translation = glm::translate(positionXYZ);
+
+	return(translation * rotationX * rotationY * rotationZ * scale);
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformcache.h
+// ============
+// cache the model matrices of the scene objects between frames
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class JobSystem;
+
+/***********************************************************
+ *  TransformCache
+ *
+ *  This class stores the scale, rotation and position of
+ *  every scene object together with its model matrix.  A
+ *  model matrix is only recomputed after the values it is
+ *  built from have changed.
+ ***********************************************************/
+class TransformCache
+{
+public:
+	// constructor
+	TransformCache();
+
+	// remove all the transforms
+	void Clear();
+	// add a transform and get its index
+	int AddTransform(
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegreesXYZ,
+		glm::vec3 positionXYZ);
+	// change the values of an existing transform
+	void SetTransform(
+		int index,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegreesXYZ,
+		glm::vec3 positionXYZ);
+
+	// recompute the model matrices of the changed transforms,
+	// in jobs of the job system when one is passed in
+	void Update(JobSystem* pJobSystem);
+
+	// get the number of transforms
+	int GetCount() const { return (int)m_modelMatrices.size(); }
+	// get the cached model matrix, valid after Update()
+	const glm::mat4& GetModelMatrix(int index) const { return m_modelMatrices[index]; }
+	// get the number of model matrices computed so far
+	unsigned int GetRecomputeCount() const { return m_recomputeCount; }
+
+	// build a model matrix from scale, rotation and position
+	// with glm, the reference the kernels are checked against
+	static glm::mat4 ComposeModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+private:
+	// values the model matrices are built from, one array per
+	// component so that batches of them can be loaded at once
+	std::vector<float> m_scaleX;
+	std::vector<float> m_scaleY;
+	std::vector<float> m_scaleZ;
+	std::vector<float> m_rotationDegreesX;
+	std::vector<float> m_rotationDegreesY;
+	std::vector<float> m_rotationDegreesZ;
+	std::vector<float> m_positionX;
+	std::vector<float> m_positionY;
+	std::vector<float> m_positionZ;
+	// cached model matrices
+	std::vector<glm::mat4> m_modelMatrices;
+	// set for transforms whose model matrix is out of date
+	std::vector<unsigned char> m_dirtyFlags;
+	// range of indices holding dirty transforms, empty when
+	// the first index is past the last one
+	int m_firstDirty;
+	int m_lastDirty;
+	// number of dirty transforms inside the dirty range
+	int m_dirtyCount;
+	// total number of model matrices computed
+	unsigned int m_recomputeCount;
+
+	// flag a transform as needing its model matrix rebuilt
+	void MarkDirty(int index);
+	// store the values of one transform
+	void StoreValues(
+		int index,
+		glm::vec3 scaleXYZ,
+		glm::vec3 rotationDegreesXYZ,
+		glm::vec3 positionXYZ);
+};
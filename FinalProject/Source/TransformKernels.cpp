@@ -0,0 +1,466 @@
+#include "TransformKernels.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define TRANSFORM_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC allows AVX2 intrinsics in any function
+#define KERNEL_TARGET_AVX2
+#else
+#include <cpuid.h>
+// GCC and Clang need AVX2 code generation enabled per function
+#define KERNEL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// declaration of global variables
+namespace
+{
+	const float g_DegreesToRadians = 0.017453292519943295f;
+
+	// pi/2 split into three parts for exact range reduction
+	const float g_HalfPiPart1 = 1.5703125f;
+	const float g_HalfPiPart2 = 4.837512969970703125e-4f;
+	const float g_HalfPiPart3 = 7.54978995489188216e-8f;
+	const float g_TwoOverPi = 0.63661977236758134f;
+
+	// minimax polynomial coefficients for sin and cos on [-pi/4, pi/4]
+	const float g_SinCoefficient1 = -1.6666654611e-1f;
+	const float g_SinCoefficient2 = 8.3321608736e-3f;
+	const float g_SinCoefficient3 = -1.9515295891e-4f;
+	const float g_CosCoefficient1 = 4.166664568298827e-2f;
+	const float g_CosCoefficient2 = -1.388731625493765e-3f;
+	const float g_CosCoefficient3 = 2.443315711809948e-5f;
+
+	const char* const g_KernelNames[TransformKernels::KERNEL_COUNT] =
+	{
+		"scalar",
+		"sse",
+		"avx2"
+	};
+
+	/***********************************************************
+	 *  ComposeScalar()
+	 *
+	 *  Build the model matrices one object at a time.  This is
+	 *  used on processors without SSE and for the objects left
+	 *  over after the last full SIMD batch.
+	 ***********************************************************/
+	void ComposeScalar(
+		const TransformKernels::TRANSFORM_SOA& t,
+		int first,
+		int count,
+		float* out)
+	{
+		for (int i = first; i < first + count; i++, out += 16)
+		{
+			float cx = std::cos(t.rotationDegreesX[i] * g_DegreesToRadians);
+			float sx = std::sin(t.rotationDegreesX[i] * g_DegreesToRadians);
+			float cy = std::cos(t.rotationDegreesY[i] * g_DegreesToRadians);
+			float sy = std::sin(t.rotationDegreesY[i] * g_DegreesToRadians);
+			float cz = std::cos(t.rotationDegreesZ[i] * g_DegreesToRadians);
+			float sz = std::sin(t.rotationDegreesZ[i] * g_DegreesToRadians);
+
+			// rotation X * Y * Z, each column scaled by its axis
+			out[0] = cy * cz * t.scaleX[i];
+			out[1] = (cx * sz + sx * sy * cz) * t.scaleX[i];
+			out[2] = (sx * sz - cx * sy * cz) * t.scaleX[i];
+			out[3] = 0.0f;
+			out[4] = -cy * sz * t.scaleY[i];
+			out[5] = (cx * cz - sx * sy * sz) * t.scaleY[i];
+			out[6] = (sx * cz + cx * sy * sz) * t.scaleY[i];
+			out[7] = 0.0f;
+			out[8] = sy * t.scaleZ[i];
+			out[9] = -sx * cy * t.scaleZ[i];
+			out[10] = cx * cy * t.scaleZ[i];
+			out[11] = 0.0f;
+			// translation
+			out[12] = t.positionX[i];
+			out[13] = t.positionY[i];
+			out[14] = t.positionZ[i];
+			out[15] = 1.0f;
+		}
+	}
+
+#ifdef TRANSFORM_KERNELS_X86
+	/***********************************************************
+	 *  SinCosSSE()
+	 *
+	 *  Compute the sine and cosine of four angles in degrees.
+	 ***********************************************************/
+	inline void SinCosSSE(__m128 degrees, __m128& sinOut, __m128& cosOut)
+	{
+		__m128 x = _mm_mul_ps(degrees, _mm_set1_ps(g_DegreesToRadians));
+
+		// reduce to [-pi/4, pi/4] and remember the quadrant
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(g_TwoOverPi)));
+		__m128 q = _mm_cvtepi32_ps(quadrant);
+		x = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(g_HalfPiPart1)));
+		x = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(g_HalfPiPart2)));
+		x = _mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(g_HalfPiPart3)));
+
+		__m128 x2 = _mm_mul_ps(x, x);
+		__m128 s = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(g_SinCoefficient3)), _mm_set1_ps(g_SinCoefficient2));
+		s = _mm_add_ps(_mm_mul_ps(s, x2), _mm_set1_ps(g_SinCoefficient1));
+		s = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(s, x2), x), x);
+		__m128 c = _mm_add_ps(_mm_mul_ps(x2, _mm_set1_ps(g_CosCoefficient3)), _mm_set1_ps(g_CosCoefficient2));
+		c = _mm_add_ps(_mm_mul_ps(c, x2), _mm_set1_ps(g_CosCoefficient1));
+		c = _mm_mul_ps(_mm_mul_ps(c, x2), x2);
+		c = _mm_add_ps(_mm_sub_ps(c, _mm_mul_ps(x2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+		// odd quadrants swap sine and cosine, then fix the signs
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(
+			_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+		__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+
+		sinOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+		cosOut = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+	}
+
+	/***********************************************************
+	 *  StoreColumnsSSE()
+	 *
+	 *  Transpose one matrix column of four objects, held as one
+	 *  register per component, and store it into each matrix.
+	 ***********************************************************/
+	inline void StoreColumnsSSE(__m128 x, __m128 y, __m128 z, __m128 w, float* out, int column)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(out + column * 4, x);
+		_mm_storeu_ps(out + 16 + column * 4, y);
+		_mm_storeu_ps(out + 32 + column * 4, z);
+		_mm_storeu_ps(out + 48 + column * 4, w);
+	}
+
+	/***********************************************************
+	 *  ComposeSSE()
+	 *
+	 *  Build the model matrices four objects at a time.
+	 ***********************************************************/
+	void ComposeSSE(
+		const TransformKernels::TRANSFORM_SOA& t,
+		int first,
+		int count,
+		float* out)
+	{
+		int i = first;
+		for (; i + 4 <= first + count; i += 4, out += 64)
+		{
+			__m128 sx, cx, sy, cy, sz, cz;
+			SinCosSSE(_mm_loadu_ps(t.rotationDegreesX + i), sx, cx);
+			SinCosSSE(_mm_loadu_ps(t.rotationDegreesY + i), sy, cy);
+			SinCosSSE(_mm_loadu_ps(t.rotationDegreesZ + i), sz, cz);
+
+			__m128 scaleX = _mm_loadu_ps(t.scaleX + i);
+			__m128 scaleY = _mm_loadu_ps(t.scaleY + i);
+			__m128 scaleZ = _mm_loadu_ps(t.scaleZ + i);
+			__m128 sxsy = _mm_mul_ps(sx, sy);
+			__m128 cxsy = _mm_mul_ps(cx, sy);
+			__m128 zero = _mm_setzero_ps();
+
+			StoreColumnsSSE(
+				_mm_mul_ps(_mm_mul_ps(cy, cz), scaleX),
+				_mm_mul_ps(_mm_add_ps(_mm_mul_ps(cx, sz), _mm_mul_ps(sxsy, cz)), scaleX),
+				_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sx, sz), _mm_mul_ps(cxsy, cz)), scaleX),
+				zero, out, 0);
+			StoreColumnsSSE(
+				_mm_mul_ps(_mm_sub_ps(zero, _mm_mul_ps(cy, sz)), scaleY),
+				_mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cx, cz), _mm_mul_ps(sxsy, sz)), scaleY),
+				_mm_mul_ps(_mm_add_ps(_mm_mul_ps(sx, cz), _mm_mul_ps(cxsy, sz)), scaleY),
+				zero, out, 1);
+			StoreColumnsSSE(
+				_mm_mul_ps(sy, scaleZ),
+				_mm_mul_ps(_mm_sub_ps(zero, _mm_mul_ps(sx, cy)), scaleZ),
+				_mm_mul_ps(_mm_mul_ps(cx, cy), scaleZ),
+				zero, out, 2);
+			StoreColumnsSSE(
+				_mm_loadu_ps(t.positionX + i),
+				_mm_loadu_ps(t.positionY + i),
+				_mm_loadu_ps(t.positionZ + i),
+				_mm_set1_ps(1.0f), out, 3);
+		}
+
+		ComposeScalar(t, i, first + count - i, out);
+	}
+
+	/***********************************************************
+	 *  SinCosAVX2()
+	 *
+	 *  Compute the sine and cosine of eight angles in degrees.
+	 ***********************************************************/
+	KERNEL_TARGET_AVX2 inline void SinCosAVX2(__m256 degrees, __m256& sinOut, __m256& cosOut)
+	{
+		__m256 x = _mm256_mul_ps(degrees, _mm256_set1_ps(g_DegreesToRadians));
+
+		// reduce to [-pi/4, pi/4] and remember the quadrant
+		__m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(g_TwoOverPi)));
+		__m256 q = _mm256_cvtepi32_ps(quadrant);
+		x = _mm256_sub_ps(x, _mm256_mul_ps(q, _mm256_set1_ps(g_HalfPiPart1)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(q, _mm256_set1_ps(g_HalfPiPart2)));
+		x = _mm256_sub_ps(x, _mm256_mul_ps(q, _mm256_set1_ps(g_HalfPiPart3)));
+
+		__m256 x2 = _mm256_mul_ps(x, x);
+		__m256 s = _mm256_add_ps(_mm256_mul_ps(x2, _mm256_set1_ps(g_SinCoefficient3)), _mm256_set1_ps(g_SinCoefficient2));
+		s = _mm256_add_ps(_mm256_mul_ps(s, x2), _mm256_set1_ps(g_SinCoefficient1));
+		s = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(s, x2), x), x);
+		__m256 c = _mm256_add_ps(_mm256_mul_ps(x2, _mm256_set1_ps(g_CosCoefficient3)), _mm256_set1_ps(g_CosCoefficient2));
+		c = _mm256_add_ps(_mm256_mul_ps(c, x2), _mm256_set1_ps(g_CosCoefficient1));
+		c = _mm256_mul_ps(_mm256_mul_ps(c, x2), x2);
+		c = _mm256_add_ps(_mm256_sub_ps(c, _mm256_mul_ps(x2, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+		// odd quadrants swap sine and cosine, then fix the signs
+		__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+			_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+		__m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+			_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+		__m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(
+			_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+
+		sinOut = _mm256_xor_ps(_mm256_blendv_ps(s, c, swap), sinSign);
+		cosOut = _mm256_xor_ps(_mm256_blendv_ps(c, s, swap), cosSign);
+	}
+
+	/***********************************************************
+	 *  StoreColumnsAVX2()
+	 *
+	 *  Transpose one matrix column of eight objects, held as one
+	 *  register per component, and store it into each matrix.
+	 ***********************************************************/
+	KERNEL_TARGET_AVX2 inline void StoreColumnsAVX2(__m256 x, __m256 y, __m256 z, __m256 w, float* out, int column)
+	{
+		StoreColumnsSSE(
+			_mm256_castps256_ps128(x),
+			_mm256_castps256_ps128(y),
+			_mm256_castps256_ps128(z),
+			_mm256_castps256_ps128(w),
+			out, column);
+		StoreColumnsSSE(
+			_mm256_extractf128_ps(x, 1),
+			_mm256_extractf128_ps(y, 1),
+			_mm256_extractf128_ps(z, 1),
+			_mm256_extractf128_ps(w, 1),
+			out + 64, column);
+	}
+
+	/***********************************************************
+	 *  ComposeAVX2()
+	 *
+	 *  Build the model matrices eight objects at a time.
+	 ***********************************************************/
+	KERNEL_TARGET_AVX2 void ComposeAVX2(
+		const TransformKernels::TRANSFORM_SOA& t,
+		int first,
+		int count,
+		float* out)
+	{
+		int i = first;
+		for (; i + 8 <= first + count; i += 8, out += 128)
+		{
+			__m256 sx, cx, sy, cy, sz, cz;
+			SinCosAVX2(_mm256_loadu_ps(t.rotationDegreesX + i), sx, cx);
+			SinCosAVX2(_mm256_loadu_ps(t.rotationDegreesY + i), sy, cy);
+			SinCosAVX2(_mm256_loadu_ps(t.rotationDegreesZ + i), sz, cz);
+
+			__m256 scaleX = _mm256_loadu_ps(t.scaleX + i);
+			__m256 scaleY = _mm256_loadu_ps(t.scaleY + i);
+			__m256 scaleZ = _mm256_loadu_ps(t.scaleZ + i);
+			__m256 sxsy = _mm256_mul_ps(sx, sy);
+			__m256 cxsy = _mm256_mul_ps(cx, sy);
+			__m256 zero = _mm256_setzero_ps();
+
+			StoreColumnsAVX2(
+				_mm256_mul_ps(_mm256_mul_ps(cy, cz), scaleX),
+				_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(cx, sz), _mm256_mul_ps(sxsy, cz)), scaleX),
+				_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sx, sz), _mm256_mul_ps(cxsy, cz)), scaleX),
+				zero, out, 0);
+			StoreColumnsAVX2(
+				_mm256_mul_ps(_mm256_sub_ps(zero, _mm256_mul_ps(cy, sz)), scaleY),
+				_mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cx, cz), _mm256_mul_ps(sxsy, sz)), scaleY),
+				_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(sx, cz), _mm256_mul_ps(cxsy, sz)), scaleY),
+				zero, out, 1);
+			StoreColumnsAVX2(
+				_mm256_mul_ps(sy, scaleZ),
+				_mm256_mul_ps(_mm256_sub_ps(zero, _mm256_mul_ps(sx, cy)), scaleZ),
+				_mm256_mul_ps(_mm256_mul_ps(cx, cy), scaleZ),
+				zero, out, 2);
+			StoreColumnsAVX2(
+				_mm256_loadu_ps(t.positionX + i),
+				_mm256_loadu_ps(t.positionY + i),
+				_mm256_loadu_ps(t.positionZ + i),
+				_mm256_set1_ps(1.0f), out, 3);
+		}
+
+		// finish with the four-wide kernel and then one at a time
+		ComposeSSE(t, i, first + count - i, out);
+	}
+
+	/***********************************************************
+	 *  QueryCpuId()
+	 *
+	 *  Read a processor feature leaf into info[eax, ebx, ecx, edx].
+	 ***********************************************************/
+	void QueryCpuId(int leaf, int subLeaf, int info[4])
+	{
+#if defined(_MSC_VER)
+		__cpuidex(info, leaf, subLeaf);
+#else
+		unsigned int a = 0, b = 0, c = 0, d = 0;
+		__cpuid_count(leaf, subLeaf, a, b, c, d);
+		info[0] = (int)a;
+		info[1] = (int)b;
+		info[2] = (int)c;
+		info[3] = (int)d;
+#endif
+	}
+
+	/***********************************************************
+	 *  QueryEnabledRegisterState()
+	 *
+	 *  Read the register state the operating system saves on a
+	 *  context switch (XCR0).
+	 ***********************************************************/
+	unsigned long long QueryEnabledRegisterState()
+	{
+#if defined(_MSC_VER)
+		return(_xgetbv(0));
+#else
+		unsigned int low = 0, high = 0;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return(((unsigned long long)high << 32) | low);
+#endif
+	}
+
+	/***********************************************************
+	 *  DetectDefaultKernel()
+	 *
+	 *  Find the widest kernel that both the processor and the
+	 *  operating system support.
+	 ***********************************************************/
+	TransformKernels::KERNEL DetectDefaultKernel()
+	{
+		int info[4];
+		QueryCpuId(0, 0, info);
+		int maxLeaf = info[0];
+
+		QueryCpuId(1, 0, info);
+		bool bSSE2 = (info[3] & (1 << 26)) != 0;
+		bool bOSXSAVE = (info[2] & (1 << 27)) != 0;
+		bool bAVX = (info[2] & (1 << 28)) != 0;
+		if (bSSE2 == false)
+		{
+			return(TransformKernels::KERNEL_SCALAR);
+		}
+
+		// AVX registers are only usable when the OS saves them
+		if ((bOSXSAVE == true) && (bAVX == true) && (maxLeaf >= 7) &&
+			((QueryEnabledRegisterState() & 0x6) == 0x6))
+		{
+			QueryCpuId(7, 0, info);
+			if ((info[1] & (1 << 5)) != 0)
+			{
+				return(TransformKernels::KERNEL_AVX2);
+			}
+		}
+
+		return(TransformKernels::KERNEL_SSE);
+	}
+#endif
+}
+
+/***********************************************************
+ *  GetDefaultKernel()
+ *
+ *  This function is used for getting the fastest kernel the
+ *  processor supports.  The check is done on the first call.
+ ***********************************************************/
+TransformKernels::KERNEL TransformKernels::GetDefaultKernel()
+{
+#ifdef TRANSFORM_KERNELS_X86
+	static const KERNEL defaultKernel = DetectDefaultKernel();
+	return(defaultKernel);
+#else
+	return(KERNEL_SCALAR);
+#endif
+}
+
+/***********************************************************
+ *  IsKernelSupported()
+ *
+ *  This function is used for checking whether a kernel can
+ *  run on this processor.
+ ***********************************************************/
+bool TransformKernels::IsKernelSupported(KERNEL kernel)
+{
+	return((kernel >= KERNEL_SCALAR) && (kernel <= GetDefaultKernel()));
+}
+
+/***********************************************************
+ *  GetKernelName()
+ *
+ *  This function is used for getting the display name of a
+ *  kernel.
+ ***********************************************************/
+const char* TransformKernels::GetKernelName(KERNEL kernel)
+{
+	if ((kernel < KERNEL_SCALAR) || (kernel >= KERNEL_COUNT))
+	{
+		return("unknown");
+	}
+
+	return(g_KernelNames[kernel]);
+}
+
+/***********************************************************
+ *  ComposeModelMatrices()
+ *
+ *  This function is used for building the model matrices of
+ *  a range of objects with the fastest supported kernel.
+ ***********************************************************/
+void TransformKernels::ComposeModelMatrices(
+	const TRANSFORM_SOA& transforms,
+	int first,
+	int count,
+	float* outMatrices)
+{
+	ComposeModelMatrices(GetDefaultKernel(), transforms, first, count, outMatrices);
+}
+
+/***********************************************************
+ *  ComposeModelMatrices()
+ *
+ *  This function is used for building the model matrices of
+ *  a range of objects with the passed in kernel.
+ ***********************************************************/
+void TransformKernels::ComposeModelMatrices(
+	KERNEL kernel,
+	const TRANSFORM_SOA& transforms,
+	int first,
+	int count,
+	float* outMatrices)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	switch (kernel)
+	{
+#ifdef TRANSFORM_KERNELS_X86
+	case KERNEL_AVX2:
+		ComposeAVX2(transforms, first, count, outMatrices);
+		break;
+	case KERNEL_SSE:
+		ComposeSSE(transforms, first, count, outMatrices);
+		break;
+#endif
+	default:
+		ComposeScalar(transforms, first, count, outMatrices);
+		break;
+	}
+}
@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformkernels.h
+// ============
+// compose many model matrices at once from structure-of-arrays inputs
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  TransformKernels
+ *
+ *  These functions build model matrices in the same order as
+ *  TransformCache::ComposeModelMatrix() - scale, then Z, Y and
+ *  X rotation, then translation - but write the combined
+ *  matrix directly in closed form.  Several objects are
+ *  processed per instruction with SSE or AVX2, picked at
+ *  runtime from what the processor supports.
+ ***********************************************************/
+namespace TransformKernels
+{
+	// instruction sets the kernels are implemented with
+	enum KERNEL
+	{
+		KERNEL_SCALAR = 0,
+		KERNEL_SSE,
+		KERNEL_AVX2,
+		KERNEL_COUNT
+	};
+
+	// transformation values for a batch of objects, one array
+	// per component, rotations in degrees
+	struct TRANSFORM_SOA
+	{
+		const float* scaleX;
+		const float* scaleY;
+		const float* scaleZ;
+		const float* rotationDegreesX;
+		const float* rotationDegreesY;
+		const float* rotationDegreesZ;
+		const float* positionX;
+		const float* positionY;
+		const float* positionZ;
+	};
+
+	// build the model matrices of the objects [first, first + count)
+	// into outMatrices, 16 column-major floats per object, using
+	// the fastest supported kernel
+	void ComposeModelMatrices(
+		const TRANSFORM_SOA& transforms,
+		int first,
+		int count,
+		float* outMatrices);
+
+	// same as above with an explicitly chosen kernel, which
+	// must be supported by the processor
+	void ComposeModelMatrices(
+		KERNEL kernel,
+		const TRANSFORM_SOA& transforms,
+		int first,
+		int count,
+		float* outMatrices);
+
+	// check whether the processor supports a kernel
+	bool IsKernelSupported(KERNEL kernel);
+	// get the kernel that is used by default
+	KERNEL GetDefaultKernel();
+	// get the display name of a kernel
+	const char* GetKernelName(KERNEL kernel);
+}
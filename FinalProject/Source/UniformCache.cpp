@@ -0,0 +1,148 @@
+#include "UniformCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// names of the uniforms in the scene shader, in UNIFORM_ID order
+	const char* const g_UniformNames[UniformCache::UNIFORM_COUNT] =
+	{
+		"objectTexture",
+		"bUseTexture",
+		"bUseLighting",
+		"UVscale",
+		"materialIndex",
+		"lightCount"
+	};
+}
+
+/***********************************************************
+ *  UniformCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+UniformCache::UniformCache()
+{
+	m_programID = 0;
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_uniforms[i].location = -1;
+		m_uniforms[i].bHasValue = false;
+	}
+	ResetCounters();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for resolving the locations of all
+ *  the scene uniforms in the shader program that is in use.
+ *  Uniforms the shader does not declare get location -1 and
+ *  are ignored when set.
+ ***********************************************************/
+bool UniformCache::Initialize()
+{
+	GLint programID = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &programID);
+	if (programID == 0)
+	{
+		std::cout << "Could not resolve uniforms: no shader program in use" << std::endl;
+		return(false);
+	}
+	m_programID = (GLuint)programID;
+
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_uniforms[i].location = glGetUniformLocation(m_programID, g_UniformNames[i]);
+	}
+
+	Invalidate();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting the remembered uniform
+ *  values, for when the shader program state was changed
+ *  outside of this cache.
+ ***********************************************************/
+void UniformCache::Invalidate()
+{
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_uniforms[i].bHasValue = false;
+	}
+}
+
+/***********************************************************
+ *  ResetCounters()
+ *
+ *  This method is used for restarting the upload counters.
+ ***********************************************************/
+void UniformCache::ResetCounters()
+{
+	m_uploadsIssued = 0;
+	m_uploadsSkipped = 0;
+}
+
+/***********************************************************
+ *  NeedsUpload()
+ *
+ *  This method is used for checking whether the passed in
+ *  value differs from the last one sent for the uniform.
+ *  When it does, the value is remembered and the upload is
+ *  counted, otherwise the skip is counted.
+ ***********************************************************/
+bool UniformCache::NeedsUpload(UNIFORM_ID id, const void* value, size_t size)
+{
+	UNIFORM_STATE& uniform = m_uniforms[id];
+	if (uniform.location < 0)
+	{
+		return(false);
+	}
+
+	if ((uniform.bHasValue == true) && (memcmp(uniform.value, value, size) == 0))
+	{
+		m_uploadsSkipped++;
+		return(false);
+	}
+
+	memcpy(uniform.value, value, size);
+	uniform.bHasValue = true;
+	m_uploadsIssued++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetInt()
+ *
+ *  This method is used for setting an integer, boolean or
+ *  sampler uniform.
+ ***********************************************************/
+void UniformCache::SetInt(UNIFORM_ID id, int value)
+{
+	if (NeedsUpload(id, &value, sizeof(value)))
+	{
+		glUniform1i(m_uniforms[id].location, value);
+	}
+}
+
+/***********************************************************
+ *  SetVec2()
+ *
+ *  This method is used for setting a vec2 uniform.
+ ***********************************************************/
+void UniformCache::SetVec2(UNIFORM_ID id, const glm::vec2& value)
+{
+	if (NeedsUpload(id, glm::value_ptr(value), sizeof(float) * 2))
+	{
+		glUniform2fv(m_uniforms[id].location, 1, glm::value_ptr(value));
+	}
+}
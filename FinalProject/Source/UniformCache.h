@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformcache.h
+// ============
+// upload shader uniforms by precomputed ID and skip unchanged values
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  UniformCache
+ *
+ *  This class resolves the locations of the scene shader
+ *  uniforms once, after the shaders are loaded, so they can
+ *  be set by ID instead of by name.  The last value sent for
+ *  every uniform is remembered and uploads of the same value
+ *  again are skipped.
+ ***********************************************************/
+class UniformCache
+{
+public:
+	// constructor
+	UniformCache();
+
+	// uniforms of the scene shader
+	enum UNIFORM_ID
+	{
+		UNIFORM_OBJECT_TEXTURE = 0,
+		UNIFORM_USE_TEXTURE,
+		UNIFORM_USE_LIGHTING,
+		UNIFORM_UV_SCALE,
+		UNIFORM_MATERIAL_INDEX,
+		UNIFORM_LIGHT_COUNT,
+		UNIFORM_COUNT
+	};
+
+	// resolve the uniform locations of the active shader program
+	bool Initialize();
+	// forget the remembered values so everything is sent again
+	void Invalidate();
+
+	// set uniform values by ID
+	void SetInt(UNIFORM_ID id, int value);
+	void SetVec2(UNIFORM_ID id, const glm::vec2& value);
+
+	// counters of uploads sent to OpenGL and skipped as unchanged
+	unsigned int GetUploadsIssued() const { return m_uploadsIssued; }
+	unsigned int GetUploadsSkipped() const { return m_uploadsSkipped; }
+	void ResetCounters();
+
+private:
+	// resolved location and last sent value of a uniform
+	struct UNIFORM_STATE
+	{
+		GLint location;
+		bool bHasValue;
+		float value[2];
+	};
+
+	// shader program the locations were resolved for
+	GLuint m_programID;
+	// state of every uniform, indexed by ID
+	UNIFORM_STATE m_uniforms[UNIFORM_COUNT];
+	// upload counters
+	unsigned int m_uploadsIssued;
+	unsigned int m_uploadsSkipped;
+
+	// check whether a value needs to be uploaded, remembering
+	// it when it does
+	bool NeedsUpload(UNIFORM_ID id, const void* value, size_t size);
+};
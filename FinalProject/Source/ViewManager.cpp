@@ -1,5 +1,6 @@
 
 #include "ViewManager.h"
+#include "Profiler.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
@@ -23,9 +24,6 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f;
-	float gLastFrame = 0.0f;
 	float cameraSpeed = 4.1f; // add the camera speed
 
 
@@ -45,12 +43,17 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_bPickButtonDown = false;
+	m_aspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.5f, 5.5f, 10.0f);
 	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
+	m_previousCamera = GetCameraState();
 }
 
 ViewManager::~ViewManager()
@@ -80,7 +83,7 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 		NULL, NULL);
 	if (window == NULL)
 	{
-		std::cout << "Failed to create GLFW window" << std::endl;
+		std::cout << "Failed to create GLFW window, OpenGL 4.4 or newer is required" << std::endl;
 		glfwTerminate();
 		return NULL;
 	}
@@ -96,13 +99,63 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// tell GLFW to capture all mouse events
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
+	InitializeWindow(window);
+
+	return(window);
+}
+
+/***********************************************************
+ *  CreateHeadlessWindow()
+ *
+ *  This method is used for creating a window that is never
+ *  shown, only for its OpenGL context.  The frames are
+ *  rendered into an offscreen framebuffer of the passed in
+ *  size instead.  An EGL context is tried first, which Mesa
+ *  can create without a display, then OSMesa.
+ ***********************************************************/
+GLFWwindow* ViewManager::CreateHeadlessWindow(const char* windowTitle, int width, int height)
+{
+	GLFWwindow* window = nullptr;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	const int contextAPIs[] = { GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API };
+	for (int contextAPI : contextAPIs)
+	{
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextAPI);
+		window = glfwCreateWindow(width, height, windowTitle, NULL, NULL);
+		if (window != NULL)
+		{
+			break;
+		}
+	}
+	if (window == NULL)
+	{
+		std::cout << "Failed to create headless GLFW window, OpenGL 4.4 or newer is required" << std::endl;
+		glfwTerminate();
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+
+	InitializeWindow(window);
+	m_aspectRatio = (float)width / (float)height;
+
+	return(window);
+}
+
+/***********************************************************
+ *  InitializeWindow()
+ *
+ *  This method is used for setting the OpenGL state every
+ *  created window starts with.
+ ***********************************************************/
+void ViewManager::InitializeWindow(GLFWwindow* window)
+{
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	m_pWindow = window;
-
-	return(window);
 }
 void scrollCallback(GLFWwindow* window, double xOffset, double yOffset)
 //when the scrollwheel is used this function will be called
@@ -136,7 +189,7 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 }
 
 
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::ProcessKeyboardEvents(float deltaTime)
 {
 	glm::mat4 projection;
 	// close the window if the escape key has been pressed
@@ -154,29 +207,29 @@ void ViewManager::ProcessKeyboardEvents()
 	// process camera zooming in and out
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime * cameraSpeed);
+		g_pCamera->ProcessKeyboard(FORWARD, deltaTime * cameraSpeed);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime * cameraSpeed);
+		g_pCamera->ProcessKeyboard(BACKWARD, deltaTime * cameraSpeed);
 	}
 
 	// process camera panning left and right
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime * cameraSpeed);
+		g_pCamera->ProcessKeyboard(LEFT, deltaTime * cameraSpeed);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime * cameraSpeed);
+		g_pCamera->ProcessKeyboard(RIGHT, deltaTime * cameraSpeed);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS) //move up 
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime * cameraSpeed);
+		g_pCamera->ProcessKeyboard(UP, deltaTime * cameraSpeed);
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS) //move down
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime * cameraSpeed);
+		g_pCamera->ProcessKeyboard(DOWN, deltaTime * cameraSpeed);
 	}
 
 	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS) //orthographic view
@@ -196,32 +249,84 @@ void ViewManager::ProcessKeyboardEvents()
 
 }
 
+/***********************************************************
+ *  GetCameraState()
+ *
+ *  This method is used for getting the parts of the current
+ *  camera a frame is drawn from.
+ ***********************************************************/
+ViewManager::CAMERA_STATE ViewManager::GetCameraState() const
+{
+	CAMERA_STATE state;
+	state.position = g_pCamera->Position;
+	state.front = g_pCamera->Front;
+	state.up = g_pCamera->Up;
+	state.zoom = g_pCamera->Zoom;
+
+	return(state);
+}
+
+/***********************************************************
+ *  UpdateCamera()
+ *
+ *  This method is used for moving the camera by one fixed
+ *  simulation step, keeping the camera from before the step
+ *  to draw the frames between the two.
+ ***********************************************************/
+void ViewManager::UpdateCamera(double timeStep)
+{
+	PROFILE_ZONE("UpdateCamera");
+
+	if (NULL == g_pCamera)
+	{
+		return;
+	}
+
+	m_previousCamera = GetCameraState();
+
+	// process any keyboard events that may be waiting in the 
+	// event queue
+	ProcessKeyboardEvents((float)timeStep);
+}
+
 /***********************************************************
  *  PrepareSceneView()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  rendering.  The camera is blended from its state before
+ *  the last simulation step to its current one, so motion
+ *  stays smooth when the frames and steps do not line up.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+void ViewManager::PrepareSceneView(float interpolation)
 {
+	PROFILE_GPU_ZONE("PrepareSceneView");
+
 	glm::mat4 view;
 	glm::mat4 projection;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
-
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	CAMERA_STATE current = GetCameraState();
+	float t = glm::clamp(interpolation, 0.0f, 1.0f);
+	glm::vec3 position = glm::mix(m_previousCamera.position, current.position, t);
+	glm::vec3 front = glm::mix(m_previousCamera.front, current.front, t);
+	glm::vec3 up = glm::mix(m_previousCamera.up, current.up, t);
+	float zoom = glm::mix(m_previousCamera.zoom, current.zoom, t);
+	// a camera turned fully around in one step has no direction
+	// halfway, so it is drawn where it is
+	if ((glm::length(front) < 0.0001f) || (glm::length(up) < 0.0001f))
+	{
+		position = current.position;
+		front = current.front;
+		up = current.up;
+	}
 
 	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	view = glm::lookAt(position, position + front, up);
+	m_viewMatrix = view;
 
 	// define the current projection matrix
-	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	projection = glm::perspective(glm::radians(zoom), m_aspectRatio, 0.1f, 100.0f);
+	m_projectionMatrix = projection;
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
@@ -231,6 +336,78 @@ void ViewManager::PrepareSceneView()
 		// set the view matrix into the shader for proper rendering
 		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
 		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		m_pShaderManager->setVec3Value("viewPosition", position);
 	}
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *  GetPickRay()
+ *
+ *  This method is used for getting the ray from the camera
+ *  through the mouse cursor, once for every press of the
+ *  left mouse button.  The cursor is moved from window to
+ *  clip coordinates and back through the view and projection
+ *  matrices of the last prepared frame.
+ ***********************************************************/
+bool ViewManager::GetPickRay(glm::vec3& origin, glm::vec3& direction)
+{
+	if (NULL == m_pWindow)
+	{
+		return(false);
+	}
+
+	bool bButtonDown = (glfwGetMouseButton(m_pWindow, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS);
+	bool bPressed = (bButtonDown == true) && (m_bPickButtonDown == false);
+	m_bPickButtonDown = bButtonDown;
+	if (bPressed == false)
+	{
+		return(false);
+	}
+
+	double cursorX = 0.0;
+	double cursorY = 0.0;
+	int windowWidth = 0;
+	int windowHeight = 0;
+	glfwGetCursorPos(m_pWindow, &cursorX, &cursorY);
+	glfwGetWindowSize(m_pWindow, &windowWidth, &windowHeight);
+	if ((windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return(false);
+	}
+
+	// window y grows downwards, clip space y upwards
+	float clipX = (float)(2.0 * cursorX / windowWidth - 1.0);
+	float clipY = (float)(1.0 - 2.0 * cursorY / windowHeight);
+
+	glm::mat4 inverseViewProjection = glm::inverse(m_projectionMatrix * m_viewMatrix);
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(clipX, clipY, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(clipX, clipY, 1.0f, 1.0f);
+	nearPoint /= nearPoint.w;
+	farPoint /= farPoint.w;
+
+	origin = glm::vec3(nearPoint);
+	direction = glm::normalize(glm::vec3(farPoint) - glm::vec3(nearPoint));
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetCameraPose()
+ *
+ *  This method is used for placing the camera, such as for
+ *  following a camera path when rendering headless.
+ ***********************************************************/
+void ViewManager::SetCameraPose(const glm::vec3& position, const glm::vec3& target)
+{
+	if (NULL == g_pCamera)
+	{
+		return;
+	}
+
+	g_pCamera->Position = position;
+	g_pCamera->Front = glm::normalize(target - position);
+	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+
+	// a placed camera is not blended from where it was
+	m_previousCamera = GetCameraState();
+}
@@ -32,14 +32,57 @@ private:
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices of the last prepared frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// whether the left mouse button was down last frame
+	bool m_bPickButtonDown;
+	// width divided by height of the rendered frames
+	float m_aspectRatio;
 
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	// the parts of the camera a frame is drawn from
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+	};
+	// camera before the last simulation step, frames are drawn
+	// between it and the current camera
+	CAMERA_STATE m_previousCamera;
+
+	// get the current state of the camera
+	CAMERA_STATE GetCameraState() const;
+
+	// set up a newly created window and its OpenGL context
+	void InitializeWindow(GLFWwindow* window);
+
+	// process keyboard events for interaction with the 3D scene,
+	// moving the camera for the passed in time in seconds
+	void ProcessKeyboardEvents(float deltaTime);
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// create a hidden window for its OpenGL context only, for
+	// rendering frames of the passed in size offscreen
+	GLFWwindow* CreateHeadlessWindow(const char* windowTitle, int width, int height);
 	
-	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
+	// move the camera by one simulation step of the passed in
+	// time in seconds
+	void UpdateCamera(double timeStep);
+	// prepare the conversion from 3D object display to 2D scene display,
+	// with the camera the passed in fraction of the way from its
+	// state before the last simulation step to its current one
+	void PrepareSceneView(float interpolation);
+
+	// get the view and projection matrices of the last prepared frame
+	const glm::mat4& GetViewMatrix() const { return m_viewMatrix; }
+	const glm::mat4& GetProjectionMatrix() const { return m_projectionMatrix; }
+	// get the ray from the camera through the mouse cursor when
+	// the left mouse button was just pressed
+	bool GetPickRay(glm::vec3& origin, glm::vec3& direction);
+	// place the camera at a position, looking at a target
+	void SetCameraPose(const glm::vec3& position, const glm::vec3& target);
 };
\ No newline at end of file